@@ -17,9 +17,11 @@
 #include "database/database_viewer.h"
 #include "database/bill_transaction_database.h"
 #include "managers/print_manager.h"
+#include "managers/receipt_builder.h"
 #include "managers/tft_screen_manager.h"
 #include "managers/sdcard_manager.h"
 #include "managers/keypad_manager.h"
+#include "managers/serial_rx_manager.h"
 #include "configuration/logo.h"
 #include "managers/sync_manager.h"
 #include "components/battery_display.h"
@@ -217,6 +219,7 @@ static void showBootScreen() {
   tft.println(F("[CHK] Printer..."));
 
   // Initialize Printer
+  printerSerial.setTxBufferSize(PRINTER_TX_BUFFER_SIZE);
   printerSerial.begin(PRINTER_BAUD, SERIAL_8N1, PRINTER_RX, PRINTER_TX);
   printer.begin();
   printer.wake();
@@ -255,9 +258,11 @@ static void showBootScreen() {
 
 
 void setup() {
+  Serial.setRxBufferSize(SERIAL_RX_BUFFER_SIZE); // must precede begin(); lines are framed by the RX task
   Serial.begin(SERIAL_BAUD);
-  Serial.setRxBufferSize(262144); // 256KB for large JSON payloads
-  Serial.setTimeout(30000); // 30 seconds timeout for long transmissions
+  if (!startSerialRx()) {
+    Serial.println(F("Serial RX task failed to start"));
+  }
   
   // Initialize TFT Backlight
   pinMode(TFT_BLK, OUTPUT);
@@ -283,6 +288,14 @@ void setup() {
   // Initialize Readings database (time offset + readings log)
   initReadingsDatabase();
 
+  // Compile the receipt layout (SD template or the built-in one)
+  initReceiptTemplate();
+
+  // Printer task; receipts are queued from here on
+  if (!startPrintQueue()) {
+    Serial.println(F("Print queue failed to start"));
+  }
+
   // Initialize Device Info (about/last sync/print count)
   Serial.println(F("\n[SETUP] Checking for old test file..."));
   if (SD.exists(DEVICE_INFO_FILE)) {
@@ -384,22 +397,29 @@ void loop() {
   if (key) {
     handleKeypadInput(key);
   }
+  printQueueStatusTick(currentState != STATE_MENU);
   
   // ===== SERIAL INPUT =====
-  if (Serial.available()) {
-    String raw = Serial.readStringUntil('\n');
+  linkIdleTick();
+  penaltyIdleTick();
+  String raw;
+  if (serialNextLine(raw)) {
     raw.trim();
+    linkNoteInput();
 
     // Check for DROPDB command first (local command, not sync)
     if (raw == "DROPDB") {
       Serial.println(F("Dropping and recreating the database..."));
       if (db) {
+        upsertReleaseStatements();
         // Drop all tables
         const char* dropTables[] = {
           "DROP TABLE IF EXISTS bill_transactions;",
           "DROP TABLE IF EXISTS bills;",
           "DROP TABLE IF EXISTS readings;",
+          "DROP TABLE IF EXISTS usage_history;",
           "DROP TABLE IF EXISTS customers;",
+          "DROP TABLE IF EXISTS tariff_tiers;",
           "DROP TABLE IF EXISTS customer_types;",
           "DROP TABLE IF EXISTS deductions;",
           "DROP TABLE IF EXISTS barangay_sequence;",
@@ -410,6 +430,12 @@ void loop() {
         for (int i = 0; dropTables[i] != NULL; i++) {
           sqlite3_exec(db, dropTables[i], NULL, NULL, NULL);
         }
+        // A new database: no digests, a new db_id, no id blocks and no
+        // applied sync chunks of the old one
+        sqlite3_exec(db, "DELETE FROM table_digests;", NULL, NULL, NULL);
+        sqlite3_exec(db, "DELETE FROM sync_counters WHERE name = 'db_id';", NULL, NULL, NULL);
+        sqlite3_exec(db, "DELETE FROM id_leases;", NULL, NULL, NULL);
+        forgetSyncSessions();
         
         Serial.println(F("All tables dropped."));
         
@@ -442,6 +468,8 @@ void loop() {
       Serial.println(F("Dropping readings table..."));
       if (db) {
         sqlite3_exec(db, "DROP TABLE IF EXISTS readings;", NULL, NULL, NULL);
+        sqlite3_exec(db, "DROP TABLE IF EXISTS usage_history;", NULL, NULL, NULL);
+        dropTableDigest("readings");
         readings.clear();
         Serial.println(F("Readings table dropped."));
       } else {
@@ -454,6 +482,7 @@ void loop() {
       Serial.println(F("Dropping bills table..."));
       if (db) {
         sqlite3_exec(db, "DROP TABLE IF EXISTS bills;", NULL, NULL, NULL);
+        dropTableDigest("bills");
         bills.clear();
         Serial.println(F("Bills table dropped."));
       } else {
@@ -466,6 +495,7 @@ void loop() {
       Serial.println(F("Dropping bill_transactions table..."));
       if (db) {
         sqlite3_exec(db, "DROP TABLE IF EXISTS bill_transactions;", NULL, NULL, NULL);
+        dropTableDigest("bill_transactions");
         Serial.println(F("Bill transactions table dropped."));
       } else {
         Serial.println(F("Database not open."));
@@ -517,7 +547,6 @@ void loop() {
       Serial.println(F("Printing sample bill..."));
       displayBillOnTFT();
       printBill();
-      Serial.println(F("Print complete."));
     } 
     else if (cmd == "D" || cmd == "DISPLAY") {
       Serial.println(F("Displaying sample bill on TFT..."));
@@ -576,204 +605,23 @@ void loop() {
 
 // ===== THERMAL PRINTER FUNCTIONS =====
 
+// Queues currentBill like the keypad's D does
 void printBill() {
-  printer.wake();
-  printer.setDefault();
-  YIELD_WDT();
-
-  unsigned long used = currentBill.currReading - currentBill.prevReading;
-  float total = currentBill.total;
-
-  customFeed(1);
-  YIELD_WDT();
-
-  printer.justify('C');
-  // printer.printBitmap(LOGO_WIDTH, LOGO_HEIGHT, logo);
-  // YIELD_WDT();  // 🚨 REQUIRED
-
-  // customFeed(1);
-  printer.println(F("[PLACEHOLDER]"));
-  printer.println(F(""));
-  YIELD_WDT();
-
-  printer.setSize('S');
-  printer.println(F("DONA JOSEFA M. BULU-AN CAPARAN"));
-  printer.println(F("Water & Sanitation Assoc."));
-  printer.println(F("Bulu-an, IPIL, Zambo. Sibugay"));
-  printer.println(F("TIN: 464-252-005-000"));
-  printer.println(F(""));
-  printer.println(F("--------------------------------"));
-  printer.boldOn();
-  printer.println(F("STATEMENT OF ACCOUNT"));
-  printer.boldOff();
-  printer.println(F("--------------------------------"));
-  YIELD_WDT();
-
-  printer.justify('L');
-  // Ref No and Date/Time
-  printer.print(F("Ref No       : "));
-  printer.println(F("REF123456"));  // Placeholder, can be dynamic
-  printer.print(F("Date/Time    : "));
-  printer.println(currentBill.readingDateTime);
-  printer.println(F("--------------------------------"));
-  YIELD_WDT();
-
-  // Customer info
-  printer.print(F("Customer : "));
-  printer.println(currentBill.customerName);
-  printer.print(F("Account  : "));
-  printer.println(currentBill.accountNo);
-  printer.print(F("Classification: "));
-  printer.println(currentBill.customerType);
-  printer.print(F("Address  : "));
-  printer.println(currentBill.address);
-  printer.print(F("Barangay : "));
-  printer.println(F("Makilas"));
-  printer.println(F("--------------------------------"));
-  YIELD_WDT();
-
-  // Collector
-  printer.justify('C');
-  printer.println(F("Collector"));
-  printer.println(currentBill.collector);
-  printer.println(F(""));
-  YIELD_WDT();
-  printer.println(F("--------------------------------"));
-  YIELD_WDT();
-
-  // Period covered
-  printer.justify('C');
-  printer.boldOn();
-  printer.println(F("Period Covered"));
-  printer.boldOff();
-  printer.println(getPeriodCovered());
-  printer.println(F(""));
-  YIELD_WDT();
-
-  // Meter readings
-  printer.justify('C');
-  printer.boldOn();
-  printer.println(F("METER READINGS"));
-  printer.boldOff();
-  // Replicate Python alignment: center in fields of 10,12,10
-  String prevStr = String(currentBill.prevReading);
-  String presStr = String(currentBill.currReading);
-  String usageStr = String(used);
-  String header_cols = centerString("Prev", 10) + centerString("Present", 12) + centerString("Usage", 10);
-  String values_cols = centerString(prevStr, 10) + centerString(presStr, 12) + centerString(usageStr, 10);
-  printer.println(header_cols);
-  printer.println(values_cols);
-  printer.println(F("--------------------------------"));
-  YIELD_WDT();
-// %10lu%8lu%7lu
-  // Rate , deduction & Penalty
-  printer.justify('C');
-  printer.boldOn();
-  printer.println(F("BILLING"));
-  printer.boldOff();
-  printer.println(F(""));
-  YIELD_WDT();
-  printer.justify('L');
-  printer.print(F("Rate/m3  : PHP "));
-  printer.println(currentBill.rate, 2);
-  printer.print(F("Water Charge : PHP "));
-  printer.println(currentBill.subtotal, 2);
-  if (currentBill.deductions > 0) {
-    printer.print(currentBill.deductionName);
-    printer.print(F(" : PHP -"));
-    printer.println(currentBill.deductions, 2);
-  }
-  if (currentBill.penalty > 0) {
-    printer.print(F("Penalty  : PHP "));
-    printer.println(currentBill.penalty, 2);
+  if (!queueBillPrint(currentBill)) {
+    Serial.println(F("Print queue full"));
   }
-  printer.println(F(""));
-  printer.println(F("================================"));
-  YIELD_WDT();
-
-  // Total
-  printer.justify('C');
-  printer.setSize('M');
-  printer.boldOn();
-  printer.println(F("*** TOTAL AMOUNT DUE ***"));
-  printer.setSize('L');
-  printer.print(F("PHP "));
-  printer.println(total, 2);
-  printer.boldOff();
-  printer.setSize('S');
-  printer.println(F("================================"));
-  YIELD_WDT();
-
-  // Due and Disconnect dates
-  printer.println(F(""));
-  printer.justify('L');
-  printer.boldOn();
-  printer.print(F("Due Date     : "));
-  printer.println(currentBill.dueDate);
-  printer.print(F("Disconnection Date: "));
-  printer.println(F("Feb 10, 2026"));  // Placeholder
-  printer.boldOff();
-  printer.println(F("--------------------------------"));
-  YIELD_WDT();
-
-  // Reminders
-  printer.println(F(""));
-  printer.println(F("REMAINDERS:"));
-  printer.println(F("- Please pay by the due date to avoid disconnection."));
-  printer.println(F("- Bring this bill when paying."));
-  printer.println(F("- For inquiries, contact the office."));
- 
-  YIELD_WDT();
-
-  // Footer
-  printer.justify('C');
-  printer.println(F(""));
-  printer.println(F("Please pay on or before due date"));
-  printer.println(F("to avoid penalties."));
-  printer.println(F(""));
-  printer.println(F("Thank you!"));
-  printer.println(F("Save Water, Save Life!"));
-  printer.justify('L');
-  YIELD_WDT();
-
-  customFeed(4);
-  YIELD_WDT();
-
-  vTaskDelay(pdMS_TO_TICKS(500)); // ✅ replace delay()
 }
 
-String getPeriodCovered() {
-  String dateStr = __DATE__;
-  String monthStr = dateStr.substring(0,3);
-  String yearStr = dateStr.substring(7,11); // Full year
-  String months[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
-  int monthIndex = -1;
-  for(int i = 0; i < 12; i++) {
-    if(months[i] == monthStr) {
-      monthIndex = i;
-      break;
-    }
-  }
-  if(monthIndex == -1) return "Unknown Period";
-  int nextMonthIndex = (monthIndex + 1) % 12;
-  String nextMonthStr = months[nextMonthIndex];
-  String nextYearStr = (nextMonthIndex == 0) ? String(yearStr.toInt() + 1) : yearStr;
-  return monthStr + " " + yearStr + " - " + nextMonthStr + " " + nextYearStr;
-}
-void customFeed(int lines) {
-  for (int i = 0; i < lines; i++) {
-    printer.write(0x0A);
-  }
-}
+// Runs on the printer task (print_manager.h)
+void printReceiptJob(const PrintJob& job) {
+  uint32_t start = millis();
+  printer.wake();
+  sendReceipt(printerSerial, job.receipt);
+  printerSerial.flush();  // last byte out of the FIFO
 
-String centerString(String s, int width) {
-  int len = s.length();
-  int totalPad = width - len;
-  int leftPad = totalPad / 2;
-  int rightPad = totalPad - leftPad;
-  String result = "";
-  for (int i = 0; i < leftPad; i++) result += " ";
-  result += s;
-  for (int i = 0; i < rightPad; i++) result += " ";
-  return result;
+  // Let the paper catch up before the next job
+  uint32_t elapsed = millis() - start;
+  if (elapsed < job.estimateMs) {
+    vTaskDelay(pdMS_TO_TICKS(job.estimateMs - elapsed));
+  }
 }
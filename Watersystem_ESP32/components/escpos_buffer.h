@@ -0,0 +1,172 @@
+#ifndef ESCPOS_BUFFER_H
+#define ESCPOS_BUFFER_H
+
+#include <Arduino.h>
+#include "../configuration/money.h"
+
+// ===== ESC/POS BUFFER =====
+// A receipt rendered into one fixed byte buffer, with the commands
+// Adafruit_Thermal would send for the same calls (justify, setSize, bold
+// through the ESC ! print mode, line feeds), so the whole job can go to
+// the printer UART in a single write. Nothing here allocates; a receipt
+// longer than ESCPOS_BUFFER_SIZE sets `overflow` and is cut short.
+//
+// measureDots() reads the finished job back the way the printer lays it
+// out (32 or 16 columns, lines wrap) for the print time estimate in
+// receipt_builder.h. Every command written here is three bytes, which is
+// what it relies on.
+
+#define ESCPOS_BUFFER_SIZE 2048
+
+#define ESCPOS_ESC 0x1B
+#define ESCPOS_GS  0x1D
+#define ESCPOS_LF  0x0A
+
+#define ESCPOS_MODE_BOLD 0x08
+
+struct EscPosBuffer {
+  uint8_t data[ESCPOS_BUFFER_SIZE];
+  size_t len = 0;
+  bool overflow = false;
+
+  uint8_t printMode = 0;    // ESC ! bits
+
+  void clear() {
+    len = 0;
+    overflow = false;
+    printMode = 0;
+  }
+
+  void raw(const uint8_t* bytes, size_t n) {
+    if (len + n > sizeof(data)) {
+      n = sizeof(data) - len;
+      overflow = true;
+    }
+    memcpy(data + len, bytes, n);
+    len += n;
+  }
+
+  void command(uint8_t a, uint8_t b, uint8_t c) {
+    uint8_t bytes[3] = {a, b, c};
+    raw(bytes, sizeof(bytes));
+  }
+
+  // Printable text; other control bytes (a stray ESC in a customer name)
+  // become spaces, so text can never turn into a command
+  void text(const char* s, size_t n) {
+    size_t start = 0;
+    for (size_t i = 0; i < n; i++) {
+      if ((uint8_t)s[i] >= 0x20) continue;
+      raw((const uint8_t*)s + start, i - start);
+      uint8_t space = ' ';
+      raw(&space, 1);
+      start = i + 1;
+    }
+    raw((const uint8_t*)s + start, n - start);
+  }
+
+  void text(const char* s) { text(s, strlen(s)); }
+
+  void line(const char* s = "") {
+    text(s);
+    feed(1);
+  }
+
+  void number(unsigned long value) {
+    char buf[12];
+    int n = snprintf(buf, sizeof(buf), "%lu", value);
+    text(buf, (size_t)n);
+  }
+
+  void money(Money amount) {
+    char buf[MONEY_BUF_SIZE];
+    size_t n = amount.format(buf, sizeof(buf));
+    text(buf, n);
+  }
+
+  // `s` padded to `width` columns: '<' left, '>' right, '^' centered
+  // with the extra space on the right; longer text is not cut
+  void field(const char* s, size_t n, char align, int width) {
+    static const char spaces[] = "                                ";
+    int pad = width > (int)n ? width - (int)n : 0;
+    if (pad > (int)sizeof(spaces) - 1) pad = sizeof(spaces) - 1;
+    int left = align == '>' ? pad : (align == '^' ? pad / 2 : 0);
+    text(spaces, (size_t)left);
+    text(s, n);
+    text(spaces, (size_t)(pad - left));
+  }
+
+  void feed(int lines) {
+    uint8_t lf = ESCPOS_LF;
+    for (int i = 0; i < lines; i++) raw(&lf, 1);
+  }
+
+  // 'L', 'C' or 'R'
+  void justify(char value) {
+    uint8_t pos = value == 'C' || value == 'c' ? 1 : (value == 'R' || value == 'r' ? 2 : 0);
+    command(ESCPOS_ESC, 'a', pos);
+  }
+
+  // 'S', 'M' (double height) or 'L' (double height and width), as Adafruit_Thermal::setSize
+  void size(char value) {
+    uint8_t gs = value == 'L' || value == 'l' ? 0x11 : (value == 'M' || value == 'm' ? 0x01 : 0x00);
+    command(ESCPOS_GS, '!', gs);
+  }
+
+  void bold(bool on) {
+    printMode = on ? (printMode | ESCPOS_MODE_BOLD) : (printMode & ~ESCPOS_MODE_BOLD);
+    command(ESCPOS_ESC, '!', printMode);
+  }
+
+  void lineHeight(uint8_t dotsPerLine) {
+    if (dotsPerLine < 24) dotsPerLine = 24;
+    command(ESCPOS_ESC, '3', dotsPerLine);
+  }
+
+  // What Adafruit_Thermal::setDefault() sends: online, left, no inverse,
+  // plain print mode, 30-dot lines, no underline, small text, charset and
+  // code page 0
+  void defaults() {
+    command(ESCPOS_ESC, '=', 1);
+    justify('L');
+    command(ESCPOS_GS, 'B', 0);
+    printMode = 0;
+    command(ESCPOS_ESC, '!', 0);
+    lineHeight(30);
+    command(ESCPOS_ESC, '-', 0);
+    size('S');
+    command(ESCPOS_ESC, 'R', 0);
+    command(ESCPOS_ESC, 't', 0);
+  }
+
+  // Paper the job advances, in dots
+  uint32_t measureDots() const {
+    uint32_t dots = 0;
+    uint8_t charHeight = 24, lineSpacing = 6, maxColumn = 32, column = 0;
+    for (size_t i = 0; i < len; i++) {
+      uint8_t c = data[i];
+      if ((c == ESCPOS_ESC || c == ESCPOS_GS) && i + 2 < len) {
+        uint8_t op = data[i + 1], arg = data[i + 2];
+        if (c == ESCPOS_GS && op == '!') {
+          charHeight = arg & 0x0F ? 48 : 24;
+          maxColumn = arg & 0xF0 ? 16 : 32;
+        } else if (c == ESCPOS_ESC && op == '3') {
+          lineSpacing = arg - 24;
+        }
+        i += 2;
+      } else if (c == ESCPOS_LF) {
+        dots += charHeight + lineSpacing;
+        column = 0;
+      } else {
+        if (column == maxColumn) {  // the printer wraps by itself
+          dots += charHeight + lineSpacing;
+          column = 0;
+        }
+        column++;
+      }
+    }
+    return dots;
+  }
+};
+
+#endif // ESCPOS_BUFFER_H
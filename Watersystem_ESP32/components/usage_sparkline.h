@@ -0,0 +1,46 @@
+#ifndef USAGE_SPARKLINE_H
+#define USAGE_SPARKLINE_H
+
+#include "../configuration/config.h"
+#include "../database/usage_history.h"
+
+extern TFT_eSPI tft;
+
+#define USAGE_SPARKLINE_MONTHS 12
+
+// Bar per month for the newest USAGE_SPARKLINE_MONTHS of the history,
+// scaled to the highest month shown; the newest month in COLOR_AMOUNT,
+// months without a reading as a dot on the baseline. One fillRect per
+// month, so it draws in a few milliseconds.
+void drawUsageSparkline(int x, int y, int w, int h, const UsageHistory& history) {
+  tft.fillRect(x, y, w, h, COLOR_BG);
+  tft.drawFastHLine(x, y + h - 1, w, COLOR_LINE);
+  if (history.count == 0) return;
+
+  uint8_t months = history.count < USAGE_SPARKLINE_MONTHS ? history.count : USAGE_SPARKLINE_MONTHS;
+  uint8_t first = history.count - months;
+  uint32_t peak = 1;
+  for (uint8_t i = first; i < history.count; i++) {
+    if ((history.present & (1UL << i)) && history.usage[i] > peak) peak = history.usage[i];
+  }
+
+  // Newest month at the right edge
+  int slot = w / USAGE_SPARKLINE_MONTHS;
+  int barW = slot > 2 ? slot - 1 : 1;
+  int left = x + w - months * slot;
+  int maxH = h - 2;
+  for (uint8_t i = 0; i < months; i++) {
+    uint8_t idx = first + i;
+    int bx = left + i * slot;
+    if (!(history.present & (1UL << idx))) {
+      tft.drawPixel(bx + barW / 2, y + h - 2, COLOR_LABEL);
+      continue;
+    }
+    int barH = (int)((uint64_t)history.usage[idx] * maxH / peak);
+    if (barH < 1) barH = 1;
+    uint16_t color = idx == history.count - 1 ? COLOR_AMOUNT : COLOR_HEADER;
+    tft.fillRect(bx, y + h - 1 - barH, barW, barH, color);
+  }
+}
+
+#endif // USAGE_SPARKLINE_H
@@ -3,6 +3,8 @@
 
 // ===== SERIAL BAUD =====
 #define SERIAL_BAUD 115200
+#define SERIAL_RX_BUFFER_SIZE 16384   // UART driver buffer behind the RX task
+#define SERIAL_FRAME_MAX 32768        // longest command line (two frames are allocated)
 
 // ===== SERIAL LOGGING =====
 // 0 = minimal serial prints (recommended for Web Serial sync UI)
@@ -30,6 +32,9 @@
 #define PRINTER_RX  16   // ESP32 RX <- Printer TX
 #define PRINTER_TX  17   // ESP32 TX -> Printer RX
 #define PRINTER_BAUD 9600
+#define PRINTER_TX_BUFFER_SIZE 2048  // UART driver TX buffer, holds a whole receipt
+#define PRINTER_DOTS_PER_SEC 400     // paper speed, 50 mm/s at 8 dots/mm
+#define PRINT_QUEUE_DEPTH 4          // receipts rendered ahead of the printer
 
 // ===== 4x4 KEYPAD PINS (Direct Wiring) =====
 // Keypad pinout (left to right, keys facing you):
@@ -57,8 +62,14 @@
 #define DB_ASSETS       "/WATER_DB/ASSETS"
 #define DB_PATH         "/sd/watersystem.db"
 #define DEVICE_INFO_FILE "/WATER_DB/device_info.psv"
+#define RECEIPT_TEMPLATE_FILE "/WATER_DB/receipt_template.txt"
 #define YIELD_WDT() vTaskDelay(1)
 
+// ===== BILLING =====
+#define BILL_DUE_DAYS 15                    // due_date = bill_date + this
+#define BILL_DISCONNECT_DAYS 10             // disconnection date on the receipt = due_date + this
+#define CLOCK_VALID_EPOCH 1704067200L       // 2024-01-01; anything earlier means SET_TIME has not run
+
 #include <sqlite3.h>
 sqlite3 *db = nullptr;
 
@@ -0,0 +1,101 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <Arduino.h>
+#include <math.h>
+
+// ===== MONEY =====
+// Peso amounts as integer centavos. Bills, deductions and payments are
+// added and scaled in integers, so a device total is the same number the
+// server's DECIMAL(10,2) columns hold. REAL columns are converted once on
+// the way in (fromAmount) and formatted straight into a caller buffer on
+// the way out; nothing here allocates.
+
+#define MONEY_BUF_SIZE 24  // "-92233720368547758.08" + NUL
+
+struct Money {
+  int64_t centavos = 0;
+
+  static Money fromCentavos(int64_t centavos) {
+    Money m;
+    m.centavos = centavos;
+    return m;
+  }
+
+  // Rounds to the nearest centavo, halves away from zero like DECIMAL(10,2)
+  static Money fromAmount(double amount) {
+    return fromCentavos((int64_t)llround(amount * 100.0));
+  }
+
+  double toAmount() const { return centavos / 100.0; }
+
+  // `percent` of this amount (12.5 = 12.5%), to two decimals of a percent,
+  // rounded half away from zero
+  Money percent(double percent) const {
+    int64_t basisPoints = llround(percent * 100.0);
+    int64_t scaled = centavos * basisPoints;
+    int64_t half = scaled < 0 ? -5000 : 5000;
+    return fromCentavos((scaled + half) / 10000);
+  }
+
+  // "1234.50"; returns the length, or 0 when `size` is too small
+  size_t format(char* buf, size_t size) const {
+    char tmp[MONEY_BUF_SIZE];
+    char* p = tmp + sizeof(tmp);
+    uint64_t v = centavos < 0 ? (uint64_t)0 - (uint64_t)centavos : (uint64_t)centavos;
+    *--p = '0' + v % 10;
+    v /= 10;
+    *--p = '0' + v % 10;
+    v /= 10;
+    *--p = '.';
+    do {
+      *--p = '0' + v % 10;
+      v /= 10;
+    } while (v);
+    if (centavos < 0) *--p = '-';
+
+    size_t len = tmp + sizeof(tmp) - p;
+    if (len + 1 > size) {
+      if (size) buf[0] = '\0';
+      return 0;
+    }
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    return len;
+  }
+
+  Money operator+(Money other) const { return fromCentavos(centavos + other.centavos); }
+  Money operator-(Money other) const { return fromCentavos(centavos - other.centavos); }
+  Money operator-() const { return fromCentavos(-centavos); }
+  Money operator*(int64_t quantity) const { return fromCentavos(centavos * quantity); }
+  Money& operator+=(Money other) {
+    centavos += other.centavos;
+    return *this;
+  }
+  Money& operator-=(Money other) {
+    centavos -= other.centavos;
+    return *this;
+  }
+
+  bool operator==(Money other) const { return centavos == other.centavos; }
+  bool operator!=(Money other) const { return centavos != other.centavos; }
+  bool operator<(Money other) const { return centavos < other.centavos; }
+  bool operator>(Money other) const { return centavos > other.centavos; }
+  bool operator<=(Money other) const { return centavos <= other.centavos; }
+  bool operator>=(Money other) const { return centavos >= other.centavos; }
+  bool isZero() const { return centavos == 0; }
+};
+
+// Prints the amount on any Print (Serial, the TFT, the thermal printer)
+size_t printMoney(Print& out, Money amount) {
+  char buf[MONEY_BUF_SIZE];
+  size_t len = amount.format(buf, sizeof(buf));
+  return out.write((const uint8_t*)buf, len);
+}
+
+size_t printlnMoney(Print& out, Money amount) {
+  size_t n = printMoney(out, amount);
+  return n + out.println();
+}
+
+#endif // MONEY_H
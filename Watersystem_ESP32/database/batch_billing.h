@@ -0,0 +1,222 @@
+#ifndef BATCH_BILLING_H
+#define BATCH_BILLING_H
+
+#include "../configuration/config.h"
+#include "../configuration/money.h"
+#include "../managers/sync/sync_stats.h"
+#include "tariff_database.h"
+#include "deduction_database.h"
+#include "device_info.h"
+#include "id_leases.h"
+#include <sqlite3.h>
+
+// ===== BATCH BILLING =====
+// Bills every reading of a month that has none yet, without going through
+// generateBillForCustomer. Each chunk of readings is one INSERT ... SELECT
+// joining readings to customers, customer types and deductions, in its own
+// transaction. The charge and the deduction come from the same code as a
+// single bill through two SQL functions:
+//
+//   ws_tariff_charge(type_id, usage_m3)        centavos, NULL without a plan
+//   ws_deduction(centavos, type, value)        centavos
+//
+// Bill ids come from one block of the bills lease per chunk, sized to the
+// readings of the chunk that get a bill. When the lease cannot cover a
+// chunk the run stops there with NO_ID_LEASE; the chunks before it stay
+// committed and the rest is billed after the next sync. Reference numbers
+// are REF<yyyymm><reading_id, 6 digits>, unique because a reading gets one
+// bill.
+
+#define BATCH_BILL_CHUNK_ROWS 200
+
+struct BatchBillResult {
+  int64_t candidates = 0;
+  int64_t billed = 0;
+  uint32_t elapsedMs = 0;
+  const char* error = nullptr;  // DB_ERROR or NO_ID_LEASE when the run stopped
+};
+
+static void wsTariffChargeFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  Money charge;
+  int64_t usage = sqlite3_value_int64(argv[1]);
+  if (usage < 0 || !tariffCharge(sqlite3_value_int(argv[0]), (uint32_t)usage, charge)) {
+    sqlite3_result_null(ctx);
+    return;
+  }
+  sqlite3_result_int64(ctx, charge.centavos);
+}
+
+static void wsDeductionFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  Money base = Money::fromCentavos(sqlite3_value_int64(argv[0]));
+  const char* type = (const char*)sqlite3_value_text(argv[1]);
+  sqlite3_result_int64(ctx, applyDeduction(base, type, sqlite3_value_double(argv[2])).centavos);
+}
+
+// Readings of the period, not billed yet, whose customer has a type; ?1 is
+// the reading_id cursor, ?2 and ?3 the period as epoch seconds
+#define BATCH_BILL_CANDIDATES \
+  "FROM readings r JOIN customers c ON c.customer_id = r.customer_id " \
+  "JOIN customer_types t ON t.type_id = c.type_id " \
+  "WHERE r.reading_id > ?1 AND CAST(r.reading_at AS INTEGER) >= ?2 AND CAST(r.reading_at AS INTEGER) < ?3 " \
+  "AND NOT EXISTS (SELECT 1 FROM bills b WHERE b.reading_id = r.reading_id)"
+
+static const char* BATCH_BILL_COUNT_SQL =
+  "SELECT COUNT(*) " BATCH_BILL_CANDIDATES ";";
+
+// Next chunk: how many readings, the last reading_id and how many of them
+// have a charge (the rows the insert keeps), ?4 = chunk rows
+static const char* BATCH_BILL_BOUND_SQL =
+  "SELECT COUNT(*), MAX(reading_id), COALESCE(SUM(charge IS NOT NULL), 0) FROM "
+  "(SELECT r.reading_id, ws_tariff_charge(t.type_id, r.usage_m3) AS charge " BATCH_BILL_CANDIDATES
+  " ORDER BY r.reading_id LIMIT ?4);";
+
+// ?4 = last reading_id of the chunk, ?5 = first leased bill_id,
+// ?6 = yyyymm, ?7 = device uid, ?8 = days until due, 0 for no due date
+static const char* BATCH_BILL_INSERT_SQL =
+  "INSERT INTO bills (bill_id, reference_number, customer_id, reading_id, device_uid, bill_date, due_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at) "
+  "SELECT ?5 + row_number() OVER (ORDER BY reading_id) - 1, "
+  "'REF' || ?6 || printf('%06d', reading_id), customer_id, reading_id, ?7, date('now'), "
+  "CASE WHEN ?8 > 0 THEN date('now', '+' || ?8 || ' days') END, rate_per_m3, "
+  "charge / 100.0, 0, (charge - ws_deduction(charge, deduction_type, deduction_value)) / 100.0, 'Pending', datetime('now'), datetime('now') "
+  "FROM (SELECT r.reading_id, r.customer_id, t.rate_per_m3, ws_tariff_charge(t.type_id, r.usage_m3) AS charge, "
+  "d.type AS deduction_type, d.value AS deduction_value "
+  "FROM readings r JOIN customers c ON c.customer_id = r.customer_id "
+  "JOIN customer_types t ON t.type_id = c.type_id "
+  "LEFT JOIN deductions d ON d.deduction_id = c.deduction_id "
+  "WHERE r.reading_id > ?1 AND r.reading_id <= ?4 AND CAST(r.reading_at AS INTEGER) >= ?2 AND CAST(r.reading_at AS INTEGER) < ?3 "
+  "AND NOT EXISTS (SELECT 1 FROM bills b WHERE b.reading_id = r.reading_id)) "
+  "WHERE charge IS NOT NULL;";
+
+static void batchBillBindPeriod(sqlite3_stmt* stmt, int64_t cursor, int64_t from, int64_t to) {
+  sqlite3_bind_int64(stmt, 1, cursor);
+  sqlite3_bind_int64(stmt, 2, from);
+  sqlite3_bind_int64(stmt, 3, to);
+}
+
+// Epoch bounds of a "YYYY-MM" month; false when it is not one
+bool batchBillPeriodBounds(const String& period, int64_t& from, int64_t& to) {
+  if (period.length() != 7 || period[4] != '-') return false;
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "SELECT CAST(strftime('%s', ?1 || '-01') AS INTEGER), CAST(strftime('%s', ?1 || '-01', '+1 month') AS INTEGER);", -1, &stmt, NULL) != SQLITE_OK) {
+    return false;
+  }
+  sqlite3_bind_text(stmt, 1, period.c_str(), -1, SQLITE_TRANSIENT);
+  bool ok = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL;
+  if (ok) {
+    from = sqlite3_column_int64(stmt, 0);
+    to = sqlite3_column_int64(stmt, 1);
+  }
+  sqlite3_finalize(stmt);
+  return ok;
+}
+
+// Prints BATCH_BILL_PROGRESS after every chunk; false with result.error set
+// on a database error or a short lease, with the chunks committed so far kept
+bool runBatchBilling(int64_t from, int64_t to, const String& period, int chunkRows, BatchBillResult& result) {
+  uint32_t start = millis();
+  sqlite3_create_function(db, "ws_tariff_charge", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, wsTariffChargeFunc, NULL, NULL);
+  sqlite3_create_function(db, "ws_deduction", 3, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, wsDeductionFunc, NULL, NULL);
+  loadTariffsFromDB();
+
+  sqlite3_stmt* countStmt = nullptr;
+  sqlite3_stmt* boundStmt = nullptr;
+  sqlite3_stmt* insertStmt = nullptr;
+  if (sqlite3_prepare_v2(db, BATCH_BILL_COUNT_SQL, -1, &countStmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(db, BATCH_BILL_BOUND_SQL, -1, &boundStmt, NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2(db, BATCH_BILL_INSERT_SQL, -1, &insertStmt, NULL) != SQLITE_OK) {
+    Serial.print(F("Batch billing prepare failed: "));
+    Serial.println(sqlite3_errmsg(db));
+    sqlite3_finalize(countStmt);
+    sqlite3_finalize(boundStmt);
+    sqlite3_finalize(insertStmt);
+    result.error = "DB_ERROR";
+    return false;
+  }
+
+  batchBillBindPeriod(countStmt, 0, from, to);
+  if (sqlite3_step(countStmt) == SQLITE_ROW) result.candidates = sqlite3_column_int64(countStmt, 0);
+  sqlite3_finalize(countStmt);
+
+  Serial.printf("BEGIN_BATCH_BILL|%s|%lld\n", period.c_str(), (long long)result.candidates);
+
+  String yyyymm = period.substring(0, 4) + period.substring(5, 7);
+  String deviceUid = getDeviceUID();
+  int64_t cursor = 0;
+  int chunk = 0;
+  bool ok = true;
+
+  while (true) {
+    SyncStat stat;
+    uint32_t t0 = micros();
+
+    sqlite3_reset(boundStmt);
+    batchBillBindPeriod(boundStmt, cursor, from, to);
+    sqlite3_bind_int(boundStmt, 4, chunkRows);
+    int64_t rows = 0;
+    int64_t last = 0;
+    int64_t billable = 0;
+    if (sqlite3_step(boundStmt) == SQLITE_ROW) {
+      rows = sqlite3_column_int64(boundStmt, 0);
+      last = sqlite3_column_int64(boundStmt, 1);
+      billable = sqlite3_column_int64(boundStmt, 2);
+    }
+    if (rows == 0) break;
+    if (billable == 0) {
+      cursor = last;
+      continue;
+    }
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    int64_t firstId = allocateLeasedIds("bills", billable);
+    if (firstId == 0) {
+      sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+      result.error = "NO_ID_LEASE";
+      ok = false;
+      break;
+    }
+    sqlite3_reset(insertStmt);
+    batchBillBindPeriod(insertStmt, cursor, from, to);
+    sqlite3_bind_int64(insertStmt, 4, last);
+    sqlite3_bind_int64(insertStmt, 5, firstId);
+    sqlite3_bind_text(insertStmt, 6, yyyymm.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(insertStmt, 7, deviceUid.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(insertStmt, 8, time(NULL) < CLOCK_VALID_EPOCH ? 0 : BILL_DUE_DAYS);
+    if (sqlite3_step(insertStmt) != SQLITE_DONE) {
+      Serial.print(F("Batch billing insert failed: "));
+      Serial.println(sqlite3_errmsg(db));
+      sqlite3_reset(insertStmt);
+      sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+      result.error = "DB_ERROR";
+      ok = false;
+      break;
+    }
+    int billed = sqlite3_changes(db);
+    stat.sqlUs = micros() - t0;
+
+    t0 = micros();
+    if (sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+      Serial.print(F("Batch billing commit failed: "));
+      Serial.println(sqlite3_errmsg(db));
+      sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+      result.error = "DB_ERROR";
+      ok = false;
+      break;
+    }
+    stat.commitUs = micros() - t0;
+    stat.rows = billed;
+    syncStatRecord("BATCH", "BILLS", chunk, stat);
+
+    result.billed += billed;
+    cursor = last;
+    chunk++;
+    Serial.printf("BATCH_BILL_PROGRESS|%lld|%lld|%lu\n", (long long)result.billed, (long long)result.candidates, (unsigned long)(millis() - start));
+    YIELD_WDT();
+  }
+
+  sqlite3_finalize(boundStmt);
+  sqlite3_finalize(insertStmt);
+  result.elapsedMs = millis() - start;
+  return ok;
+}
+
+#endif // BATCH_BILLING_H
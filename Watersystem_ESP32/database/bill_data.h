@@ -0,0 +1,31 @@
+#ifndef BILL_DATA_H
+#define BILL_DATA_H
+
+#include <Arduino.h>
+#include "../configuration/money.h"
+
+// ===== BILL DATA STRUCTURE =====
+struct BillData {
+  String customerName;
+  String accountNo;
+  String address;
+  String collector;
+  String dueDate;
+  unsigned long prevReading;
+  unsigned long currReading;
+  Money rate;
+  Money penalty;
+  Money subtotal;
+  Money deductions;
+  Money total;
+  unsigned long usage;
+  String customerType;
+  Money minCharge;
+  unsigned long minM3;
+  String deductionName;
+  String readingDateTime;
+  String referenceNumber;
+  String barangay;
+};
+
+#endif // BILL_DATA_H
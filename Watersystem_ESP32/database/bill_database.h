@@ -2,10 +2,13 @@
 #define BILL_DATABASE_H
 
 #include "../configuration/config.h"
+#include "../configuration/money.h"
 #include "customers_database.h"
 #include "customer_type_database.h"
 #include "deduction_database.h"
 #include "device_info.h"
+#include "customer_context.h"
+#include "bill_data.h"
 #include <time.h>
 #include <SD.h>
 #include <vector>
@@ -13,36 +16,12 @@
 #include <ArduinoJson.h>
 
 // Forward declarations
-float calculateDeductions(float baseAmount, unsigned long deductionId);
-int getLastReadingIdForCustomer(int customerId);
+Money calculateDeductions(Money baseAmount, unsigned long deductionId);
 void updateCustomerPreviousReading(int customerId, unsigned long newPreviousReading);
-bool hasReadingThisMonth(int customerId);
 void updateExistingReading(int readingId, unsigned long currentReading, unsigned long usage);
 
 const int CURRENT_YEAR = 2026;
 
-// ===== BILL DATA STRUCTURE =====
-struct BillData {
-  String customerName;
-  String accountNo;
-  String address;
-  String collector;
-  String dueDate;
-  unsigned long prevReading;
-  unsigned long currReading;
-  float rate;
-  float penalty;
-  float subtotal;
-  float deductions;
-  float total;
-  unsigned long usage;
-  String customerType;
-  float minCharge;
-  unsigned long minM3;
-  String deductionName;
-  String readingDateTime;
-};
-
 // ===== BILL STRUCTURE FOR STORAGE =====
 struct Bill {
   int bill_id;
@@ -51,10 +30,11 @@ struct Bill {
   int reading_id;
   String device_uid;
   String bill_date;
-  float rate_per_m3;
-  float charges;
-  float penalty;
-  float total_due;
+  String due_date;  // empty: no due date, never penalized
+  Money rate_per_m3;
+  Money charges;
+  Money penalty;
+  Money total_due;
   String status;
   String created_at;
   String updated_at;
@@ -74,27 +54,28 @@ static int loadBillCallback(void *data, int argc, char **argv, char **azColName)
   b.reading_id = atoi(argv[3]);
   b.device_uid = argv[4];
   b.bill_date = argv[5];
-  b.rate_per_m3 = atof(argv[6]);
-  b.charges = atof(argv[7]);
-  b.penalty = atof(argv[8]);
-  b.total_due = atof(argv[9]);
+  b.rate_per_m3 = Money::fromAmount(atof(argv[6]));
+  b.charges = Money::fromAmount(atof(argv[7]));
+  b.penalty = Money::fromAmount(atof(argv[8]));
+  b.total_due = Money::fromAmount(atof(argv[9]));
   b.status = argv[10];
   b.created_at = argv[11];
   b.updated_at = argv[12];
+  b.due_date = argv[13] ? argv[13] : "";
   bills.push_back(b);
   return 0;
 }
 
 void loadBillsFromDB() {
   bills.clear();
-  const char *sql = "SELECT bill_id, reference_number, customer_id, reading_id, device_uid, bill_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at FROM bills;";
+  const char *sql = "SELECT bill_id, reference_number, customer_id, reading_id, device_uid, bill_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at, due_date FROM bills;";
   sqlite3_exec(db, sql, loadBillCallback, NULL, NULL);
 }
 
 std::vector<Bill> getBillsChunk(int offset, int limit) {
   std::vector<Bill> chunk;
   char sql[256];
-  sprintf(sql, "SELECT bill_id, reference_number, customer_id, reading_id, device_uid, bill_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at FROM bills ORDER BY bill_id LIMIT %d OFFSET %d;", limit, offset);
+  sprintf(sql, "SELECT bill_id, reference_number, customer_id, reading_id, device_uid, bill_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at, due_date FROM bills ORDER BY bill_id LIMIT %d OFFSET %d;", limit, offset);
   sqlite3_exec(db, sql, [](void *data, int argc, char **argv, char **azColName) -> int {
     std::vector<Bill>* chunk = static_cast<std::vector<Bill>*>(data);
     Bill b;
@@ -104,13 +85,14 @@ std::vector<Bill> getBillsChunk(int offset, int limit) {
     b.reading_id = atoi(argv[3]);
     b.device_uid = argv[4];
     b.bill_date = argv[5];
-    b.rate_per_m3 = atof(argv[6]);
-    b.charges = atof(argv[7]);
-    b.penalty = atof(argv[8]);
-    b.total_due = atof(argv[9]);
+    b.rate_per_m3 = Money::fromAmount(atof(argv[6]));
+    b.charges = Money::fromAmount(atof(argv[7]));
+    b.penalty = Money::fromAmount(atof(argv[8]));
+    b.total_due = Money::fromAmount(atof(argv[9]));
     b.status = argv[10];
     b.created_at = argv[11];
     b.updated_at = argv[12];
+    b.due_date = argv[13] ? argv[13] : "";
     chunk->push_back(b);
     return 0;
   }, &chunk, NULL);
@@ -157,8 +139,19 @@ bool saveBillToDB(Bill bill) {
   Serial.print(F("Saving bill for reading "));
   Serial.println(bill.reading_id);
   char sql[1024];
-  sprintf(sql, "INSERT INTO bills (reference_number, customer_id, reading_id, device_uid, bill_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at) VALUES ('%s', %d, %d, '%s', '%s', %f, %f, %f, %f, '%s', datetime('now'), datetime('now'));",
-          bill.reference_number.c_str(), bill.customer_id, bill.reading_id, bill.device_uid.c_str(), bill.bill_date.c_str(), bill.rate_per_m3, bill.charges, bill.penalty, bill.total_due, bill.status.c_str());
+  char rate[MONEY_BUF_SIZE], charges[MONEY_BUF_SIZE], penalty[MONEY_BUF_SIZE], totalDue[MONEY_BUF_SIZE];
+  bill.rate_per_m3.format(rate, sizeof(rate));
+  bill.charges.format(charges, sizeof(charges));
+  bill.penalty.format(penalty, sizeof(penalty));
+  bill.total_due.format(totalDue, sizeof(totalDue));
+  int64_t billId = allocateLeasedId("bills");
+  if (billId == 0) {
+    Serial.println(F("Bill not saved: no leased bill ids left, sync the device"));
+    return false;
+  }
+  String dueDate = bill.due_date.length() ? "'" + bill.due_date + "'" : String("NULL");
+  sprintf(sql, "INSERT INTO bills (bill_id, reference_number, customer_id, reading_id, device_uid, bill_date, due_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at) VALUES (%lld, '%s', %d, %d, '%s', '%s', %s, %s, %s, %s, %s, '%s', datetime('now'), datetime('now'));",
+          (long long)billId, bill.reference_number.c_str(), bill.customer_id, bill.reading_id, bill.device_uid.c_str(), bill.bill_date.c_str(), dueDate.c_str(), rate, charges, penalty, totalDue, bill.status.c_str());
   // Serial.println(sql);  // Commented out to save heap memory
   int rc = sqlite3_exec(db, sql, NULL, NULL, NULL);
   Serial.print(F("Bill save result: "));
@@ -183,53 +176,30 @@ int findBillByAccount(String accountNo) {
 }
 
 // ===== CALCULATE BILL AMOUNT =====
-float calculateBillAmount(unsigned long customerTypeId, unsigned long deductionId) {
+Money calculateBillAmount(unsigned long customerTypeId, unsigned long deductionId) {
   int typeIndex = findCustomerTypeById(customerTypeId);
-  if (typeIndex == -1) return 0.0;
+  if (typeIndex == -1) return Money();
   CustomerType* type = getCustomerTypeAt(typeIndex);
-  if (!type) return 0.0;
+  if (!type) return Money();
 
-  float baseAmount = type->min_charge; // Minimum charge
+  Money baseAmount = Money::fromAmount(type->min_charge); // Minimum charge
 
   // Apply deductions
-  float deductionAmount = calculateDeductions(baseAmount, deductionId);
+  Money deductionAmount = calculateDeductions(baseAmount, deductionId);
 
   return baseAmount - deductionAmount;
 }
 
 // ===== CALCULATE DEDUCTIONS =====
-float calculateDeductions(float baseAmount, unsigned long deductionId) {
-  if (deductionId == 0) return 0.0;
+Money calculateDeductions(Money baseAmount, unsigned long deductionId) {
+  if (deductionId == 0) return Money();
 
   int deductionIndex = findDeductionById(deductionId);
-  if (deductionIndex == -1) return 0.0;
+  if (deductionIndex == -1) return Money();
   Deduction* deduction = getDeductionAt(deductionIndex);
-  if (!deduction) return 0.0;
+  if (!deduction) return Money();
 
-  if (deduction->type == "percentage") {
-    return baseAmount * (deduction->value / 100.0);
-  } else if (deduction->type == "fixed") {
-    return deduction->value;
-  }
-  return 0.0;
-}
-
-// ===== GET LAST READING ID FOR CUSTOMER =====
-int getLastReadingIdForCustomer(int customerId) {
-  String query = "SELECT reading_id FROM readings WHERE customer_id = " + String(customerId) + " ORDER BY reading_id DESC LIMIT 1;";
-  sqlite3_stmt *stmt;
-  int rc = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, NULL);
-  if (rc != SQLITE_OK) {
-    Serial.printf("SQL error: %s\n", sqlite3_errmsg(db));
-    return 0;
-  }
-  
-  int readingId = 0;
-  if (sqlite3_step(stmt) == SQLITE_ROW) {
-    readingId = sqlite3_column_int(stmt, 0);
-  }
-  sqlite3_finalize(stmt);
-  return readingId;
+  return applyDeduction(baseAmount, deduction->type.c_str(), deduction->value);
 }
 
 // ===== UPDATE CUSTOMER PREVIOUS READING =====
@@ -238,163 +208,157 @@ void updateCustomerPreviousReading(int customerId, unsigned long newPreviousRead
   sqlite3_exec(db, query.c_str(), NULL, NULL, NULL);
 }
 
-// ===== CHECK IF CUSTOMER HAS READING THIS MONTH =====
-bool hasReadingThisMonth(int customerId) {
-  String query = "SELECT COUNT(*) FROM readings WHERE customer_id = " + String(customerId) + ";";
-  sqlite3_stmt *stmt;
-  int rc = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, NULL);
-  if (rc != SQLITE_OK) {
-    Serial.printf("SQL error: %s\n", sqlite3_errmsg(db));
-    return false;
-  }
-  
-  bool hasReading = false;
-  if (sqlite3_step(stmt) == SQLITE_ROW) {
-    hasReading = sqlite3_column_int(stmt, 0) > 0;
-  }
-  sqlite3_finalize(stmt);
-  return hasReading;
-}
-
 // ===== UPDATE EXISTING READING =====
 void updateExistingReading(int readingId, unsigned long currentReading, unsigned long usage) {
   String query = "UPDATE readings SET current_reading = " + String(currentReading) + ", usage_m3 = " + String(usage) + ", updated_at = datetime('now') WHERE reading_id = " + String(readingId) + ";";
   sqlite3_exec(db, query.c_str(), NULL, NULL, NULL);
 }
 
-// ===== GET EXISTING READING ID THIS MONTH =====
-int getExistingReadingIdThisMonth(int customerId) {
-  String query = "SELECT reading_id FROM readings WHERE customer_id = " + String(customerId) + " ORDER BY reading_id DESC LIMIT 1;";
-  sqlite3_stmt *stmt;
-  int rc = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, NULL);
-  if (rc != SQLITE_OK) {
-    Serial.printf("SQL error: %s\n", sqlite3_errmsg(db));
-    return 0;
-  }
-  
-  int readingId = 0;
-  if (sqlite3_step(stmt) == SQLITE_ROW) {
-    readingId = sqlite3_column_int(stmt, 0);
-  }
+// Stores the anomaly the reader confirmed, or clears it (NULL) for USAGE_OK
+void setReadingAnomaly(int readingId, UsageAnomaly anomaly) {
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "UPDATE readings SET anomaly = ?, updated_at = datetime('now') WHERE reading_id = ?;", -1, &stmt, NULL) != SQLITE_OK) return;
+  const char* name = usageAnomalyName(anomaly);
+  if (name) sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+  else sqlite3_bind_null(stmt, 1);
+  sqlite3_bind_int(stmt, 2, readingId);
+  sqlite3_step(stmt);
   sqlite3_finalize(stmt);
-  return readingId;
 }
 
-// ===== GET EXISTING READING DATA THIS MONTH =====
-bool getExistingReadingDataThisMonth(int customerId, unsigned long& prevReading, unsigned long& currReading, unsigned long& usage) {
-  String query = "SELECT previous_reading, current_reading, usage_m3 FROM readings WHERE customer_id = " + String(customerId) + " ORDER BY reading_id DESC LIMIT 1;";
-  sqlite3_stmt *stmt;
-  int rc = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, NULL);
-  if (rc != SQLITE_OK) {
-    Serial.printf("SQL error: %s\n", sqlite3_errmsg(db));
-    return false;
-  }
-  
-  bool found = false;
-  if (sqlite3_step(stmt) == SQLITE_ROW) {
-    prevReading = sqlite3_column_int(stmt, 0);
-    currReading = sqlite3_column_int(stmt, 1);
-    usage = sqlite3_column_int(stmt, 2);
-    found = true;
+// Reference number, penalty, total due and due date of the bill made for a
+// reading, as stored; false when there is none
+bool loadBillForReading(int readingId, BillData& out) {
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "SELECT reference_number, penalty, total_due, due_date FROM bills WHERE reading_id = ? LIMIT 1;", -1, &stmt, NULL) != SQLITE_OK) return false;
+  sqlite3_bind_int(stmt, 1, readingId);
+  bool found = sqlite3_step(stmt) == SQLITE_ROW;
+  if (found) {
+    const char* ref = (const char*)sqlite3_column_text(stmt, 0);
+    const char* due = (const char*)sqlite3_column_text(stmt, 3);
+    out.referenceNumber = ref ? ref : "";
+    out.penalty = Money::fromAmount(sqlite3_column_double(stmt, 1));
+    out.total = Money::fromAmount(sqlite3_column_double(stmt, 2));
+    out.dueDate = due && due[0] ? due : "-";
   }
   sqlite3_finalize(stmt);
   return found;
 }
 
 // ===== UPDATE EXISTING BILL =====
-void updateExistingBill(int customerId, int readingId, float charges, float totalDue, float rate) {
+void updateExistingBill(int customerId, int readingId, Money charges, Money totalDue, Money rate) {
   Serial.print(F("Updating bill for customer "));
   Serial.print(customerId);
   Serial.print(F(", reading "));
   Serial.println(readingId);
-  String query = "UPDATE bills SET charges = " + String(charges, 2) + ", total_due = " + String(totalDue, 2) + ", rate_per_m3 = " + String(rate, 2) + ", updated_at = datetime('now') WHERE customer_id = " + String(customerId) + " AND reading_id = " + String(readingId) + ";";
+  char chargesStr[MONEY_BUF_SIZE], totalStr[MONEY_BUF_SIZE], rateStr[MONEY_BUF_SIZE];
+  charges.format(chargesStr, sizeof(chargesStr));
+  totalDue.format(totalStr, sizeof(totalStr));
+  rate.format(rateStr, sizeof(rateStr));
+  char query[256];
+  // A penalty already applied stays on the bill
+  snprintf(query, sizeof(query), "UPDATE bills SET charges = %s, total_due = round(%s + COALESCE(penalty, 0), 2), rate_per_m3 = %s, updated_at = datetime('now') WHERE customer_id = %d AND reading_id = %d;",
+           chargesStr, totalStr, rateStr, customerId, readingId);
   // Serial.println(query);  // Commented out to save heap memory
-  sqlite3_exec(db, query.c_str(), NULL, NULL, NULL);
+  sqlite3_exec(db, query, NULL, NULL, NULL);
 }
 
-// ===== GENERATE BILL FOR CUSTOMER =====
-bool generateBillForCustomer(String accountNo, unsigned long currentReading) {
-  int customerIndex = findCustomerByAccount(accountNo);
-  if (customerIndex == -1) return false;
-  Customer* customer = getCustomerAt(customerIndex);
-  if (!customer) return false;
-
-  // Save old previous reading for display
-  unsigned long oldPreviousReading = customer->previous_reading;
-
-  // Calculate usage - this will be recalculated if existing reading
-  unsigned long usage = currentReading - customer->previous_reading;
-  if (usage <= 0) return false; // Invalid usage
+// ===== BILL DATES =====
+// Today (UTC, like datetime('now')) and today + BILL_DUE_DAYS. The due
+// date stays empty while the clock is unset, so such a bill is never
+// penalized against a 1970 due date.
+void billDatesToday(String& billDate, String& dueDate) {
+  time_t now = time(NULL);
+  char buf[11];
+  struct tm t;
+  gmtime_r(&now, &t);
+  strftime(buf, sizeof(buf), "%Y-%m-%d", &t);
+  billDate = buf;
+  dueDate = "";
+  if (now < CLOCK_VALID_EPOCH) return;
+  time_t due = now + (time_t)BILL_DUE_DAYS * 86400;
+  gmtime_r(&due, &t);
+  strftime(buf, sizeof(buf), "%Y-%m-%d", &t);
+  dueDate = buf;
+}
 
-  // Get customer type
-  int typeIndex = findCustomerTypeById(customer->type_id);
-  if (typeIndex == -1) return false;
-  CustomerType* customerType = getCustomerTypeAt(typeIndex);
-  if (!customerType) return false;
+// ===== GENERATE BILL FOR CONTEXT =====
+// Records the reading and its bill for a loaded customer context and fills
+// currentBill. Nothing is read from the database: the customer, type,
+// deduction and latest reading all come from `ctx`, which is updated to
+// the new reading so the flow can go round again.
+bool generateBillForContext(CustomerContext& ctx, unsigned long currentReading) {
+  if (!ctx.loaded || !ctx.hasType) return false;
+  Customer* customer = &ctx.customer;
+  const CustomerType* customerType = &ctx.type;
+
+  // A reading already taken this month is replaced, from its own previous reading
+  bool hasExistingReading = ctx.readingThisMonth;
+  unsigned long oldPreviousReading = contextPreviousReading(ctx);
+  if (currentReading <= oldPreviousReading) return false; // Invalid usage
+  unsigned long usage = currentReading - oldPreviousReading;
 
-  // Check if customer already has reading this month
-  bool hasExistingReading = hasReadingThisMonth(customer->customer_id);
   int readingId;
-  String readingAt = "datetime('now')"; // Use current database time
-
-  unsigned long existingCurrReading = 0;
-  unsigned long existingUsage = 0;
-
+  uint32_t readingEpoch = deviceEpochNow();
   if (hasExistingReading) {
     Serial.println(F("Updating existing reading..."));
-    // Get existing reading data
-    if (getExistingReadingDataThisMonth(customer->customer_id, oldPreviousReading, existingCurrReading, existingUsage)) {
-      Serial.print(F("Existing prev: "));
-      Serial.print(oldPreviousReading);
-      Serial.print(F(", curr: "));
-      Serial.println(existingCurrReading);
-    }
-    // Recalculate usage based on existing previous reading
-    usage = currentReading - oldPreviousReading;
-    Serial.print(F("New usage: "));
-    Serial.println(usage);
-    // Get reading ID first
-    readingId = getExistingReadingIdThisMonth(customer->customer_id);
+    Serial.print(F("Existing prev: "));
+    Serial.print(oldPreviousReading);
+    Serial.print(F(", curr: "));
+    Serial.println(ctx.readingCurrent);
+    readingId = ctx.readingId;
+    readingEpoch = ctx.readingAt;
     Serial.print(F("Reading ID to update: "));
     Serial.println(readingId);
-    // Update existing reading
     updateExistingReading(readingId, currentReading, usage);
   } else {
+    // Both ids come from the leases; without them the reading would be left with no bill
+    if (idLeaseRemaining("readings") < 1 || idLeaseRemaining("bills") < 1) {
+      Serial.println(F("No leased ids left for a new reading and bill, sync the device"));
+      return false;
+    }
     Serial.println(F("Creating new reading..."));
-    // Save new reading to database
-    saveReadingToDB(customer->customer_id, customer->previous_reading, currentReading, usage, readingAt);
-    // Get the reading ID (last inserted)
-    readingId = getLastReadingIdForCustomer(customer->customer_id);
+    if (!saveReadingToDB(customer->customer_id, oldPreviousReading, currentReading, usage, "datetime('now')")) return false;
+    readingId = (int)sqlite3_last_insert_rowid(db);
     Serial.print(F("New reading ID: "));
     Serial.println(readingId);
   }
-
-  // Calculate charges based on usage
-  float charges = 0.0;
-  if (usage <= customerType->min_m3) {
-    charges = customerType->min_charge;
-  } else {
-    charges = usage * customerType->rate_per_m3;
+  if (hasExistingReading || ctx.anomaly != USAGE_OK) setReadingAnomaly(readingId, ctx.anomaly);
+
+  // Calculate charges based on usage (see tariff_database.h)
+  Money rate = Money::fromAmount(customerType->rate_per_m3);
+  Money charges;
+  if (!tariffCharge(customerType->type_id, usage, charges)) {
+    // Plans not loaded yet; same rules without tiers
+    charges = usage <= customerType->min_m3 ? Money::fromAmount(customerType->min_charge) : rate * usage;
   }
 
   // Apply deductions
-  float deductionAmount = calculateDeductions(charges, customer->deduction_id);
-  float totalDue = charges - deductionAmount;
+  Money deductionAmount = ctx.hasDeduction ? applyDeduction(charges, ctx.deduction.type.c_str(), ctx.deduction.value) : Money();
+  Money totalDue = charges - deductionAmount;
 
   // Update existing bill for this reading if it exists
   if (hasExistingReading) {
-    updateExistingBill(customer->customer_id, readingId, charges, totalDue, customerType->rate_per_m3);
+    updateExistingBill(customer->customer_id, readingId, charges, totalDue, rate);
     Serial.println(F("Updated existing bill"));
   }
 
   // Update customer's previous reading
   updateCustomerPreviousReading(customer->customer_id, currentReading);
 
-  // Update in-memory customer previous reading
-  if (currentCustomer) {
+  // Keep the context and the keypad flow's customer in step with the database
+  customer->previous_reading = currentReading;
+  ctx.readingId = readingId;
+  ctx.readingPrevious = oldPreviousReading;
+  ctx.readingCurrent = currentReading;
+  ctx.readingUsage = usage;
+  ctx.readingAt = readingEpoch;
+  ctx.readingThisMonth = true;
+  usageHistoryRecord(ctx.history, usagePeriodOf(readingEpoch), usage);
+  saveUsageHistory(customer->customer_id, ctx.history);
+  if (currentCustomer && currentCustomer->customer_id == customer->customer_id) {
     currentCustomer->previous_reading = currentReading;
   }
-  if (!customer) return false;
 
   // Populate currentBill for display
   currentBill.customerName = customer->customer_name;
@@ -403,28 +367,29 @@ bool generateBillForCustomer(String accountNo, unsigned long currentReading) {
   currentBill.prevReading = oldPreviousReading;
   currentBill.currReading = currentReading;
   currentBill.usage = usage;
-  currentBill.rate = customerType->rate_per_m3;
-  currentBill.minCharge = customerType->min_charge;
+  currentBill.rate = rate;
+  currentBill.minCharge = Money::fromAmount(customerType->min_charge);
   currentBill.minM3 = customerType->min_m3;
   currentBill.customerType = customerType->type_name;
   currentBill.subtotal = charges;
   currentBill.deductions = deductionAmount;
   currentBill.total = totalDue;
-  currentBill.penalty = 0.0;
-  currentBill.subtotal = charges;
-  currentBill.dueDate = "2026-02-15"; // 30 days from now
+  currentBill.penalty = Money();
+  currentBill.deductionName = ctx.hasDeduction ? ctx.deduction.name : String();
+  String billDate, dueDate;
+  billDatesToday(billDate, dueDate);
+  currentBill.dueDate = dueDate.length() ? dueDate : String("-");
+  char readingAt[20];
+  time_t readingTime = (time_t)readingEpoch;
+  struct tm t;
+  localtime_r(&readingTime, &t);
+  strftime(readingAt, sizeof(readingAt), "%Y-%m-%d %H:%M", &t);
   currentBill.readingDateTime = readingAt;
-
-  // Get deduction name if any
-  if (customer->deduction_id > 0) {
-    int dedIndex = findDeductionById(customer->deduction_id);
-    if (dedIndex != -1) {
-      Deduction* ded = getDeductionAt(dedIndex);
-      if (ded) {
-        currentBill.deductionName = ded->name;
-      }
-    }
-  }
+  currentBill.barangay = ctx.barangay;
+  currentBill.referenceNumber = String();
+  // A re-read keeps the bill it already has: its penalty, due date and the
+  // total updateExistingBill() just stored
+  if (hasExistingReading) loadBillForReading(readingId, currentBill);
 
   // Only create new bill if this is a new reading
   if (!hasExistingReading) {
@@ -432,13 +397,15 @@ bool generateBillForCustomer(String accountNo, unsigned long currentReading) {
     // Create bill record
     Bill bill;
     bill.reference_number = generateBillReferenceNumber(customer->account_no);
+    currentBill.referenceNumber = bill.reference_number;
     bill.customer_id = customer->customer_id;
     bill.reading_id = readingId;
     bill.device_uid = getDeviceUID();
-    bill.bill_date = "2026-01-19";
-    bill.rate_per_m3 = customerType->rate_per_m3;
+    bill.bill_date = billDate;
+    bill.due_date = dueDate;
+    bill.rate_per_m3 = rate;
     bill.charges = charges;
-    bill.penalty = 0.0;
+    bill.penalty = Money();
     bill.total_due = totalDue;
     bill.status = "Pending";
 
@@ -460,4 +427,11 @@ bool generateBillForCustomer(String accountNo, unsigned long currentReading) {
   return true; // Successfully updated existing reading/bill
 }
 
+// ===== GENERATE BILL FOR CUSTOMER =====
+bool generateBillForCustomer(String accountNo, unsigned long currentReading) {
+  CustomerContext ctx;
+  if (!loadCustomerContext(accountNo, ctx)) return false;
+  return generateBillForContext(ctx, currentReading);
+}
+
 #endif  // BILL_DATABASE_H
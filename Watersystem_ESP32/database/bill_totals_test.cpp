@@ -0,0 +1,60 @@
+// Host test: bill totals against database/bill_totals_golden.txt, the table
+// the server's Bill::applyPenalty() is tested with. Deductions are taken the
+// way applyDeduction() takes them, the penalty is added the way the penalty
+// run adds it (REAL columns, round(..., 2)). From Watersystem_ESP32/:
+//
+//   g++ -std=c++17 -I. -Ihost_test database/bill_totals_test.cpp -lsqlite3 -o /tmp/bill_totals_test && /tmp/bill_totals_test
+
+#include "../configuration/config.h"
+#include "../configuration/money.h"
+
+static bool sameAmount(Money amount, const char* expected) {
+  char buf[MONEY_BUF_SIZE];
+  amount.format(buf, sizeof(buf));
+  return strcmp(buf, expected) == 0;
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "database/bill_totals_golden.txt";
+  FILE* golden = fopen(path, "r");
+  if (!golden) {
+    printf("cannot open %s\n", path);
+    return 2;
+  }
+
+  sqlite3_open(":memory:", &db);
+  sqlite3_stmt* penaltyStmt;
+  sqlite3_prepare_v2(db, "SELECT printf('%.2f', round(? + ?, 2));", -1, &penaltyStmt, NULL);
+
+  char line[256];
+  int cases = 0;
+  int failed = 0;
+  while (fgets(line, sizeof(line), golden)) {
+    char charges[24], type[16], deduction[24], total[24], penalty[24], totalWithPenalty[24];
+    double value;
+    if (line[0] == '#' || sscanf(line, "%23s %15s %lf %23s %23s %23s %23s", charges, type, &value, deduction, total, penalty, totalWithPenalty) != 7) continue;
+    cases++;
+
+    Money base = Money::fromAmount(atof(charges));
+    Money taken = strcmp(type, "percentage") == 0 ? base.percent(value)
+                  : strcmp(type, "fixed") == 0    ? Money::fromAmount(value)
+                                                  : Money();
+    Money due = base - taken;
+
+    sqlite3_reset(penaltyStmt);
+    sqlite3_bind_double(penaltyStmt, 1, due.toAmount());
+    sqlite3_bind_double(penaltyStmt, 2, atof(penalty));
+    const char* penalized = sqlite3_step(penaltyStmt) == SQLITE_ROW ? (const char*)sqlite3_column_text(penaltyStmt, 0) : "";
+
+    if (!sameAmount(taken, deduction) || !sameAmount(due, total) || strcmp(penalized, totalWithPenalty) != 0) {
+      printf("FAIL %s", line);
+      failed++;
+    }
+  }
+  fclose(golden);
+  sqlite3_finalize(penaltyStmt);
+  sqlite3_close(db);
+
+  printf("%d cases, %d failed\n", cases, failed);
+  return failed ? 1 : 0;
+}
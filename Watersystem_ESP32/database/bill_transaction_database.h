@@ -2,6 +2,7 @@
 #define BILL_TRANSACTION_DATABASE_H
 
 #include "../configuration/config.h"
+#include "../configuration/money.h"
 #include "database_manager.h"
 #include <vector>
 #include <ArduinoJson.h>
@@ -13,9 +14,9 @@ struct BillTransaction {
   String bill_reference_number;
   String type;
   String source;
-  float amount;
-  float cash_received;
-  float change;
+  Money amount;
+  Money cash_received;
+  Money change;
   String transaction_date;
   String payment_method;
   String processed_by_device_uid;
@@ -34,9 +35,9 @@ static int loadBillTransactionCallback(void *data, int argc, char **argv, char *
   bt.bill_reference_number = argv[2];
   bt.type = argv[3];
   bt.source = argv[4];
-  bt.amount = atof(argv[5]);
-  bt.cash_received = atof(argv[6]);
-  bt.change = atof(argv[7]);
+  bt.amount = Money::fromAmount(atof(argv[5]));
+  bt.cash_received = Money::fromAmount(atof(argv[6]));
+  bt.change = Money::fromAmount(atof(argv[7]));
   bt.transaction_date = argv[8];
   bt.payment_method = argv[9];
   bt.processed_by_device_uid = argv[10];
@@ -66,9 +67,9 @@ std::vector<BillTransaction> getBillTransactionsChunk(int offset, int limit) {
     bt.bill_reference_number = argv[2];
     bt.type = argv[3];
     bt.source = argv[4];
-    bt.amount = atof(argv[5]);
-    bt.cash_received = atof(argv[6]);
-    bt.change = atof(argv[7]);
+    bt.amount = Money::fromAmount(atof(argv[5]));
+    bt.cash_received = Money::fromAmount(atof(argv[6]));
+    bt.change = Money::fromAmount(atof(argv[7]));
     bt.transaction_date = argv[8];
     bt.payment_method = argv[9];
     bt.processed_by_device_uid = argv[10];
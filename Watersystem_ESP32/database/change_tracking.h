@@ -0,0 +1,94 @@
+#ifndef CHANGE_TRACKING_H
+#define CHANGE_TRACKING_H
+
+#include "../configuration/config.h"
+#include <sqlite3.h>
+
+// ===== CHANGE TRACKING =====
+// readings, bills and bill_transactions carry a change_seq column stamped
+// from one device-wide counter whenever a row is inserted or its data
+// changes. The server keeps the highest change_seq it has stored per table
+// (its watermark) and asks only for rows above it, so an export costs
+// O(changes) through the change_seq index instead of O(table).
+//
+// Bookkeeping-only updates (updated_at) do not bump the sequence. Rows
+// that predate change tracking are stamped with their primary key so that
+// the first delta export (since=0) still picks them up.
+
+static const char* CHANGE_SEQ_NEXT =
+  "UPDATE sync_counters SET value = value + 1 WHERE name = 'change_seq';";
+
+static void createChangeTrackingFor(const char* table, const char* key, const char* dataColumns) {
+  char sql[768];
+
+  snprintf(sql, sizeof(sql), "ALTER TABLE %s ADD COLUMN change_seq INTEGER;", table);
+  sqlite3_exec(db, sql, NULL, NULL, NULL);  // Ignore error if column exists
+
+  // Backfill with the primary key so values stay unique for keyset paging
+  snprintf(sql, sizeof(sql), "UPDATE %s SET change_seq = %s WHERE change_seq IS NULL;", table, key);
+  sqlite3_exec(db, sql, NULL, NULL, NULL);
+  snprintf(sql, sizeof(sql),
+           "UPDATE sync_counters SET value = MAX(value, (SELECT COALESCE(MAX(change_seq), 0) FROM %s)) WHERE name = 'change_seq';",
+           table);
+  sqlite3_exec(db, sql, NULL, NULL, NULL);
+
+  snprintf(sql, sizeof(sql), "CREATE INDEX IF NOT EXISTS idx_%s_change_seq ON %s(change_seq);", table, table);
+  sqlite3_exec(db, sql, NULL, NULL, NULL);
+
+  snprintf(sql, sizeof(sql),
+           "CREATE TRIGGER IF NOT EXISTS trg_%s_seq_insert AFTER INSERT ON %s BEGIN "
+           "%s "
+           "UPDATE %s SET change_seq = (SELECT value FROM sync_counters WHERE name = 'change_seq') WHERE %s = NEW.%s; "
+           "END;",
+           table, table, CHANGE_SEQ_NEXT, table, key, key);
+  sqlite3_exec(db, sql, NULL, NULL, NULL);
+
+  snprintf(sql, sizeof(sql),
+           "CREATE TRIGGER IF NOT EXISTS trg_%s_seq_update AFTER UPDATE OF %s ON %s "
+           "WHEN NEW.change_seq IS OLD.change_seq BEGIN "
+           "%s "
+           "UPDATE %s SET change_seq = (SELECT value FROM sync_counters WHERE name = 'change_seq') WHERE %s = NEW.%s; "
+           "END;",
+           table, dataColumns, table, CHANGE_SEQ_NEXT, table, key, key);
+  sqlite3_exec(db, sql, NULL, NULL, NULL);
+}
+
+void createChangeTracking() {
+  sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS sync_counters (name TEXT PRIMARY KEY, value INTEGER NOT NULL);", NULL, NULL, NULL);
+  sqlite3_exec(db, "INSERT OR IGNORE INTO sync_counters (name, value) VALUES ('change_seq', 0);", NULL, NULL, NULL);
+  // Random id of this database file; a new id tells the server its watermarks no longer apply
+  sqlite3_exec(db, "INSERT OR IGNORE INTO sync_counters (name, value) VALUES ('db_id', abs(random() % 2147483647));", NULL, NULL, NULL);
+
+  createChangeTrackingFor("readings", "reading_id",
+                          "customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, anomaly");
+  createChangeTrackingFor("bills", "bill_id",
+                          "reference_number, customer_id, reading_id, device_uid, bill_date, due_date, rate_per_m3, charges, penalty, total_due, status");
+  createChangeTrackingFor("bill_transactions", "bill_transaction_id",
+                          "bill_id, bill_reference_number, type, source, amount, cash_received, change, transaction_date, payment_method, processed_by_device_uid, notes");
+}
+
+static int64_t readSyncCounter(const char* name) {
+  if (!db) return 0;
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "SELECT value FROM sync_counters WHERE name = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+    return 0;
+  }
+  sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+  int64_t value = 0;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    value = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+  return value;
+}
+
+// Current value of the device-wide change counter (0 if unavailable)
+int64_t currentChangeSeq() {
+  return readSyncCounter("change_seq");
+}
+
+int64_t currentDatabaseId() {
+  return readSyncCounter("db_id");
+}
+
+#endif // CHANGE_TRACKING_H
@@ -0,0 +1,169 @@
+#ifndef CUSTOMER_CONTEXT_H
+#define CUSTOMER_CONTEXT_H
+
+#include "../configuration/config.h"
+#include "customers_database.h"
+#include "customer_type_database.h"
+#include "deduction_database.h"
+#include "readings_database.h"
+#include "usage_history.h"
+#include "usage_anomaly.h"
+#include <sqlite3.h>
+
+// ===== CUSTOMER CONTEXT =====
+// Everything the keypad flow needs about one customer, read by a single
+// joined query when the account is confirmed: the customer row, its type,
+// deduction and barangay, its latest reading and its usage history. The
+// info, reading, bill and print steps all work from this copy; generating
+// the bill writes the reading, the bill and previous_reading and updates
+// the context to match, without reading anything back.
+
+struct CustomerContext {
+  bool loaded = false;
+  Customer customer;
+
+  bool hasType = false;
+  CustomerType type;
+
+  bool hasDeduction = false;
+  Deduction deduction;
+
+  String barangay;
+  String brgyPrefix;
+
+  // Latest reading, reading_id 0 when there is none
+  int readingId = 0;
+  unsigned long readingPrevious = 0;
+  unsigned long readingCurrent = 0;
+  unsigned long readingUsage = 0;
+  uint32_t readingAt = 0;
+  bool readingThisMonth = false;
+
+  UsageHistory history;
+
+  // Set when the reader confirms a flagged reading; stored with it
+  UsageAnomaly anomaly = USAGE_OK;
+};
+
+CustomerContext currentContext;
+
+static const char* CUSTOMER_CONTEXT_SQL =
+  "SELECT c.customer_id, c.account_no, c.type_id, c.customer_name, c.deduction_id, c.brgy_id, c.address, "
+  "c.previous_reading, c.status, c.created_at, c.updated_at, "
+  "t.type_id, t.type_name, t.rate_per_m3, t.min_m3, t.min_charge, t.penalty, COALESCE(t.max_m3, 0), "
+  "d.deduction_id, d.name, d.type, d.value, "
+  "b.barangay, b.prefix, "
+  "r.reading_id, r.previous_reading, r.current_reading, r.usage_m3, CAST(r.reading_at AS INTEGER), "
+  "strftime('%Y-%m', CAST(r.reading_at AS INTEGER), 'unixepoch') = strftime('%Y-%m', ?2, 'unixepoch'), "
+  "h.last_period, h.present, h.history, h.stat_n, h.stat_mean, h.stat_var "
+  "FROM customers c "
+  "LEFT JOIN customer_types t ON t.type_id = c.type_id "
+  "LEFT JOIN deductions d ON d.deduction_id = c.deduction_id "
+  "LEFT JOIN barangay_sequence b ON b.brgy_id = c.brgy_id "
+  "LEFT JOIN readings r ON r.reading_id = (SELECT MAX(reading_id) FROM readings WHERE customer_id = c.customer_id) "
+  "LEFT JOIN usage_history h ON h.customer_id = c.customer_id "
+  "WHERE c.account_no = ?1;";
+
+static String contextText(sqlite3_stmt* stmt, int col) {
+  const char* text = (const char*)sqlite3_column_text(stmt, col);
+  return text ? String(text) : String();
+}
+
+// Loads the account into `ctx`; false when there is no such account
+bool loadCustomerContext(const String& accountNo, CustomerContext& ctx) {
+  ctx = CustomerContext();
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, CUSTOMER_CONTEXT_SQL, -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("Failed to prepare loadCustomerContext: "));
+    Serial.println(sqlite3_errmsg(db));
+    return false;
+  }
+  sqlite3_bind_text(stmt, 1, accountNo.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, deviceEpochNow());
+  if (sqlite3_step(stmt) != SQLITE_ROW) {
+    sqlite3_finalize(stmt);
+    return false;
+  }
+
+  Customer& c = ctx.customer;
+  c.customer_id = sqlite3_column_int(stmt, 0);
+  c.account_no = contextText(stmt, 1);
+  c.type_id = sqlite3_column_int(stmt, 2);
+  c.customer_name = contextText(stmt, 3);
+  c.deduction_id = sqlite3_column_int(stmt, 4);
+  c.brgy_id = sqlite3_column_int(stmt, 5);
+  c.address = contextText(stmt, 6);
+  c.previous_reading = (unsigned long)sqlite3_column_int64(stmt, 7);
+  c.status = contextText(stmt, 8);
+  c.created_at = contextText(stmt, 9);
+  c.updated_at = contextText(stmt, 10);
+
+  ctx.hasType = sqlite3_column_type(stmt, 11) != SQLITE_NULL;
+  if (ctx.hasType) {
+    ctx.type.type_id = sqlite3_column_int(stmt, 11);
+    ctx.type.type_name = contextText(stmt, 12);
+    ctx.type.rate_per_m3 = sqlite3_column_double(stmt, 13);
+    ctx.type.min_m3 = (unsigned long)sqlite3_column_int64(stmt, 14);
+    ctx.type.min_charge = sqlite3_column_double(stmt, 15);
+    ctx.type.penalty = sqlite3_column_double(stmt, 16);
+    ctx.type.max_m3 = (unsigned long)sqlite3_column_int64(stmt, 17);
+  }
+
+  ctx.hasDeduction = sqlite3_column_type(stmt, 18) != SQLITE_NULL;
+  if (ctx.hasDeduction) {
+    ctx.deduction.deduction_id = sqlite3_column_int(stmt, 18);
+    ctx.deduction.name = contextText(stmt, 19);
+    ctx.deduction.type = contextText(stmt, 20);
+    ctx.deduction.value = sqlite3_column_double(stmt, 21);
+  }
+
+  ctx.barangay = contextText(stmt, 22);
+  ctx.brgyPrefix = contextText(stmt, 23);
+
+  if (sqlite3_column_type(stmt, 24) != SQLITE_NULL) {
+    ctx.readingId = sqlite3_column_int(stmt, 24);
+    ctx.readingPrevious = (unsigned long)sqlite3_column_int64(stmt, 25);
+    ctx.readingCurrent = (unsigned long)sqlite3_column_int64(stmt, 26);
+    ctx.readingUsage = (unsigned long)sqlite3_column_int64(stmt, 27);
+    ctx.readingAt = (uint32_t)sqlite3_column_int64(stmt, 28);
+    ctx.readingThisMonth = sqlite3_column_int(stmt, 29) != 0;
+  }
+
+  if (sqlite3_column_type(stmt, 30) != SQLITE_NULL) {
+    const uint8_t* blob = (const uint8_t*)sqlite3_column_blob(stmt, 32);
+    int blobLen = sqlite3_column_bytes(stmt, 32);
+    usageHistoryDecode(blob, blobLen, sqlite3_column_int(stmt, 30), (uint32_t)sqlite3_column_int64(stmt, 31), ctx.history);
+    ctx.history.stats.n = (uint16_t)sqlite3_column_int(stmt, 33);
+    ctx.history.stats.mean = (float)sqlite3_column_double(stmt, 34);
+    ctx.history.stats.var = (float)sqlite3_column_double(stmt, 35);
+  }
+  sqlite3_finalize(stmt);
+
+  ctx.loaded = true;
+  return true;
+}
+
+// Loads the account into currentContext and currentCustomer for the keypad
+// flow; returns 0 like findCustomerByAccount, -1 when not found
+int selectCustomerContext(const String& accountNo) {
+  if (!loadCustomerContext(accountNo, currentContext)) return -1;
+  if (currentCustomer) delete currentCustomer;
+  currentCustomer = new Customer(currentContext.customer);
+  return 0;
+}
+
+// Previous reading the next reading is measured from: this month's reading
+// is replaced, so its own previous reading applies
+unsigned long contextPreviousReading(const CustomerContext& ctx) {
+  return ctx.readingThisMonth ? ctx.readingPrevious : ctx.customer.previous_reading;
+}
+
+// Anomaly check for `currentReading`, in the month the bill will be dated
+// (see usage_anomaly.h); currentReading must be above the previous reading
+UsageCheck checkContextUsage(const CustomerContext& ctx, unsigned long currentReading) {
+  uint32_t readingEpoch = ctx.readingThisMonth ? ctx.readingAt : deviceEpochNow();
+  uint32_t usage = (uint32_t)(currentReading - contextPreviousReading(ctx));
+  return checkUsage(ctx.history, usagePeriodOf(readingEpoch), usage, ctx.hasType ? ctx.type.max_m3 : 0);
+}
+
+#endif // CUSTOMER_CONTEXT_H
@@ -7,6 +7,7 @@
 #include <sqlite3.h>
 #include <vector>
 #include "database_manager.h"
+#include "tariff_database.h"
 
 // ===== CUSTOMER TYPE DATA STRUCTURE =====
 struct CustomerType {
@@ -16,6 +17,7 @@ struct CustomerType {
   unsigned long min_m3;
   float min_charge;
   float penalty;
+  unsigned long max_m3;  // usage above this is flagged at reading entry, 0 = no limit
   String created_at;
   String updated_at;
 };
@@ -33,14 +35,16 @@ static int loadCustomerTypeCallback(void *data, int argc, char **argv, char **az
   ct.penalty = atof(argv[5]);
   ct.created_at = argv[6];
   ct.updated_at = argv[7];
+  ct.max_m3 = argv[8] ? strtoul(argv[8], NULL, 10) : 0;
   customerTypes.push_back(ct);
   return 0;
 }
 
 void loadCustomerTypesFromDB() {
   customerTypes.clear();
-  const char *sql = "SELECT type_id, type_name, rate_per_m3, min_m3, min_charge, penalty, created_at, updated_at FROM customer_types;";
+  const char *sql = "SELECT type_id, type_name, rate_per_m3, min_m3, min_charge, penalty, created_at, updated_at, max_m3 FROM customer_types;";
   sqlite3_exec(db, sql, loadCustomerTypeCallback, NULL, NULL);
+  loadTariffsFromDB();
 }
 
 void initCustomerTypesDatabase() {
@@ -4,6 +4,11 @@
 #include "../configuration/config.h"
 #include "../managers/sdcard_manager.h"
 #include "device_info.h"
+#include "change_tracking.h"
+#include "table_digests.h"
+#include "id_leases.h"
+#include "tariff_database.h"
+#include "usage_history.h"
 #include <sqlite3.h>
 #include <SD.h>
 
@@ -25,6 +30,8 @@ void initDatabase() {
       return;
     }
     sqlite3_exec(db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+    // Before any write: the digest triggers call these functions
+    registerTableDigestFunctions();
     createAllTables();
   }
 }
@@ -39,26 +46,32 @@ void createAllTables() {
   sqlite3_exec(db, sql_deductions, NULL, NULL, NULL);
 
   // Customer types table
-  const char *sql_customer_types = "CREATE TABLE IF NOT EXISTS customer_types (type_id INTEGER PRIMARY KEY, type_name TEXT UNIQUE, rate_per_m3 REAL, min_m3 INTEGER DEFAULT 0, min_charge REAL, penalty REAL, created_at TEXT, updated_at TEXT);";
+  const char *sql_customer_types = "CREATE TABLE IF NOT EXISTS customer_types (type_id INTEGER PRIMARY KEY, type_name TEXT UNIQUE, rate_per_m3 REAL, min_m3 INTEGER DEFAULT 0, min_charge REAL, penalty REAL, max_m3 INTEGER, created_at TEXT, updated_at TEXT);";
   sqlite3_exec(db, sql_customer_types, NULL, NULL, NULL);
+  sqlite3_exec(db, "ALTER TABLE customer_types ADD COLUMN max_m3 INTEGER;", NULL, NULL, NULL); // Ignore error if column exists
+
+  // Tariff blocks per customer type (see tariff_database.h)
+  createTariffTiers();
 
   // Customers table
   const char *sql_customers = "CREATE TABLE IF NOT EXISTS customers (customer_id INTEGER PRIMARY KEY, account_no TEXT UNIQUE, type_id INTEGER, customer_name TEXT, deduction_id INTEGER, brgy_id INTEGER, address TEXT, previous_reading INTEGER, status TEXT DEFAULT 'active', created_at TEXT, updated_at TEXT, FOREIGN KEY(deduction_id) REFERENCES deductions(deduction_id), FOREIGN KEY(type_id) REFERENCES customer_types(type_id), FOREIGN KEY(brgy_id) REFERENCES barangay_sequence(brgy_id));";
   sqlite3_exec(db, sql_customers, NULL, NULL, NULL);
 
   // Readings table
-  const char *sql_readings = "CREATE TABLE IF NOT EXISTS readings (reading_id INTEGER PRIMARY KEY, customer_id INTEGER, device_uid TEXT, previous_reading INTEGER, current_reading INTEGER, usage_m3 INTEGER, reading_at TEXT, created_at TEXT, updated_at TEXT, FOREIGN KEY(customer_id) REFERENCES customers(customer_id));";
+  const char *sql_readings = "CREATE TABLE IF NOT EXISTS readings (reading_id INTEGER PRIMARY KEY, customer_id INTEGER, device_uid TEXT, previous_reading INTEGER, current_reading INTEGER, usage_m3 INTEGER, reading_at TEXT, anomaly TEXT, created_at TEXT, updated_at TEXT, FOREIGN KEY(customer_id) REFERENCES customers(customer_id));";
   sqlite3_exec(db, sql_readings, NULL, NULL, NULL);
   // Add device_uid column if not exists
   const char *sql_add_device_uid_readings = "ALTER TABLE readings ADD COLUMN device_uid TEXT;";
   sqlite3_exec(db, sql_add_device_uid_readings, NULL, NULL, NULL); // Ignore error if column exists
+  sqlite3_exec(db, "ALTER TABLE readings ADD COLUMN anomaly TEXT;", NULL, NULL, NULL); // Ignore error if column exists
 
   // Bills table
-  const char *sql_bills = "CREATE TABLE IF NOT EXISTS bills (bill_id INTEGER PRIMARY KEY, reference_number TEXT UNIQUE, customer_id INTEGER, reading_id INTEGER, device_uid TEXT, bill_date TEXT, rate_per_m3 REAL, charges REAL, penalty REAL, total_due REAL, status TEXT DEFAULT 'Pending', created_at TEXT, updated_at TEXT, FOREIGN KEY(customer_id) REFERENCES customers(customer_id), FOREIGN KEY(reading_id) REFERENCES readings(reading_id));";
+  const char *sql_bills = "CREATE TABLE IF NOT EXISTS bills (bill_id INTEGER PRIMARY KEY, reference_number TEXT UNIQUE, customer_id INTEGER, reading_id INTEGER, device_uid TEXT, bill_date TEXT, due_date TEXT, rate_per_m3 REAL, charges REAL, penalty REAL, total_due REAL, status TEXT DEFAULT 'Pending', created_at TEXT, updated_at TEXT, FOREIGN KEY(customer_id) REFERENCES customers(customer_id), FOREIGN KEY(reading_id) REFERENCES readings(reading_id));";
   sqlite3_exec(db, sql_bills, NULL, NULL, NULL);
   // Add device_uid column if not exists
   const char *sql_add_device_uid_bills = "ALTER TABLE bills ADD COLUMN device_uid TEXT;";
   sqlite3_exec(db, sql_add_device_uid_bills, NULL, NULL, NULL); // Ignore error if column exists
+  sqlite3_exec(db, "ALTER TABLE bills ADD COLUMN due_date TEXT;", NULL, NULL, NULL); // Ignore error if column exists
 
   // Bill transactions table
   const char *sql_bill_transactions = "CREATE TABLE IF NOT EXISTS bill_transactions (bill_transaction_id INTEGER PRIMARY KEY, bill_id INTEGER, bill_reference_number TEXT, type TEXT, source TEXT, amount REAL, cash_received REAL, change REAL, transaction_date TEXT, payment_method TEXT, processed_by_device_uid TEXT, notes TEXT, created_at TEXT, updated_at TEXT, FOREIGN KEY(bill_id) REFERENCES bills(bill_id), FOREIGN KEY(bill_reference_number) REFERENCES bills(reference_number));";
@@ -68,6 +81,44 @@ void createAllTables() {
   const char *sql_device_info = "CREATE TABLE IF NOT EXISTS device_info (brgy_id INTEGER, device_mac TEXT UNIQUE, device_uid TEXT, firmware_version TEXT, device_name TEXT, print_count INTEGER DEFAULT 0, customer_count INTEGER DEFAULT 0, last_sync TEXT, created_at TEXT DEFAULT CURRENT_TIMESTAMP, updated_at TEXT);";
   sqlite3_exec(db, sql_device_info, NULL, NULL, NULL);
 
+  // Chunks applied per sync session, for idempotent retries and RESUME
+  const char *sql_sync_ledger = "CREATE TABLE IF NOT EXISTS sync_ledger (session_id TEXT, stream TEXT, chunk_index INTEGER, total_chunks INTEGER, content_hash TEXT, applied_at TEXT, PRIMARY KEY (session_id, stream, chunk_index));";
+  sqlite3_exec(db, sql_sync_ledger, NULL, NULL, NULL);
+
+  // Indexes behind the EXPORT_* filters (see managers/sync/export_engine.h);
+  // reading_at is matched as the same expression the filter uses
+  const char *sql_export_indexes[] = {
+    "CREATE INDEX IF NOT EXISTS idx_customers_brgy_id ON customers(brgy_id);",
+    "CREATE INDEX IF NOT EXISTS idx_readings_reading_at ON readings(CAST(reading_at AS INTEGER));",
+    "CREATE INDEX IF NOT EXISTS idx_readings_customer_id ON readings(customer_id);",
+    "CREATE INDEX IF NOT EXISTS idx_bills_bill_date ON bills(bill_date);",
+    "CREATE INDEX IF NOT EXISTS idx_bills_status ON bills(status);",
+    "CREATE INDEX IF NOT EXISTS idx_bills_customer_id ON bills(customer_id);",
+    "CREATE INDEX IF NOT EXISTS idx_bill_transactions_date ON bill_transactions(transaction_date);",
+    "CREATE INDEX IF NOT EXISTS idx_bill_transactions_bill_id ON bill_transactions(bill_id);",
+  };
+  for (const char *sql : sql_export_indexes) {
+    sqlite3_exec(db, sql, NULL, NULL, NULL);
+  }
+
+  // Bill lookup by reading, for BATCH_BILL's "not billed yet" check
+  sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS idx_bills_reading_id ON bills(reading_id);", NULL, NULL, NULL);
+
+  // Unpaid bills by due date, for the penalty run (see penalty_engine.h)
+  sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS idx_bills_status_due ON bills(status, due_date);", NULL, NULL, NULL);
+
+  // change_seq columns, triggers and indexes for delta exports
+  createChangeTracking();
+
+  // Per-table count / max updated_at / hash for TABLE_DIGESTS
+  createTableDigests();
+
+  // Server-granted primary key blocks for device-created rows
+  createIdLeases();
+
+  // Per-customer monthly usage for the info screen trend
+  initUsageHistory();
+
   // Optimize SQLite for low memory ESP32
 sqlite3_exec(db, "PRAGMA journal_mode = WAL;", NULL, NULL, NULL);
 sqlite3_exec(db, "PRAGMA synchronous = NORMAL;", NULL, NULL, NULL);
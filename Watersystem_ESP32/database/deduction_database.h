@@ -3,6 +3,7 @@
 
 #include <SD.h>
 #include "../configuration/config.h"
+#include "../configuration/money.h"
 #include "sync_utils.h"
 #include <sqlite3.h>
 #include <vector>
@@ -33,6 +34,14 @@ static int loadDeductionCallback(void *data, int argc, char **argv, char **azCol
   return 0;
 }
 
+// Amount a deduction of `type` ("percentage" or "fixed") takes off `base`
+Money applyDeduction(Money base, const char* type, double value) {
+  if (!type) return Money();
+  if (strcmp(type, "percentage") == 0) return base.percent(value);
+  if (strcmp(type, "fixed") == 0) return Money::fromAmount(value);
+  return Money();
+}
+
 void loadDeductionsFromDB() {
   deductions.clear();
   const char *sql = "SELECT deduction_id, name, type, value, created_at, updated_at FROM deductions;";
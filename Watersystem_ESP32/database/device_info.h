@@ -4,6 +4,7 @@
 #include <SD.h>
 #include "../configuration/config.h"
 #include "../managers/sdcard_manager.h"
+#include "change_tracking.h"
 
 // Device info stored in PSV file on SD card: /WATER_DB/device_info.psv
 // Format: key|value per line
@@ -260,6 +261,12 @@ static void exportDeviceInfoForSync() {
   Serial.print(F("INFO|pending_readings|"));
   Serial.println((unsigned long)countPendingReadings());
 
+  Serial.print(F("INFO|change_seq|"));
+  Serial.println((long long)currentChangeSeq());
+
+  Serial.print(F("INFO|db_id|"));
+  Serial.println((long long)currentDatabaseId());
+
   // SD card status
   Serial.print(F("INFO|sd_present|"));
   Serial.println(deviceInfoSdReady() ? 1 : 0);
@@ -0,0 +1,99 @@
+#ifndef ID_LEASES_H
+#define ID_LEASES_H
+
+#include "../configuration/config.h"
+#include <sqlite3.h>
+
+// ===== ID LEASES =====
+// New readings, bills and bill_transactions take their primary key from a
+// block of ids the server granted to this device (id_leases: next_id up to
+// last_id, inclusive). Blocks of different devices never overlap, so the
+// server stores exported rows under the device's own keys.
+//
+// There is no fallback: SQLite's max(id) + 1 would be the first id of the
+// next block the server grants, possibly to another device. A table
+// without a lease, or whose lease ran out, refuses new rows until the next
+// sync tops it up; ID_LEASES reports what is left so the client can ask
+// for a new block in time.
+
+struct IdLeaseTable {
+  const char* table;
+  const char* key;
+};
+
+static const IdLeaseTable ID_LEASE_TABLES[] = {
+  { "readings", "reading_id" },
+  { "bills", "bill_id" },
+  { "bill_transactions", "bill_transaction_id" },
+};
+
+void createIdLeases() {
+  sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS id_leases (table_name TEXT PRIMARY KEY, next_id INTEGER NOT NULL, last_id INTEGER NOT NULL);", NULL, NULL, NULL);
+}
+
+const IdLeaseTable* idLeaseTableFor(const String& table) {
+  for (const IdLeaseTable& lease : ID_LEASE_TABLES) {
+    if (table == lease.table) return &lease;
+  }
+  return nullptr;
+}
+
+// Takes `count` consecutive ids of the table's lease and returns the first;
+// 0 when the lease cannot cover all of them
+int64_t allocateLeasedIds(const char* table, int64_t count) {
+  if (!db || count <= 0) return 0;
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "SELECT next_id, last_id FROM id_leases WHERE table_name = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+    return 0;
+  }
+  sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+  int64_t id = 0;
+  bool leased = false;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    leased = true;
+    if (sqlite3_column_int64(stmt, 0) + count - 1 <= sqlite3_column_int64(stmt, 1)) id = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+
+  if (id == 0) {
+    if (leased) {
+      Serial.print(F("Not enough leased ids left for "));
+      Serial.println(table);
+    }
+    return 0;
+  }
+
+  if (sqlite3_prepare_v2(db, "UPDATE id_leases SET next_id = ? WHERE table_name = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+    return 0;
+  }
+  sqlite3_bind_int64(stmt, 1, id + count);
+  sqlite3_bind_text(stmt, 2, table, -1, SQLITE_STATIC);
+  bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+  sqlite3_finalize(stmt);
+  return ok ? id : 0;
+}
+
+// Takes the next id of the table's lease; 0 when there is none left
+int64_t allocateLeasedId(const char* table) {
+  return allocateLeasedIds(table, 1);
+}
+
+// Ids left in the table's lease; 0 without one
+int64_t idLeaseRemaining(const char* table) {
+  if (!db) return 0;
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "SELECT next_id, last_id FROM id_leases WHERE table_name = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+    return 0;
+  }
+  sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+  int64_t remaining = 0;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    int64_t next = sqlite3_column_int64(stmt, 0);
+    int64_t last = sqlite3_column_int64(stmt, 1);
+    if (next > 0 && last >= next) remaining = last - next + 1;
+  }
+  sqlite3_finalize(stmt);
+  return remaining;
+}
+
+#endif // ID_LEASES_H
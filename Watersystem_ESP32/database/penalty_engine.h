@@ -0,0 +1,83 @@
+#ifndef PENALTY_ENGINE_H
+#define PENALTY_ENGINE_H
+
+#include "../configuration/config.h"
+#include "../managers/sync/sync_stats.h"
+#include <sqlite3.h>
+#include <time.h>
+
+// ===== PENALTIES =====
+// A Pending bill whose due_date has passed gets its customer type's
+// penalty added to penalty and total_due once, and moves to 'Due'. Bills
+// leave 'Pending' as they are penalized, so idx_bills_status_due(status,
+// due_date) holds in its Pending range only the bills that crossed their
+// due date since the previous run: a run costs one index seek when nothing
+// is overdue, and a bill is never penalized twice.
+//
+// Bills without a due_date (made before this column, or while the clock
+// was unset) are never touched. Nothing runs until SET_TIME has set the
+// clock, otherwise no bill would ever be overdue, or every bill would be.
+
+struct PenaltyRunResult {
+  int64_t updated = 0;
+  uint32_t elapsedMs = 0;
+  char today[11] = "";
+  SyncStat stat;  // sql_us / commit_us of the UPDATE
+};
+
+// customer_types.penalty of the bill's customer, 0 without a type
+#define PENALTY_OF_BILL \
+  "COALESCE((SELECT t.penalty FROM customers c JOIN customer_types t ON t.type_id = c.type_id " \
+  "WHERE c.customer_id = bills.customer_id), 0)"
+
+static const char* PENALTY_UPDATE_SQL =
+  "UPDATE bills SET penalty = round(COALESCE(penalty, 0) + " PENALTY_OF_BILL ", 2), "
+  "total_due = round(COALESCE(total_due, 0) + " PENALTY_OF_BILL ", 2), "
+  "status = 'Due', updated_at = datetime('now') "
+  "WHERE status = 'Pending' AND due_date < ?1;";
+
+bool penaltyClockSet() {
+  return time(NULL) >= CLOCK_VALID_EPOCH;
+}
+
+// Penalizes every Pending bill due before today (UTC, as bill dates are
+// written); false on a database error, with nothing changed
+bool runPenalties(PenaltyRunResult& result) {
+  uint32_t start = millis();
+  time_t now = time(NULL);
+  struct tm t;
+  gmtime_r(&now, &t);
+  strftime(result.today, sizeof(result.today), "%Y-%m-%d", &t);
+
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, PENALTY_UPDATE_SQL, -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("Penalty prepare failed: "));
+    Serial.println(sqlite3_errmsg(db));
+    return false;
+  }
+
+  SyncStat& stat = result.stat;
+  uint32_t t0 = micros();
+  sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+  sqlite3_bind_text(stmt, 1, result.today, -1, SQLITE_STATIC);
+  bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+  if (ok) result.updated = sqlite3_changes(db);
+  sqlite3_finalize(stmt);
+  stat.sqlUs = micros() - t0;
+
+  t0 = micros();
+  if (!ok || sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+    Serial.print(F("Penalty run failed: "));
+    Serial.println(sqlite3_errmsg(db));
+    sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    result.updated = 0;
+    return false;
+  }
+  stat.commitUs = micros() - t0;
+  stat.rows = result.updated;
+
+  result.elapsedMs = millis() - start;
+  return true;
+}
+
+#endif // PENALTY_ENGINE_H
@@ -58,28 +58,21 @@ static uint32_t deviceEpochNow() {
   return (uint32_t)((long)(millis() / 1000) + g_timeOffsetSeconds);
 }
 
-void saveReadingToDB(int customer_id, unsigned long previous_reading, unsigned long current_reading, unsigned long usage_m3, String reading_at) {
+bool saveReadingToDB(int customer_id, unsigned long previous_reading, unsigned long current_reading, unsigned long usage_m3, String reading_at) {
   char sql[512];
   String deviceUID = getDeviceUID();
   String timestamp = String(deviceEpochNow());
-  sprintf(sql, "INSERT INTO readings (customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, created_at, updated_at) VALUES (%d, '%s', %lu, %lu, %lu, '%s', datetime('now'), datetime('now'));", customer_id, deviceUID.c_str(), previous_reading, current_reading, usage_m3, timestamp.c_str());
+  int64_t readingId = allocateLeasedId("readings");
+  if (readingId == 0) {
+    Serial.println(F("Reading not saved: no leased reading ids left, sync the device"));
+    return false;
+  }
+  sprintf(sql, "INSERT INTO readings (reading_id, customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, created_at, updated_at) VALUES (%lld, %d, '%s', %lu, %lu, %lu, '%s', datetime('now'), datetime('now'));", (long long)readingId, customer_id, deviceUID.c_str(), previous_reading, current_reading, usage_m3, timestamp.c_str());
   // Serial.println(sql);  // Commented out to save heap memory
   int rc = sqlite3_exec(db, sql, NULL, NULL, NULL);
   Serial.print(F("Reading save result: "));
   Serial.println(rc == SQLITE_OK ? "OK" : "FAILED");
-}
-
-bool hasReadingForCustomerInYearMonth(int customer_id, int year, int month) {
-  char sql[256];
-  sprintf(sql, "SELECT COUNT(*) FROM readings WHERE customer_id = %d AND strftime('%%Y', datetime(reading_at, 'unixepoch')) = '%04d' AND strftime('%%m', datetime(reading_at, 'unixepoch')) = '%02d';", customer_id, year, month);
-  // For simplicity, assume no reading if not loaded, but since we load all, check vector
-  for (const auto& r : readings) {
-    if (r.customer_id == customer_id) {
-      // Parse reading_at for year month
-      // For now, return false to allow new reading
-    }
-  }
-  return false; // Placeholder
+  return rc == SQLITE_OK;
 }
 
 // For time offset, keep SD for now or migrate to settings
@@ -126,24 +119,6 @@ void initReadingsDatabase() {
   loadDeviceTimeOffsetFromDB(); // Load from DB
 }
 
-// ===== HAS READING FOR ACCOUNT THIS MONTH =====
-bool hasReadingForAccountThisMonth(String accountNo) {
-  // Find customer_id by account
-  int customerIndex = findCustomerByAccount(accountNo);
-  if (customerIndex == -1) return false;
-  Customer* c = getCustomerAt(customerIndex);
-  if (!c) return false;
-  int customer_id = c->customer_id;
-
-  // Check if reading exists for this month
-  time_t now = time(NULL);
-  struct tm *t = localtime(&now);
-  int year = t->tm_year + 1900;
-  int month = t->tm_mon + 1;
-
-  return hasReadingForCustomerInYearMonth(customer_id, year, month);
-}
-
 // ===== RECORD READING FOR CUSTOMER INDEX =====
 bool recordReadingForCustomerIndex(int customerIndex, unsigned long currentReading) {
   Customer* c = getCustomerAt(customerIndex);
@@ -168,13 +143,6 @@ bool recordReadingForCustomerIndex(int customerIndex, unsigned long currentReadi
   return true;
 }
 
-// ===== MARK ALL READINGS SYNCED =====
-bool markAllReadingsSynced() {
-  const char *sql = "UPDATE readings SET updated_at = datetime('now');";
-  int rc = sqlite3_exec(db, sql, NULL, NULL, NULL);
-  return rc == SQLITE_OK;
-}
-
 void setDeviceEpoch(uint32_t epoch) {
   // Set the ESP32 system time
   struct timeval tv;
@@ -0,0 +1,210 @@
+#ifndef TABLE_DIGESTS_H
+#define TABLE_DIGESTS_H
+
+#include "../configuration/config.h"
+#include "../managers/sync/sync_codec.h"
+#include <sqlite3.h>
+
+// ===== TABLE DIGESTS =====
+// One row per synced table in table_digests: row count, highest updated_at
+// and an order-independent content hash (XOR of FNV-1a 64 row hashes).
+// Triggers keep the row current on every INSERT, UPDATE and DELETE, so
+// TABLE_DIGESTS answers from seven rows instead of scanning the tables and
+// the client can skip a whole phase when nothing changed on either side.
+//
+// The triggers call ws_row_hash() and ws_xor(), which are registered on the
+// connection by registerTableDigestFunctions() right after sqlite3_open.
+// recursive_triggers is on so that INSERT OR REPLACE fires the DELETE
+// trigger for the row it replaces. A digest row remembers the column list it
+// was built from; when a spec below changes, its triggers and digest are
+// rebuilt on the next start. So is a digest whose triggers are gone or whose
+// row count no longer matches the table, as after a table was dropped and
+// created again; the drop commands also remove the digest row outright
+// through dropTableDigest().
+
+struct TableDigestSpec {
+  const char* table;
+  const char* columns;  // hashed columns, everything but change_seq
+};
+
+static const TableDigestSpec TABLE_DIGEST_SPECS[] = {
+  { "barangay_sequence", "brgy_id, barangay, prefix, next_number, updated_at" },
+  { "customer_types", "type_id, type_name, rate_per_m3, min_m3, min_charge, penalty, max_m3, created_at, updated_at" },
+  { "deductions", "deduction_id, name, type, value, created_at, updated_at" },
+  { "customers", "customer_id, account_no, type_id, customer_name, deduction_id, brgy_id, address, previous_reading, status, created_at, updated_at" },
+  { "readings", "reading_id, customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, anomaly, created_at, updated_at" },
+  { "bills", "bill_id, reference_number, customer_id, reading_id, device_uid, bill_date, due_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at" },
+  { "bill_transactions", "bill_transaction_id, bill_id, bill_reference_number, type, source, amount, cash_received, change, transaction_date, payment_method, processed_by_device_uid, notes, created_at, updated_at" },
+};
+
+// ws_row_hash(col, ...): FNV-1a 64 over the text of each value, 0x1F
+// between values and 0x1E for NULL
+static void wsRowHashFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  static const uint8_t SEP = 0x1F;
+  static const uint8_t NUL = 0x1E;
+  uint64_t h = FNV64_OFFSET;
+  for (int i = 0; i < argc; i++) {
+    if (i > 0) h = fnv64Update(h, &SEP, 1);
+    if (sqlite3_value_type(argv[i]) == SQLITE_NULL) {
+      h = fnv64Update(h, &NUL, 1);
+      continue;
+    }
+    const unsigned char* text = sqlite3_value_text(argv[i]);
+    if (text) h = fnv64Update(h, text, sqlite3_value_bytes(argv[i]));
+  }
+  sqlite3_result_int64(ctx, (sqlite3_int64)h);
+}
+
+// ws_xor(a, b); SQLite has no XOR operator
+static void wsXorFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  uint64_t a = (uint64_t)sqlite3_value_int64(argv[0]);
+  uint64_t b = (uint64_t)sqlite3_value_int64(argv[1]);
+  sqlite3_result_int64(ctx, (sqlite3_int64)(a ^ b));
+}
+
+void registerTableDigestFunctions() {
+  sqlite3_create_function(db, "ws_row_hash", -1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, wsRowHashFunc, NULL, NULL);
+  sqlite3_create_function(db, "ws_xor", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, wsXorFunc, NULL, NULL);
+  sqlite3_exec(db, "PRAGMA recursive_triggers = ON;", NULL, NULL, NULL);
+}
+
+// Prefixes every column with NEW. or OLD.
+static String tableDigestRowRef(const char* columns, const char* prefix) {
+  String out;
+  String cols = columns;
+  int start = 0;
+  while (start < (int)cols.length()) {
+    int comma = cols.indexOf(',', start);
+    if (comma < 0) comma = cols.length();
+    String col = cols.substring(start, comma);
+    col.trim();
+    if (out.length()) out += ", ";
+    out += prefix;
+    out += col;
+    start = comma + 1;
+  }
+  return out;
+}
+
+// Full scan, only when the digest is missing or its columns changed
+static void rebuildTableDigest(const TableDigestSpec& spec) {
+  String sql = String("SELECT ws_row_hash(") + spec.columns + ") FROM " + spec.table + ";";
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("Table digest rebuild failed: "));
+    Serial.println(sqlite3_errmsg(db));
+    return;
+  }
+  uint64_t hash = 0;
+  int64_t rows = 0;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    hash ^= (uint64_t)sqlite3_column_int64(stmt, 0);
+    rows++;
+  }
+  sqlite3_finalize(stmt);
+
+  sql = String("INSERT OR REPLACE INTO table_digests (table_name, columns, row_count, max_updated_at, hash) "
+               "VALUES (?, ?, ?, (SELECT MAX(updated_at) FROM ") + spec.table + "), ?);";
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    return;
+  }
+  sqlite3_bind_text(stmt, 1, spec.table, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, spec.columns, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 3, rows);
+  sqlite3_bind_int64(stmt, 4, (sqlite3_int64)hash);
+  sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+}
+
+static void createTableDigestTriggers(const TableDigestSpec& spec) {
+  String newRow = tableDigestRowRef(spec.columns, "NEW.");
+  String oldRow = tableDigestRowRef(spec.columns, "OLD.");
+  String where = String(" WHERE table_name = '") + spec.table + "'; ";
+  // max_updated_at only moves forward, like MAX(updated_at) at rebuild
+  String maxUpdated = "max_updated_at = CASE WHEN max_updated_at IS NULL OR NEW.updated_at > max_updated_at "
+                      "THEN NEW.updated_at ELSE max_updated_at END";
+
+  String sql;
+  const char* kinds[] = { "insert", "delete", "update" };
+  for (const char* kind : kinds) {
+    sql = String("DROP TRIGGER IF EXISTS trg_") + spec.table + "_digest_" + kind + ";";
+    sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+  }
+
+  sql = String("CREATE TRIGGER trg_") + spec.table + "_digest_insert AFTER INSERT ON " + spec.table + " BEGIN "
+               "UPDATE table_digests SET row_count = row_count + 1, " + maxUpdated +
+               ", hash = ws_xor(hash, ws_row_hash(" + newRow + "))" + where + "END;";
+  sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+
+  sql = String("CREATE TRIGGER trg_") + spec.table + "_digest_delete AFTER DELETE ON " + spec.table + " BEGIN "
+        "UPDATE table_digests SET row_count = row_count - 1, hash = ws_xor(hash, ws_row_hash(" + oldRow + "))" + where + "END;";
+  sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+
+  // Listing the columns keeps change_seq stamping from firing this trigger
+  sql = String("CREATE TRIGGER trg_") + spec.table + "_digest_update AFTER UPDATE OF " + spec.columns + " ON " + spec.table + " BEGIN "
+        "UPDATE table_digests SET " + maxUpdated +
+        ", hash = ws_xor(ws_xor(hash, ws_row_hash(" + oldRow + ")), ws_row_hash(" + newRow + "))" + where + "END;";
+  sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+}
+
+// The digest row was built from the spec's columns, its three triggers
+// exist and its row count still matches the table
+static bool tableDigestCurrent(const TableDigestSpec& spec) {
+  sqlite3_stmt* stmt;
+  bool current = false;
+  int64_t rowCount = -1;
+  if (sqlite3_prepare_v2(db, "SELECT columns, row_count FROM table_digests WHERE table_name = ?;", -1, &stmt, NULL) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, spec.table, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      const char* columns = (const char*)sqlite3_column_text(stmt, 0);
+      current = columns && strcmp(columns, spec.columns) == 0;
+      rowCount = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+  }
+  if (!current) return false;
+
+  String pattern = String("trg_") + spec.table + "_digest_*";
+  current = false;
+  if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' AND tbl_name = ? AND name GLOB ?;", -1, &stmt, NULL) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, spec.table, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, pattern.c_str(), -1, SQLITE_TRANSIENT);
+    current = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == 3;
+    sqlite3_finalize(stmt);
+  }
+  if (!current) return false;
+
+  String sql = String("SELECT COUNT(*) FROM ") + spec.table + ";";
+  current = false;
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+    current = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 0) == rowCount;
+    sqlite3_finalize(stmt);
+  }
+  return current;
+}
+
+// Forgets the digest of a table being dropped; the next createTableDigests()
+// builds it again with the table's triggers
+void dropTableDigest(const char* table) {
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "DELETE FROM table_digests WHERE table_name = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+    return;
+  }
+  sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+  sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+}
+
+void createTableDigests() {
+  sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS table_digests (table_name TEXT PRIMARY KEY, columns TEXT, row_count INTEGER NOT NULL, max_updated_at, hash INTEGER NOT NULL);", NULL, NULL, NULL);
+
+  for (const TableDigestSpec& spec : TABLE_DIGEST_SPECS) {
+    if (tableDigestCurrent(spec)) continue;
+    sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    createTableDigestTriggers(spec);
+    rebuildTableDigest(spec);
+    sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+  }
+}
+
+#endif // TABLE_DIGESTS_H
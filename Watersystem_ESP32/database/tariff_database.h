@@ -0,0 +1,130 @@
+#ifndef TARIFF_DATABASE_H
+#define TARIFF_DATABASE_H
+
+#include "../configuration/config.h"
+#include "../configuration/money.h"
+#include <sqlite3.h>
+#include <vector>
+
+// ===== TARIFFS =====
+// Water charges per customer type, in integer centavos:
+//
+//   usage <= min_m3            min_charge
+//   no tariff_tiers rows       usage * rate_per_m3 (the original flat rate)
+//   otherwise                  min_charge, plus each m3 above min_m3 at the
+//                              rate of the block it falls in
+//
+// A tariff_tiers row starts a block: m3 above from_m3, up to the next row's
+// from_m3, cost rate_per_m3 each. With min_m3 = 10 and tiers (10, 25.00),
+// (20, 30.00), a usage of 23 costs min_charge + 10 * 25.00 + 3 * 30.00.
+// min_charge covers everything up to min_m3, so the first block always
+// starts there.
+//
+// The tables are compiled at load into one sorted block array with the
+// charge at the start of every block already summed, so a bill costs one
+// plan lookup, a short scan and one multiply. CustomerType::chargeCentavos()
+// on the server implements the same rules; tariff_database_test.cpp and the
+// server's TariffChargeTest hold both to database/tariff_golden.txt.
+
+struct TariffBlock {
+  uint32_t fromM3;
+  int32_t rateCentavos;
+  int64_t baseCentavos;  // charge for exactly fromM3
+};
+
+struct TariffPlan {
+  int typeId;
+  uint32_t minM3;
+  int64_t minCentavos;
+  int32_t flatRateCentavos;
+  uint16_t firstBlock;
+  uint16_t blockCount;
+};
+
+std::vector<TariffPlan> tariffPlans;
+std::vector<TariffBlock> tariffBlocks;
+
+void createTariffTiers() {
+  sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS tariff_tiers (tier_id INTEGER PRIMARY KEY, type_id INTEGER NOT NULL, from_m3 INTEGER NOT NULL, rate_per_m3 REAL NOT NULL, created_at TEXT, updated_at TEXT);", NULL, NULL, NULL);
+  sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS idx_tariff_tiers_type ON tariff_tiers(type_id, from_m3);", NULL, NULL, NULL);
+}
+
+// Rebuilds the in-RAM plans from customer_types and tariff_tiers
+void loadTariffsFromDB() {
+  tariffPlans.clear();
+  tariffBlocks.clear();
+  if (!db) return;
+
+  const char* sql = "SELECT t.type_id, t.min_m3, t.min_charge, t.rate_per_m3, r.from_m3, r.rate_per_m3 "
+                    "FROM customer_types t LEFT JOIN tariff_tiers r ON r.type_id = t.type_id "
+                    "ORDER BY t.type_id, r.from_m3;";
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("Tariff load failed: "));
+    Serial.println(sqlite3_errmsg(db));
+    return;
+  }
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    int typeId = sqlite3_column_int(stmt, 0);
+    if (tariffPlans.empty() || tariffPlans.back().typeId != typeId) {
+      TariffPlan plan;
+      plan.typeId = typeId;
+      plan.minM3 = (uint32_t)sqlite3_column_int64(stmt, 1);
+      plan.minCentavos = Money::fromAmount(sqlite3_column_double(stmt, 2)).centavos;
+      plan.flatRateCentavos = (int32_t)Money::fromAmount(sqlite3_column_double(stmt, 3)).centavos;
+      plan.firstBlock = tariffBlocks.size();
+      plan.blockCount = 0;
+      tariffPlans.push_back(plan);
+    }
+    if (sqlite3_column_type(stmt, 4) == SQLITE_NULL) continue;
+
+    TariffPlan& plan = tariffPlans.back();
+    uint32_t from = (uint32_t)sqlite3_column_int64(stmt, 4);
+    if (from < plan.minM3 || plan.blockCount == 0) from = plan.minM3;
+    TariffBlock block;
+    block.fromM3 = from;
+    block.rateCentavos = (int32_t)Money::fromAmount(sqlite3_column_double(stmt, 5)).centavos;
+    if (plan.blockCount == 0) {
+      block.baseCentavos = plan.minCentavos;
+    } else {
+      TariffBlock& prev = tariffBlocks.back();
+      if (prev.fromM3 == from) {
+        // A later block starting at the same m3 replaces the earlier one
+        prev.rateCentavos = block.rateCentavos;
+        continue;
+      }
+      block.baseCentavos = prev.baseCentavos + (int64_t)(from - prev.fromM3) * prev.rateCentavos;
+    }
+    tariffBlocks.push_back(block);
+    plan.blockCount++;
+  }
+  sqlite3_finalize(stmt);
+}
+
+const TariffPlan* findTariffPlan(int typeId) {
+  for (const TariffPlan& plan : tariffPlans) {
+    if (plan.typeId == typeId) return &plan;
+  }
+  return nullptr;
+}
+
+Money tariffCharge(const TariffPlan& plan, uint32_t usage) {
+  if (usage <= plan.minM3) return Money::fromCentavos(plan.minCentavos);
+  if (plan.blockCount == 0) return Money::fromCentavos((int64_t)usage * plan.flatRateCentavos);
+
+  const TariffBlock* blocks = &tariffBlocks[plan.firstBlock];
+  uint16_t i = plan.blockCount - 1;
+  while (i > 0 && blocks[i].fromM3 >= usage) i--;
+  return Money::fromCentavos(blocks[i].baseCentavos + (int64_t)(usage - blocks[i].fromM3) * blocks[i].rateCentavos);
+}
+
+// Charge for a customer type; false when the type has no plan
+bool tariffCharge(int typeId, uint32_t usage, Money& charge) {
+  const TariffPlan* plan = findTariffPlan(typeId);
+  if (!plan) return false;
+  charge = tariffCharge(*plan, usage);
+  return true;
+}
+
+#endif // TARIFF_DATABASE_H
@@ -0,0 +1,102 @@
+// Host test: tariffCharge() against database/tariff_golden.txt, the table
+// CustomerType::chargeCentavos() is tested with on the server. From
+// Watersystem_ESP32/:
+//
+//   g++ -std=c++17 -O2 -I. -Ihost_test database/tariff_database_test.cpp -lsqlite3 -o /tmp/tariff_test && /tmp/tariff_test
+//
+// With --bench it then bills TARIFF_BENCH_BILLS seeded random usages over
+// the golden plans through tariffCharge() and prints the time per bill.
+
+#include "tariff_database.h"
+#include <chrono>
+#include <vector>
+
+#define TARIFF_BENCH_BILLS 100000
+
+// Bills TARIFF_BENCH_BILLS usages of 0..150 m3 spread over every plan
+static void benchTariffCharge() {
+  std::vector<int> typeIds;
+  std::vector<uint32_t> usages;
+  uint32_t seed = 0x2545F491;
+  for (int i = 0; i < TARIFF_BENCH_BILLS; i++) {
+    seed ^= seed << 13;  // xorshift32, so every run bills the same usages
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    typeIds.push_back(tariffPlans[seed % tariffPlans.size()].typeId);
+    usages.push_back((seed >> 8) % 151);
+  }
+
+  int64_t total = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < TARIFF_BENCH_BILLS; i++) {
+    Money charge;
+    tariffCharge(typeIds[i], usages[i], charge);
+    total += charge.centavos;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+
+  printf("bench: %d bills over %u plans in %.2f ms, %.1f ns per bill (total %lld centavos)\n", TARIFF_BENCH_BILLS,
+         (unsigned)tariffPlans.size(), elapsed / 1e6, (double)elapsed / TARIFF_BENCH_BILLS, (long long)total);
+}
+
+int main(int argc, char** argv) {
+  bool bench = false;
+  const char* path = "database/tariff_golden.txt";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bench") == 0) bench = true;
+    else path = argv[i];
+  }
+  FILE* golden = fopen(path, "r");
+  if (!golden) {
+    printf("cannot open %s\n", path);
+    return 2;
+  }
+
+  sqlite3_open(":memory:", &db);
+  sqlite3_exec(db, "CREATE TABLE customer_types (type_id INTEGER PRIMARY KEY, min_m3 INTEGER, min_charge REAL, rate_per_m3 REAL);", NULL, NULL, NULL);
+  createTariffTiers();
+
+  // Plans first, then every case against the compiled plans
+  char line[256];
+  while (fgets(line, sizeof(line), golden)) {
+    if (strncmp(line, "plan ", 5) != 0) continue;
+    char* tok = strtok(line + 5, " \n");
+    int typeId = atoi(tok);
+    const char* minM3 = strtok(NULL, " \n");
+    const char* minCharge = strtok(NULL, " \n");
+    const char* rate = strtok(NULL, " \n");
+    char sql[256];
+    snprintf(sql, sizeof(sql), "INSERT INTO customer_types VALUES (%d, %s, %s, %s);", typeId, minM3, minCharge, rate);
+    sqlite3_exec(db, sql, NULL, NULL, NULL);
+    while ((tok = strtok(NULL, " \n"))) {
+      char* sep = strchr(tok, ':');
+      if (!sep) continue;
+      *sep = '\0';
+      snprintf(sql, sizeof(sql), "INSERT INTO tariff_tiers (type_id, from_m3, rate_per_m3) VALUES (%d, %s, %s);", typeId, tok, sep + 1);
+      sqlite3_exec(db, sql, NULL, NULL, NULL);
+    }
+  }
+  loadTariffsFromDB();
+
+  rewind(golden);
+  int cases = 0;
+  int failed = 0;
+  while (fgets(line, sizeof(line), golden)) {
+    int typeId;
+    unsigned usage;
+    long long expected;
+    if (line[0] == '#' || sscanf(line, "%d %u %lld", &typeId, &usage, &expected) != 3) continue;
+    cases++;
+    Money charge;
+    if (!tariffCharge(typeId, usage, charge) || charge.centavos != expected) {
+      printf("FAIL type %d usage %u: expected %lld, got %lld\n", typeId, usage, expected, (long long)charge.centavos);
+      failed++;
+    }
+  }
+  fclose(golden);
+
+  printf("%d cases, %d failed\n", cases, failed);
+  if (bench && !failed) benchTariffCharge();
+  sqlite3_close(db);
+  return failed ? 1 : 0;
+}
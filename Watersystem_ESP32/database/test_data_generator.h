@@ -59,7 +59,7 @@ void generateTestBillTransactions(int billCount) {
   while (sqlite3_step(stmt) == SQLITE_ROW && transCount < billCount) {
     int billId = sqlite3_column_int(stmt, 0);
     String refNum = String((const char*)sqlite3_column_text(stmt, 1));
-    float totalDue = sqlite3_column_double(stmt, 2);
+    Money totalDue = Money::fromAmount(sqlite3_column_double(stmt, 2));
 
     // Check if transaction already exists for this bill
     bool exists = false;
@@ -71,15 +71,22 @@ void generateTestBillTransactions(int billCount) {
     if (exists) continue;  // Skip if transaction already exists
 
     // Create a payment transaction
-    const char* transSql = "INSERT INTO bill_transactions (bill_id, bill_reference_number, type, source, amount, cash_received, change, transaction_date, payment_method, processed_by_device_uid, notes, created_at, updated_at) VALUES (?, ?, 'payment', 'Device', ?, ?, 0, datetime('now'), 'cash', ?, 'Test payment', datetime('now'), datetime('now'));";
+    const char* transSql = "INSERT INTO bill_transactions (bill_transaction_id, bill_id, bill_reference_number, type, source, amount, cash_received, change, transaction_date, payment_method, processed_by_device_uid, notes, created_at, updated_at) VALUES (?, ?, ?, 'payment', 'Device', ?, ?, 0, datetime('now'), 'cash', ?, 'Test payment', datetime('now'), datetime('now'));";
     sqlite3_stmt* transStmt;
     int rc2 = sqlite3_prepare_v2(db, transSql, -1, &transStmt, NULL);
     if (rc2 == SQLITE_OK) {
-      sqlite3_bind_int(transStmt, 1, billId);
-      sqlite3_bind_text(transStmt, 2, refNum.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_double(transStmt, 3, totalDue);
-      sqlite3_bind_double(transStmt, 4, totalDue);
-      sqlite3_bind_text(transStmt, 5, getDeviceUID().c_str(), -1, SQLITE_TRANSIENT);
+      int64_t transactionId = allocateLeasedId("bill_transactions");
+      if (transactionId == 0) {
+        Serial.println(F("No leased transaction ids left, stopping"));
+        sqlite3_finalize(transStmt);
+        break;
+      }
+      sqlite3_bind_int64(transStmt, 1, transactionId);
+      sqlite3_bind_int(transStmt, 2, billId);
+      sqlite3_bind_text(transStmt, 3, refNum.c_str(), -1, SQLITE_TRANSIENT);
+      sqlite3_bind_double(transStmt, 4, totalDue.toAmount());
+      sqlite3_bind_double(transStmt, 5, totalDue.toAmount());
+      sqlite3_bind_text(transStmt, 6, getDeviceUID().c_str(), -1, SQLITE_TRANSIENT);
       int rc_step = sqlite3_step(transStmt);
       if (rc_step == SQLITE_DONE) {
         transCount++;
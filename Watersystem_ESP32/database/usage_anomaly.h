@@ -0,0 +1,80 @@
+#ifndef USAGE_ANOMALY_H
+#define USAGE_ANOMALY_H
+
+#include "../configuration/config.h"
+#include "usage_history.h"
+#include <math.h>
+
+// ===== USAGE ANOMALY CHECK =====
+// Judges a new reading's usage against the customer's running statistics
+// (usage_history.h) and the type's max_m3, before the bill is made. Both
+// are already in the customer context, so the check is a few float
+// operations and reads nothing. A flagged reading goes through the
+// confirm screen; if the reader keeps it, the flag is stored in
+// readings.anomaly and exported for review on the server.
+//
+// HIGH/LOW: more than USAGE_ANOMALY_SIGMAS spreads from the mean, once
+// USAGE_ANOMALY_MIN_MONTHS months are known. The spread is the standard
+// deviation, but never less than USAGE_ANOMALY_FLOOR_M3 or
+// USAGE_ANOMALY_FLOOR_PCT of the mean, so a very steady customer is not
+// flagged for a couple of m3. An extra digit typed (10x the usage) is
+// always well outside.
+// TYPE_MAX: above the type's max_m3, when set; applies from the first
+// reading.
+
+#define USAGE_ANOMALY_MIN_MONTHS 3
+#define USAGE_ANOMALY_SIGMAS 4.0f
+#define USAGE_ANOMALY_FLOOR_M3 3.0f
+#define USAGE_ANOMALY_FLOOR_PCT 0.2f
+
+enum UsageAnomaly : uint8_t {
+  USAGE_OK,
+  USAGE_HIGH,
+  USAGE_LOW,
+  USAGE_TYPE_MAX
+};
+
+struct UsageCheck {
+  UsageAnomaly anomaly = USAGE_OK;
+  uint32_t usage = 0;
+  uint32_t expected = 0;  // running mean, rounded
+  uint32_t low = 0;       // accepted range, valid when months >= USAGE_ANOMALY_MIN_MONTHS
+  uint32_t high = 0;
+  uint32_t typeMax = 0;   // 0 = none
+  uint16_t months = 0;
+};
+
+// Value stored in readings.anomaly; nullptr for USAGE_OK
+const char* usageAnomalyName(UsageAnomaly anomaly) {
+  switch (anomaly) {
+    case USAGE_HIGH: return "HIGH";
+    case USAGE_LOW: return "LOW";
+    case USAGE_TYPE_MAX: return "TYPE_MAX";
+    default: return nullptr;
+  }
+}
+
+UsageCheck checkUsage(const UsageHistory& h, int32_t period, uint32_t usage, uint32_t typeMax) {
+  UsageCheck check;
+  check.usage = usage;
+  check.typeMax = typeMax;
+
+  UsageStats stats = usageStatsBefore(h, period);
+  check.months = stats.n;
+  check.expected = (uint32_t)(stats.mean + 0.5f);
+  if (stats.n >= USAGE_ANOMALY_MIN_MONTHS) {
+    float spread = sqrtf(stats.var > 0 ? stats.var : 0);
+    if (spread < USAGE_ANOMALY_FLOOR_M3) spread = USAGE_ANOMALY_FLOOR_M3;
+    if (spread < stats.mean * USAGE_ANOMALY_FLOOR_PCT) spread = stats.mean * USAGE_ANOMALY_FLOOR_PCT;
+    float low = stats.mean - USAGE_ANOMALY_SIGMAS * spread;
+    float high = stats.mean + USAGE_ANOMALY_SIGMAS * spread;
+    check.low = low > 0 ? (uint32_t)ceilf(low) : 0;
+    check.high = (uint32_t)high;
+    if (usage > check.high) check.anomaly = USAGE_HIGH;
+    else if (usage < check.low) check.anomaly = USAGE_LOW;
+  }
+  if (typeMax > 0 && usage > typeMax) check.anomaly = USAGE_TYPE_MAX;
+  return check;
+}
+
+#endif // USAGE_ANOMALY_H
@@ -0,0 +1,252 @@
+#ifndef USAGE_HISTORY_H
+#define USAGE_HISTORY_H
+
+#include "../configuration/config.h"
+#include <sqlite3.h>
+#include <time.h>
+
+// ===== USAGE HISTORY =====
+// The usage of each customer's last USAGE_HISTORY_PERIODS months, one row
+// per customer in usage_history, so the info screen can show a trend
+// without scanning readings. Months are numbered year * 12 + month - 1
+// (UTC); last_period is the newest month held.
+//
+// history is a blob of zigzag varints, oldest month first: each is the
+// difference from the month before (the first from 0), so a steady
+// customer costs about a byte per month. Months without a reading repeat
+// the previous value and have their bit clear in `present` (bit 0 = the
+// oldest month held). The row is rewritten on every reading and read as
+// part of the customer context.
+//
+// stat_n, stat_mean and stat_var are a running mean and variance of the
+// monthly usage, for the anomaly check (usage_anomaly.h). A month is
+// folded in once, when a later month is recorded, so re-reading the
+// current month does not count it twice. The first USAGE_STATS_WINDOW
+// months weigh equally, later ones decay exponentially, so the statistics
+// follow a customer whose usage changes.
+
+#define USAGE_HISTORY_PERIODS 24
+#define USAGE_HISTORY_BLOB_MAX (USAGE_HISTORY_PERIODS * 5)
+#define USAGE_STATS_WINDOW 6
+
+struct UsageStats {
+  uint16_t n = 0;
+  float mean = 0;
+  float var = 0;
+};
+
+struct UsageHistory {
+  int32_t lastPeriod = 0;
+  uint8_t count = 0;
+  uint32_t present = 0;
+  uint32_t usage[USAGE_HISTORY_PERIODS] = {};
+  UsageStats stats;  // months before the newest held
+};
+
+// True when the stat_* columns were just added to an existing table, whose
+// rows have no statistics yet
+bool createUsageHistory() {
+  sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS usage_history (customer_id INTEGER PRIMARY KEY, last_period INTEGER NOT NULL, present INTEGER NOT NULL, history BLOB, stat_n INTEGER NOT NULL DEFAULT 0, stat_mean REAL NOT NULL DEFAULT 0, stat_var REAL NOT NULL DEFAULT 0, updated_at TEXT);", NULL, NULL, NULL);
+  bool added = sqlite3_exec(db, "ALTER TABLE usage_history ADD COLUMN stat_n INTEGER NOT NULL DEFAULT 0;", NULL, NULL, NULL) == SQLITE_OK;
+  sqlite3_exec(db, "ALTER TABLE usage_history ADD COLUMN stat_mean REAL NOT NULL DEFAULT 0;", NULL, NULL, NULL);
+  sqlite3_exec(db, "ALTER TABLE usage_history ADD COLUMN stat_var REAL NOT NULL DEFAULT 0;", NULL, NULL, NULL);
+  return added;
+}
+
+void usageStatsAdd(UsageStats& s, uint32_t usage) {
+  if (s.n < 0xFFFF) s.n++;
+  float alpha = 1.0f / (s.n < USAGE_STATS_WINDOW ? s.n : USAGE_STATS_WINDOW);
+  float diff = (float)usage - s.mean;
+  float step = alpha * diff;
+  s.mean += step;
+  s.var = (1.0f - alpha) * (s.var + diff * step);
+}
+
+// Statistics a reading for `period` is judged against: the held ones, plus
+// the newest month when `period` comes after it
+UsageStats usageStatsBefore(const UsageHistory& h, int32_t period) {
+  UsageStats s = h.stats;
+  if (h.count > 0 && period > h.lastPeriod && (h.present & (1UL << (h.count - 1)))) {
+    usageStatsAdd(s, h.usage[h.count - 1]);
+  }
+  return s;
+}
+
+int32_t usagePeriodOf(uint32_t epoch) {
+  time_t when = (time_t)epoch;
+  struct tm t;
+  gmtime_r(&when, &t);
+  return (t.tm_year + 1900) * 12 + t.tm_mon;
+}
+
+size_t usageHistoryEncode(const UsageHistory& h, uint8_t* out) {
+  size_t len = 0;
+  int64_t prev = 0;
+  for (uint8_t i = 0; i < h.count; i++) {
+    int64_t delta = (int64_t)h.usage[i] - prev;
+    uint64_t zz = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    while (zz >= 0x80) {
+      out[len++] = (uint8_t)(zz | 0x80);
+      zz >>= 7;
+    }
+    out[len++] = (uint8_t)zz;
+    prev = h.usage[i];
+  }
+  return len;
+}
+
+// False on a malformed blob, with `h` left empty
+bool usageHistoryDecode(const uint8_t* data, size_t len, int32_t lastPeriod, uint32_t present, UsageHistory& h) {
+  h = UsageHistory();
+  int64_t prev = 0;
+  size_t pos = 0;
+  while (pos < len) {
+    if (h.count == USAGE_HISTORY_PERIODS) {
+      h = UsageHistory();
+      return false;
+    }
+    uint64_t zz = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+      if (pos == len || shift > 35) {
+        h = UsageHistory();
+        return false;
+      }
+      byte = data[pos++];
+      zz |= (uint64_t)(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    int64_t delta = (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+    prev += delta;
+    h.usage[h.count++] = (uint32_t)prev;
+  }
+  h.lastPeriod = lastPeriod;
+  h.present = present & ((1UL << h.count) - 1);
+  return true;
+}
+
+// Puts a month's usage in the history; a month already held is replaced,
+// a month USAGE_HISTORY_PERIODS or more before the newest is ignored
+void usageHistoryRecord(UsageHistory& h, int32_t period, uint32_t usage) {
+  UsageStats stats = usageStatsBefore(h, period);
+  if (h.count == 0 || period - h.lastPeriod >= USAGE_HISTORY_PERIODS) {
+    h = UsageHistory();
+    h.stats = stats;
+    h.lastPeriod = period;
+    h.count = 1;
+    h.present = 1;
+    h.usage[0] = usage;
+    return;
+  }
+
+  if (period <= h.lastPeriod) {
+    if (h.lastPeriod - period >= USAGE_HISTORY_PERIODS) return;
+    int idx = (int)h.count - 1 - (h.lastPeriod - period);
+    if (idx < 0) {
+      // Before the oldest month held: open slots at the front, the ones
+      // between carrying this month's value
+      int shift = -idx;
+      memmove(h.usage + shift, h.usage, h.count * sizeof(h.usage[0]));
+      for (int i = 0; i < shift; i++) h.usage[i] = usage;
+      h.present <<= shift;
+      h.count += shift;
+      idx = 0;
+    }
+    h.usage[idx] = usage;
+    h.present |= 1UL << idx;
+    return;
+  }
+
+  h.stats = stats;
+  // Months without a reading carry the previous value, not present
+  uint32_t carry = h.usage[h.count - 1];
+  for (int32_t p = h.lastPeriod + 1; p <= period; p++) {
+    if (h.count == USAGE_HISTORY_PERIODS) {
+      memmove(h.usage, h.usage + 1, (USAGE_HISTORY_PERIODS - 1) * sizeof(h.usage[0]));
+      h.present >>= 1;
+      h.count--;
+    }
+    bool isNew = p == period;
+    h.usage[h.count] = isNew ? usage : carry;
+    if (isNew) h.present |= 1UL << h.count;
+    h.count++;
+  }
+  h.lastPeriod = period;
+}
+
+// Mean of the months with a reading among the newest `months`; false when
+// there is none
+bool usageHistoryAverage(const UsageHistory& h, uint8_t months, uint32_t& average) {
+  uint64_t sum = 0;
+  uint8_t n = 0;
+  uint8_t first = h.count > months ? h.count - months : 0;
+  for (uint8_t i = first; i < h.count; i++) {
+    if (!(h.present & (1UL << i))) continue;
+    sum += h.usage[i];
+    n++;
+  }
+  if (n == 0) return false;
+  average = (uint32_t)((sum + n / 2) / n);
+  return true;
+}
+
+bool saveUsageHistory(int customerId, const UsageHistory& h) {
+  uint8_t blob[USAGE_HISTORY_BLOB_MAX];
+  size_t len = usageHistoryEncode(h, blob);
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO usage_history (customer_id, last_period, present, history, stat_n, stat_mean, stat_var, updated_at) VALUES (?, ?, ?, ?, ?, ?, ?, datetime('now'));", -1, &stmt, NULL) != SQLITE_OK) {
+    return false;
+  }
+  sqlite3_bind_int(stmt, 1, customerId);
+  sqlite3_bind_int(stmt, 2, h.lastPeriod);
+  sqlite3_bind_int64(stmt, 3, h.present);
+  sqlite3_bind_blob(stmt, 4, blob, (int)len, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 5, h.stats.n);
+  sqlite3_bind_double(stmt, 6, h.stats.mean);
+  sqlite3_bind_double(stmt, 7, h.stats.var);
+  bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+  sqlite3_finalize(stmt);
+  return ok;
+}
+
+// Builds every customer's history from readings, in one pass and one
+// transaction; run once when usage_history is new or gains columns
+void rebuildUsageHistory() {
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "SELECT customer_id, CAST(reading_at AS INTEGER), usage_m3 FROM readings ORDER BY customer_id, reading_id;", -1, &stmt, NULL) != SQLITE_OK) {
+    return;
+  }
+  sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+  int customerId = 0;
+  int customers = 0;
+  UsageHistory h;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    int id = sqlite3_column_int(stmt, 0);
+    if (id != customerId) {
+      if (customerId != 0) saveUsageHistory(customerId, h);
+      customerId = id;
+      customers++;
+      h = UsageHistory();
+      if (customers % 100 == 0) YIELD_WDT();
+    }
+    usageHistoryRecord(h, usagePeriodOf((uint32_t)sqlite3_column_int64(stmt, 1)), (uint32_t)sqlite3_column_int64(stmt, 2));
+  }
+  if (customerId != 0) saveUsageHistory(customerId, h);
+  sqlite3_finalize(stmt);
+  sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+  Serial.printf("Usage history built for %d customers\n", customers);
+}
+
+void initUsageHistory() {
+  bool upgraded = createUsageHistory();
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "SELECT EXISTS (SELECT 1 FROM usage_history), EXISTS (SELECT 1 FROM readings);", -1, &stmt, NULL) != SQLITE_OK) {
+    return;
+  }
+  bool needsBuild = sqlite3_step(stmt) == SQLITE_ROW && (upgraded || sqlite3_column_int(stmt, 0) == 0) && sqlite3_column_int(stmt, 1) == 1;
+  sqlite3_finalize(stmt);
+  if (needsBuild) rebuildUsageHistory();
+}
+
+#endif // USAGE_HISTORY_H
@@ -0,0 +1,95 @@
+#ifndef HOST_TEST_ARDUINO_H
+#define HOST_TEST_ARDUINO_H
+
+// ===== HOST BUILD OF THE SKETCH HEADERS =====
+// Just enough of the Arduino core for the *_test.cpp programs next to the
+// headers they test to build and run on a PC, e.g. from Watersystem_ESP32/:
+//
+//   g++ -std=c++17 -I. -Ihost_test database/tariff_database_test.cpp -lsqlite3 -o /tmp/t && /tmp/t
+//
+// Serial goes to stdout (or a test's capture string), millis()/micros()
+// are the host's steady clock.
+
+#include <chrono>
+#include <cctype>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+inline uint32_t micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline uint32_t millis() { return micros() / 1000; }
+
+class String : public std::string {
+ public:
+  String() {}
+  String(const char* s) : std::string(s ? s : "") {}
+  String(const std::string& s) : std::string(s) {}
+  explicit String(int v) : std::string(std::to_string(v)) {}
+  explicit String(long v) : std::string(std::to_string(v)) {}
+  explicit String(unsigned long v) : std::string(std::to_string(v)) {}
+  bool startsWith(const char* p) const { return rfind(p, 0) == 0; }
+  int indexOf(char c, int from = 0) const { size_t r = find(c, from); return r == npos ? -1 : (int)r; }
+  String substring(int from) const { return String(substr(from)); }
+  String substring(int from, int to) const { return String(substr(from, to - from)); }
+  long toInt() const { return atol(c_str()); }
+  void trim() {
+    while (!empty() && isspace((unsigned char)back())) pop_back();
+    while (!empty() && isspace((unsigned char)front())) erase(0, 1);
+  }
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(const uint8_t* data, size_t len) { return fwrite(data, 1, len, stdout); }
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const __FlashStringHelper* s) { return print((const char*)s); }
+  size_t print(const std::string& s) { return write((const uint8_t*)s.data(), s.size()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return print(std::to_string(v)); }
+  size_t print(long v) { return print(std::to_string(v)); }
+  size_t print(unsigned int v) { return print(std::to_string(v)); }
+  size_t print(unsigned long v) { return print(std::to_string(v)); }
+  size_t print(long long v) { return print(std::to_string(v)); }
+  template <class T> size_t println(const T& v) { return print(v) + print('\n'); }
+  size_t println() { return print('\n'); }
+  size_t printf(const char* format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return write((const uint8_t*)buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+};
+
+// Output goes to `capture` instead of stdout while a test has one set
+class HardwareSerial : public Print {
+ public:
+  std::string* capture = nullptr;
+  size_t write(const uint8_t* data, size_t len) override {
+    if (!capture) return Print::write(data, len);
+    capture->append((const char*)data, len);
+    return len;
+  }
+  using Print::write;
+};
+static HardwareSerial Serial;
+
+// Heap figures for the STAT lines; the host has no such limits
+struct HostEsp {
+  uint32_t getFreeHeap() { return 0; }
+  uint32_t getMaxAllocHeap() { return 0; }
+};
+inline HostEsp ESP;
+
+#endif  // HOST_TEST_ARDUINO_H
@@ -0,0 +1,112 @@
+#ifndef HOST_TEST_ARDUINOJSON_H
+#define HOST_TEST_ARDUINOJSON_H
+
+// ===== HOST BUILD: ARDUINOJSON =====
+// The part of ArduinoJson 6 the JSON exporters use (an array of flat
+// objects written with serializeJson), so export_engine.h builds on a PC.
+// Output matches the library's for ints, strings and serialized() values;
+// floats are printed with up to 9 decimals like ArduinoJson's double
+// formatting, which covers the magnitudes the exports hold.
+
+#include <Arduino.h>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SerializedValue {
+  std::string text;
+};
+
+inline SerializedValue serialized(const char* s, size_t len) { return SerializedValue{std::string(s, len)}; }
+
+typedef std::vector<std::pair<std::string, std::string>> HostJsonMembers;
+
+class HostJsonMember {
+ public:
+  HostJsonMember(HostJsonMembers* members, const char* key) : members_(members), key_(key) {}
+  void operator=(long v) { set(std::to_string(v)); }
+  void operator=(int v) { set(std::to_string(v)); }
+  void operator=(float v) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.9f", (double)v);
+    std::string s = buf;
+    while (s.back() == '0') s.pop_back();
+    if (s.back() == '.') s.pop_back();
+    set(s);
+  }
+  void operator=(const String& v) {
+    std::string s = "\"";
+    for (char c : v) {
+      if (c == '"' || c == '\\') s += '\\';
+      s += c;
+    }
+    set(s + "\"");
+  }
+  void operator=(const SerializedValue& v) { set(v.text); }
+
+ private:
+  void set(const std::string& json) { members_->emplace_back(key_, json); }
+  HostJsonMembers* members_;
+  const char* key_;
+};
+
+class JsonObject {
+ public:
+  explicit JsonObject(HostJsonMembers* members) : members_(members) {}
+  HostJsonMember operator[](const char* key) { return HostJsonMember(members_, key); }
+
+ private:
+  HostJsonMembers* members_;
+};
+
+class JsonArray {
+ public:
+  explicit JsonArray(std::deque<HostJsonMembers>* items) : items_(items) {}
+  JsonObject createNestedObject() {
+    items_->emplace_back();
+    return JsonObject(&items_->back());
+  }
+  std::string json() const {
+    std::string out = "[";
+    for (size_t i = 0; i < items_->size(); i++) {
+      if (i) out += ',';
+      out += '{';
+      const HostJsonMembers& members = (*items_)[i];
+      for (size_t m = 0; m < members.size(); m++) {
+        if (m) out += ',';
+        out += '"' + members[m].first + "\":" + members[m].second;
+      }
+      out += '}';
+    }
+    return out + "]";
+  }
+
+ private:
+  std::deque<HostJsonMembers>* items_;
+};
+
+class DynamicJsonDocument {
+ public:
+  explicit DynamicJsonDocument(size_t) {}
+  template <class T> T to() {
+    items_.clear();
+    return T(&items_);
+  }
+  void clear() { items_.clear(); }
+
+ private:
+  std::deque<HostJsonMembers> items_;
+};
+
+inline size_t serializeJson(const JsonArray& arr, Print& out) {
+  std::string json = arr.json();
+  return out.write((const uint8_t*)json.data(), json.size());
+}
+
+inline size_t serializeJson(const JsonArray& arr, String& out) {
+  out = arr.json();
+  return out.length();
+}
+
+#endif  // HOST_TEST_ARDUINOJSON_H
@@ -7,6 +7,7 @@
 #include "../database/readings_database.h"
 #include "../database/customers_database.h"
 #include "../database/barangay_database.h"
+#include "../database/customer_context.h"
 #include "../database/test_data_generator.h"
 #include <SD.h>
 
@@ -26,6 +27,7 @@ void displayReadingAlreadyDoneScreen();
 void processAccountNumberEntry();
 void processReadingEntry();
 void resetWorkflow();
+void nextAccountWorkflow();
 void displayMenuScreen();
 void displayViewRateScreen();
 
@@ -55,6 +57,7 @@ Keypad keypad = Keypad(makeKeymap(keys), rowPins, colPins, KEYPAD_ROWS, KEYPAD_C
 void handleKeypadInput(char key) {
   Serial.print(F("Key pressed: "));
   Serial.println(key);
+  printQueueStatusInvalidate();  // the handler may redraw the whole screen
   
   // Handle based on current workflow state
   if (currentState == STATE_WELCOME) {
@@ -126,12 +129,19 @@ void handleKeypadInput(char key) {
       tft.fillScreen(COLOR_BG);
       tft.setTextColor(COLOR_HEADER);
       tft.setCursor(25, 50);
-      tft.println(F("Printing test..."));
-      printer.wake();
-      printer.println(F("=== PRINTER TEST ==="));
-      printer.println(F("Water Billing System"));
-      printer.println(F("Test Print OK"));
-      printer.feed(3);
+      PrintJob* job = printQueueAcquire();
+      if (job) {
+        tft.println(F("Printing test..."));
+        job->receipt.defaults();
+        job->receipt.line("=== PRINTER TEST ===");
+        job->receipt.line("Water Billing System");
+        job->receipt.line("Test Print OK");
+        job->receipt.feed(3);
+        snprintf(job->label, sizeof(job->label), "TEST");
+        printQueueSubmit(job);
+      } else {
+        tft.println(F("Printer busy..."));
+      }
       delay(2000);
       displayMenuScreen();
     }
@@ -176,7 +186,7 @@ void handleKeypadInput(char key) {
         accountNum = "0" + accountNum;
       }
       String fullAccount = prefix + "-" + accountNum;
-      selectedCustomerIndex = findCustomerByAccount(fullAccount);
+      selectedCustomerIndex = selectCustomerContext(fullAccount);
       processAccountNumberEntry();
     }
     else if (key == 'B') {  // Clear
@@ -191,7 +201,7 @@ void handleKeypadInput(char key) {
     // Customer info displayed
     if (key == 'D') {  // Proceed to reading
       // If this account already has a reading for the current month, warn first.
-      if (hasReadingForAccountThisMonth(currentCustomer->account_no)) {
+      if (currentContext.readingThisMonth) {
         currentState = STATE_READING_ALREADY_DONE;
         displayReadingAlreadyDoneScreen();
       } else {
@@ -234,30 +244,38 @@ void handleKeypadInput(char key) {
       resetWorkflow();
     }
   }
+  else if (currentState == STATE_CONFIRM_ANOMALY) {
+    // Usage outside the usual range
+    if (key == 'D') {  // Keep the reading, flagged
+      currentState = STATE_BILL_CALCULATED;
+      displayBillCalculated();
+    }
+    else if (key == 'B') {  // Re-enter the reading
+      currentContext.anomaly = USAGE_OK;
+      currentState = STATE_ENTER_READING;
+      inputBuffer = "";
+      displayEnterReadingScreen();
+    }
+    else if (key == 'C') {  // Cancel
+      resetWorkflow();
+    }
+  }
   else if (currentState == STATE_BILL_CALCULATED) {
     // Bill ready to print
     if (key == 'D') {  // Print bill
-      Serial.println(F("Starting print job..."));
-      currentState = STATE_PRINTING;
+      if (!queueBillPrint(currentBill)) {
+        // Every slot is still waiting on the printer; keep the bill up
+        Serial.println(F("Print queue full"));
+        drawPrintQueueFull();
+        return;
+      }
+      Serial.println(F("Bill queued for printing."));
 
       // Track print count for device info
       incrementPrintCount();
-      
-      // Start printing and animation in parallel using FreeRTOS
-      startParallelPrinting();
-      
-      // Wait for both tasks to complete
-      waitForPrintCompletion();
-      
-      Serial.println(F("Print workflow complete."));
-      
-      // Remove temp reading date file
-      deselectTftSelectSd();
-      SD.remove("/temp_reading_date.txt");
-      Serial.println(F("Temp reading date removed from SD"));
-      
-      delay(500);
-      resetWorkflow();
+
+      // The printer task takes it from here; next customer
+      nextAccountWorkflow();
     }
     else if (key == 'C') {  // Cancel
       resetWorkflow();
@@ -2,168 +2,206 @@
 #define PRINT_MANAGER_H
 
 #include "../configuration/config.h"
-#include <esp_task_wdt.h>
+#include "../components/escpos_buffer.h"
+#include "receipt_builder.h"
+
+// ===== PRINT QUEUE =====
+// Receipts are rendered on the UI side into one of PRINT_QUEUE_DEPTH job
+// slots and handed to a printer task that owns the printer UART, so the
+// keypad is back on account entry while the paper is still coming out and
+// the next customer's reading can be taken in the meantime. Slots move
+// between two queues of indexes, as in serial_rx_manager.h:
+//   free  -> UI renders the job -> ready -> printer task prints it -> free
+// With every slot taken the UI is told the queue is full; nothing waits.
+
+struct PrintJob {
+  EscPosBuffer receipt;
+  uint32_t estimateMs = 0;  // receiptPrintMs() of the receipt
+  char label[24];           // account number, for the status line and log
+};
 
 // ===== EXTERNAL OBJECTS FROM MAIN .INO =====
 extern TFT_eSPI tft;
 
-// ===== PRINTER STATUS TRACKING =====
-volatile bool isPrinting = false;
-volatile bool printComplete = false;
-volatile int printProgress = 0;  // 0-100%
+// Wakes the printer, sends the job and waits until the paper is out; defined in the main .ino
+void printReceiptJob(const PrintJob& job);
 
-// ===== FREERTOS TASK HANDLES =====
+static PrintJob printJobs[PRINT_QUEUE_DEPTH];
+static QueueHandle_t printFreeJobs = NULL;
+static QueueHandle_t printReadyJobs = NULL;
 TaskHandle_t printTaskHandle = NULL;
-TaskHandle_t animationTaskHandle = NULL;
 
-// Forward declarations
-void printBill();
-void displayPrintingAnimation();
+// ===== PRINTER STATUS (written by the printer task) =====
+volatile bool isPrinting = false;
+volatile uint32_t printJobsDone = 0;
+volatile uint32_t printJobStartedMs = 0;
+volatile uint32_t printJobEstimateMs = 0;
 
 // ===== PRINTER TASK (Runs in background) =====
-void printerTask(void *parameter) {
-  // Start printing
-  isPrinting = true;
-  printComplete = false;
-  printProgress = 0;
-  
-  Serial.println(F("[Printer Task] Starting print..."));
-  
-
-  // Call the print function
-  printBill();
-  
-  // Mark as complete
-  isPrinting = false;
-  printComplete = true;
-  printProgress = 100;
-  
-  Serial.println(F("[Printer Task] Print finished!"));
-  
-  // Delete this task
-  vTaskDelete(NULL);
+static void printerTask(void* parameter) {
+  uint8_t idx;
+  for (;;) {
+    xQueueReceive(printReadyJobs, &idx, portMAX_DELAY);
+    PrintJob& job = printJobs[idx];
+
+    printJobEstimateMs = job.estimateMs;
+    printJobStartedMs = millis();
+    isPrinting = true;
+    Serial.printf("[Printer Task] Printing %s (~%lu ms)\n", job.label, (unsigned long)job.estimateMs);
+
+    printReceiptJob(job);
+
+    isPrinting = false;
+    printJobsDone = printJobsDone + 1;
+    xQueueSend(printFreeJobs, &idx, portMAX_DELAY);
+    Serial.printf("[Printer Task] Done %s\n", job.label);
+  }
 }
 
-// ===== ANIMATION TASK (Monitor & Display) =====
-void animationTask(void *parameter) {
-  tft.fillScreen(COLOR_BG);
-  
-  tft.setTextColor(COLOR_HEADER);
-  tft.setTextSize(2);
-  tft.setCursor(25, 20);
-  tft.println(F("PRINTING"));
-  
-  tft.setTextColor(COLOR_TEXT);
-  tft.setTextSize(1);
-  tft.setCursor(35, 45);
-  tft.println(F("Please wait..."));
-  
-  // Draw progress bar border
-  tft.drawRect(20, 70, 120, 20, COLOR_LINE);
-  
-  int lastProgress = 0;
-  unsigned long animationStartTime = millis();
-  
-  // Run while printing or until complete
-  while (!printComplete) {
-    unsigned long elapsedTime = millis() - animationStartTime;
-    
-    // Estimate progress based on elapsed time (33 seconds = 33000ms)
-    int estimatedProgress = (elapsedTime * 100) / 33000;
-    
-    // Don't go over 95% until actually done
-    if (estimatedProgress > 95) {
-      estimatedProgress = 95;
-    }
-    
-    // Update progress bar if changed
-    if (estimatedProgress != lastProgress) {
-      lastProgress = estimatedProgress;
-      printProgress = estimatedProgress;
-      
-      // Fill progress bar
-      int barWidth = (120 * estimatedProgress) / 100;
-      tft.fillRect(20, 70, barWidth, 20, COLOR_AMOUNT);
-      
-      // Update percentage text
-      tft.setTextColor(COLOR_BG);
-      tft.setTextSize(1);
-      tft.setCursor(60, 75);
-      if (estimatedProgress < 10) {
-        tft.print(F("  "));
-      } else if (estimatedProgress < 100) {
-        tft.print(F(" "));
-      }
-      tft.println(estimatedProgress);
-      
-      Serial.print(F("[Animation] Progress: "));
-      Serial.print(estimatedProgress);
-      Serial.println(F("%"));
-    }
-    
-    delay(500);  // Update every 500ms
+// Creates the job queues and starts the printer task; call after the printer is set up
+bool startPrintQueue() {
+  printFreeJobs = xQueueCreate(PRINT_QUEUE_DEPTH, sizeof(uint8_t));
+  printReadyJobs = xQueueCreate(PRINT_QUEUE_DEPTH, sizeof(uint8_t));
+  if (!printFreeJobs || !printReadyJobs) return false;
+  for (uint8_t i = 0; i < PRINT_QUEUE_DEPTH; i++) {
+    xQueueSend(printFreeJobs, &i, 0);
   }
-  
-  // Print complete - fill bar to 100%
-  tft.fillRect(20, 70, 120, 20, COLOR_AMOUNT);
-  tft.setTextColor(COLOR_BG);
+
+  return xTaskCreatePinnedToCore(
+    printerTask,        // Task function
+    "PrinterTask",      // Task name
+    4096,               // Stack size (bytes)
+    NULL,               // Parameters
+    1,                  // Priority (same as loop)
+    &printTaskHandle,   // Task handle
+    1                   // Core 1
+  ) == pdPASS;
+}
+
+// A free slot to render into, or nullptr when every slot is queued or printing
+PrintJob* printQueueAcquire() {
+  uint8_t idx;
+  if (!printFreeJobs || xQueueReceive(printFreeJobs, &idx, 0) != pdTRUE) return nullptr;
+  PrintJob* job = &printJobs[idx];
+  job->receipt.clear();
+  job->estimateMs = 0;
+  job->label[0] = '\0';
+  return job;
+}
+
+// Hands a rendered slot from printQueueAcquire() to the printer task
+void printQueueSubmit(PrintJob* job) {
+  uint8_t idx = (uint8_t)(job - printJobs);
+  job->estimateMs = receiptPrintMs(job->receipt);
+  if (job->receipt.overflow) {
+    Serial.println(F("WARNING: receipt longer than the print buffer, cut short"));
+  }
+#if WS_SERIAL_VERBOSE
+  Serial.printf("Receipt %s: %u bytes, %lu dots, ~%lu ms\n", job->label, (unsigned)job->receipt.len,
+                (unsigned long)job->receipt.measureDots(), (unsigned long)job->estimateMs);
+#endif
+  xQueueSend(printReadyJobs, &idx, portMAX_DELAY);
+}
+
+// Renders `bill` and queues it; false when the queue is full
+bool queueBillPrint(const BillData& bill) {
+  PrintJob* job = printQueueAcquire();
+  if (!job) return false;
+  buildBillReceipt(job->receipt, bill);
+  snprintf(job->label, sizeof(job->label), "%s", bill.accountNo.c_str());
+  printQueueSubmit(job);
+  return true;
+}
+
+// Jobs waiting plus the one printing
+int printQueueDepth() {
+  if (!printFreeJobs) return 0;
+  return PRINT_QUEUE_DEPTH - (int)uxQueueMessagesWaiting(printFreeJobs);
+}
+
+// ===== PRINT QUEUE STATUS LINE =====
+// A strip under the workflow screens. Only the UI task draws on the TFT,
+// so loop() polls the status through printQueueStatusTick(); a screen
+// change clears the strip, and printQueueStatusInvalidate() has it drawn
+// again.
+
+#define PRINT_STATUS_Y 208
+#define PRINT_STATUS_H 18
+
+static int printStatusShownDepth = -1;
+static int printStatusShownPercent = -1;
+static uint32_t printStatusShownDone = 0;
+static uint32_t printStatusHoldUntilMs = 0;
+
+void printQueueStatusInvalidate() {
+  printStatusShownDepth = -1;
+}
+
+// Percent of the current job's estimated time gone by, capped at 99
+static int printJobPercent() {
+  if (!isPrinting) return 0;
+  uint32_t estimate = printJobEstimateMs ? printJobEstimateMs : 1;
+  uint32_t percent = (millis() - printJobStartedMs) * 100 / estimate;
+  return percent > 99 ? 99 : (int)percent;
+}
+
+void drawPrintQueueStatus(int depth, int percent) {
+  tft.fillRect(0, PRINT_STATUS_Y, 320, PRINT_STATUS_H, COLOR_BG);
+  if (depth == 0) {
+    if (printJobsDone == 0) return;
+    tft.setTextFont(1);
+    tft.setTextSize(1);
+    tft.setTextColor(COLOR_LABEL);
+    tft.setCursor(6, PRINT_STATUS_Y + 5);
+    tft.printf("Printer idle - %lu printed", (unsigned long)printJobsDone);
+    return;
+  }
+
+  tft.setTextFont(1);
   tft.setTextSize(1);
-  tft.setCursor(60, 75);
-  tft.println(F("100%"));
-  
-  // Show completion message
   tft.setTextColor(COLOR_AMOUNT);
-  tft.setTextSize(1);
-  tft.setCursor(35, 105);
-  tft.println(F("Done!"));
-  
-  Serial.println(F("[Animation] Print complete!"));
-  delay(1000);  // Show completion for 1 second
-  
-  // Delete this task
-  vTaskDelete(NULL);
+  tft.setCursor(6, PRINT_STATUS_Y + 5);
+  tft.printf("Printing %d%%", percent);
+  tft.setTextColor(COLOR_LABEL);
+  tft.setCursor(110, PRINT_STATUS_Y + 5);
+  if (depth > 1) tft.printf("%d waiting", depth - 1);
+
+  // One box per slot, filled while it holds a job
+  for (int i = 0; i < PRINT_QUEUE_DEPTH; i++) {
+    int x = 314 - (PRINT_QUEUE_DEPTH - i) * 14;
+    if (i < depth) tft.fillRect(x, PRINT_STATUS_Y + 3, 10, 12, i == 0 ? COLOR_AMOUNT : COLOR_LABEL);
+    else tft.drawRect(x, PRINT_STATUS_Y + 3, 10, 12, COLOR_LINE);
+  }
 }
 
-// ===== START PARALLEL PRINTING =====
-void startParallelPrinting() {
-  Serial.println(F("Starting parallel print and animation tasks..."));
-  
-  // Create printer task (high priority)
-    xTaskCreatePinnedToCore(
-    printerTask,
-    "PrinterTask",
-    4096,
-    NULL,
-    1,
-    &printTaskHandle,
-    1   // ✅ CORE 1 (critical)
-    );
-  
-  // Small delay to let printer start
-  delay(100);
-  
-  // Create animation task (medium priority)
-  xTaskCreate(
-    animationTask,         // Function to execute
-    "AnimationTask",       // Task name
-    4096,                  // Stack size (words)
-    NULL,                  // Parameter
-    1,                     // Priority
-    &animationTaskHandle   // Task handle
-  );
+// Shown instead of the status when a bill finds no free slot; stays up
+// for a few seconds unless a slot frees first
+void drawPrintQueueFull() {
+  tft.fillRect(0, PRINT_STATUS_Y, 320, PRINT_STATUS_H, COLOR_BG);
+  tft.setTextFont(1);
+  tft.setTextSize(1);
+  tft.setTextColor(ST77XX_RED);
+  tft.setCursor(6, PRINT_STATUS_Y + 5);
+  tft.print(F("Print queue full - press D again shortly"));
+  printStatusShownDepth = printQueueDepth();
+  printStatusHoldUntilMs = millis() + 3000;
 }
 
-// ===== WAIT FOR PRINT COMPLETION =====
-void waitForPrintCompletion() {
-  unsigned long timeoutTime = millis() + 45000;  // 45 second timeout
-  
-  while (!printComplete && millis() < timeoutTime) {
-    delay(100);  // Check every 100ms
-  }
-  
-  if (!printComplete) {
-    Serial.println(F("WARNING: Print timeout after 45 seconds!"));
+// Redraws the strip when the queue or the progress changed; `visible` is
+// false on screens that use the bottom of the display
+void printQueueStatusTick(bool visible) {
+  if (!visible) {
+    printStatusShownDepth = -1;
+    return;
   }
+  int depth = printQueueDepth();
+  if (depth == printStatusShownDepth && (int32_t)(millis() - printStatusHoldUntilMs) < 0) return;
+  int percent = printJobPercent() / 10 * 10;
+  if (depth == printStatusShownDepth && percent == printStatusShownPercent && printJobsDone == printStatusShownDone) return;
+  drawPrintQueueStatus(depth, percent);
+  printStatusShownDepth = depth;
+  printStatusShownPercent = percent;
+  printStatusShownDone = printJobsDone;
 }
 
 #endif  // PRINT_MANAGER_H
@@ -0,0 +1,42 @@
+#ifndef RECEIPT_BUILDER_H
+#define RECEIPT_BUILDER_H
+
+#include "../configuration/config.h"
+#include "../components/escpos_buffer.h"
+#include "../database/bill_data.h"
+#include "receipt_template.h"
+
+// ===== BILL RECEIPT =====
+// The statement a print job carries (print_manager.h), rendered into the
+// job's buffer and written to UART2 in one go. The UART driver's TX ring
+// buffer is sized to hold a whole receipt (PRINTER_TX_BUFFER_SIZE, set
+// before printerSerial.begin), so the write returns at once and the driver
+// feeds the hardware FIFO from its interrupt; the printer task then only
+// waits for the paper. receipt_builder_test.cpp replays a receipt through
+// an emulated UART on a PC and reports the bytes and the minimum print
+// time.
+
+// The layout comes from the active receipt template (receipt_template.h)
+void buildBillReceipt(EscPosBuffer& out, const BillData& bill) {
+  renderReceipt(receiptTemplate, bill, out);
+}
+
+// Time for the UART to send the job at PRINTER_BAUD (8N1, 10 bits a byte)
+uint32_t receiptSendMs(const EscPosBuffer& job) {
+  return (uint32_t)(((uint64_t)job.len * 10 * 1000 + PRINTER_BAUD - 1) / PRINTER_BAUD);
+}
+
+// Shortest time the printer can take: the UART, or the paper at
+// PRINTER_DOTS_PER_SEC, whichever is slower
+uint32_t receiptPrintMs(const EscPosBuffer& job) {
+  uint32_t paperMs = (uint32_t)(((uint64_t)job.measureDots() * 1000 + PRINTER_DOTS_PER_SEC - 1) / PRINTER_DOTS_PER_SEC);
+  uint32_t sendMs = receiptSendMs(job);
+  return paperMs > sendMs ? paperMs : sendMs;
+}
+
+// Queues the whole job on the UART; returns without waiting for it to go out
+void sendReceipt(HardwareSerial& port, const EscPosBuffer& job) {
+  port.write(job.data, job.len);
+}
+
+#endif // RECEIPT_BUILDER_H
@@ -0,0 +1,135 @@
+// Host test: the bill receipt as the printer UART sees it. Renders a bill
+// through the built-in template, sends it through sendReceipt() to an
+// emulated UART and reports the bytes per receipt, the UART and paper time
+// and the theoretical minimum print time (receiptPrintMs()). For
+// comparison it also replays the same bytes with Adafruit_Thermal's pacing
+// (11 bit times a byte, 30 ms a dot row of text, 2.1 ms a dot of feed,
+// plus the wake and the 500 ms tail), which the receipt path used to wait
+// out byte by byte. From Watersystem_ESP32/:
+//
+//   g++ -std=c++17 -I. -Ihost_test managers/receipt_builder_test.cpp -lsqlite3 -o /tmp/receipt_test && /tmp/receipt_test
+
+#include "receipt_builder.h"
+#include <string>
+
+// 8N1 UART at PRINTER_BAUD that records what it is handed and when it
+// would have finished shifting it out
+class EmulatedUart : public HardwareSerial {
+ public:
+  std::string sent;
+  int writes = 0;
+  uint64_t busyUs = 0;
+
+  size_t write(const uint8_t* data, size_t len) override {
+    sent.append((const char*)data, len);
+    writes++;
+    busyUs += (uint64_t)len * 10 * 1000000 / PRINTER_BAUD;
+    return len;
+  }
+};
+
+// Seconds Adafruit_Thermal's timeoutWait() pacing spends on `s`
+static double adafruitPacingSeconds(const std::string& s) {
+  double byteUs = 11.0 * 1e6 / PRINTER_BAUD;
+  double us = 0;
+  double charHeight = 24;
+  bool lineEmpty = true;
+  for (size_t i = 0; i < s.size(); i++) {
+    uint8_t c = s[i];
+    if ((c == ESCPOS_ESC || c == ESCPOS_GS) && i + 2 < s.size()) {
+      if (c == ESCPOS_GS && s[i + 1] == '!') charHeight = s[i + 2] & 0x0F ? 48 : 24;
+      us += 3 * byteUs;
+      i += 2;
+      continue;
+    }
+    us += byteUs;
+    if (c == ESCPOS_LF) {
+      us += lineEmpty ? (charHeight + 6) * 2100 : charHeight * 30000 + 6 * 2100;
+      lineEmpty = true;
+    } else {
+      lineEmpty = false;
+    }
+  }
+  return (us + 50000 + 500000) / 1e6;
+}
+
+static int failed = 0;
+
+static void expect(bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL %s\n", what);
+    failed++;
+  }
+}
+
+int main() {
+  initReceiptTemplate();
+  expect(receiptTemplate.builtIn, "no template file, so the built-in one is used");
+
+  BillData bill;
+  bill.customerName = "JUAN DELA CRUZ SANTOS";
+  bill.accountNo = "MKL-00123";
+  bill.address = "Purok 3, Bulu-an";
+  bill.barangay = "Makilas";
+  bill.collector = "Maria Reyes";
+  bill.referenceNumber = "REF00120261";
+  bill.readingDateTime = "2026-10-19 09:41";
+  bill.dueDate = "2026-11-03";
+  bill.customerType = "Residential";
+  bill.prevReading = 1234;
+  bill.currReading = 1262;
+  bill.usage = 28;
+  bill.rate = Money::fromAmount(25);
+  bill.subtotal = Money::fromAmount(700);
+  bill.deductionName = "Senior";
+  bill.deductions = Money::fromAmount(35);
+  bill.penalty = Money::fromAmount(50);
+  bill.total = Money::fromAmount(715);
+  bill.minCharge = Money::fromAmount(150);
+  bill.minM3 = 10;
+
+  static EscPosBuffer receipt;
+  buildBillReceipt(receipt, bill);
+  EmulatedUart uart;
+  sendReceipt(uart, receipt);
+
+  uint32_t dots = receipt.measureDots();
+  uint32_t sendMs = receiptSendMs(receipt);
+  uint32_t paperMs = (uint32_t)(((uint64_t)dots * 1000 + PRINTER_DOTS_PER_SEC - 1) / PRINTER_DOTS_PER_SEC);
+  uint32_t printMs = receiptPrintMs(receipt);
+
+  expect(!receipt.overflow, "receipt fits the ESC/POS buffer");
+  expect(receipt.len <= PRINTER_TX_BUFFER_SIZE, "receipt fits the UART TX buffer, so the write does not block");
+  expect(uart.writes == 1, "the receipt goes to the UART in one write");
+  expect(uart.sent.size() == receipt.len && memcmp(uart.sent.data(), receipt.data, receipt.len) == 0, "the UART gets the buffer as rendered");
+  expect(sendMs == (uint32_t)((uart.busyUs + 999) / 1000), "receiptSendMs() matches the emulated UART");
+  expect(printMs == (paperMs > sendMs ? paperMs : sendMs), "receiptPrintMs() is the slower of UART and paper");
+  expect(uart.sent.find("MKL-00123") != std::string::npos, "account number printed");
+  expect(uart.sent.find("715.00") != std::string::npos, "total printed");
+  expect(uart.sent.find("50.00") != std::string::npos, "penalty printed");
+  expect(uart.sent.find("Disconnection Date: 2026-11-13") != std::string::npos, "disconnection date is the due date + BILL_DISCONNECT_DAYS");
+
+  // Without a due date (clock unset) there is no disconnection date to print
+  BillData undated = bill;
+  undated.dueDate = "-";
+  static EscPosBuffer undatedReceipt;
+  buildBillReceipt(undatedReceipt, undated);
+  std::string undatedText((const char*)undatedReceipt.data, undatedReceipt.len);
+  expect(undatedText.find("Disconnection") == std::string::npos, "no disconnection line without a due date");
+  BillData yearEnd = bill;
+  yearEnd.dueDate = "2026-12-28";
+  char date[RECEIPT_SLOT_TEXT_MAX];
+  receiptSlotText(RS_DISCONNECTION_DATE, yearEnd, date, sizeof(date));
+  expect(strcmp(date, "2027-01-07") == 0, "disconnection date carries into the next year");
+
+  double oldSeconds = adafruitPacingSeconds(uart.sent);
+  printf("bytes per receipt: %u of %d (TX buffer %d)\n", (unsigned)receipt.len, ESCPOS_BUFFER_SIZE, PRINTER_TX_BUFFER_SIZE);
+  printf("UART at %d baud: %u ms\n", PRINTER_BAUD, (unsigned)sendMs);
+  printf("paper: %u dots at %d dots/s: %u ms\n", (unsigned)dots, PRINTER_DOTS_PER_SEC, (unsigned)paperMs);
+  printf("theoretical minimum print time: %u ms\n", (unsigned)printMs);
+  printf("Adafruit_Thermal pacing on the same bytes: %.1f s\n", oldSeconds);
+  expect(oldSeconds * 1000 > printMs, "the burst is never slower than the paced path");
+
+  printf(failed ? "%d checks failed\n" : "all checks passed\n", failed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,529 @@
+#ifndef RECEIPT_TEMPLATE_H
+#define RECEIPT_TEMPLATE_H
+
+#include "../configuration/config.h"
+#include "../components/escpos_buffer.h"
+#include "../database/bill_data.h"
+#include <SD.h>
+
+// ===== RECEIPT TEMPLATES =====
+// The bill receipt layout as a text template, compiled once into ESC/POS
+// byte runs and slot references, so printing a bill is a memcpy per run
+// plus a few formatted fields. The active template is read from
+// RECEIPT_TEMPLATE_FILE at boot, or set by RECEIPT_TEMPLATE from the
+// server (receipt_template_sync.h); without one the built-in layout below
+// is used.
+//
+// Source format, one line at a time:
+//   text            printed as a line; {slot} is replaced by a bill field,
+//                   {slot:^10} centers it in 10 columns ('<' left, '>' right);
+//                   {{ prints '{', a line starting with !! prints one '!'
+//   !justify L|C|R  !size S|M|L  !bold on|off  !feed <n>
+//   !if <slot> ... !endif   lines kept only when the slot is non-zero /
+//                   non-empty (one level, keep !bold inside balanced)
+//   !# comment
+//
+// Compiled code is a list of ops:
+//   RT_OP_STATIC len16 bytes...   ESC/POS bytes, copied as they are
+//   RT_OP_SLOT slot align width
+//   RT_OP_IF slot skip16          skips `skip` bytes of code when empty
+
+#define RECEIPT_TEMPLATE_LINE_MAX 160
+#define RECEIPT_SLOT_TEXT_MAX 48
+
+enum ReceiptSlot : uint8_t {
+  RS_NAME,
+  RS_ACCOUNT,
+  RS_TYPE,
+  RS_ADDRESS,
+  RS_BARANGAY,
+  RS_COLLECTOR,
+  RS_REF,
+  RS_DATETIME,
+  RS_PERIOD,
+  RS_PREV,
+  RS_PRESENT,
+  RS_USAGE,
+  RS_RATE,
+  RS_CHARGE,
+  RS_DEDUCTION_NAME,
+  RS_DEDUCTION,
+  RS_PENALTY,
+  RS_TOTAL,
+  RS_DUE_DATE,
+  RS_DISCONNECTION_DATE,
+  RS_COUNT
+};
+
+static const char* const RECEIPT_SLOT_NAMES[RS_COUNT] = {
+  "name", "account", "type", "address", "barangay", "collector", "ref",
+  "datetime", "period", "prev", "present", "usage", "rate", "charge",
+  "deduction_name", "deduction", "penalty", "total", "due_date",
+  "disconnection_date",
+};
+
+enum ReceiptOp : uint8_t {
+  RT_OP_STATIC = 1,
+  RT_OP_SLOT = 2,
+  RT_OP_IF = 3
+};
+
+struct ReceiptTemplate {
+  EscPosBuffer code;
+  uint32_t sourceHash = 0;
+  bool builtIn = true;
+};
+
+// Compiler state between receiptTemplateLine() calls
+struct ReceiptTemplateCompiler {
+  ReceiptTemplate* out = nullptr;
+  int runStart = -1;  // header of the open RT_OP_STATIC, -1 when none
+  int ifStart = -1;   // the open RT_OP_IF, -1 when none
+  int line = 0;
+  const char* error = nullptr;
+};
+
+ReceiptTemplate receiptTemplate;
+
+static const char RECEIPT_BUILTIN_TEMPLATE[] =
+  "!feed 1\n"
+  "!justify C\n"
+  "[PLACEHOLDER]\n"
+  "\n"
+  "!size S\n"
+  "DONA JOSEFA M. BULU-AN CAPARAN\n"
+  "Water & Sanitation Assoc.\n"
+  "Bulu-an, IPIL, Zambo. Sibugay\n"
+  "TIN: 464-252-005-000\n"
+  "\n"
+  "--------------------------------\n"
+  "!bold on\n"
+  "STATEMENT OF ACCOUNT\n"
+  "!bold off\n"
+  "--------------------------------\n"
+  "!justify L\n"
+  "Ref No       : {ref}\n"
+  "Date/Time    : {datetime}\n"
+  "--------------------------------\n"
+  "Customer : {name}\n"
+  "Account  : {account}\n"
+  "Classification: {type}\n"
+  "Address  : {address}\n"
+  "Barangay : {barangay}\n"
+  "--------------------------------\n"
+  "!justify C\n"
+  "Collector\n"
+  "{collector}\n"
+  "\n"
+  "--------------------------------\n"
+  "!bold on\n"
+  "Period Covered\n"
+  "!bold off\n"
+  "{period}\n"
+  "\n"
+  "!bold on\n"
+  "METER READINGS\n"
+  "!bold off\n"
+  "   Prev     Present     Usage   \n"
+  "{prev:^10}{present:^12}{usage:^10}\n"
+  "--------------------------------\n"
+  "!bold on\n"
+  "BILLING\n"
+  "!bold off\n"
+  "\n"
+  "!justify L\n"
+  "Rate/m3  : PHP {rate}\n"
+  "Water Charge : PHP {charge}\n"
+  "!if deduction\n"
+  "{deduction_name} : PHP -{deduction}\n"
+  "!endif\n"
+  "!if penalty\n"
+  "Penalty  : PHP {penalty}\n"
+  "!endif\n"
+  "\n"
+  "================================\n"
+  "!justify C\n"
+  "!size M\n"
+  "!bold on\n"
+  "*** TOTAL AMOUNT DUE ***\n"
+  "!size L\n"
+  "PHP {total}\n"
+  "!bold off\n"
+  "!size S\n"
+  "================================\n"
+  "\n"
+  "!justify L\n"
+  "!bold on\n"
+  "Due Date     : {due_date}\n"
+  "!if disconnection_date\n"
+  "Disconnection Date: {disconnection_date}\n"
+  "!endif\n"
+  "!bold off\n"
+  "--------------------------------\n"
+  "\n"
+  "REMAINDERS:\n"
+  "- Please pay by the due date to avoid disconnection.\n"
+  "- Bring this bill when paying.\n"
+  "- For inquiries, contact the office.\n"
+  "!justify C\n"
+  "\n"
+  "Please pay on or before due date\n"
+  "to avoid penalties.\n"
+  "\n"
+  "Thank you!\n"
+  "Save Water, Save Life!\n"
+  "!justify L\n"
+  "!feed 4\n";
+
+// "Jan 2026 - Feb 2026": the build month and the next, as printed so far
+void receiptPeriodCovered(char* out, size_t size) {
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  const char* date = __DATE__;  // "Mmm dd yyyy"
+  int month = -1;
+  for (int i = 0; i < 12; i++) {
+    if (strncmp(months + i * 3, date, 3) == 0) {
+      month = i;
+      break;
+    }
+  }
+  if (month < 0) {
+    snprintf(out, size, "Unknown Period");
+    return;
+  }
+  int year = atoi(date + 7);
+  int next = (month + 1) % 12;
+  snprintf(out, size, "%.3s %d - %.3s %d", months + month * 3, year, months + next * 3, next == 0 ? year + 1 : year);
+}
+
+static size_t receiptCopy(const String& value, char* out, size_t size) {
+  size_t n = value.length() < size - 1 ? value.length() : size - 1;
+  memcpy(out, value.c_str(), n);
+  out[n] = '\0';
+  return n;
+}
+
+// due_date + BILL_DISCONNECT_DAYS, empty while the bill has no due date
+static size_t receiptDisconnectionDate(const String& dueDate, char* out, size_t size) {
+  int year, month, day;
+  if (sscanf(dueDate.c_str(), "%4d-%2d-%2d", &year, &month, &day) != 3) {
+    out[0] = '\0';
+    return 0;
+  }
+  struct tm t = {};
+  t.tm_year = year - 1900;
+  t.tm_mon = month - 1;
+  t.tm_mday = day + BILL_DISCONNECT_DAYS;  // mktime() carries into the month and year
+  t.tm_hour = 12;
+  mktime(&t);
+  return strftime(out, size, "%Y-%m-%d", &t);
+}
+
+static size_t receiptNumber(unsigned long value, char* out, size_t size) {
+  int n = snprintf(out, size, "%lu", value);
+  return n < 0 ? 0 : (size_t)n;
+}
+
+// Text of one slot for `bill`; returns its length
+size_t receiptSlotText(ReceiptSlot slot, const BillData& bill, char* out, size_t size) {
+  switch (slot) {
+    case RS_NAME: return receiptCopy(bill.customerName, out, size);
+    case RS_ACCOUNT: return receiptCopy(bill.accountNo, out, size);
+    case RS_TYPE: return receiptCopy(bill.customerType, out, size);
+    case RS_ADDRESS: return receiptCopy(bill.address, out, size);
+    case RS_BARANGAY: return receiptCopy(bill.barangay, out, size);
+    case RS_COLLECTOR: return receiptCopy(bill.collector, out, size);
+    case RS_REF: return receiptCopy(bill.referenceNumber, out, size);
+    case RS_DATETIME: return receiptCopy(bill.readingDateTime, out, size);
+    case RS_PERIOD:
+      receiptPeriodCovered(out, size);
+      return strlen(out);
+    case RS_PREV: return receiptNumber(bill.prevReading, out, size);
+    case RS_PRESENT: return receiptNumber(bill.currReading, out, size);
+    case RS_USAGE: return receiptNumber(bill.currReading - bill.prevReading, out, size);
+    case RS_RATE: return bill.rate.format(out, size);
+    case RS_CHARGE: return bill.subtotal.format(out, size);
+    case RS_DEDUCTION_NAME: return receiptCopy(bill.deductionName, out, size);
+    case RS_DEDUCTION: return bill.deductions.format(out, size);
+    case RS_PENALTY: return bill.penalty.format(out, size);
+    case RS_TOTAL: return bill.total.format(out, size);
+    case RS_DUE_DATE: return receiptCopy(bill.dueDate, out, size);
+    case RS_DISCONNECTION_DATE: return receiptDisconnectionDate(bill.dueDate, out, size);
+    default:
+      out[0] = '\0';
+      return 0;
+  }
+}
+
+// What !if tests: amounts and readings non-zero, text non-empty
+bool receiptSlotSet(ReceiptSlot slot, const BillData& bill) {
+  switch (slot) {
+    case RS_PREV: return bill.prevReading != 0;
+    case RS_PRESENT: return bill.currReading != 0;
+    case RS_USAGE: return bill.currReading != bill.prevReading;
+    case RS_RATE: return bill.rate != Money();
+    case RS_CHARGE: return bill.subtotal != Money();
+    case RS_DEDUCTION: return bill.deductions != Money();
+    case RS_PENALTY: return bill.penalty != Money();
+    case RS_TOTAL: return bill.total != Money();
+    default: {
+      char text[RECEIPT_SLOT_TEXT_MAX];
+      return receiptSlotText(slot, bill, text, sizeof(text)) > 0;
+    }
+  }
+}
+
+static int receiptSlotOf(const char* name, size_t n) {
+  for (int i = 0; i < RS_COUNT; i++) {
+    if (strlen(RECEIPT_SLOT_NAMES[i]) == n && strncmp(RECEIPT_SLOT_NAMES[i], name, n) == 0) return i;
+  }
+  return -1;
+}
+
+static void receiptOpenRun(ReceiptTemplateCompiler& c) {
+  if (c.runStart >= 0) return;
+  c.runStart = (int)c.out->code.len;
+  uint8_t header[3] = {RT_OP_STATIC, 0, 0};
+  c.out->code.raw(header, sizeof(header));
+}
+
+static void receiptCloseRun(ReceiptTemplateCompiler& c) {
+  if (c.runStart < 0) return;
+  EscPosBuffer& code = c.out->code;
+  size_t n = code.len - c.runStart - 3;
+  if (n == 0) {
+    code.len = c.runStart;  // nothing was written
+  } else {
+    code.data[c.runStart + 1] = n & 0xFF;
+    code.data[c.runStart + 2] = n >> 8;
+  }
+  c.runStart = -1;
+}
+
+void receiptTemplateBegin(ReceiptTemplateCompiler& c, ReceiptTemplate& out) {
+  c = ReceiptTemplateCompiler();
+  c.out = &out;
+  out.code.clear();
+  out.sourceHash = 2166136261UL;
+  out.builtIn = false;
+}
+
+// Text line with {slot} fields
+static bool receiptTextLine(ReceiptTemplateCompiler& c, const char* s, size_t n) {
+  EscPosBuffer& code = c.out->code;
+  size_t i = 0;
+  if (n >= 2 && s[0] == '!' && s[1] == '!') i = 1;
+  size_t start = i;
+  while (i < n) {
+    if (s[i] != '{') {
+      i++;
+      continue;
+    }
+    receiptOpenRun(c);
+    code.text(s + start, i - start);
+    if (i + 1 < n && s[i + 1] == '{') {
+      code.text("{", 1);
+      i += 2;
+      start = i;
+      continue;
+    }
+    const char* close = (const char*)memchr(s + i, '}', n - i);
+    if (!close) {
+      c.error = "UNCLOSED_SLOT";
+      return false;
+    }
+    const char* name = s + i + 1;
+    const char* colon = (const char*)memchr(name, ':', close - name);
+    int slot = receiptSlotOf(name, (colon ? colon : close) - name);
+    if (slot < 0) {
+      c.error = "UNKNOWN_SLOT";
+      return false;
+    }
+    char align = '<';
+    int width = 0;
+    if (colon) {
+      align = colon[1];
+      if (align != '<' && align != '>' && align != '^') {
+        c.error = "BAD_FORMAT";
+        return false;
+      }
+      width = atoi(colon + 2);
+      if (width < 0 || width > 32) {
+        c.error = "BAD_FORMAT";
+        return false;
+      }
+    }
+    receiptCloseRun(c);
+    uint8_t op[4] = {RT_OP_SLOT, (uint8_t)slot, (uint8_t)align, (uint8_t)width};
+    code.raw(op, sizeof(op));
+    i = close - s + 1;
+    start = i;
+  }
+  receiptOpenRun(c);
+  code.text(s + start, n - start);
+  code.feed(1);
+  return true;
+}
+
+static bool receiptDirective(ReceiptTemplateCompiler& c, const char* s, size_t n) {
+  EscPosBuffer& code = c.out->code;
+  char word[16];
+  char arg[24];
+  char line[RECEIPT_TEMPLATE_LINE_MAX + 1];
+  memcpy(line, s, n);
+  line[n] = '\0';
+  arg[0] = '\0';
+  if (sscanf(line, "!%15s %23s", word, arg) < 1) {
+    c.error = "BAD_DIRECTIVE";
+    return false;
+  }
+
+  if (word[0] == '#') return true;
+  if (strcmp(word, "if") == 0) {
+    int slot = receiptSlotOf(arg, strlen(arg));
+    if (slot < 0) {
+      c.error = "UNKNOWN_SLOT";
+      return false;
+    }
+    if (c.ifStart >= 0) {
+      c.error = "NESTED_IF";
+      return false;
+    }
+    receiptCloseRun(c);
+    c.ifStart = (int)code.len;
+    uint8_t op[4] = {RT_OP_IF, (uint8_t)slot, 0, 0};
+    code.raw(op, sizeof(op));
+    return true;
+  }
+  if (strcmp(word, "endif") == 0) {
+    if (c.ifStart < 0) {
+      c.error = "UNBALANCED_IF";
+      return false;
+    }
+    receiptCloseRun(c);
+    size_t skip = code.len - c.ifStart - 4;
+    code.data[c.ifStart + 2] = skip & 0xFF;
+    code.data[c.ifStart + 3] = skip >> 8;
+    c.ifStart = -1;
+    return true;
+  }
+
+  receiptOpenRun(c);
+  if (strcmp(word, "justify") == 0 && arg[0] && strchr("LCRlcr", arg[0])) {
+    code.justify(arg[0]);
+  } else if (strcmp(word, "size") == 0 && arg[0] && strchr("SMLsml", arg[0])) {
+    code.size(arg[0]);
+  } else if (strcmp(word, "bold") == 0 && (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0)) {
+    code.bold(strcmp(arg, "on") == 0);
+  } else if (strcmp(word, "feed") == 0 && atoi(arg) > 0 && atoi(arg) <= 20) {
+    code.feed(atoi(arg));
+  } else {
+    c.error = "BAD_DIRECTIVE";
+    return false;
+  }
+  return true;
+}
+
+// One source line, without its '\n'; false with c.error set on a mistake
+bool receiptTemplateLine(ReceiptTemplateCompiler& c, const char* s, size_t n) {
+  c.line++;
+  if (n > 0 && s[n - 1] == '\r') n--;
+  for (size_t i = 0; i < n; i++) c.out->sourceHash = (c.out->sourceHash ^ (uint8_t)s[i]) * 16777619UL;
+  c.out->sourceHash = (c.out->sourceHash ^ '\n') * 16777619UL;
+  if (n > RECEIPT_TEMPLATE_LINE_MAX) {
+    c.error = "LINE_TOO_LONG";
+    return false;
+  }
+
+  bool ok = (n > 0 && s[0] == '!' && !(n >= 2 && s[1] == '!')) ? receiptDirective(c, s, n) : receiptTextLine(c, s, n);
+  if (ok && c.out->code.overflow) {
+    c.error = "TOO_LARGE";
+    return false;
+  }
+  return ok;
+}
+
+bool receiptTemplateEnd(ReceiptTemplateCompiler& c) {
+  receiptCloseRun(c);
+  if (c.ifStart >= 0) {
+    c.error = "UNBALANCED_IF";
+    return false;
+  }
+  return true;
+}
+
+// Compiles a whole source held in memory
+bool compileReceiptTemplate(const char* source, size_t len, ReceiptTemplate& out, ReceiptTemplateCompiler& c) {
+  receiptTemplateBegin(c, out);
+  size_t start = 0;
+  while (start < len) {
+    const char* nl = (const char*)memchr(source + start, '\n', len - start);
+    size_t end = nl ? nl - source : len;
+    if (!receiptTemplateLine(c, source + start, end - start)) return false;
+    start = end + 1;
+  }
+  return receiptTemplateEnd(c);
+}
+
+void useBuiltInReceiptTemplate() {
+  ReceiptTemplateCompiler c;
+  compileReceiptTemplate(RECEIPT_BUILTIN_TEMPLATE, sizeof(RECEIPT_BUILTIN_TEMPLATE) - 1, receiptTemplate, c);
+  receiptTemplate.builtIn = true;
+}
+
+// Compiles RECEIPT_TEMPLATE_FILE line by line into receiptTemplate; the
+// built-in layout when there is no file or it does not compile
+void initReceiptTemplate() {
+  File file = SD.open(RECEIPT_TEMPLATE_FILE, FILE_READ);
+  if (!file) {
+    useBuiltInReceiptTemplate();
+    return;
+  }
+
+  ReceiptTemplateCompiler c;
+  receiptTemplateBegin(c, receiptTemplate);
+  char line[RECEIPT_TEMPLATE_LINE_MAX + 2];
+  bool ok = true;
+  while (ok && file.available()) {
+    size_t n = file.readBytesUntil('\n', line, sizeof(line));
+    ok = receiptTemplateLine(c, line, n);
+  }
+  file.close();
+  if (ok) ok = receiptTemplateEnd(c);
+
+  if (!ok) {
+    Serial.printf("Receipt template line %d: %s, using the built-in one\n", c.line, c.error);
+    useBuiltInReceiptTemplate();
+    return;
+  }
+  Serial.printf("Receipt template loaded: %u bytes\n", (unsigned)receiptTemplate.code.len);
+}
+
+// Renders `bill` through the template into `out`
+void renderReceipt(const ReceiptTemplate& t, const BillData& bill, EscPosBuffer& out) {
+  out.clear();
+  out.defaults();
+  const uint8_t* code = t.code.data;
+  size_t n = t.code.len;
+  size_t p = 0;
+  while (p < n) {
+    uint8_t op = code[p];
+    if (op == RT_OP_STATIC && p + 3 <= n) {
+      size_t len = code[p + 1] | (code[p + 2] << 8);
+      out.raw(code + p + 3, len);
+      p += 3 + len;
+    } else if (op == RT_OP_SLOT && p + 4 <= n) {
+      char text[RECEIPT_SLOT_TEXT_MAX];
+      size_t len = receiptSlotText((ReceiptSlot)code[p + 1], bill, text, sizeof(text));
+      out.field(text, len, (char)code[p + 2], code[p + 3]);
+      p += 4;
+    } else if (op == RT_OP_IF && p + 4 <= n) {
+      size_t skip = code[p + 2] | (code[p + 3] << 8);
+      p += 4;
+      if (!receiptSlotSet((ReceiptSlot)code[p - 3], bill)) p += skip;
+    } else {
+      break;  // corrupt code
+    }
+  }
+}
+
+#endif // RECEIPT_TEMPLATE_H
@@ -0,0 +1,145 @@
+#ifndef SERIAL_RX_MANAGER_H
+#define SERIAL_RX_MANAGER_H
+
+#include <Arduino.h>
+#include "../configuration/config.h"
+
+// ===== SERIAL RX TASK =====
+// A task on core 0 drains the UART and frames lines into two bounded frame
+// buffers. loop() takes a finished frame, hands the buffer straight back
+// and runs the command while the RX task fills the other buffer, so
+// reception overlaps JSON parsing and SQLite commits. With both frames
+// full the task stops reading and bytes wait in the (small) UART buffer.
+//
+// Frames are filled and emptied through two queues of buffer indexes:
+//   free  -> RX task fills the frame -> ready -> loop() copies it -> free
+// A line longer than SERIAL_FRAME_MAX is dropped. A chunk line
+// (<NAME>_CHUNK|<index>|...) is answered NAK|CHUNK|<index>|LINE_TOO_LONG
+// like any other rejected chunk, so a windowed sender hears about it at
+// once; anything else gets ERR|LINE_TOO_LONG|<start of line>.
+
+struct SerialFrame {
+  char* data = nullptr;
+  size_t len = 0;
+  bool overflow = false;
+};
+
+static SerialFrame serialFrames[2];
+static QueueHandle_t serialFreeFrames = NULL;
+static QueueHandle_t serialReadyFrames = NULL;
+static volatile bool serialRxDropPartial = false;
+TaskHandle_t serialRxTaskHandle = NULL;
+
+static void serialRxTask(void* parameter) {
+  uint8_t buf[256];
+  uint8_t idx;
+  xQueueReceive(serialFreeFrames, &idx, portMAX_DELAY);
+  SerialFrame* frame = &serialFrames[idx];
+
+  for (;;) {
+    int n = Serial.available();
+    if (n <= 0) {
+      vTaskDelay(1);
+      continue;
+    }
+    n = Serial.read(buf, n < (int)sizeof(buf) ? n : sizeof(buf));
+
+    if (serialRxDropPartial) {
+      serialRxDropPartial = false;
+      frame->len = 0;
+      frame->overflow = false;
+    }
+
+    for (int i = 0; i < n; i++) {
+      char c = (char)buf[i];
+      if (c == '\r') continue;
+      if (c != '\n') {
+        if (frame->len < SERIAL_FRAME_MAX - 1) {
+          frame->data[frame->len++] = c;
+        } else {
+          frame->overflow = true;
+        }
+        continue;
+      }
+
+      frame->data[frame->len] = '\0';
+      xQueueSend(serialReadyFrames, &idx, portMAX_DELAY);
+      // Blocks while loop() is still busy with the other frame
+      xQueueReceive(serialFreeFrames, &idx, portMAX_DELAY);
+      frame = &serialFrames[idx];
+      frame->len = 0;
+      frame->overflow = false;
+    }
+  }
+}
+
+// Allocates the frame buffers and starts the RX task; call after Serial.begin
+bool startSerialRx() {
+  serialFreeFrames = xQueueCreate(2, sizeof(uint8_t));
+  serialReadyFrames = xQueueCreate(2, sizeof(uint8_t));
+  if (!serialFreeFrames || !serialReadyFrames) return false;
+
+  for (uint8_t i = 0; i < 2; i++) {
+    serialFrames[i].data = (char*)malloc(SERIAL_FRAME_MAX);
+    if (!serialFrames[i].data) {
+      Serial.println(F("Serial RX: frame allocation failed"));
+      return false;
+    }
+    xQueueSend(serialFreeFrames, &i, 0);
+  }
+
+  return xTaskCreatePinnedToCore(
+    serialRxTask,        // Task function
+    "SerialRxTask",      // Task name
+    4096,                // Stack size (bytes)
+    NULL,                // Parameters
+    2,                   // Priority (above loop so the UART keeps draining)
+    &serialRxTaskHandle, // Task handle
+    0                    // Core 0 (loop() runs on core 1)
+  ) == pdPASS;
+}
+
+// Chunk index of a line starting <NAME>_CHUNK|<index>|, or -1
+static long serialChunkIndex(const char* line) {
+  const char* bar = strchr(line, '|');
+  if (!bar || bar - line < 6 || strncmp(bar - 6, "_CHUNK", 6) != 0) return -1;
+  const char* digits = bar + 1;
+  const char* end = digits;
+  while (*end >= '0' && *end <= '9' && end - digits < 9) end++;
+  if (end == digits || *end != '|') return -1;
+  return strtol(digits, nullptr, 10);
+}
+
+// Takes the next complete line, waiting up to timeoutMs. The frame goes
+// back to the RX task as soon as it has been copied.
+bool serialNextLine(String& out, uint32_t timeoutMs = 0) {
+  uint8_t idx;
+  if (!serialReadyFrames || xQueueReceive(serialReadyFrames, &idx, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+    return false;
+  }
+
+  SerialFrame* frame = &serialFrames[idx];
+  bool ok = !frame->overflow;
+  if (ok) {
+    out = frame->data;
+  } else {
+    out = "";
+    long chunk = serialChunkIndex(frame->data);
+    if (chunk >= 0) {
+      Serial.printf("NAK|CHUNK|%ld|LINE_TOO_LONG\n", chunk);
+    } else {
+      frame->data[48] = '\0';
+      Serial.print(F("ERR|LINE_TOO_LONG|"));
+      Serial.println(frame->data);
+    }
+  }
+  xQueueSend(serialFreeFrames, &idx, portMAX_DELAY);
+  return ok;
+}
+
+// Drops the line being received (bytes garbled by a baud switch)
+void serialDiscardPartial() {
+  serialRxDropPartial = true;
+}
+
+#endif // SERIAL_RX_MANAGER_H
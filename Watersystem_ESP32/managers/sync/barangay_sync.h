@@ -2,6 +2,8 @@
 #define BARANGAY_SYNC_H
 
 #include "../../database/barangay_database.h"
+#include "sync_stats.h"
+#include "upsert_engine.h"
 
 // ===== BARANGAY SYNC OPERATIONS =====
 
@@ -36,7 +38,15 @@ bool handleUpsertBarangay(String payload) {
   unsigned long createdAt = (unsigned long)createdStr.toInt();
   unsigned long updatedAt = (unsigned long)updatedStr.toInt();
 
-  if (upsertBarangayFromSync(brgyId, barangay, prefix, nextNumber, createdAt, updatedAt)) {
+  SyncStat stat;
+  stat.rows = 1;
+  stat.bytes = payload.length();
+  uint32_t t0 = micros();
+  bool ok = upsertBarangayFromSync(brgyId, barangay, prefix, nextNumber, createdAt, updatedAt);
+  stat.sqlUs = micros() - t0;
+  syncStatRecord("UPSERT", "BARANGAY", 0, stat);
+
+  if (ok) {
     Serial.print(F("ACK|UPSERT|"));
     Serial.println(barangay);
   } else {
@@ -46,4 +56,26 @@ bool handleUpsertBarangay(String payload) {
   return true;
 }
 
+// ===== BATCH UPSERT =====
+// UPSERT_BARANGAYS_JSON_CHUNK, same protocol as UPSERT_DEDUCTIONS_JSON_CHUNK;
+// ends with ACK|UPSERT_BARANGAYS|<rows>.
+static const UpsertColumn BARANGAY_UPSERT_COLUMNS[] = {
+  {"brgy_id", UPSERT_INT, UPSERT_FLAG_KEY, nullptr, 0},
+  {"barangay", UPSERT_TEXT, 0, "", 0},
+  {"prefix", UPSERT_TEXT, 0, "", 0},
+  {"next_number", UPSERT_INT, 0, nullptr, 0},
+  {"updated_at", UPSERT_INT, 0, nullptr, 0},
+};
+
+static const UpsertSpec BARANGAY_UPSERT_SPEC = {
+  "BARANGAYS", "barangay_sequence", BARANGAY_UPSERT_COLUMNS,
+  sizeof(BARANGAY_UPSERT_COLUMNS) / sizeof(BARANGAY_UPSERT_COLUMNS[0]),
+  UPSERT_REPLACE, false, 8192, "UPSERT_BARANGAYS", loadBarangaysFromDB
+};
+
+// Handle UPSERT_BARANGAYS_JSON_CHUNK command
+bool handleUpsertBarangaysJsonChunk(String payload) {
+  return runChunkUpsert(BARANGAY_UPSERT_SPEC, payload);
+}
+
 #endif // BARANGAY_SYNC_H
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef BATCH_BILL_SYNC_H
+#define BATCH_BILL_SYNC_H
+
+#include "../../configuration/config.h"
+#include "../../database/batch_billing.h"
+
+// ===== BATCH BILL =====
+//   BATCH_BILL|<YYYY-MM>[|<rows per chunk>]
+//     BEGIN_BATCH_BILL|<YYYY-MM>|<readings without a bill>
+//     STAT|BATCH:BILLS|...                                  one per chunk
+//     BATCH_BILL_PROGRESS|<billed>|<readings>|<elapsed_ms>  one per chunk
+//     END_BATCH_BILL|<billed>|<skipped>|<elapsed_ms>|<bills per second>
+//   ERR|BATCH_BILL|BAD_PERIOD
+//   ERR|BATCH_BILL|DB_ERROR or NO_ID_LEASE|<billed>   after the chunks that committed
+// Readings skipped are those whose customer type has no tariff plan.
+// NO_ID_LEASE: the bills lease ran short; sync to top it up and run again.
+
+// Handle BATCH_BILL command
+bool handleBatchBill(String payload) {
+  int sep = payload.indexOf('|');
+  String period = sep >= 0 ? payload.substring(0, sep) : payload;
+  int chunkRows = sep >= 0 ? payload.substring(sep + 1).toInt() : BATCH_BILL_CHUNK_ROWS;
+  if (chunkRows <= 0) chunkRows = BATCH_BILL_CHUNK_ROWS;
+  period.trim();
+
+  int64_t from = 0;
+  int64_t to = 0;
+  if (!db || !batchBillPeriodBounds(period, from, to)) {
+    Serial.println(F("ERR|BATCH_BILL|BAD_PERIOD"));
+    return true;
+  }
+
+  BatchBillResult result;
+  if (!runBatchBilling(from, to, period, chunkRows, result)) {
+    Serial.printf("ERR|BATCH_BILL|%s|%lld\n", result.error ? result.error : "DB_ERROR", (long long)result.billed);
+    return true;
+  }
+
+  unsigned long perSecond = result.elapsedMs > 0 ? (unsigned long)(result.billed * 1000 / result.elapsedMs) : (unsigned long)result.billed;
+  Serial.printf("END_BATCH_BILL|%lld|%lld|%lu|%lu\n", (long long)result.billed,
+                (long long)(result.candidates - result.billed), (unsigned long)result.elapsedMs, perSecond);
+  return true;
+}
+
+#endif // BATCH_BILL_SYNC_H
@@ -3,141 +3,97 @@
 
 #include "../../database/bill_transaction_database.h"
 #include "../../configuration/config.h"
+#include "sync_compress.h"
+#include "upsert_engine.h"
+#include "export_engine.h"
 #include <ArduinoJson.h>
 #include <vector>
 
 // ===== BILL TRANSACTION SYNC OPERATIONS =====
 
+static const ExportColumn BILL_TRANSACTION_EXPORT_COLUMNS[] = {
+  {"bill_transaction_id", EXPORT_INT, EXPORT_FLAG_DELTA},
+  {"bill_id", EXPORT_INT, EXPORT_FLAG_DELTA},
+  {"bill_reference_number", EXPORT_TEXT, 0},
+  {"type", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"source", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"amount", EXPORT_MONEY, 0},
+  {"cash_received", EXPORT_MONEY, 0},
+  {"change", EXPORT_MONEY, 0},
+  {"transaction_date", EXPORT_TEXT, 0},
+  {"payment_method", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"processed_by_device_uid", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"notes", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"created_at", EXPORT_TEXT, 0},
+  {"updated_at", EXPORT_TEXT, 0},
+};
+
+// status is the status of the bill the transaction belongs to
+static const ExportFilter BILL_TRANSACTION_EXPORT_FILTERS[] = {
+  {"from", "transaction_date >= ?", EXPORT_TEXT},
+  {"to", "transaction_date < date(?, '+1 day')", EXPORT_TEXT},
+  {"brgy", "bill_id IN (SELECT bill_id FROM bills WHERE customer_id IN (SELECT customer_id FROM customers WHERE brgy_id = ?))", EXPORT_INT},
+  {"status", "bill_id IN (SELECT bill_id FROM bills WHERE status = ?)", EXPORT_TEXT},
+  {"type", "type = ?", EXPORT_TEXT},
+  {"device", "processed_by_device_uid = ?", EXPORT_TEXT},
+};
+
+static const ExportSpec BILL_TRANSACTION_EXPORT_SPEC = {
+  "BILL_TRANSACTIONS",
+  "SELECT COUNT(*) FROM bill_transactions;",
+  "SELECT bill_transaction_id, bill_id, bill_reference_number, type, source, amount, cash_received, change, transaction_date, payment_method, processed_by_device_uid, notes, created_at, updated_at FROM bill_transactions ORDER BY bill_transaction_id LIMIT ? OFFSET ?;",
+  BILL_TRANSACTION_EXPORT_COLUMNS,
+  sizeof(BILL_TRANSACTION_EXPORT_COLUMNS) / sizeof(BILL_TRANSACTION_EXPORT_COLUMNS[0]),
+  50,
+  "SELECT COUNT(*) FROM bill_transactions WHERE change_seq > ?;",
+  "SELECT bill_transaction_id, bill_id, bill_reference_number, type, source, amount, cash_received, change, transaction_date, payment_method, processed_by_device_uid, notes, created_at, updated_at, change_seq FROM bill_transactions WHERE change_seq > ? ORDER BY change_seq LIMIT ?;",
+  "SELECT COALESCE(MAX(change_seq), 0) FROM bill_transactions;",
+  "bill_transactions",
+  "bill_transaction_id, bill_id, bill_reference_number, type, source, amount, cash_received, change, transaction_date, payment_method, processed_by_device_uid, notes, created_at, updated_at",
+  "bill_transaction_id",
+  BILL_TRANSACTION_EXPORT_FILTERS,
+  sizeof(BILL_TRANSACTION_EXPORT_FILTERS) / sizeof(BILL_TRANSACTION_EXPORT_FILTERS[0])
+};
+
 // Handle EXPORT_BILL_TRANSACTIONS command
-bool handleExportBillTransactions() {
+// Args: since=<change_seq> and/or filters, see runTableExport
+bool handleExportBillTransactions(String args) {
   Serial.println(F("Exporting bill transactions..."));
-  const int CHUNK_SIZE = 50;
-  int totalTransactions = getTotalBillTransactions();
-  int totalChunks = (totalTransactions + CHUNK_SIZE - 1) / CHUNK_SIZE;
-  Serial.print(F("BEGIN_BILL_TRANSACTIONS_JSON|"));
-  Serial.println(totalChunks);
-  int offset = 0;
-  for (int chunk = 0; chunk < totalChunks; ++chunk) {
-    Serial.printf("Heap free before chunk %d: %d\n", chunk, ESP.getFreeHeap());
-    std::vector<BillTransaction> transactionsChunk = getBillTransactionsChunk(offset, CHUNK_SIZE);
-    DynamicJsonDocument doc(65536);
-    JsonArray arr = doc.to<JsonArray>();
-    for (const auto& bt : transactionsChunk) {
-      JsonObject obj = arr.createNestedObject();
-      obj["bill_transaction_id"] = bt.bill_transaction_id;
-      obj["bill_id"] = bt.bill_id;
-      obj["bill_reference_number"] = bt.bill_reference_number;
-      obj["type"] = bt.type;
-      obj["source"] = bt.source;
-      obj["amount"] = bt.amount;
-      obj["cash_received"] = bt.cash_received;
-      obj["change"] = bt.change;
-      obj["transaction_date"] = bt.transaction_date;
-      obj["payment_method"] = bt.payment_method;
-      obj["processed_by_device_uid"] = bt.processed_by_device_uid;
-      obj["notes"] = bt.notes;
-      obj["created_at"] = bt.created_at;
-      obj["updated_at"] = bt.updated_at;
-    }
-    Serial.print(F("BILL_TRANSACTIONS_CHUNK|"));
-    Serial.print(chunk);
-    Serial.print(F("|"));
-    serializeJson(arr, Serial);
-    Serial.println();
-    Serial.printf("Heap free after chunk %d: %d\n", chunk, ESP.getFreeHeap());
-    offset += transactionsChunk.size();
-  }
-  Serial.println(F("END_BILL_TRANSACTIONS_JSON"));
-  return true;
+  return runTableExport(BILL_TRANSACTION_EXPORT_SPEC, args);
 }
 
-// Handle UPSERT_BILL_TRANSACTIONS_JSON_CHUNK command
-bool handleUpsertBillTransactionsJsonChunk(String payload) {
-  int p1 = payload.indexOf('|');
-  int p2 = (p1 >= 0) ? payload.indexOf('|', p1 + 1) : -1;
-  if (p1 < 0 || p2 < 0) {
-    Serial.println(F("ERR|BAD_CHUNK_FORMAT"));
-    return true;
-  }
-
-  int chunkIndex = payload.substring(0, p1).toInt();
-  int totalChunks = payload.substring(p1 + 1, p2).toInt();
-  String jsonChunk = payload.substring(p2 + 1);
-  jsonChunk.replace("\\|", "|");
-
-  // Parse the JSON chunk (it's an array of bill transactions)
-  DynamicJsonDocument doc(16384); // 16KB should be enough for transactions
-  Serial.println(F("About to deserialize JSON for bill transactions"));
-  DeserializationError error = deserializeJson(doc, jsonChunk);
-  if (error) {
-    Serial.print(F("ERR|JSON_PARSE_FAIL|"));
-    Serial.println(error.c_str());
-    return true;
-  }
-
-  JsonArray arr = doc.as<JsonArray>();
-  int count = arr.size();
-  Serial.printf("Processing %d bill transactions in chunk %d/%d\n", count, chunkIndex + 1, totalChunks);
-
-  sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
-
-  for (JsonObject obj : arr) {
-    int bill_transaction_id = obj["bill_transaction_id"];
-    int bill_id = obj["bill_id"];
-    String bill_reference_number = obj["bill_reference_number"];
-    String type = obj["type"];
-    String source = obj["source"];
-    float amount = obj["amount"];
-    float cash_received = obj["cash_received"];
-    float change = obj["change"];
-    String transaction_date = obj["transaction_date"];
-    String payment_method = obj["payment_method"];
-    String processed_by_device_uid = obj["processed_by_device_uid"];
-    String notes = obj["notes"];
-    String created_at = obj["created_at"];
-    String updated_at = obj["updated_at"];
-
-    // Upsert logic: INSERT OR REPLACE
-    const char* sql = "INSERT OR REPLACE INTO bill_transactions (bill_transaction_id, bill_id, bill_reference_number, type, source, amount, cash_received, change, transaction_date, payment_method, processed_by_device_uid, notes, created_at, updated_at) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc == SQLITE_OK) {
-      sqlite3_bind_int(stmt, 1, bill_transaction_id);
-      sqlite3_bind_int(stmt, 2, bill_id);
-      sqlite3_bind_text(stmt, 3, bill_reference_number.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(stmt, 4, type.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(stmt, 5, source.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_double(stmt, 6, amount);
-      sqlite3_bind_double(stmt, 7, cash_received);
-      sqlite3_bind_double(stmt, 8, change);
-      sqlite3_bind_text(stmt, 9, transaction_date.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(stmt, 10, payment_method.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(stmt, 11, processed_by_device_uid.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(stmt, 12, notes.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(stmt, 13, created_at.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(stmt, 14, updated_at.c_str(), -1, SQLITE_TRANSIENT);
-
-      int step = sqlite3_step(stmt);
-      if (step != SQLITE_DONE) {
-        Serial.printf("ERR|INSERT_FAIL|%s\n", sqlite3_errmsg(db));
-      }
-      sqlite3_finalize(stmt);
-    } else {
-      Serial.printf("ERR|PREPARE_FAIL|%s\n", sqlite3_errmsg(db));
-    }
-  }
-
-  sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
-
-  Serial.printf("ACK|CHUNK_%d_PROCESSED\n", chunkIndex);
+static const UpsertColumn BILL_TRANSACTION_UPSERT_COLUMNS[] = {
+  {"bill_transaction_id", UPSERT_INT, UPSERT_FLAG_KEY, nullptr, 0},
+  {"bill_id", UPSERT_INT, 0, nullptr, 0},
+  {"bill_reference_number", UPSERT_TEXT, 0, "", 0},
+  {"type", UPSERT_TEXT, 0, "", 0},
+  {"source", UPSERT_TEXT, 0, "", 0},
+  {"amount", UPSERT_REAL, 0, nullptr, 0},
+  {"cash_received", UPSERT_REAL, 0, nullptr, 0},
+  {"change", UPSERT_REAL, 0, nullptr, 0},
+  {"transaction_date", UPSERT_TEXT, 0, "", 0},
+  {"payment_method", UPSERT_TEXT, 0, "", 0},
+  {"processed_by_device_uid", UPSERT_TEXT, 0, "", 0},
+  {"notes", UPSERT_TEXT, UPSERT_FLAG_NULLABLE, nullptr, 0},
+  {"created_at", UPSERT_TEXT, 0, "", 0},
+  {"updated_at", UPSERT_TEXT, 0, "", 0},
+};
+
+// Once every chunk is in, reload the in-memory data
+static void reloadBillTransactionsAfterSync() {
+  loadBillTransactionsFromDB();
+  Serial.printf("Reloaded %d bill transactions into memory\n", billTransactions.size());
+}
 
-  // If this is the last chunk, reload the in-memory data
-  if (chunkIndex == totalChunks - 1) {
-    loadBillTransactionsFromDB();
-    Serial.printf("Reloaded %d bill transactions into memory\n", billTransactions.size());
-  }
+static const UpsertSpec BILL_TRANSACTION_UPSERT_SPEC = {
+  "BILL_TRANSACTIONS", "bill_transactions", BILL_TRANSACTION_UPSERT_COLUMNS,
+  sizeof(BILL_TRANSACTION_UPSERT_COLUMNS) / sizeof(BILL_TRANSACTION_UPSERT_COLUMNS[0]),
+  UPSERT_REPLACE, false, 16384, nullptr, reloadBillTransactionsAfterSync
+};
 
-  return true;
+// Handle UPSERT_BILL_TRANSACTIONS_JSON_CHUNK command
+bool handleUpsertBillTransactionsJsonChunk(String payload) {
+  return runChunkUpsert(BILL_TRANSACTION_UPSERT_SPEC, payload);
 }
 
 #endif // BILL_TRANSACTION_SYNC_H
\ No newline at end of file
@@ -0,0 +1,280 @@
+#ifndef CHUNK_WINDOW_H
+#define CHUNK_WINDOW_H
+
+#include <Arduino.h>
+#include <vector>
+#include <sqlite3.h>
+#include "../../configuration/config.h"
+#include "sync_codec.h"
+#include "sync_stats.h"
+
+// ===== CHUNK RECEIVE WINDOW =====
+// Tracks which chunks of an import stream have been committed so the client
+// can keep several chunks in flight. While one chunk is being committed the
+// next ones are framed by the serial RX task (see serial_rx_manager.h).
+//
+// Replies per chunk:
+//   ACK|CHUNK|<index>|<next_expected>   chunk committed (selective + cumulative)
+//   NAK|CHUNK|<index>|<reason>          chunk failed, client resends only this one
+// The stream's final ACK is sent once every chunk has been committed,
+// whatever order they arrived in.
+//
+// Inside a sync session (SYNC_SESSION|<id>) every committed chunk is also
+// recorded in sync_ledger with the hash of its payload, in the same
+// transaction as its rows. A reapplied chunk with the same hash is only
+// ACKed again, even after a reset, and RESUME|<id> lists the ledger so the
+// client can skip what was already applied when the cable dropped.
+
+#define CHUNK_WINDOW_MAX_STREAMS 8
+
+struct ChunkWindow {
+  String stream;
+  int total = 0;
+  int nextExpected = 0;   // every chunk below this one is committed
+  int received = 0;
+  std::vector<bool> done;
+};
+
+static ChunkWindow chunkWindows[CHUNK_WINDOW_MAX_STREAMS];
+
+void upsertReleaseStatements();  // upsert_engine.h, statements live for one session
+
+static String syncSessionId;          // empty = no ledger
+static char chunkPayloadHash[17] = "";  // hash of the chunk being applied
+
+// Marks chunks of this stream already applied in the current session
+static void chunkLedgerSeed(ChunkWindow& w) {
+  if (syncSessionId.length() == 0 || w.total <= 0) return;
+  sqlite3_stmt* stmt;
+  const char* sql = "SELECT chunk_index FROM sync_ledger WHERE session_id = ? AND stream = ? AND total_chunks = ?;";
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) return;
+  sqlite3_bind_text(stmt, 1, syncSessionId.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 2, w.stream.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 3, w.total);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    int idx = sqlite3_column_int(stmt, 0);
+    if (idx >= 0 && idx < w.total && !w.done[idx]) {
+      w.done[idx] = true;
+      w.received++;
+    }
+  }
+  sqlite3_finalize(stmt);
+  while (w.nextExpected < w.total && w.done[w.nextExpected]) w.nextExpected++;
+}
+
+// True when the ledger holds this chunk with a different payload hash
+static bool chunkLedgerHashDiffers(const char* stream, int chunkIndex) {
+  if (syncSessionId.length() == 0) return false;
+  sqlite3_stmt* stmt;
+  const char* sql = "SELECT content_hash FROM sync_ledger WHERE session_id = ? AND stream = ? AND chunk_index = ?;";
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) return false;
+  sqlite3_bind_text(stmt, 1, syncSessionId.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 2, stream, -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 3, chunkIndex);
+  bool differs = false;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char* stored = (const char*)sqlite3_column_text(stmt, 0);
+    differs = !stored || strcmp(stored, chunkPayloadHash) != 0;
+  }
+  sqlite3_finalize(stmt);
+  return differs;
+}
+
+static ChunkWindow& chunkWindowFor(const char* stream, int total) {
+  ChunkWindow* free = nullptr;
+  for (auto& w : chunkWindows) {
+    if (w.stream == stream) {
+      // A finished stream or a different chunk count means a new transfer
+      if (w.total != total || w.received >= w.total) {
+        w.total = 0;
+      }
+      if (w.total > 0) return w;
+      free = &w;
+      break;
+    }
+    if (!free && w.stream.length() == 0) free = &w;
+  }
+  if (!free) free = &chunkWindows[0];
+
+  free->stream = stream;
+  free->total = total;
+  free->nextExpected = 0;
+  free->received = 0;
+  free->done.assign(total > 0 ? total : 0, false);
+  chunkLedgerSeed(*free);
+  return *free;
+}
+
+// Returns false when the chunk was already committed with the same
+// payload; the ACK is repeated and the caller must skip it.
+bool chunkWindowBegin(const char* stream, int chunkIndex, int totalChunks, const String& payload) {
+  fnv64Hex(fnv64Update(FNV64_OFFSET, (const uint8_t*)payload.c_str(), payload.length()), chunkPayloadHash);
+  ChunkWindow& w = chunkWindowFor(stream, totalChunks);
+  if (chunkIndex < 0 || chunkIndex >= w.total || !w.done[chunkIndex]) return true;
+  if (chunkLedgerHashDiffers(stream, chunkIndex)) return true;
+
+  Serial.print(F("ACK|CHUNK|"));
+  Serial.print(chunkIndex);
+  Serial.print(F("|"));
+  Serial.println(w.nextExpected);
+  return false;
+}
+
+// Marks the chunk committed, sends its ACK, and returns true once the whole
+// stream has been received.
+bool chunkWindowCommit(const char* stream, int chunkIndex, int totalChunks) {
+  ChunkWindow& w = chunkWindowFor(stream, totalChunks);
+  if (chunkIndex >= 0 && chunkIndex < w.total && !w.done[chunkIndex]) {
+    w.done[chunkIndex] = true;
+    w.received++;
+    while (w.nextExpected < w.total && w.done[w.nextExpected]) w.nextExpected++;
+  }
+
+  Serial.print(F("ACK|CHUNK|"));
+  Serial.print(chunkIndex);
+  Serial.print(F("|"));
+  Serial.println(w.nextExpected);
+  return w.received >= w.total;
+}
+
+// True while no chunk of the stream's current transfer has been committed,
+// counting the ledger inside a session
+bool chunkWindowUntouched(const char* stream, int totalChunks) {
+  return chunkWindowFor(stream, totalChunks).received == 0;
+}
+
+// Records the chunk in the session ledger; call inside the chunk's
+// transaction, right before COMMIT.
+void chunkLedgerRecord(const char* stream, int chunkIndex, int totalChunks) {
+  if (syncSessionId.length() == 0) return;
+  sqlite3_stmt* stmt;
+  const char* sql =
+    "INSERT OR REPLACE INTO sync_ledger (session_id, stream, chunk_index, total_chunks, content_hash, applied_at) "
+    "VALUES (?, ?, ?, ?, ?, datetime('now'));";
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) return;
+  sqlite3_bind_text(stmt, 1, syncSessionId.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 2, stream, -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 3, chunkIndex);
+  sqlite3_bind_int(stmt, 4, totalChunks);
+  sqlite3_bind_text(stmt, 5, chunkPayloadHash, -1, SQLITE_TRANSIENT);
+  sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+}
+
+void chunkWindowReject(int chunkIndex, const __FlashStringHelper* reason) {
+  Serial.print(F("NAK|CHUNK|"));
+  Serial.print(chunkIndex);
+  Serial.print(F("|"));
+  Serial.println(reason);
+}
+
+// ===== SYNC SESSIONS =====
+
+static void resetChunkWindows() {
+  upsertReleaseStatements();
+  for (auto& w : chunkWindows) {
+    w.stream = "";
+    w.total = 0;
+    w.done.clear();
+  }
+}
+
+// Forgets every session and its ledger, for a database that was wiped: a
+// RESUME must not report chunks that are no longer in it
+void forgetSyncSessions() {
+  sqlite3_exec(db, "DELETE FROM sync_ledger;", NULL, NULL, NULL);
+  syncSessionId = "";
+  resetChunkWindows();
+}
+
+// Handle SYNC_SESSION command: start a new session, dropping older ledgers
+bool handleSyncSession(String sessionId) {
+  sessionId.trim();
+  if (sessionId.length() == 0) {
+    Serial.println(F("ERR|BAD_SESSION_ID"));
+    return true;
+  }
+
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "DELETE FROM sync_ledger WHERE session_id <> ?;", -1, &stmt, NULL) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, sessionId.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+  }
+  syncSessionId = sessionId;
+  resetChunkWindows();
+  syncStatsReset();
+
+  Serial.print(F("ACK|SYNC_SESSION|"));
+  Serial.println(syncSessionId);
+  return true;
+}
+
+// Handle RESUME command: continue a session and list its applied chunks as
+// RESUME_CHUNK|<stream>|<index>|<total>|<hash>
+bool handleResume(String sessionId) {
+  sessionId.trim();
+
+  sqlite3_stmt* stmt;
+  const char* sql = "SELECT stream, chunk_index, total_chunks, content_hash FROM sync_ledger WHERE session_id = ? ORDER BY stream, chunk_index;";
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.println(F("ERR|RESUME_FAILED"));
+    return true;
+  }
+  sqlite3_bind_text(stmt, 1, sessionId.c_str(), -1, SQLITE_TRANSIENT);
+
+  int applied = 0;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    Serial.print(F("RESUME_CHUNK|"));
+    Serial.print((const char*)sqlite3_column_text(stmt, 0));
+    Serial.print(F("|"));
+    Serial.print(sqlite3_column_int(stmt, 1));
+    Serial.print(F("|"));
+    Serial.print(sqlite3_column_int(stmt, 2));
+    Serial.print(F("|"));
+    Serial.println((const char*)sqlite3_column_text(stmt, 3));
+    applied++;
+  }
+  sqlite3_finalize(stmt);
+
+  if (applied == 0) {
+    Serial.print(F("ERR|UNKNOWN_SESSION|"));
+    Serial.println(sessionId);
+    return true;
+  }
+
+  syncSessionId = sessionId;
+  resetChunkWindows();
+
+  Serial.print(F("ACK|RESUME|"));
+  Serial.print(syncSessionId);
+  Serial.print(F("|"));
+  Serial.println(applied);
+  return true;
+}
+
+// Handle SYNC_SESSION_END command: the session finished, forget its ledger
+bool handleSyncSessionEnd(String sessionId) {
+  sessionId.trim();
+
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "DELETE FROM sync_ledger WHERE session_id = ?;", -1, &stmt, NULL) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, sessionId.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+  }
+  if (syncSessionId == sessionId) syncSessionId = "";
+  upsertReleaseStatements();
+
+  Serial.print(F("ACK|SYNC_SESSION_END|"));
+  Serial.println(sessionId);
+  return true;
+}
+
+// Handle SYNC_REPORT command: per-phase totals since the session started
+bool handleSyncReport() {
+  printSyncReport(syncSessionId);
+  return true;
+}
+
+#endif // CHUNK_WINDOW_H
@@ -0,0 +1,239 @@
+#ifndef CUSTOMER_DIGEST_H
+#define CUSTOMER_DIGEST_H
+
+#include "../../configuration/config.h"
+#include "export_engine.h"
+#include "sync_codec.h"
+#include "sync_stats.h"
+#include <sqlite3.h>
+
+// ===== CUSTOMER ROSTER DIGEST =====
+// Lets the server find which customers differ without pulling the roster.
+// Each row hashes to FNV-1a 64 over its synced fields; a range hash is the
+// XOR of its row hashes. Ranges are half-open account_no intervals [lo, hi)
+// (empty hi = unbounded) walked through the account_no index in one pass.
+//
+//   DIGEST|lo=A,hi=B,buckets=N[,brgy=ID]
+//     BEGIN_DIGEST|<rows>|<buckets>
+//     DIGEST_RANGE|<lo>|<hi>|<count>|<hash>     equal-count sub-ranges
+//     END_DIGEST
+//   DIGEST_KEYS|lo=A,hi=B[,brgy=ID]
+//     BEGIN_DIGEST_KEYS|<rows>
+//     DIGEST_KEY|<account_no>|<hash>
+//     END_DIGEST_KEYS
+//   REMOVE_CUSTOMER|<account_no>
+//
+// The server recurses into mismatched ranges until they are small enough
+// to list keys, then pushes only the customers that differ.
+
+#define DIGEST_MAX_BUCKETS 64
+
+// Fields are hashed in this order, separated by 0x1F, NULL as "" / 0:
+// account_no, customer_name, address, status, type_id, deduction_id, brgy_id
+// previous_reading is left out: the device advances it with every reading
+// and the server's copy lags until the next roster edit.
+static const char* DIGEST_SELECT_BOUNDED =
+  "SELECT account_no, customer_name, address, status, type_id, deduction_id, brgy_id "
+  "FROM customers WHERE account_no >= ?1 AND account_no < ?2 AND (?3 = 0 OR brgy_id = ?3) ORDER BY account_no;";
+static const char* DIGEST_SELECT_OPEN =
+  "SELECT account_no, customer_name, address, status, type_id, deduction_id, brgy_id "
+  "FROM customers WHERE account_no >= ?1 AND (?3 = 0 OR brgy_id = ?3) ORDER BY account_no;";
+static const char* DIGEST_COUNT_BOUNDED =
+  "SELECT COUNT(*) FROM customers WHERE account_no >= ?1 AND account_no < ?2 AND (?3 = 0 OR brgy_id = ?3);";
+static const char* DIGEST_COUNT_OPEN =
+  "SELECT COUNT(*) FROM customers WHERE account_no >= ?1 AND (?3 = 0 OR brgy_id = ?3);";
+
+struct DigestRange {
+  String lo;
+  String hi;
+  int64_t brgyId = 0;
+};
+
+static DigestRange digestRangeFromArgs(const String& args) {
+  DigestRange range;
+  String value;
+  if (exportArg(args, "lo", value)) range.lo = value;
+  if (exportArg(args, "hi", value)) range.hi = value;
+  if (exportArg(args, "brgy", value)) range.brgyId = atoll(value.c_str());
+  return range;
+}
+
+static sqlite3_stmt* digestPrepare(const DigestRange& range, bool count) {
+  bool open = range.hi.length() == 0;
+  const char* sql = count ? (open ? DIGEST_COUNT_OPEN : DIGEST_COUNT_BOUNDED)
+                          : (open ? DIGEST_SELECT_OPEN : DIGEST_SELECT_BOUNDED);
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("Digest prepare error: "));
+    Serial.println(sqlite3_errmsg(db));
+    return nullptr;
+  }
+  sqlite3_bind_text(stmt, 1, range.lo.c_str(), -1, SQLITE_TRANSIENT);
+  if (!open) sqlite3_bind_text(stmt, 2, range.hi.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 3, range.brgyId);
+  return stmt;
+}
+
+static uint64_t digestRowHash(sqlite3_stmt* stmt) {
+  static const uint8_t SEP = 0x1F;
+  uint64_t h = FNV64_OFFSET;
+  char num[24];
+  for (int col = 0; col < 7; col++) {
+    if (col > 0) h = fnv64Update(h, &SEP, 1);
+    if (col >= 4) {
+      int n = snprintf(num, sizeof(num), "%lld", (long long)sqlite3_column_int64(stmt, col));
+      h = fnv64Update(h, (const uint8_t*)num, n);
+    } else {
+      const unsigned char* text = sqlite3_column_text(stmt, col);
+      if (text) h = fnv64Update(h, text, sqlite3_column_bytes(stmt, col));
+    }
+  }
+  return h;
+}
+
+static void printDigestHash(uint64_t h) {
+  char hex[17];
+  fnv64Hex(h, hex);
+  Serial.print(hex);
+}
+
+static void printDigestRange(const String& lo, const String& hi, int count, uint64_t h) {
+  Serial.print(F("DIGEST_RANGE|"));
+  Serial.print(lo);
+  Serial.print(F("|"));
+  Serial.print(hi);
+  Serial.print(F("|"));
+  Serial.print(count);
+  Serial.print(F("|"));
+  printDigestHash(h);
+  Serial.println();
+}
+
+// Handle DIGEST command
+bool handleDigest(String args) {
+  uint32_t t0 = micros();
+  DigestRange range = digestRangeFromArgs(args);
+  String value;
+  int buckets = exportArg(args, "buckets", value) ? value.toInt() : 16;
+  if (buckets < 1) buckets = 1;
+  if (buckets > DIGEST_MAX_BUCKETS) buckets = DIGEST_MAX_BUCKETS;
+
+  sqlite3_stmt* stmt = digestPrepare(range, true);
+  if (!stmt) {
+    Serial.println(F("ERR|DIGEST_FAILED"));
+    return true;
+  }
+  int total = (sqlite3_step(stmt) == SQLITE_ROW) ? sqlite3_column_int(stmt, 0) : 0;
+  sqlite3_finalize(stmt);
+
+  int perBucket = (total + buckets - 1) / buckets;
+  if (perBucket < 1) perBucket = 1;
+
+  stmt = digestPrepare(range, false);
+  if (!stmt) {
+    Serial.println(F("ERR|DIGEST_FAILED"));
+    return true;
+  }
+
+  Serial.print(F("BEGIN_DIGEST|"));
+  Serial.print(total);
+  Serial.print(F("|"));
+  Serial.println(total > 0 ? (total + perBucket - 1) / perBucket : 1);
+
+  // One pass: a bucket closes at the first key of the next one, so the
+  // sub-ranges tile [lo, hi) exactly and the server can hash the same keys.
+  String bucketLo = range.lo;
+  int bucketCount = 0;
+  uint64_t bucketHash = 0;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (bucketCount == perBucket) {
+      String key = (const char*)sqlite3_column_text(stmt, 0);
+      printDigestRange(bucketLo, key, bucketCount, bucketHash);
+      bucketLo = key;
+      bucketCount = 0;
+      bucketHash = 0;
+    }
+    bucketHash ^= digestRowHash(stmt);
+    bucketCount++;
+  }
+  sqlite3_finalize(stmt);
+  printDigestRange(bucketLo, range.hi, bucketCount, bucketHash);
+
+  SyncStat stat;
+  stat.rows = total;
+  stat.sqlUs = micros() - t0;
+  syncStatRecord("DIGEST", "RANGES", 0, stat);
+  Serial.println(F("END_DIGEST"));
+  return true;
+}
+
+// Handle DIGEST_KEYS command
+bool handleDigestKeys(String args) {
+  uint32_t t0 = micros();
+  DigestRange range = digestRangeFromArgs(args);
+
+  sqlite3_stmt* stmt = digestPrepare(range, true);
+  if (!stmt) {
+    Serial.println(F("ERR|DIGEST_FAILED"));
+    return true;
+  }
+  int total = (sqlite3_step(stmt) == SQLITE_ROW) ? sqlite3_column_int(stmt, 0) : 0;
+  sqlite3_finalize(stmt);
+
+  stmt = digestPrepare(range, false);
+  if (!stmt) {
+    Serial.println(F("ERR|DIGEST_FAILED"));
+    return true;
+  }
+
+  Serial.print(F("BEGIN_DIGEST_KEYS|"));
+  Serial.println(total);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    Serial.print(F("DIGEST_KEY|"));
+    Serial.print((const char*)sqlite3_column_text(stmt, 0));
+    Serial.print(F("|"));
+    printDigestHash(digestRowHash(stmt));
+    Serial.println();
+  }
+  sqlite3_finalize(stmt);
+
+  SyncStat stat;
+  stat.rows = total;
+  stat.sqlUs = micros() - t0;
+  syncStatRecord("DIGEST", "KEYS", 0, stat);
+  Serial.println(F("END_DIGEST_KEYS"));
+  return true;
+}
+
+// Handle REMOVE_CUSTOMER command
+bool handleRemoveCustomer(String accountNo) {
+  accountNo.trim();
+
+  // Customers with readings or bills on the device are kept (reported as
+  // NOT_REMOVED); those rows still have to reach the server first.
+  sqlite3_stmt* stmt;
+  const char* sql =
+    "DELETE FROM customers WHERE account_no = ? "
+    "AND NOT EXISTS (SELECT 1 FROM readings r WHERE r.customer_id = customers.customer_id) "
+    "AND NOT EXISTS (SELECT 1 FROM bills b WHERE b.customer_id = customers.customer_id);";
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("ERR|REMOVE_CUSTOMER_FAILED|"));
+    Serial.println(accountNo);
+    return true;
+  }
+  sqlite3_bind_text(stmt, 1, accountNo.c_str(), -1, SQLITE_TRANSIENT);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+
+  if (rc != SQLITE_DONE) {
+    Serial.print(F("ERR|REMOVE_CUSTOMER_FAILED|"));
+  } else if (sqlite3_changes(db) == 0) {
+    Serial.print(F("ERR|CUSTOMER_NOT_REMOVED|"));
+  } else {
+    Serial.print(F("ACK|REMOVE_CUSTOMER|"));
+  }
+  Serial.println(accountNo);
+  return true;
+}
+
+#endif // CUSTOMER_DIGEST_H
@@ -2,6 +2,8 @@
 #define CUSTOMER_TYPE_SYNC_H
 
 #include "../../database/customer_type_database.h"
+#include "sync_stats.h"
+#include "upsert_engine.h"
 
 // ===== CUSTOMER TYPE SYNC OPERATIONS =====
 
@@ -45,7 +47,15 @@ bool handleUpsertCustomerType(String payload) {
   unsigned long createdAt = (unsigned long)createdStr.toInt();
   unsigned long updatedAt = (unsigned long)updatedStr.toInt();
 
-  if (upsertCustomerTypeFromSync(typeId, typeName, ratePerM3, minM3, minCharge, penalty, createdAt, updatedAt)) {
+  SyncStat stat;
+  stat.rows = 1;
+  stat.bytes = payload.length();
+  uint32_t t0 = micros();
+  bool ok = upsertCustomerTypeFromSync(typeId, typeName, ratePerM3, minM3, minCharge, penalty, createdAt, updatedAt);
+  stat.sqlUs = micros() - t0;
+  syncStatRecord("UPSERT", "CUSTOMER_TYPE", 0, stat);
+
+  if (ok) {
     Serial.print(F("ACK|UPSERT|"));
     Serial.println(typeName);
   } else {
@@ -55,4 +65,57 @@ bool handleUpsertCustomerType(String payload) {
   return true;
 }
 
+// ===== BATCH UPSERT =====
+// UPSERT_CUSTOMER_TYPES_JSON_CHUNK, same protocol as UPSERT_DEDUCTIONS_JSON_CHUNK;
+// ends with ACK|UPSERT_CUSTOMER_TYPES|<rows>.
+static const UpsertColumn CUSTOMER_TYPE_UPSERT_COLUMNS[] = {
+  {"type_id", UPSERT_INT, UPSERT_FLAG_KEY, nullptr, 0},
+  {"type_name", UPSERT_TEXT, 0, "", 0},
+  {"rate_per_m3", UPSERT_REAL, 0, nullptr, 0},
+  {"min_m3", UPSERT_INT, 0, nullptr, 0},
+  {"min_charge", UPSERT_REAL, 0, nullptr, 0},
+  {"penalty", UPSERT_REAL, 0, nullptr, 0},
+  {"max_m3", UPSERT_INT, UPSERT_FLAG_NULLABLE, nullptr, 0},
+  {"created_at", UPSERT_INT, 0, nullptr, 0},
+  {"updated_at", UPSERT_INT, 0, nullptr, 0},
+};
+
+static const UpsertSpec CUSTOMER_TYPE_UPSERT_SPEC = {
+  "CUSTOMER_TYPES", "customer_types", CUSTOMER_TYPE_UPSERT_COLUMNS,
+  sizeof(CUSTOMER_TYPE_UPSERT_COLUMNS) / sizeof(CUSTOMER_TYPE_UPSERT_COLUMNS[0]),
+  UPSERT_REPLACE, false, 8192, "UPSERT_CUSTOMER_TYPES", loadCustomerTypesFromDB
+};
+
+// Handle UPSERT_CUSTOMER_TYPES_JSON_CHUNK command
+bool handleUpsertCustomerTypesJsonChunk(String payload) {
+  return runChunkUpsert(CUSTOMER_TYPE_UPSERT_SPEC, payload);
+}
+
+// ===== TARIFF TIERS =====
+// UPSERT_TARIFF_TIERS_JSON_CHUNK carries every tier of every customer type
+// (at least one chunk, empty when no type has tiers): the first chunk
+// committed clears the table, so tiers removed on the server disappear here
+// too. Ends with
+// ACK|UPSERT_TARIFF_TIERS|<rows> and recompiles the tariff plans.
+static const UpsertColumn TARIFF_TIER_UPSERT_COLUMNS[] = {
+  {"tier_id", UPSERT_INT, UPSERT_FLAG_KEY, nullptr, 0},
+  {"type_id", UPSERT_INT, 0, nullptr, 0},
+  {"from_m3", UPSERT_INT, 0, nullptr, 0},
+  {"rate_per_m3", UPSERT_REAL, 0, nullptr, 0},
+  {"created_at", UPSERT_INT, 0, nullptr, 0},
+  {"updated_at", UPSERT_INT, 0, nullptr, 0},
+};
+
+static const UpsertSpec TARIFF_TIER_UPSERT_SPEC = {
+  "TARIFF_TIERS", "tariff_tiers", TARIFF_TIER_UPSERT_COLUMNS,
+  sizeof(TARIFF_TIER_UPSERT_COLUMNS) / sizeof(TARIFF_TIER_UPSERT_COLUMNS[0]),
+  UPSERT_REPLACE, false, 8192, "UPSERT_TARIFF_TIERS", loadTariffsFromDB,
+  "DELETE FROM tariff_tiers;"
+};
+
+// Handle UPSERT_TARIFF_TIERS_JSON_CHUNK command
+bool handleUpsertTariffTiersJsonChunk(String payload) {
+  return runChunkUpsert(TARIFF_TIER_UPSERT_SPEC, payload);
+}
+
 #endif // CUSTOMER_TYPE_SYNC_H
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define DEDUCTION_SYNC_H
 
 #include "../../database/deduction_database.h"
+#include "sync_stats.h"
+#include "upsert_engine.h"
 
 // ===== DEDUCTION SYNC OPERATIONS =====
 
@@ -36,7 +38,15 @@ bool handleUpsertDeduction(String payload) {
   unsigned long createdAt = (unsigned long)createdStr.toInt();
   unsigned long updatedAt = (unsigned long)updatedStr.toInt();
 
-  if (upsertDeductionFromSync(deductionId, name, type, value, createdAt, updatedAt)) {
+  SyncStat stat;
+  stat.rows = 1;
+  stat.bytes = payload.length();
+  uint32_t t0 = micros();
+  bool ok = upsertDeductionFromSync(deductionId, name, type, value, createdAt, updatedAt);
+  stat.sqlUs = micros() - t0;
+  syncStatRecord("UPSERT", "DEDUCTION", 0, stat);
+
+  if (ok) {
     Serial.print(F("ACK|UPSERT|"));
     Serial.println(name);
   } else {
@@ -46,4 +56,30 @@ bool handleUpsertDeduction(String payload) {
   return true;
 }
 
+// ===== BATCH UPSERT =====
+// UPSERT_DEDUCTIONS_JSON_CHUNK|<index>|<total>|[{...}, ...]
+// All rows of a chunk go through one prepared statement in one transaction,
+// and the in-memory list is reloaded once, after the last chunk. Answers
+// ACK|CHUNK per chunk, then ACK|UPSERT_DEDUCTIONS|<rows in the last chunk>.
+// The single-row UPSERT_DEDUCTION above stays for older clients.
+static const UpsertColumn DEDUCTION_UPSERT_COLUMNS[] = {
+  {"deduction_id", UPSERT_INT, UPSERT_FLAG_KEY, nullptr, 0},
+  {"name", UPSERT_TEXT, 0, "", 0},
+  {"type", UPSERT_TEXT, 0, "", 0},
+  {"value", UPSERT_REAL, 0, nullptr, 0},
+  {"created_at", UPSERT_INT, 0, nullptr, 0},
+  {"updated_at", UPSERT_INT, 0, nullptr, 0},
+};
+
+static const UpsertSpec DEDUCTION_UPSERT_SPEC = {
+  "DEDUCTIONS", "deductions", DEDUCTION_UPSERT_COLUMNS,
+  sizeof(DEDUCTION_UPSERT_COLUMNS) / sizeof(DEDUCTION_UPSERT_COLUMNS[0]),
+  UPSERT_REPLACE, false, 8192, "UPSERT_DEDUCTIONS", loadDeductionsFromDB
+};
+
+// Handle UPSERT_DEDUCTIONS_JSON_CHUNK command
+bool handleUpsertDeductionsJsonChunk(String payload) {
+  return runChunkUpsert(DEDUCTION_UPSERT_SPEC, payload);
+}
+
 #endif // DEDUCTION_SYNC_H
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "../../database/device_info.h"
 #include "../../configuration/config.h"
+#include "upsert_engine.h"
 #include <SD.h>
 
 // ===== DEVICE SYNC OPERATIONS =====
@@ -17,6 +18,7 @@ bool handleExportDeviceInfo() {
 // Handle DROP_DB command
 bool handleDropDatabase() {
   Serial.println(F("Dropping database..."));
+  upsertReleaseStatements();
   if (db) {
     sqlite3_close(db);
     db = nullptr;
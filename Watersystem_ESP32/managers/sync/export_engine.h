@@ -0,0 +1,542 @@
+#ifndef EXPORT_ENGINE_H
+#define EXPORT_ENGINE_H
+
+#include "../../configuration/config.h"
+#include "../../configuration/money.h"
+#include "sync_codec.h"
+#include "sync_compress.h"
+#include "sync_stats.h"
+#include <ArduinoJson.h>
+#include <sqlite3.h>
+
+// ===== TABLE EXPORT ENGINE =====
+// Shared by EXPORT_READINGS, EXPORT_BILLS and EXPORT_BILL_TRANSACTIONS.
+// Each table describes its columns once; the engine streams them as JSON
+// (default) or as compact MessagePack chunks when the client negotiated it,
+// optionally LZ-compressed (see sync_compress.h).
+
+enum SyncExportFormat {
+  EXPORT_FORMAT_JSON,
+  EXPORT_FORMAT_MSGPACK
+};
+
+SyncExportFormat g_exportFormat = EXPORT_FORMAT_JSON;
+
+enum ExportColType : uint8_t {
+  EXPORT_INT,
+  EXPORT_REAL,
+  EXPORT_TEXT,
+  EXPORT_MONEY   // REAL peso amount; exact two decimals in JSON, centavos in MessagePack
+};
+
+#define EXPORT_FLAG_DELTA 0x01  // MessagePack: sent as difference from the previous row
+#define EXPORT_FLAG_HOIST 0x02  // MessagePack: sent once per chunk when every row shares it
+
+struct ExportColumn {
+  const char* name;
+  ExportColType type;
+  uint8_t flags;
+};
+
+// A filter argument of EXPORT_* / EXPORT_OPEN (key=value) and the SQL
+// condition it adds; the ? in `condition` takes the value.
+struct ExportFilter {
+  const char* arg;
+  const char* condition;
+  ExportColType type;   // how the value is bound
+};
+
+struct ExportSpec {
+  const char* label;          // READINGS -> BEGIN_READINGS_JSON, READINGS_CHUNK|, READINGS_MP|
+  const char* countSql;
+  const char* selectSql;      // selects `columns` in order, ends with LIMIT ? OFFSET ?
+  const ExportColumn* columns;
+  size_t columnCount;
+  int chunkSize;
+  // Delta export (since=N): same columns plus a trailing change_seq cursor,
+  // WHERE change_seq > ? ORDER BY change_seq LIMIT ?
+  const char* deltaCountSql;
+  const char* deltaSelectSql;
+  const char* watermarkSql;   // SELECT MAX(change_seq) for the WATERMARK line
+  // Filtered export: statements are built from these and page by keyset on
+  // `key`, or on change_seq when since= is given as well
+  const char* table;
+  const char* columnList;     // the columns of selectSql
+  const char* key;
+  const ExportFilter* filters;
+  size_t filterCount;
+};
+
+// ===== NEGOTIATION =====
+bool setExportFormat(const String& name) {
+  if (name == "JSON") {
+    g_exportFormat = EXPORT_FORMAT_JSON;
+    return true;
+  }
+  if (name == "MSGPACK") {
+    g_exportFormat = EXPORT_FORMAT_MSGPACK;
+    return true;
+  }
+  return false;
+}
+
+const char* exportFormatName() {
+  return g_exportFormat == EXPORT_FORMAT_MSGPACK ? "MSGPACK" : "JSON";
+}
+
+// Handle SET_EXPORT_FORMAT command
+bool handleSetExportFormat(String payload) {
+  payload.trim();
+  if (!setExportFormat(payload)) {
+    Serial.print(F("ERR|UNKNOWN_EXPORT_FORMAT|"));
+    Serial.println(payload);
+    return true;
+  }
+  Serial.print(F("ACK|EXPORT_FORMAT|"));
+  Serial.println(exportFormatName());
+  return true;
+}
+
+// Reads `key` from export arguments of the form key=value,key=value
+bool exportArg(const String& args, const char* key, String& value) {
+  int start = 0;
+  while (start < (int)args.length()) {
+    int end = args.indexOf(',', start);
+    if (end < 0) end = args.length();
+    int eq = args.indexOf('=', start);
+    if (eq > start && eq < end && args.substring(start, eq) == key) {
+      value = args.substring(eq + 1, end);
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+// since=N from the export arguments, or -1 for a full export
+int64_t exportSince(const String& args) {
+  String value;
+  if (!exportArg(args, "since", value)) return -1;
+  return (int64_t)atoll(value.c_str());
+}
+
+// ===== EXPORT QUERY =====
+// The statements behind one export: the spec's own for full and delta
+// exports, or ones built from its filters, e.g.
+//   EXPORT_BILLS|status=Pending,from=2026-01-01,to=2026-01-31
+// Filters are plain WHERE conditions on indexed columns, so SQLite skips
+// the rows they exclude. Keyset exports (delta or filtered) select one more
+// column after the spec columns: the cursor the next chunk starts after.
+#define EXPORT_MAX_FILTERS 6
+
+struct ExportQuery {
+  const ExportSpec* spec = nullptr;
+  int64_t since = -1;
+  bool keyset = false;
+  int64_t firstCursor = -1;
+  String countSql;
+  String selectSql;
+  const ExportFilter* filters[EXPORT_MAX_FILTERS];
+  String values[EXPORT_MAX_FILTERS];
+  size_t filterCount = 0;
+};
+
+// Numbers the ? of a filter condition so it binds at `index`
+static String exportFilterCondition(const char* condition, int index) {
+  String out;
+  for (const char* c = condition; *c; ++c) {
+    out += *c;
+    if (*c == '?') out += String(index);
+  }
+  return out;
+}
+
+// Parses since= and the filters; prints ERR|UNKNOWN_EXPORT_FILTER for a key
+// the table has no filter for
+bool exportQueryOpen(const ExportSpec& spec, const String& args, ExportQuery& q) {
+  q = ExportQuery();
+  q.spec = &spec;
+  q.since = exportSince(args);
+
+  int start = 0;
+  while (start < (int)args.length()) {
+    int end = args.indexOf(',', start);
+    if (end < 0) end = args.length();
+    int eq = args.indexOf('=', start);
+    if (eq > start && eq < end) {
+      String key = args.substring(start, eq);
+      if (key != "since") {
+        const ExportFilter* filter = nullptr;
+        for (size_t f = 0; f < spec.filterCount; ++f) {
+          if (key == spec.filters[f].arg) filter = &spec.filters[f];
+        }
+        if (!filter || q.filterCount >= EXPORT_MAX_FILTERS) {
+          Serial.print(F("ERR|UNKNOWN_EXPORT_FILTER|"));
+          Serial.println(key);
+          return false;
+        }
+        q.filters[q.filterCount] = filter;
+        q.values[q.filterCount] = args.substring(eq + 1, end);
+        q.filterCount++;
+      }
+    }
+    start = end + 1;
+  }
+
+  bool delta = q.since >= 0;
+  q.keyset = delta || q.filterCount > 0;
+  q.firstCursor = delta ? q.since : INT64_MIN;
+  if (q.filterCount == 0) {
+    q.countSql = delta ? spec.deltaCountSql : spec.countSql;
+    q.selectSql = delta ? spec.deltaSelectSql : spec.selectSql;
+    return true;
+  }
+
+  // Marking the cursor condition as nearly always true makes SQLite drive
+  // the query from a filter's index when there is one, not the cursor's
+  const char* cursor = delta ? "change_seq" : spec.key;
+  String where = String(" WHERE likelihood(") + cursor + " > ?1, 0.9)";
+  for (size_t f = 0; f < q.filterCount; ++f) {
+    where += " AND ";
+    where += exportFilterCondition(q.filters[f]->condition, 3 + f);
+  }
+  q.countSql = String("SELECT COUNT(*) FROM ") + spec.table + where + ";";
+  q.selectSql = String("SELECT ") + spec.columnList + ", " + cursor + " FROM " + spec.table + where +
+                " ORDER BY " + cursor + " LIMIT ?2;";
+  return true;
+}
+
+static void exportQueryBindFilters(sqlite3_stmt* stmt, const ExportQuery& q) {
+  for (size_t f = 0; f < q.filterCount; ++f) {
+    if (q.filters[f]->type == EXPORT_TEXT) {
+      sqlite3_bind_text(stmt, 3 + f, q.values[f].c_str(), -1, SQLITE_TRANSIENT);
+    } else {
+      sqlite3_bind_int64(stmt, 3 + f, atoll(q.values[f].c_str()));
+    }
+  }
+}
+
+// Keyset: ?1 cursor, ?2 chunk size. Full export: LIMIT ? OFFSET ?.
+void exportQueryBind(sqlite3_stmt* stmt, const ExportQuery& q, int chunk, int64_t cursor) {
+  if (q.keyset) {
+    sqlite3_bind_int64(stmt, 1, cursor);
+    sqlite3_bind_int(stmt, 2, q.spec->chunkSize);
+  } else {
+    sqlite3_bind_int(stmt, 1, q.spec->chunkSize);
+    sqlite3_bind_int(stmt, 2, chunk * q.spec->chunkSize);
+  }
+  exportQueryBindFilters(stmt, q);
+}
+
+// Rows the export will send, or -1 when the count query fails
+int exportQueryCount(const ExportQuery& q) {
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, q.countSql.c_str(), -1, &stmt, NULL) != SQLITE_OK) return -1;
+  if (q.keyset) sqlite3_bind_int64(stmt, 1, q.firstCursor);
+  exportQueryBindFilters(stmt, q);
+  int count = 0;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    count = sqlite3_column_int(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+  return count;
+}
+
+static int64_t exportScalar(const char* sql, int64_t bind = -1) {
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) return -1;
+  if (bind >= 0) sqlite3_bind_int64(stmt, 1, bind);
+  int64_t value = 0;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    value = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+  return value;
+}
+
+// Column header frame, e.g. READINGS_COLS|reading_id:i:d,customer_id:i,device_uid:s:h
+static void printExportColumns(const ExportSpec& spec) {
+  Serial.print(spec.label);
+  Serial.print(F("_COLS|"));
+  for (size_t c = 0; c < spec.columnCount; ++c) {
+    const ExportColumn& col = spec.columns[c];
+    if (c > 0) Serial.print(',');
+    Serial.print(col.name);
+    Serial.print(':');
+    Serial.print(col.type == EXPORT_INT ? 'i' : (col.type == EXPORT_REAL ? 'f' : (col.type == EXPORT_MONEY ? 'm' : 's')));
+    if (col.flags & EXPORT_FLAG_DELTA) Serial.print(F(":d"));
+    if (col.flags & EXPORT_FLAG_HOIST) Serial.print(F(":h"));
+  }
+  Serial.println();
+}
+
+// ===== JSON CHUNK =====
+// payloadHash (optional) receives the FNV-1a 64 of the payload field as sent.
+// Both chunk writers report STAT|EXPORT:<label>: sql_us reading the rows,
+// tx_us encoding and writing them out.
+static size_t exportChunkJson(const ExportSpec& spec, sqlite3_stmt* stmt, int chunk, int& rows, int64_t& cursor, bool keyset, SyncPayloadStats& stats, uint64_t* payloadHash = nullptr) {
+  DynamicJsonDocument doc(65536);
+  JsonArray arr = doc.to<JsonArray>();
+  rows = 0;
+  SyncStat stat;
+  uint32_t t0 = micros();
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    JsonObject obj = arr.createNestedObject();
+    for (size_t c = 0; c < spec.columnCount; ++c) {
+      const ExportColumn& col = spec.columns[c];
+      switch (col.type) {
+        case EXPORT_INT:
+          obj[col.name] = (long)sqlite3_column_int64(stmt, c);
+          break;
+        case EXPORT_REAL:
+          obj[col.name] = (float)sqlite3_column_double(stmt, c);
+          break;
+        case EXPORT_MONEY: {
+          // Written as a raw JSON number; serialized() of a char* copies
+          // into the document, so the stack buffer can go
+          char amount[MONEY_BUF_SIZE];
+          size_t len = Money::fromAmount(sqlite3_column_double(stmt, c)).format(amount, sizeof(amount));
+          obj[col.name] = serialized(amount, len);
+          break;
+        }
+        case EXPORT_TEXT: {
+          const char* text = (const char*)sqlite3_column_text(stmt, c);
+          obj[col.name] = String(text ? text : "");
+          break;
+        }
+      }
+    }
+    if (keyset) cursor = sqlite3_column_int64(stmt, spec.columnCount);
+    rows++;
+  }
+  stat.sqlUs = micros() - t0;
+  t0 = micros();
+
+  Serial.print(spec.label);
+  Serial.print(F("_CHUNK|"));
+  Serial.print(chunk);
+  Serial.print(F("|"));
+  Fnv64Print out(Serial);
+  size_t bytes;
+  if (g_syncCompression) {
+    String json;
+    serializeJson(arr, json);
+    doc.clear();
+    bytes = writeSyncPayload(out, (const uint8_t*)json.c_str(), json.length(), false, stats);
+  } else {
+    bytes = serializeJson(arr, out);
+    stats.rawBytes += bytes;
+  }
+  Serial.println();
+  doc.clear();
+  if (payloadHash) *payloadHash = out.hash;
+
+  stat.txUs = micros() - t0;
+  stat.rows = rows;
+  stat.bytes = bytes;
+  syncStatRecord("EXPORT", spec.label, chunk, stat);
+  return bytes;
+}
+
+// ===== MESSAGEPACK CHUNK =====
+// Chunk body: [ {hoisted_column: value, ...}, [ [row values...], ... ] ]
+// One pass over the (already bound) statement encodes every column of
+// every row into `cells` and notes where each cell ends. A hoistable column
+// whose cells all encode to the same bytes as the first row's is then sent
+// once in the map, and the rows are copied into `mp` without it. Comparing
+// encoded bytes means REAL and MONEY columns are compared as sent, not
+// through an integer read. Delta columns are never hoisted.
+static void exportWriteCell(MsgPackWriter& mp, sqlite3_stmt* stmt, size_t c, const ExportColumn& col, int64_t& previous) {
+  if (sqlite3_column_type(stmt, c) == SQLITE_NULL) {
+    mp.writeNil();
+    return;
+  }
+  switch (col.type) {
+    case EXPORT_INT: {
+      int64_t v = sqlite3_column_int64(stmt, c);
+      if (col.flags & EXPORT_FLAG_DELTA) {
+        mp.writeInt(v - previous);
+        previous = v;
+      } else {
+        mp.writeInt(v);
+      }
+      break;
+    }
+    case EXPORT_REAL:
+      mp.writeFloat((float)sqlite3_column_double(stmt, c));
+      break;
+    case EXPORT_MONEY:
+      mp.writeInt(Money::fromAmount(sqlite3_column_double(stmt, c)).centavos);
+      break;
+    case EXPORT_TEXT: {
+      const char* text = (const char*)sqlite3_column_text(stmt, c);
+      mp.writeStr(text, (size_t)sqlite3_column_bytes(stmt, c));
+      break;
+    }
+  }
+}
+
+static size_t exportChunkMsgPack(const ExportSpec& spec, sqlite3_stmt* stmt, int chunk, int& rows, int64_t& cursor, bool keyset, MsgPackWriter& mp, SyncPayloadStats& stats, uint64_t* payloadHash = nullptr) {
+  const size_t n = spec.columnCount;
+  std::vector<bool> hoisted(n, false);
+  for (size_t c = 0; c < n; ++c) {
+    hoisted[c] = (spec.columns[c].flags & (EXPORT_FLAG_HOIST | EXPORT_FLAG_DELTA)) == EXPORT_FLAG_HOIST;
+  }
+  std::vector<int64_t> previous(n, 0);
+  std::vector<uint32_t> cellEnd;  // rows * n end offsets into cells
+  cellEnd.reserve((size_t)spec.chunkSize * n);
+  MsgPackWriter cells;
+  SyncStat stat;
+  uint32_t t0 = micros();
+
+  rows = 0;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (keyset) cursor = sqlite3_column_int64(stmt, n);
+    for (size_t c = 0; c < n; ++c) {
+      uint32_t start = (uint32_t)cells.size();
+      exportWriteCell(cells, stmt, c, spec.columns[c], previous[c]);
+      cellEnd.push_back((uint32_t)cells.size());
+      if (rows > 0 && hoisted[c]) {
+        uint32_t firstStart = c > 0 ? cellEnd[c - 1] : 0;
+        uint32_t len = (uint32_t)cells.size() - start;
+        hoisted[c] = (len == cellEnd[c] - firstStart) && memcmp(cells.data() + start, cells.data() + firstStart, len) == 0;
+      }
+    }
+    rows++;
+  }
+
+  size_t hoistedCount = 0;
+  for (size_t c = 0; c < n; ++c) {
+    if (rows == 0) hoisted[c] = false;
+    if (hoisted[c]) hoistedCount++;
+  }
+
+  mp.clear();
+  mp.writeArrayHeader(2);
+  mp.writeMapHeader(hoistedCount);
+  for (size_t c = 0; c < n; ++c) {
+    if (!hoisted[c]) continue;
+    uint32_t firstStart = c > 0 ? cellEnd[c - 1] : 0;
+    mp.writeStr(spec.columns[c].name);
+    mp.writeRaw(cells.data() + firstStart, cellEnd[c] - firstStart);
+  }
+
+  mp.writeArrayHeader(rows);
+  uint32_t start = 0;
+  for (int r = 0; r < rows; ++r) {
+    mp.writeArrayHeader(n - hoistedCount);
+    for (size_t c = 0; c < n; ++c) {
+      uint32_t end = cellEnd[(size_t)r * n + c];
+      if (!hoisted[c]) mp.writeRaw(cells.data() + start, end - start);
+      start = end;
+    }
+  }
+
+  stat.sqlUs = micros() - t0;
+  t0 = micros();
+
+  Serial.print(spec.label);
+  Serial.print(F("_MP|"));
+  Serial.print(chunk);
+  Serial.print(F("|"));
+  Fnv64Print out(Serial);
+  size_t bytes = writeSyncPayload(out, mp.data(), mp.size(), true, stats);
+  Serial.println();
+  if (payloadHash) *payloadHash = out.hash;
+
+  stat.txUs = micros() - t0;
+  stat.rows = rows;
+  stat.bytes = bytes;
+  syncStatRecord("EXPORT", spec.label, chunk, stat);
+  return bytes;
+}
+
+// EXPORT_STATS|label|format[+LZ]|rows|payload_bytes|elapsed_ms|raw_bytes|compress_us
+static void printExportStats(const ExportSpec& spec, int rows, size_t bytes, uint32_t elapsedMs, const SyncPayloadStats& stats) {
+  Serial.print(F("EXPORT_STATS|"));
+  Serial.print(spec.label);
+  Serial.print(F("|"));
+  Serial.print(exportFormatName());
+  if (g_syncCompression) Serial.print(F("+LZ"));
+  Serial.print(F("|"));
+  Serial.print(rows);
+  Serial.print(F("|"));
+  Serial.print((unsigned long)bytes);
+  Serial.print(F("|"));
+  Serial.print(elapsedMs);
+  Serial.print(F("|"));
+  Serial.print(stats.rawBytes);
+  Serial.print(F("|"));
+  Serial.println(stats.compressUs);
+}
+
+// ===== RUN EXPORT =====
+// Args: empty for the whole table (OFFSET paging), since=N for rows with
+// change_seq > N (keyset paging on the change_seq index), plus any filters
+// of the spec. A filtered export has no WATERMARK: it does not cover every
+// row changed up to it.
+bool runTableExport(const ExportSpec& spec, const String& args) {
+  uint32_t startMs = millis();
+  ExportQuery q;
+  if (!exportQueryOpen(spec, args, q)) return true;
+  int totalRows = exportQueryCount(q);
+  if (totalRows < 0) {
+    Serial.println(F("Failed to prepare count query"));
+    return false;
+  }
+  int totalChunks = (totalRows + spec.chunkSize - 1) / spec.chunkSize;
+
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, q.selectSql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("Failed to prepare export query: "));
+    Serial.println(sqlite3_errmsg(db));
+    return false;
+  }
+
+  Serial.print(F("BEGIN_"));
+  Serial.print(spec.label);
+  Serial.print(F("_JSON|"));
+  Serial.println(totalChunks);
+
+  bool msgpack = (g_exportFormat == EXPORT_FORMAT_MSGPACK);
+  if (msgpack) {
+    printExportColumns(spec);
+  }
+
+  MsgPackWriter mp;
+  SyncPayloadStats stats;
+  size_t totalBytes = 0;
+  int exportedRows = 0;
+  int64_t cursor = q.firstCursor;
+  for (int chunk = 0; chunk < totalChunks; ++chunk) {
+    exportQueryBind(stmt, q, chunk, cursor);
+
+    int rows = 0;
+    totalBytes += msgpack ? exportChunkMsgPack(spec, stmt, chunk, rows, cursor, q.keyset, mp, stats)
+                          : exportChunkJson(spec, stmt, chunk, rows, cursor, q.keyset, stats);
+    exportedRows += rows;
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+  }
+  sqlite3_finalize(stmt);
+
+  printExportStats(spec, exportedRows, totalBytes, millis() - startMs, stats);
+
+  // WATERMARK|label|max_change_seq: the since= value for the next export
+  // once the server has stored these rows.
+  if (q.filterCount == 0) {
+    Serial.print(F("WATERMARK|"));
+    Serial.print(spec.label);
+    Serial.print(F("|"));
+    Serial.println((long long)exportScalar(spec.watermarkSql));
+  }
+
+  Serial.print(F("END_"));
+  Serial.print(spec.label);
+  Serial.println(F("_JSON"));
+  return true;
+}
+
+#endif // EXPORT_ENGINE_H
@@ -0,0 +1,321 @@
+// Host test: the export encodings side by side. Seeds a bills table laid
+// out like the device's, exports it through runTableExport() as JSON,
+// MessagePack and MessagePack+LZ, and reports the payload bytes per row and
+// the export time of each from its EXPORT_STATS line. Every MessagePack
+// chunk is decoded and checked against the table, including a table whose
+// hoisted columns are REAL and MONEY. From Watersystem_ESP32/:
+//
+//   g++ -std=c++17 -O2 -I. -Ihost_test managers/sync/export_engine_test.cpp -lsqlite3 -o /tmp/export_test && /tmp/export_test
+//
+// Times are the host's; on the device they come from the same
+// EXPORT_STATS line.
+
+#include "export_engine.h"
+#include <map>
+#include <string>
+#include <vector>
+
+static int failed = 0;
+
+static void check(bool ok, const std::string& what) {
+  if (!ok) {
+    printf("FAIL %s\n", what.c_str());
+    failed++;
+  }
+}
+
+// Same columns as BILL_EXPORT_SPEC in bill_sync.h
+static const ExportColumn TEST_BILL_COLUMNS[] = {
+  {"bill_id", EXPORT_INT, EXPORT_FLAG_DELTA},
+  {"reference_number", EXPORT_TEXT, 0},
+  {"customer_id", EXPORT_INT, 0},
+  {"reading_id", EXPORT_INT, EXPORT_FLAG_DELTA},
+  {"device_uid", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"bill_date", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"due_date", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"rate_per_m3", EXPORT_MONEY, 0},
+  {"charges", EXPORT_MONEY, 0},
+  {"penalty", EXPORT_MONEY, 0},
+  {"total_due", EXPORT_MONEY, 0},
+  {"status", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+};
+
+static const ExportSpec TEST_BILL_SPEC = {
+  "BILLS",
+  "SELECT COUNT(*) FROM bills;",
+  "SELECT bill_id, reference_number, customer_id, reading_id, device_uid, bill_date, due_date, rate_per_m3, charges, penalty, total_due, status FROM bills ORDER BY bill_id LIMIT ? OFFSET ?;",
+  TEST_BILL_COLUMNS,
+  sizeof(TEST_BILL_COLUMNS) / sizeof(TEST_BILL_COLUMNS[0]),
+  150,
+  nullptr, nullptr,
+  "SELECT 0;",
+  "bills", nullptr, "bill_id", nullptr, 0
+};
+
+// Hoistable REAL and MONEY columns: 1.5 and 1.7 share an integer part but
+// must not be hoisted together
+static const ExportColumn TEST_METER_COLUMNS[] = {
+  {"id", EXPORT_INT, EXPORT_FLAG_DELTA},
+  {"level", EXPORT_REAL, EXPORT_FLAG_HOIST},
+  {"rate", EXPORT_MONEY, EXPORT_FLAG_HOIST},
+  {"note", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+};
+
+static const ExportSpec TEST_METER_SPEC = {
+  "METERS",
+  "SELECT COUNT(*) FROM meters;",
+  "SELECT id, level, rate, note FROM meters ORDER BY id LIMIT ? OFFSET ?;",
+  TEST_METER_COLUMNS,
+  sizeof(TEST_METER_COLUMNS) / sizeof(TEST_METER_COLUMNS[0]),
+  4,
+  nullptr, nullptr,
+  "SELECT 0;",
+  "meters", nullptr, "id", nullptr, 0
+};
+
+static void exec(const char* sql) {
+  char* err = nullptr;
+  if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+    printf("SQL error: %s\n", err);
+    exit(1);
+  }
+}
+
+static void seed() {
+  exec("CREATE TABLE bills (bill_id INTEGER PRIMARY KEY, reference_number TEXT, customer_id INTEGER, reading_id INTEGER,"
+       " device_uid TEXT, bill_date TEXT, due_date TEXT, rate_per_m3 REAL, charges REAL, penalty REAL, total_due REAL, status TEXT);");
+  exec("BEGIN;");
+  static const double rates[] = {22.00, 25.50, 30.00};
+  for (int i = 0; i < 600; i++) {
+    int customer = 1 + (i * 37) % 400;
+    double rate = rates[customer % 3];
+    int usage = 5 + (i * 13) % 30;
+    double charges = usage * rate;
+    double penalty = i % 11 == 0 ? charges * 0.10 : 0;
+    int day = 5 + i / 150;
+    if (i >= 300 && i < 450) day += i % 2;  // one chunk with two billing days
+    char sql[512];
+    snprintf(sql, sizeof(sql),
+             "INSERT INTO bills VALUES (%d, 'WB-2026-%06d', %d, %d, 'ESP32-A1B2C3', '2026-01-%02d', '2026-01-%02d', %.2f, %.2f, %.2f, %.2f, '%s');",
+             1000 + i, i + 1, customer, 5000 + i, day, day + 15, rate, charges, penalty, charges + penalty,
+             i >= 450 && i % 7 == 0 ? "Paid" : "Pending");
+    exec(sql);
+  }
+  exec("COMMIT;");
+
+  exec("CREATE TABLE meters (id INTEGER PRIMARY KEY, level REAL, rate REAL, note TEXT);");
+  exec("INSERT INTO meters VALUES (1, 1.5, 12.50, 'a'), (2, 1.7, 12.75, 'a'), (3, 1.2, 12.10, 'a'), (4, 1.9, 12.90, 'a'),"
+       " (5, 2.25, 15.00, 'b'), (6, 2.25, 15.00, 'b'), (7, 2.25, 15.00, 'b'), (8, 2.25, 15.00, 'b'),"
+       " (9, NULL, 15.00, NULL), (10, 3.5, 15.00, NULL), (11, 3.5, 15.00, 'c'), (12, 3.5, 15.004, NULL);");
+}
+
+// ===== MESSAGEPACK READER =====
+// Values as text, so they compare against what SQLite returns
+struct MpReader {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  uint64_t be(int n) {
+    uint64_t v = 0;
+    while (n--) v = (v << 8) | *p++;
+    return v;
+  }
+
+  size_t header(uint8_t fix, uint8_t fixMask, uint8_t b16, uint8_t b32) {
+    uint8_t b = *p++;
+    if ((b & ~fixMask) == fix) return b & fixMask;
+    if (b == b16) return (size_t)be(2);
+    if (b == b32) return (size_t)be(4);
+    return SIZE_MAX;
+  }
+  size_t array() { return header(0x90, 0x0F, 0xDC, 0xDD); }
+  size_t map() { return header(0x80, 0x0F, 0xDE, 0xDF); }
+
+  std::string value() {
+    uint8_t b = *p++;
+    if (b == 0xC0) return "nil";
+    if (b < 0x80) return std::to_string(b);
+    if (b >= 0xE0) return std::to_string((int8_t)b);
+    if ((b & 0xE0) == 0xA0) return str(b & 0x1F);
+    switch (b) {
+      case 0xCA: {
+        uint32_t bits = (uint32_t)be(4);
+        float f;
+        memcpy(&f, &bits, 4);
+        char buf[32];
+        snprintf(buf, sizeof(buf), "f%.4f", f);
+        return buf;
+      }
+      case 0xCC: return std::to_string(be(1));
+      case 0xCD: return std::to_string(be(2));
+      case 0xCE: return std::to_string(be(4));
+      case 0xCF: return std::to_string(be(8));
+      case 0xD0: return std::to_string((int8_t)be(1));
+      case 0xD1: return std::to_string((int16_t)be(2));
+      case 0xD2: return std::to_string((int32_t)be(4));
+      case 0xD3: return std::to_string((int64_t)be(8));
+      case 0xD9: return str((size_t)be(1));
+      case 0xDA: return str((size_t)be(2));
+      case 0xDB: return str((size_t)be(4));
+    }
+    return "?";
+  }
+
+  std::string str(size_t len) {
+    std::string s((const char*)p, len);
+    p += len;
+    return s;
+  }
+};
+
+// Rows of a table as the decoder should see them, column by column
+static std::vector<std::vector<std::string>> expectedRows(const ExportSpec& spec) {
+  std::vector<std::vector<std::string>> rows;
+  sqlite3_stmt* stmt;
+  std::string sql = spec.selectSql;
+  sql = sql.substr(0, sql.find(" LIMIT")) + ";";
+  sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    std::vector<std::string> row;
+    for (size_t c = 0; c < spec.columnCount; c++) {
+      char buf[32];
+      if (sqlite3_column_type(stmt, c) == SQLITE_NULL) {
+        row.push_back("nil");
+        continue;
+      }
+      switch (spec.columns[c].type) {
+        case EXPORT_INT: row.push_back(std::to_string(sqlite3_column_int64(stmt, c))); break;
+        case EXPORT_REAL:
+          snprintf(buf, sizeof(buf), "f%.4f", (float)sqlite3_column_double(stmt, c));
+          row.push_back(buf);
+          break;
+        case EXPORT_MONEY: row.push_back(std::to_string(Money::fromAmount(sqlite3_column_double(stmt, c)).centavos)); break;
+        case EXPORT_TEXT: row.push_back((const char*)sqlite3_column_text(stmt, c)); break;
+      }
+    }
+    rows.push_back(row);
+  }
+  sqlite3_finalize(stmt);
+  return rows;
+}
+
+// Decodes every <LABEL>_MP line of an export and checks it row by row;
+// returns the hoisted column names of each chunk
+static std::vector<std::string> checkMsgPackExport(const ExportSpec& spec, const std::string& out) {
+  std::vector<std::vector<std::string>> expected = expectedRows(spec);
+  std::vector<std::string> hoistedPerChunk;
+  std::string prefix = std::string(spec.label) + "_MP|";
+  size_t row = 0;
+  size_t pos = 0;
+  while ((pos = out.find(prefix, pos)) != std::string::npos) {
+    size_t eol = out.find('\n', pos);
+    std::string line = out.substr(pos, eol - pos);
+    pos = eol;
+    std::string field = line.substr(line.find('|', prefix.size()) + 1);
+
+    std::vector<uint8_t> bytes;
+    if (field.rfind("Z:", 0) == 0) {
+      size_t sep = field.find(':', 2);
+      size_t rawLen = atoi(field.c_str() + 2);
+      std::vector<uint8_t> packed;
+      base64Decode(field.c_str() + sep + 1, field.size() - sep - 1, packed);
+      bytes.resize(rawLen);
+      check(lzDecompress(packed.data(), packed.size(), bytes.data(), rawLen), "LZ chunk inflates");
+    } else {
+      check(base64Decode(field.c_str(), field.size(), bytes), "base64 chunk decodes");
+    }
+
+    MpReader mp{bytes.data(), bytes.data() + bytes.size()};
+    check(mp.array() == 2, "chunk is [hoisted, rows]");
+    std::map<std::string, std::string> hoisted;
+    std::string names;
+    for (size_t h = mp.map(); h > 0; h--) {
+      std::string name = mp.value();
+      hoisted[name] = mp.value();
+      names += (names.empty() ? "" : ",") + name;
+    }
+    hoistedPerChunk.push_back(names);
+
+    std::vector<int64_t> previous(spec.columnCount, 0);
+    for (size_t r = mp.array(); r > 0; r--, row++) {
+      check(mp.array() == spec.columnCount - hoisted.size(), "row width");
+      for (size_t c = 0; c < spec.columnCount; c++) {
+        const ExportColumn& col = spec.columns[c];
+        std::string value;
+        if (hoisted.count(col.name)) {
+          value = hoisted[col.name];
+        } else {
+          value = mp.value();
+          if ((col.flags & EXPORT_FLAG_DELTA) && value != "nil") {
+            previous[c] += atoll(value.c_str());
+            value = std::to_string(previous[c]);
+          }
+        }
+        if (row < expected.size() && value != expected[row][c]) {
+          check(false, std::string(spec.label) + " row " + std::to_string(row) + " " + col.name + ": " + value + " != " + expected[row][c]);
+        }
+      }
+    }
+    check(mp.p == mp.end, "chunk fully read");
+  }
+  check(row == expected.size(), std::string(spec.label) + " row count");
+  return hoistedPerChunk;
+}
+
+struct ExportRun {
+  std::string out;
+  int rows = 0;
+  unsigned long bytes = 0;
+  unsigned long ms = 0;
+};
+
+// Runs one export with Serial captured and reads back its EXPORT_STATS line
+static ExportRun runExport(const ExportSpec& spec, SyncExportFormat format, bool lz) {
+  g_exportFormat = format;
+  g_syncCompression = lz;
+  ExportRun run;
+  Serial.capture = &run.out;
+  uint32_t t0 = micros();
+  runTableExport(spec, "");
+  run.ms = micros() - t0;  // whole export, microseconds
+  Serial.capture = nullptr;
+
+  size_t stats = run.out.find("EXPORT_STATS|");
+  check(stats != std::string::npos, "EXPORT_STATS line");
+  std::string fields = run.out.substr(stats, run.out.find('\n', stats) - stats);
+  // EXPORT_STATS|label|format|rows|payload_bytes|...
+  size_t f3 = fields.find('|', fields.find('|', fields.find('|') + 1) + 1);
+  size_t f4 = fields.find('|', f3 + 1);
+  run.rows = atoi(fields.c_str() + f3 + 1);
+  run.bytes = strtoul(fields.c_str() + f4 + 1, nullptr, 10);
+  return run;
+}
+
+int main() {
+  sqlite3_open(":memory:", &db);
+  seed();
+
+  std::vector<std::string> hoisted = checkMsgPackExport(TEST_METER_SPEC, runExport(TEST_METER_SPEC, EXPORT_FORMAT_MSGPACK, false).out);
+  check(hoisted.size() == 3, "three meter chunks");
+  check(hoisted.size() > 0 && hoisted[0] == "note", "REAL/MONEY with the same integer part are not hoisted: " + (hoisted.size() > 0 ? hoisted[0] : ""));
+  check(hoisted.size() > 1 && hoisted[1] == "level,rate,note", "equal REAL/MONEY are hoisted: " + (hoisted.size() > 1 ? hoisted[1] : ""));
+  // 15.004 is sent as 1500 centavos like 15.00, so rate still goes once
+  check(hoisted.size() > 2 && hoisted[2] == "rate", "NULL next to a value is not hoisted: " + (hoisted.size() > 2 ? hoisted[2] : ""));
+
+  ExportRun json = runExport(TEST_BILL_SPEC, EXPORT_FORMAT_JSON, false);
+  ExportRun msgpack = runExport(TEST_BILL_SPEC, EXPORT_FORMAT_MSGPACK, false);
+  ExportRun lz = runExport(TEST_BILL_SPEC, EXPORT_FORMAT_MSGPACK, true);
+  hoisted = checkMsgPackExport(TEST_BILL_SPEC, msgpack.out);
+  checkMsgPackExport(TEST_BILL_SPEC, lz.out);
+  check(hoisted.size() == 4 && hoisted[0] == "device_uid,bill_date,due_date,status", "bill chunk 0 hoists the shared columns");
+  check(hoisted.size() == 4 && hoisted[2] == "device_uid,status", "bill chunk 2 keeps the mixed dates per row");
+  check(json.rows == 600 && msgpack.rows == 600 && lz.rows == 600, "every bill exported");
+
+  printf("%d bills, %d per chunk, payload bytes per row / export time per row (host):\n", json.rows, TEST_BILL_SPEC.chunkSize);
+  for (const ExportRun* run : {&json, &msgpack, &lz}) {
+    printf("  %-12s %6.1f bytes  %6.2f us\n", run == &json ? "JSON" : (run == &msgpack ? "MSGPACK" : "MSGPACK+LZ"),
+           (double)run->bytes / run->rows, (double)run->ms / run->rows);
+  }
+  printf(failed ? "%d checks failed\n" : "all checks passed\n", failed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,203 @@
+#ifndef EXPORT_PULL_H
+#define EXPORT_PULL_H
+
+#include "../../configuration/config.h"
+#include "export_engine.h"
+#include "reading_sync.h"
+#include "bill_sync.h"
+#include "bill_transaction_sync.h"
+#include <vector>
+
+// ===== CLIENT-PACED EXPORT =====
+// The pushed EXPORT_<TABLE> streams every chunk back to back. Here the
+// client pulls chunks as it consumes them, so it never has more data in
+// flight than it asked for, and re-requests any chunk whose hash does not
+// match what it received.
+//
+//   EXPORT_OPEN|<LABEL>[|since=N,<filter>=<value>,...]
+//     <LABEL>_COLS|...                            MessagePack only
+//     EXPORT_READY|<LABEL>|<chunks>|<rows>|<watermark, -1 when filtered>
+//   EXPORT_PULL|<LABEL>|<first>|<count>
+//     <LABEL>_CHUNK|<i>|<payload>  (or <LABEL>_MP|<i>|<payload>)
+//     CHUNK_SUM|<LABEL>|<i>|<rows>|<fnv64 of payload>
+//   EXPORT_CLOSE|<LABEL>
+//     EXPORT_STATS|...
+//     END_<LABEL>_JSON
+//
+// The watermark is read when the export opens; rows changed later carry a
+// higher change_seq and are picked up by the next delta export.
+
+#define EXPORT_PULL_MAX_CHUNKS 16  // per EXPORT_PULL
+
+static const ExportSpec* const EXPORT_PULL_SPECS[] = {
+  &READING_EXPORT_SPEC,
+  &BILL_EXPORT_SPEC,
+  &BILL_TRANSACTION_EXPORT_SPEC,
+};
+
+struct ExportPullSession {
+  const ExportSpec* spec = nullptr;
+  ExportQuery query;
+  int totalRows = 0;
+  int totalChunks = 0;
+  // Keyset exports: chunk i starts after chunkCursor[i]
+  std::vector<int64_t> chunkCursor;
+  uint32_t startMs = 0;
+  size_t bytes = 0;
+  int rows = 0;
+  SyncPayloadStats stats;
+};
+
+static ExportPullSession exportPull;
+
+static const ExportSpec* exportPullSpecFor(const String& label) {
+  for (const ExportSpec* spec : EXPORT_PULL_SPECS) {
+    if (label == spec->label) return spec;
+  }
+  return nullptr;
+}
+
+static bool exportPullIsOpen(const String& label) {
+  if (exportPull.spec && label == exportPull.spec->label) return true;
+  Serial.print(F("ERR|EXPORT_NOT_OPEN|"));
+  Serial.println(label);
+  return false;
+}
+
+static void exportPullBind(sqlite3_stmt* stmt, int chunk) {
+  sqlite3_reset(stmt);
+  const ExportQuery& q = exportPull.query;
+  exportQueryBind(stmt, q, chunk, q.keyset ? exportPull.chunkCursor[chunk] : 0);
+}
+
+// Walks the keyset up to `chunk` without sending anything, for a pull that
+// skips ahead of the chunks sent so far
+static void exportPullSeek(sqlite3_stmt* stmt, int chunk) {
+  const size_t cursorCol = exportPull.spec->columnCount;
+  while ((int)exportPull.chunkCursor.size() <= chunk) {
+    int prev = exportPull.chunkCursor.size() - 1;
+    int64_t cursor = exportPull.chunkCursor[prev];
+    exportPullBind(stmt, prev);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      cursor = sqlite3_column_int64(stmt, cursorCol);
+    }
+    exportPull.chunkCursor.push_back(cursor);
+  }
+}
+
+// Handle EXPORT_OPEN command
+bool handleExportOpen(String payload) {
+  int bar = payload.indexOf('|');
+  String label = bar >= 0 ? payload.substring(0, bar) : payload;
+  String args = bar >= 0 ? payload.substring(bar + 1) : String();
+  label.trim();
+
+  const ExportSpec* spec = exportPullSpecFor(label);
+  if (!spec) {
+    Serial.print(F("ERR|UNKNOWN_EXPORT|"));
+    Serial.println(label);
+    return true;
+  }
+
+  exportPull = ExportPullSession();
+  if (!exportQueryOpen(*spec, args, exportPull.query)) return true;
+  int totalRows = exportQueryCount(exportPull.query);
+  if (totalRows < 0) {
+    Serial.print(F("ERR|EXPORT_FAILED|"));
+    Serial.println(label);
+    return true;
+  }
+
+  exportPull.spec = spec;
+  exportPull.totalRows = totalRows;
+  exportPull.totalChunks = (totalRows + spec->chunkSize - 1) / spec->chunkSize;
+  exportPull.chunkCursor.push_back(exportPull.query.firstCursor);
+  exportPull.startMs = millis();
+
+  if (g_exportFormat == EXPORT_FORMAT_MSGPACK) {
+    printExportColumns(*spec);
+  }
+  Serial.print(F("EXPORT_READY|"));
+  Serial.print(spec->label);
+  Serial.print(F("|"));
+  Serial.print(exportPull.totalChunks);
+  Serial.print(F("|"));
+  Serial.print(totalRows);
+  Serial.print(F("|"));
+  Serial.println(exportPull.query.filterCount ? -1LL : (long long)exportScalar(spec->watermarkSql));
+  return true;
+}
+
+// Handle EXPORT_PULL command
+bool handleExportPull(String payload) {
+  int p1 = payload.indexOf('|');
+  int p2 = p1 >= 0 ? payload.indexOf('|', p1 + 1) : -1;
+  if (p2 < 0) {
+    Serial.println(F("ERR|BAD_EXPORT_PULL"));
+    return true;
+  }
+  String label = payload.substring(0, p1);
+  if (!exportPullIsOpen(label)) return true;
+
+  const ExportSpec& spec = *exportPull.spec;
+  int first = payload.substring(p1 + 1, p2).toInt();
+  int count = payload.substring(p2 + 1).toInt();
+  if (first < 0) first = 0;
+  if (count > EXPORT_PULL_MAX_CHUNKS) count = EXPORT_PULL_MAX_CHUNKS;
+  int last = first + count;
+  if (last > exportPull.totalChunks) last = exportPull.totalChunks;
+
+  bool keyset = exportPull.query.keyset;
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, exportPull.query.selectSql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("ERR|EXPORT_FAILED|"));
+    Serial.println(label);
+    return true;
+  }
+
+  bool msgpack = (g_exportFormat == EXPORT_FORMAT_MSGPACK);
+  MsgPackWriter mp;
+  for (int chunk = first; chunk < last; ++chunk) {
+    if (keyset) exportPullSeek(stmt, chunk);
+    exportPullBind(stmt, chunk);
+
+    int rows = 0;
+    int64_t cursor = keyset ? exportPull.chunkCursor[chunk] : -1;
+    uint64_t hash = FNV64_OFFSET;
+    exportPull.bytes += msgpack ? exportChunkMsgPack(spec, stmt, chunk, rows, cursor, keyset, mp, exportPull.stats, &hash)
+                                : exportChunkJson(spec, stmt, chunk, rows, cursor, keyset, exportPull.stats, &hash);
+    exportPull.rows += rows;
+    if (keyset && (int)exportPull.chunkCursor.size() == chunk + 1) {
+      exportPull.chunkCursor.push_back(cursor);
+    }
+
+    char hex[17];
+    fnv64Hex(hash, hex);
+    Serial.print(F("CHUNK_SUM|"));
+    Serial.print(spec.label);
+    Serial.print(F("|"));
+    Serial.print(chunk);
+    Serial.print(F("|"));
+    Serial.print(rows);
+    Serial.print(F("|"));
+    Serial.println(hex);
+  }
+  sqlite3_finalize(stmt);
+  return true;
+}
+
+// Handle EXPORT_CLOSE command
+bool handleExportClose(String label) {
+  label.trim();
+  if (!exportPullIsOpen(label)) return true;
+
+  // Rows and bytes include chunks the client pulled again
+  printExportStats(*exportPull.spec, exportPull.rows, exportPull.bytes, millis() - exportPull.startMs, exportPull.stats);
+  Serial.print(F("END_"));
+  Serial.print(exportPull.spec->label);
+  Serial.println(F("_JSON"));
+  exportPull = ExportPullSession();
+  return true;
+}
+
+#endif // EXPORT_PULL_H
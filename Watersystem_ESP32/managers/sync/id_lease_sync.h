@@ -0,0 +1,101 @@
+#ifndef ID_LEASE_SYNC_H
+#define ID_LEASE_SYNC_H
+
+#include "../../configuration/config.h"
+#include "../../database/id_leases.h"
+#include <sqlite3.h>
+
+// ===== ID LEASES =====
+//   ID_LEASES
+//     BEGIN_ID_LEASES|<tables>
+//     ID_LEASE|<table>|<next_id>|<last_id>|<remaining>    0|0|0 without a lease
+//     END_ID_LEASES
+//   SET_ID_LEASE|<table>|<first_id>|<last_id>
+//     ACK|ID_LEASE|<table>|<first_id>|<last_id>
+//     ERR|ID_LEASE|<reason>
+// A new block replaces the current one; ids left in the old block are
+// simply not used. A block that overlaps rows already in the table is
+// refused, so a stale grant can never produce a duplicate key.
+
+// Handle ID_LEASES command
+bool handleIdLeases() {
+  Serial.print(F("BEGIN_ID_LEASES|"));
+  Serial.println(sizeof(ID_LEASE_TABLES) / sizeof(ID_LEASE_TABLES[0]));
+
+  sqlite3_stmt* stmt;
+  bool prepared = sqlite3_prepare_v2(db, "SELECT next_id, last_id FROM id_leases WHERE table_name = ?;", -1, &stmt, NULL) == SQLITE_OK;
+  for (const IdLeaseTable& lease : ID_LEASE_TABLES) {
+    long long next = 0;
+    long long last = 0;
+    if (prepared) {
+      sqlite3_reset(stmt);
+      sqlite3_bind_text(stmt, 1, lease.table, -1, SQLITE_STATIC);
+      if (sqlite3_step(stmt) == SQLITE_ROW) {
+        next = sqlite3_column_int64(stmt, 0);
+        last = sqlite3_column_int64(stmt, 1);
+      }
+    }
+    long long remaining = next > 0 && last >= next ? last - next + 1 : 0;
+    Serial.printf("ID_LEASE|%s|%lld|%lld|%lld\n", lease.table, next, last, remaining);
+  }
+  if (prepared) sqlite3_finalize(stmt);
+
+  Serial.println(F("END_ID_LEASES"));
+  return true;
+}
+
+// Handle SET_ID_LEASE command
+bool handleSetIdLease(String payload) {
+  int p1 = payload.indexOf('|');
+  int p2 = p1 >= 0 ? payload.indexOf('|', p1 + 1) : -1;
+  if (p2 < 0) {
+    Serial.println(F("ERR|ID_LEASE|BAD_FORMAT"));
+    return true;
+  }
+  const IdLeaseTable* lease = idLeaseTableFor(payload.substring(0, p1));
+  long long first = atoll(payload.substring(p1 + 1, p2).c_str());
+  long long last = atoll(payload.substring(p2 + 1).c_str());
+  if (!lease) {
+    Serial.println(F("ERR|ID_LEASE|UNKNOWN_TABLE"));
+    return true;
+  }
+  if (first <= 0 || last < first) {
+    Serial.println(F("ERR|ID_LEASE|BAD_RANGE"));
+    return true;
+  }
+
+  char sql[160];
+  snprintf(sql, sizeof(sql), "SELECT COUNT(*) FROM %s WHERE %s BETWEEN ? AND ?;", lease->table, lease->key);
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.println(F("ERR|ID_LEASE|DB_ERROR"));
+    return true;
+  }
+  sqlite3_bind_int64(stmt, 1, first);
+  sqlite3_bind_int64(stmt, 2, last);
+  bool inUse = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 0) > 0;
+  sqlite3_finalize(stmt);
+  if (inUse) {
+    Serial.println(F("ERR|ID_LEASE|IN_USE"));
+    return true;
+  }
+
+  if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO id_leases (table_name, next_id, last_id) VALUES (?, ?, ?);", -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.println(F("ERR|ID_LEASE|DB_ERROR"));
+    return true;
+  }
+  sqlite3_bind_text(stmt, 1, lease->table, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, first);
+  sqlite3_bind_int64(stmt, 3, last);
+  bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+  sqlite3_finalize(stmt);
+  if (!ok) {
+    Serial.println(F("ERR|ID_LEASE|DB_ERROR"));
+    return true;
+  }
+
+  Serial.printf("ACK|ID_LEASE|%s|%lld|%lld\n", lease->table, first, last);
+  return true;
+}
+
+#endif // ID_LEASE_SYNC_H
@@ -0,0 +1,208 @@
+#ifndef LINK_SYNC_H
+#define LINK_SYNC_H
+
+#include <Arduino.h>
+#include "../../configuration/config.h"
+#include "sync_codec.h"
+#include "../serial_rx_manager.h"
+
+// ===== SERIAL LINK SPEED =====
+// The link boots at SERIAL_BAUD. The client can raise it for a sync:
+//
+//   SET_BAUD|<rate>
+//     ACK|SET_BAUD|<rate>                     sent at the old rate, then switch
+//   BAUD_OK|<rate>|<seed>|<pattern>           client, at the new rate
+//     ACK|BAUD_OK|<rate>|<seed>|<pattern>     pattern checked both ways
+//
+// Without an intact BAUD_OK within BAUD_CONFIRM_MS the device switches back
+// and reports ERR|BAUD_REVERTED|<old>. A raised rate also falls back to
+// SERIAL_BAUD after LINK_IDLE_REVERT_MS without input, so a client that
+// went away (page reload) can always reconnect at the default.
+//
+//   LINKTEST|<bytes>|<seed>
+//     BEGIN_LINKTEST|<lines>
+//     LT|<seq>|<pattern>                      device -> client throughput
+//     END_LINKTEST|<lines>|<bytes>|<elapsed_us>
+//   LINKTEST_ECHO|<seq>|<seed>|<pattern>
+//     LT_ECHO|<seq>|OK|BAD                    client -> device integrity
+//
+// Patterns are xorshift32 streams over the base64 alphabet, so both sides
+// generate them without sending the expected data.
+
+#define BAUD_CONFIRM_MS 2000
+#define LINK_IDLE_REVERT_MS 60000UL
+#define LINKTEST_LINE_CHARS 96
+#define LINKTEST_MAX_BYTES (256 * 1024)
+#define BAUD_OK_PATTERN_CHARS 128
+
+static const uint32_t LINK_BAUD_RATES[] = { 115200, 230400, 460800, 921600, 1500000, 2000000 };
+
+static uint32_t linkBaud = SERIAL_BAUD;
+static unsigned long linkLastInputMs = 0;
+
+static inline char linkPatternChar(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return BASE64_ALPHABET[state & 0x3F];
+}
+
+// Seed for one pattern line; never zero so xorshift does not stall
+static inline uint32_t linkPatternSeed(uint32_t seed, uint32_t seq) {
+  return (seed ^ (seq * 2654435761UL)) | 1;
+}
+
+static bool linkPatternMatches(const String& text, uint32_t state) {
+  for (size_t i = 0; i < text.length(); i++) {
+    if (text[i] != linkPatternChar(state)) return false;
+  }
+  return true;
+}
+
+static void linkPrintPattern(uint32_t state, int chars) {
+  char buf[LINKTEST_LINE_CHARS > BAUD_OK_PATTERN_CHARS ? LINKTEST_LINE_CHARS : BAUD_OK_PATTERN_CHARS];
+  for (int i = 0; i < chars; i++) buf[i] = linkPatternChar(state);
+  Serial.write((const uint8_t*)buf, chars);
+}
+
+static bool linkBaudSupported(uint32_t rate) {
+  for (uint32_t r : LINK_BAUD_RATES) {
+    if (r == rate) return true;
+  }
+  return false;
+}
+
+static void linkSwitchBaud(uint32_t rate) {
+  Serial.flush();  // let the last reply leave at the old rate
+  delay(20);
+  Serial.updateBaudRate(rate);
+  linkBaud = rate;
+  serialDiscardPartial();  // drop bytes garbled by the switch
+}
+
+// Records serial activity; called for every received command line
+void linkNoteInput() {
+  linkLastInputMs = millis();
+}
+
+// Falls back to SERIAL_BAUD once a raised link has been idle; call from loop()
+void linkIdleTick() {
+  if (linkBaud != SERIAL_BAUD && millis() - linkLastInputMs > LINK_IDLE_REVERT_MS) {
+    linkSwitchBaud(SERIAL_BAUD);
+  }
+}
+
+// Waits for BAUD_OK|<rate>|<seed>|<pattern> at the new rate
+static bool linkAwaitBaudConfirm(uint32_t rate) {
+  String line;
+  unsigned long deadline = millis() + BAUD_CONFIRM_MS;
+  long remaining;
+  while ((remaining = (long)(deadline - millis())) > 0) {
+    if (!serialNextLine(line, (uint32_t)remaining)) continue;
+
+    // Switch noise can stick to the front of the line
+    int start = line.indexOf("BAUD_OK|");
+    if (start < 0) continue;
+    line = line.substring(start);
+
+    // BAUD_OK|<rate>|<seed>|<pattern>
+    int p1 = line.indexOf('|');
+    int p2 = line.indexOf('|', p1 + 1);
+    int p3 = p2 >= 0 ? line.indexOf('|', p2 + 1) : -1;
+    if (p3 > 0 && (uint32_t)line.substring(p1 + 1, p2).toInt() == rate) {
+      uint32_t seed = (uint32_t)strtoul(line.substring(p2 + 1, p3).c_str(), NULL, 10);
+      String pattern = line.substring(p3 + 1);
+      pattern.trim();
+      if (pattern.length() == BAUD_OK_PATTERN_CHARS && linkPatternMatches(pattern, linkPatternSeed(seed, 0))) {
+        Serial.print(F("ACK|BAUD_OK|"));
+        Serial.print(rate);
+        Serial.print(F("|"));
+        Serial.print(seed);
+        Serial.print(F("|"));
+        linkPrintPattern(linkPatternSeed(seed, 1), BAUD_OK_PATTERN_CHARS);
+        Serial.println();
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Handle SET_BAUD command
+bool handleSetBaud(String payload) {
+  payload.trim();
+  uint32_t rate = (uint32_t)strtoul(payload.c_str(), NULL, 10);
+  if (!linkBaudSupported(rate)) {
+    Serial.print(F("ERR|UNSUPPORTED_BAUD|"));
+    Serial.println(payload);
+    return true;
+  }
+
+  Serial.print(F("ACK|SET_BAUD|"));
+  Serial.println(rate);
+  if (rate == linkBaud) return true;
+
+  uint32_t previous = linkBaud;
+  linkSwitchBaud(rate);
+  if (!linkAwaitBaudConfirm(rate)) {
+    linkSwitchBaud(previous);
+    Serial.print(F("ERR|BAUD_REVERTED|"));
+    Serial.println(previous);
+  }
+  linkNoteInput();
+  return true;
+}
+
+// Handle LINKTEST command
+bool handleLinkTest(String payload) {
+  int p1 = payload.indexOf('|');
+  long bytes = payload.substring(0, p1 >= 0 ? p1 : payload.length()).toInt();
+  uint32_t seed = p1 >= 0 ? (uint32_t)strtoul(payload.substring(p1 + 1).c_str(), NULL, 10) : 1;
+  if (bytes <= 0) bytes = 16384;
+  if (bytes > LINKTEST_MAX_BYTES) bytes = LINKTEST_MAX_BYTES;
+
+  int lines = (bytes + LINKTEST_LINE_CHARS - 1) / LINKTEST_LINE_CHARS;
+  Serial.print(F("BEGIN_LINKTEST|"));
+  Serial.println(lines);
+
+  unsigned long startUs = micros();
+  for (int seq = 0; seq < lines; seq++) {
+    Serial.print(F("LT|"));
+    Serial.print(seq);
+    Serial.print(F("|"));
+    linkPrintPattern(linkPatternSeed(seed, seq), LINKTEST_LINE_CHARS);
+    Serial.println();
+  }
+  Serial.flush();
+  unsigned long elapsedUs = micros() - startUs;
+
+  Serial.print(F("END_LINKTEST|"));
+  Serial.print(lines);
+  Serial.print(F("|"));
+  Serial.print((long)lines * LINKTEST_LINE_CHARS);
+  Serial.print(F("|"));
+  Serial.println(elapsedUs);
+  return true;
+}
+
+// Handle LINKTEST_ECHO command
+bool handleLinkTestEcho(String payload) {
+  int p1 = payload.indexOf('|');
+  int p2 = p1 >= 0 ? payload.indexOf('|', p1 + 1) : -1;
+  if (p2 < 0) {
+    Serial.println(F("ERR|BAD_LINKTEST"));
+    return true;
+  }
+  String seq = payload.substring(0, p1);
+  uint32_t seed = (uint32_t)strtoul(payload.substring(p1 + 1, p2).c_str(), NULL, 10);
+  String pattern = payload.substring(p2 + 1);
+  bool ok = pattern.length() == LINKTEST_LINE_CHARS &&
+            linkPatternMatches(pattern, linkPatternSeed(seed, (uint32_t)seq.toInt()));
+
+  Serial.print(F("LT_ECHO|"));
+  Serial.print(seq);
+  Serial.println(ok ? F("|OK") : F("|BAD"));
+  return true;
+}
+
+#endif // LINK_SYNC_H
@@ -0,0 +1,67 @@
+#ifndef PENALTY_SYNC_H
+#define PENALTY_SYNC_H
+
+#include "../../configuration/config.h"
+#include "../../database/penalty_engine.h"
+#include "sync_stats.h"
+#include "link_sync.h"
+
+// ===== PENALTY RUN =====
+//   PENALTY_RUN
+//     STAT|PENALTY:BILLS|0|...
+//     PENALTY_RUN|<bills penalized>|<elapsed_ms>|<today>
+//   ERR|PENALTY_RUN|CLOCK_NOT_SET or DB_ERROR
+// The same run happens on its own every PENALTY_IDLE_INTERVAL_MS once the
+// serial link has been quiet for LINK_IDLE_REVERT_MS, silently unless
+// WS_SERIAL_VERBOSE is set.
+
+#define PENALTY_IDLE_INTERVAL_MS 3600000UL
+
+static unsigned long penaltyLastRunMs = 0;
+static bool penaltyHasRun = false;
+
+// Handle PENALTY_RUN command
+bool handlePenaltyRun() {
+  if (!db) {
+    Serial.println(F("ERR|PENALTY_RUN|DB_ERROR"));
+    return true;
+  }
+  if (!penaltyClockSet()) {
+    Serial.println(F("ERR|PENALTY_RUN|CLOCK_NOT_SET"));
+    return true;
+  }
+
+  PenaltyRunResult result;
+  if (!runPenalties(result)) {
+    Serial.println(F("ERR|PENALTY_RUN|DB_ERROR"));
+    return true;
+  }
+  penaltyLastRunMs = millis();
+  penaltyHasRun = true;
+
+  syncStatRecord("PENALTY", "BILLS", 0, result.stat);
+  Serial.printf("PENALTY_RUN|%lld|%lu|%s\n", (long long)result.updated, (unsigned long)result.elapsedMs, result.today);
+  return true;
+}
+
+// Runs the penalties when due and nothing is talking to the device; call from loop()
+void penaltyIdleTick() {
+  if (!db || !penaltyClockSet()) return;
+  unsigned long now = millis();
+  if (penaltyHasRun && now - penaltyLastRunMs < PENALTY_IDLE_INTERVAL_MS) return;
+  if (now - linkLastInputMs < LINK_IDLE_REVERT_MS) return;
+
+  PenaltyRunResult result;
+  bool ok = runPenalties(result);
+  penaltyLastRunMs = now;
+  penaltyHasRun = true;
+#if WS_SERIAL_VERBOSE
+  if (ok) {
+    Serial.printf("Penalties applied to %lld bills in %lu ms\n", (long long)result.updated, (unsigned long)result.elapsedMs);
+  }
+#else
+  (void)ok;
+#endif
+}
+
+#endif // PENALTY_SYNC_H
@@ -3,89 +3,61 @@
 
 #include "../../database/readings_database.h"
 #include "../../database/bill_database.h"
+#include "export_engine.h"
 #include <ArduinoJson.h>
 
 // ===== READING SYNC OPERATIONS =====
 
-// Handle EXPORT_READINGS command
-bool handleExportReadings() {
-  Serial.println(F("Exporting readings..."));
-  // Get total count
-  sqlite3_stmt* countStmt;
-  const char* countSql = "SELECT COUNT(*) FROM readings;";
-  int rc = sqlite3_prepare_v2(db, countSql, -1, &countStmt, NULL);
-  if (rc != SQLITE_OK) {
-    Serial.println(F("Failed to prepare count query"));
-    return false;
-  }
-  rc = sqlite3_step(countStmt);
-  int totalReadings = 0;
-  if (rc == SQLITE_ROW) {
-    totalReadings = sqlite3_column_int(countStmt, 0);
-  }
-  sqlite3_finalize(countStmt);
-  const int CHUNK_SIZE = 150;
-  int totalChunks = (totalReadings + CHUNK_SIZE - 1) / CHUNK_SIZE;
-  Serial.print(F("BEGIN_READINGS_JSON|"));
-  Serial.println(totalChunks);
-
-  // Prepare statement for chunked query
-  sqlite3_stmt* stmt;
-  const char* sql = "SELECT reading_id, customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at FROM readings ORDER BY reading_id LIMIT ? OFFSET ?;";
-  int rc2 = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-  if (rc2 != SQLITE_OK) {
-    Serial.println(F("Failed to prepare readings query"));
-    return false;
-  }
-
-  for (int chunk = 0; chunk < totalChunks; ++chunk) {
-    Serial.printf("Heap free before chunk %d: %d\n", chunk, ESP.getFreeHeap());
-    int offset = chunk * CHUNK_SIZE;
-    sqlite3_bind_int(stmt, 1, CHUNK_SIZE);
-    sqlite3_bind_int(stmt, 2, offset);
-
-    DynamicJsonDocument doc(65536);  // Larger doc for 150 items
-    JsonArray arr = doc.to<JsonArray>();
+// Column layout shared by the JSON and MessagePack encodings
+static const ExportColumn READING_EXPORT_COLUMNS[] = {
+  {"reading_id", EXPORT_INT, EXPORT_FLAG_DELTA},
+  {"customer_id", EXPORT_INT, 0},
+  {"device_uid", EXPORT_TEXT, EXPORT_FLAG_HOIST},
+  {"previous_reading", EXPORT_INT, 0},
+  {"current_reading", EXPORT_INT, 0},
+  {"usage_m3", EXPORT_INT, 0},
+  {"reading_at", EXPORT_INT, EXPORT_FLAG_DELTA},
+  {"anomaly", EXPORT_TEXT, 0},
+};
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-      JsonObject obj = arr.createNestedObject();
-      obj["reading_id"] = (int)sqlite3_column_int(stmt, 0);
-      obj["customer_id"] = (int)sqlite3_column_int(stmt, 1);
-      obj["device_uid"] = String((const char*)sqlite3_column_text(stmt, 2));
-      obj["previous_reading"] = (unsigned long)sqlite3_column_int64(stmt, 3);
-      obj["current_reading"] = (unsigned long)sqlite3_column_int64(stmt, 4);
-      obj["usage_m3"] = (unsigned long)sqlite3_column_int64(stmt, 5);
-      obj["reading_at"] = (unsigned long)sqlite3_column_int64(stmt, 6);
-    }
+// reading_at holds epoch seconds; from/to take dates (YYYY-MM-DD, UTC)
+static const ExportFilter READING_EXPORT_FILTERS[] = {
+  {"from", "CAST(reading_at AS INTEGER) >= CAST(strftime('%s', ?) AS INTEGER)", EXPORT_TEXT},
+  {"to", "CAST(reading_at AS INTEGER) < CAST(strftime('%s', ?, '+1 day') AS INTEGER)", EXPORT_TEXT},
+  {"brgy", "customer_id IN (SELECT customer_id FROM customers WHERE brgy_id = ?)", EXPORT_INT},
+  {"device", "device_uid = ?", EXPORT_TEXT},
+};
 
-    Serial.print(F("READINGS_CHUNK|"));
-    Serial.print(chunk);
-    Serial.print(F("|"));
-    serializeJson(arr, Serial);
-    Serial.println();
-    doc.clear();
+static const ExportSpec READING_EXPORT_SPEC = {
+  "READINGS",
+  "SELECT COUNT(*) FROM readings;",
+  "SELECT reading_id, customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, anomaly FROM readings ORDER BY reading_id LIMIT ? OFFSET ?;",
+  READING_EXPORT_COLUMNS,
+  sizeof(READING_EXPORT_COLUMNS) / sizeof(READING_EXPORT_COLUMNS[0]),
+  150,
+  "SELECT COUNT(*) FROM readings WHERE change_seq > ?;",
+  "SELECT reading_id, customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, anomaly, change_seq FROM readings WHERE change_seq > ? ORDER BY change_seq LIMIT ?;",
+  "SELECT COALESCE(MAX(change_seq), 0) FROM readings;",
+  "readings",
+  "reading_id, customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, anomaly",
+  "reading_id",
+  READING_EXPORT_FILTERS,
+  sizeof(READING_EXPORT_FILTERS) / sizeof(READING_EXPORT_FILTERS[0])
+};
 
-    // Reset statement for next chunk
-    sqlite3_reset(stmt);
-    sqlite3_clear_bindings(stmt);
-
-    Serial.printf("Heap free after chunk %d: %d\n", chunk, ESP.getFreeHeap());
-  }
-
-  sqlite3_finalize(stmt);
-  Serial.println(F("END_READINGS_JSON"));
-  return true;
+// Handle EXPORT_READINGS command
+// Args: since=<change_seq> and/or filters, see runTableExport
+bool handleExportReadings(String args) {
+  Serial.println(F("Exporting readings..."));
+  return runTableExport(READING_EXPORT_SPEC, args);
 }
 
 // Handle READINGS_SYNCED command
+// The server's change_seq watermark already records which readings it has,
+// so no row is touched here; only the last sync time is kept.
 bool handleReadingsSynced() {
-  bool ok = markAllReadingsSynced();
-  if (ok) {
-    setLastSyncEpoch(deviceEpochNow());
-    Serial.println(F("ACK|READINGS_SYNCED"));
-  } else {
-    Serial.println(F("ERR|READINGS_SYNC_FAILED"));
-  }
+  setLastSyncEpoch(deviceEpochNow());
+  Serial.println(F("ACK|READINGS_SYNCED"));
   return true;
 }
 
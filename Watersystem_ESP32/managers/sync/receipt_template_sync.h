@@ -0,0 +1,66 @@
+#ifndef RECEIPT_TEMPLATE_SYNC_H
+#define RECEIPT_TEMPLATE_SYNC_H
+
+#include "../../configuration/config.h"
+#include "../receipt_template.h"
+#include <ArduinoJson.h>
+#include <SD.h>
+
+// ===== RECEIPT TEMPLATE =====
+//   RECEIPT_TEMPLATE|{"source":"<template text>"}
+//     ACK|RECEIPT_TEMPLATE|<compiled bytes>|<source hash>
+//   ERR|RECEIPT_TEMPLATE|<reason>|<line>
+// The source is compiled before anything is replaced, so a bad template
+// leaves the current one in place. A good one is written to
+// RECEIPT_TEMPLATE_FILE (skipped when the hash matches what is loaded)
+// and used from the next receipt on. An empty source goes back to the
+// built-in layout and removes the file.
+
+// Handle RECEIPT_TEMPLATE command
+bool handleReceiptTemplate(String payload) {
+  DynamicJsonDocument doc(payload.length() + 256);
+  if (deserializeJson(doc, payload)) {
+    Serial.println(F("ERR|RECEIPT_TEMPLATE|JSON_PARSE_FAILED|0"));
+    return true;
+  }
+  const char* source = doc["source"] | "";
+  size_t len = strlen(source);
+
+  if (len == 0) {
+    if (SD.exists(RECEIPT_TEMPLATE_FILE)) SD.remove(RECEIPT_TEMPLATE_FILE);
+    useBuiltInReceiptTemplate();
+    Serial.printf("ACK|RECEIPT_TEMPLATE|%u|0\n", (unsigned)receiptTemplate.code.len);
+    return true;
+  }
+
+  ReceiptTemplate* staged = new ReceiptTemplate();
+  ReceiptTemplateCompiler c;
+  if (!compileReceiptTemplate(source, len, *staged, c)) {
+    Serial.printf("ERR|RECEIPT_TEMPLATE|%s|%d\n", c.error, c.line);
+    delete staged;
+    return true;
+  }
+
+  if (receiptTemplate.builtIn || staged->sourceHash != receiptTemplate.sourceHash) {
+    File file = SD.open(RECEIPT_TEMPLATE_FILE, FILE_WRITE);
+    if (!file) {
+      Serial.println(F("ERR|RECEIPT_TEMPLATE|SD_WRITE_FAILED|0"));
+      delete staged;
+      return true;
+    }
+    size_t written = file.write((const uint8_t*)source, len);
+    file.close();
+    if (written != len) {
+      Serial.println(F("ERR|RECEIPT_TEMPLATE|SD_WRITE_FAILED|0"));
+      delete staged;
+      return true;
+    }
+  }
+
+  receiptTemplate = *staged;
+  delete staged;
+  Serial.printf("ACK|RECEIPT_TEMPLATE|%u|%08lx\n", (unsigned)receiptTemplate.code.len, (unsigned long)receiptTemplate.sourceHash);
+  return true;
+}
+
+#endif // RECEIPT_TEMPLATE_SYNC_H
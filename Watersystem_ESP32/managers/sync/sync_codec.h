@@ -0,0 +1,223 @@
+#ifndef SYNC_CODEC_H
+#define SYNC_CODEC_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// ===== SYNC WIRE CODECS =====
+// Compact binary encoding for the export path. Payloads are MessagePack,
+// carried over the line-based serial protocol as base64 text.
+
+// ===== FNV-1a 64 =====
+// Content hash shared by the roster digest and the chunk ledger.
+static const uint64_t FNV64_OFFSET = 0xcbf29ce484222325ULL;
+static const uint64_t FNV64_PRIME = 0x100000001b3ULL;
+
+static inline uint64_t fnv64Update(uint64_t h, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    h ^= data[i];
+    h *= FNV64_PRIME;
+  }
+  return h;
+}
+
+// Writes the hash as 16 lowercase hex digits plus terminator
+static inline void fnv64Hex(uint64_t h, char out[17]) {
+  snprintf(out, 17, "%08lx%08lx", (unsigned long)(h >> 32), (unsigned long)(h & 0xFFFFFFFFUL));
+}
+
+// Forwards to another Print and hashes every byte that passes through
+class Fnv64Print : public Print {
+ public:
+  explicit Fnv64Print(Print& out) : out_(out) {}
+
+  size_t write(uint8_t b) override {
+    hash = fnv64Update(hash, &b, 1);
+    return out_.write(b);
+  }
+
+  size_t write(const uint8_t* buf, size_t len) override {
+    hash = fnv64Update(hash, buf, len);
+    return out_.write(buf, len);
+  }
+
+  uint64_t hash = FNV64_OFFSET;
+
+ private:
+  Print& out_;
+};
+
+// ===== BASE64 =====
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Streams base64 straight to the output so no second copy of the payload is held in RAM.
+// Returns the number of characters written.
+size_t base64Write(Print& out, const uint8_t* data, size_t len) {
+  char quad[4];
+  size_t written = 0;
+  size_t i = 0;
+  while (i + 2 < len) {
+    uint32_t v = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+    quad[0] = BASE64_ALPHABET[(v >> 18) & 0x3F];
+    quad[1] = BASE64_ALPHABET[(v >> 12) & 0x3F];
+    quad[2] = BASE64_ALPHABET[(v >> 6) & 0x3F];
+    quad[3] = BASE64_ALPHABET[v & 0x3F];
+    written += out.write((const uint8_t*)quad, 4);
+    i += 3;
+  }
+  size_t rest = len - i;
+  if (rest > 0) {
+    uint32_t v = (uint32_t)data[i] << 16;
+    if (rest == 2) v |= (uint32_t)data[i + 1] << 8;
+    quad[0] = BASE64_ALPHABET[(v >> 18) & 0x3F];
+    quad[1] = BASE64_ALPHABET[(v >> 12) & 0x3F];
+    quad[2] = (rest == 2) ? BASE64_ALPHABET[(v >> 6) & 0x3F] : '=';
+    quad[3] = '=';
+    written += out.write((const uint8_t*)quad, 4);
+  }
+  return written;
+}
+
+static int8_t base64Value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+// Decodes base64 text into `out`. Stops at padding; returns false on any other bad character.
+bool base64Decode(const char* text, size_t len, std::vector<uint8_t>& out) {
+  out.clear();
+  out.reserve(len / 4 * 3);
+  uint32_t acc = 0;
+  int bits = 0;
+  for (size_t i = 0; i < len; ++i) {
+    char c = text[i];
+    if (c == '=') break;
+    int8_t v = base64Value(c);
+    if (v < 0) return false;
+    acc = (acc << 6) | (uint32_t)v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back((uint8_t)(acc >> bits));
+    }
+  }
+  return true;
+}
+
+// ===== MESSAGEPACK WRITER =====
+// Only the subset the exporters need: nil, ints, float32, str, array, map.
+class MsgPackWriter {
+public:
+  std::vector<uint8_t> buf;
+
+  void clear() { buf.clear(); }
+  size_t size() const { return buf.size(); }
+  const uint8_t* data() const { return buf.data(); }
+
+  void writeNil() { buf.push_back(0xC0); }
+
+  void writeInt(int64_t v) {
+    if (v >= 0) {
+      writeUInt((uint64_t)v);
+    } else if (v >= -32) {
+      buf.push_back((uint8_t)(int8_t)v);
+    } else if (v >= INT8_MIN) {
+      buf.push_back(0xD0);
+      buf.push_back((uint8_t)(int8_t)v);
+    } else if (v >= INT16_MIN) {
+      buf.push_back(0xD1);
+      putBE((uint16_t)(int16_t)v, 2);
+    } else if (v >= INT32_MIN) {
+      buf.push_back(0xD2);
+      putBE((uint32_t)(int32_t)v, 4);
+    } else {
+      buf.push_back(0xD3);
+      putBE((uint64_t)v, 8);
+    }
+  }
+
+  void writeUInt(uint64_t v) {
+    if (v < 128) {
+      buf.push_back((uint8_t)v);
+    } else if (v <= 0xFF) {
+      buf.push_back(0xCC);
+      buf.push_back((uint8_t)v);
+    } else if (v <= 0xFFFF) {
+      buf.push_back(0xCD);
+      putBE(v, 2);
+    } else if (v <= 0xFFFFFFFFULL) {
+      buf.push_back(0xCE);
+      putBE(v, 4);
+    } else {
+      buf.push_back(0xCF);
+      putBE(v, 8);
+    }
+  }
+
+  void writeFloat(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    buf.push_back(0xCA);
+    putBE(bits, 4);
+  }
+
+  void writeStr(const char* s, size_t len) {
+    if (len < 32) {
+      buf.push_back((uint8_t)(0xA0 | len));
+    } else if (len <= 0xFF) {
+      buf.push_back(0xD9);
+      buf.push_back((uint8_t)len);
+    } else if (len <= 0xFFFF) {
+      buf.push_back(0xDA);
+      putBE(len, 2);
+    } else {
+      buf.push_back(0xDB);
+      putBE(len, 4);
+    }
+    buf.insert(buf.end(), (const uint8_t*)s, (const uint8_t*)s + len);
+  }
+
+  void writeStr(const char* s) { writeStr(s, s ? strlen(s) : 0); }
+
+  // Bytes that are already MessagePack, e.g. a value encoded elsewhere
+  void writeRaw(const uint8_t* p, size_t len) { buf.insert(buf.end(), p, p + len); }
+
+  void writeArrayHeader(size_t n) {
+    if (n < 16) {
+      buf.push_back((uint8_t)(0x90 | n));
+    } else if (n <= 0xFFFF) {
+      buf.push_back(0xDC);
+      putBE(n, 2);
+    } else {
+      buf.push_back(0xDD);
+      putBE(n, 4);
+    }
+  }
+
+  void writeMapHeader(size_t n) {
+    if (n < 16) {
+      buf.push_back((uint8_t)(0x80 | n));
+    } else if (n <= 0xFFFF) {
+      buf.push_back(0xDE);
+      putBE(n, 2);
+    } else {
+      buf.push_back(0xDF);
+      putBE(n, 4);
+    }
+  }
+
+private:
+  void putBE(uint64_t v, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+      buf.push_back((uint8_t)(v >> (i * 8)));
+    }
+  }
+};
+
+#endif // SYNC_CODEC_H
@@ -0,0 +1,228 @@
+#ifndef SYNC_COMPRESS_H
+#define SYNC_COMPRESS_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "sync_codec.h"
+#include "sync_stats.h"
+
+// ===== SYNC COMPRESSION =====
+// Optional LZ4-block compression for sync payloads, switched on with
+// SET_COMPRESSION|LZ. A compressed payload travels as Z:<raw_len>:<base64>
+// in place of the plain JSON / base64 MessagePack field, in both directions.
+// Uncompressed payloads are still accepted, so either side can fall back.
+//
+// Cost on the device: every payload run through the codec is added to the
+// LZ:DEFLATE and LZ:INFLATE phases of SYNC_REPORT, with the uncompressed
+// bytes and the codec time as parse_us, so parse_us * 1024 / bytes is the
+// CPU cost per KB. The report's elapsed_ms compared between a session with
+// SET_COMPRESSION|LZ and one with OFF gives the end-to-end effect.
+
+#define LZ_HASH_BITS 11                  // 2048 x uint16 = 4KB match table
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5               // LZ4 block rules, keeps stock decoders happy
+#define LZ_MATCH_SAFE_DISTANCE 12
+#define LZ_MAX_INPUT 0xFFFF              // offsets and table entries are 16-bit
+
+bool g_syncCompression = false;
+
+static uint16_t lzHashTable[1 << LZ_HASH_BITS];
+
+struct SyncPayloadStats {
+  uint32_t rawBytes = 0;      // payload size before compression
+  uint32_t compressUs = 0;    // time spent in lzCompress
+};
+
+static inline uint32_t lzRead32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t lzHash(uint32_t seq) {
+  return (seq * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+static void lzWriteLength(std::vector<uint8_t>& out, size_t len) {
+  while (len >= 255) {
+    out.push_back(255);
+    len -= 255;
+  }
+  out.push_back((uint8_t)len);
+}
+
+static void lzWriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLen, size_t offset, size_t matchLen) {
+  size_t matchCode = matchLen - LZ_MIN_MATCH;
+  uint8_t token = (uint8_t)((literalLen >= 15 ? 15 : literalLen) << 4);
+  token |= (uint8_t)(matchCode >= 15 ? 15 : matchCode);
+  out.push_back(token);
+  if (literalLen >= 15) lzWriteLength(out, literalLen - 15);
+  out.insert(out.end(), literals, literals + literalLen);
+  out.push_back((uint8_t)(offset & 0xFF));
+  out.push_back((uint8_t)(offset >> 8));
+  if (matchCode >= 15) lzWriteLength(out, matchCode - 15);
+}
+
+// Greedy single-pass LZ4 block compressor. Returns false if the input is too
+// large for 16-bit offsets; the caller then sends the payload uncompressed.
+bool lzCompress(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+  out.clear();
+  if (n > LZ_MAX_INPUT) return false;
+  out.reserve(n / 2 + 16);
+  memset(lzHashTable, 0, sizeof(lzHashTable));
+
+  size_t anchor = 0;
+  size_t ip = 0;
+  const size_t matchStartLimit = n > LZ_MATCH_SAFE_DISTANCE ? n - LZ_MATCH_SAFE_DISTANCE : 0;
+  const size_t matchEndLimit = n > LZ_LAST_LITERALS ? n - LZ_LAST_LITERALS : 0;
+
+  while (ip < matchStartLimit) {
+    uint32_t seq = lzRead32(in + ip);
+    uint32_t h = lzHash(seq);
+    size_t ref = lzHashTable[h];
+    lzHashTable[h] = (uint16_t)ip;
+
+    if (ref < ip && lzRead32(in + ref) == seq) {
+      size_t len = LZ_MIN_MATCH;
+      while (ip + len < matchEndLimit && in[ref + len] == in[ip + len]) len++;
+      lzWriteSequence(out, in + anchor, ip - anchor, ip - ref, len);
+      ip += len;
+      anchor = ip;
+      if (ip < matchStartLimit) {
+        lzHashTable[lzHash(lzRead32(in + ip - 2))] = (uint16_t)(ip - 2);
+      }
+    } else {
+      ip++;
+    }
+  }
+
+  size_t literalLen = n - anchor;
+  out.push_back((uint8_t)((literalLen >= 15 ? 15 : literalLen) << 4));
+  if (literalLen >= 15) lzWriteLength(out, literalLen - 15);
+  out.insert(out.end(), in + anchor, in + n);
+  return true;
+}
+
+// Decodes an LZ4 block into `out`, which must hold exactly outLen bytes.
+bool lzDecompress(const uint8_t* in, size_t n, uint8_t* out, size_t outLen) {
+  size_t ip = 0;
+  size_t op = 0;
+  while (ip < n) {
+    uint8_t token = in[ip++];
+
+    size_t literalLen = token >> 4;
+    if (literalLen == 15) {
+      uint8_t b;
+      do {
+        if (ip >= n) return false;
+        b = in[ip++];
+        literalLen += b;
+      } while (b == 255);
+    }
+    if (ip + literalLen > n || op + literalLen > outLen) return false;
+    memcpy(out + op, in + ip, literalLen);
+    ip += literalLen;
+    op += literalLen;
+    if (ip >= n) break;  // last sequence carries literals only
+
+    if (ip + 2 > n) return false;
+    size_t offset = in[ip] | ((size_t)in[ip + 1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) return false;
+
+    size_t matchLen = token & 0x0F;
+    if (matchLen == 15) {
+      uint8_t b;
+      do {
+        if (ip >= n) return false;
+        b = in[ip++];
+        matchLen += b;
+      } while (b == 255);
+    }
+    matchLen += LZ_MIN_MATCH;
+    if (op + matchLen > outLen) return false;
+    for (size_t i = 0; i < matchLen; ++i, ++op) {
+      out[op] = out[op - offset];  // byte-wise: matches may overlap
+    }
+  }
+  return op == outLen;
+}
+
+// ===== PAYLOAD ENVELOPE =====
+
+// Writes one sync payload field. With compression on and a smaller result it
+// is Z:<raw_len>:<base64>; otherwise binary payloads go out as base64 and
+// text payloads verbatim. Returns the number of characters written.
+size_t writeSyncPayload(Print& out, const uint8_t* data, size_t len, bool binary, SyncPayloadStats& stats) {
+  stats.rawBytes += len;
+  if (g_syncCompression) {
+    std::vector<uint8_t> packed;
+    uint32_t t0 = micros();
+    bool ok = lzCompress(data, len, packed);
+    SyncStat stat;
+    stat.bytes = len;
+    stat.parseUs = micros() - t0;
+    stats.compressUs += stat.parseUs;
+    syncStatAdd("LZ", "DEFLATE", stat);
+    if (ok && packed.size() * 4 / 3 + 12 < (binary ? len * 4 / 3 : len)) {
+      size_t written = out.print(F("Z:"));
+      written += out.print((unsigned long)len);
+      written += out.print(':');
+      return written + base64Write(out, packed.data(), packed.size());
+    }
+  }
+  if (binary) return base64Write(out, data, len);
+  return out.write(data, len);
+}
+
+// Expands a Z:<raw_len>:<base64> field in place. Plain fields are left alone.
+// On failure `reason` is set for the caller's ERR reply; a raw length the
+// compressor could not have produced is refused before anything is allocated.
+bool decodeSyncPayload(String& field, const __FlashStringHelper*& reason) {
+  if (!field.startsWith("Z:")) return true;
+  reason = F("BAD_COMPRESSED_CHUNK");
+  int sep = field.indexOf(':', 2);
+  if (sep < 0) return false;
+  long rawLen = sep - 2 <= 5 ? field.substring(2, sep).toInt() : 0;  // 5 digits, so toInt() cannot overflow
+  if (rawLen <= 0 || rawLen > LZ_MAX_INPUT) {
+    reason = F("BAD_COMPRESSED_LENGTH");
+    return false;
+  }
+
+  std::vector<uint8_t> packed;
+  if (!base64Decode(field.c_str() + sep + 1, field.length() - sep - 1, packed)) return false;
+
+  std::vector<uint8_t> raw(rawLen + 1);
+  uint32_t t0 = micros();
+  if (!lzDecompress(packed.data(), packed.size(), raw.data(), rawLen)) return false;
+  SyncStat stat;
+  stat.bytes = rawLen;
+  stat.parseUs = micros() - t0;
+  syncStatAdd("LZ", "INFLATE", stat);
+  raw[rawLen] = 0;
+
+  std::vector<uint8_t>().swap(packed);
+  field = String((const char*)raw.data());
+  return true;
+}
+
+// Handle SET_COMPRESSION command
+bool handleSetCompression(String payload) {
+  payload.trim();
+  if (payload == "LZ") {
+    g_syncCompression = true;
+  } else if (payload == "OFF") {
+    g_syncCompression = false;
+  } else {
+    Serial.print(F("ERR|UNKNOWN_COMPRESSION|"));
+    Serial.println(payload);
+    return true;
+  }
+  Serial.print(F("ACK|COMPRESSION|"));
+  Serial.println(g_syncCompression ? F("LZ") : F("OFF"));
+  return true;
+}
+
+#endif // SYNC_COMPRESS_H
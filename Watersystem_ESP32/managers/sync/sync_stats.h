@@ -0,0 +1,106 @@
+#ifndef SYNC_STATS_H
+#define SYNC_STATS_H
+
+#include <Arduino.h>
+#include "../../configuration/config.h"
+
+// ===== SYNC TELEMETRY =====
+// Every sync handler reports one structured record per unit of work
+// (chunk, table export, digest, reference row):
+//
+//   STAT|<phase>|<index>|<rows>|<bytes>|<parse_us>|<sql_us>|<commit_us>|<tx_us>|<heap_free>|<max_block>
+//
+// A phase is <kind>:<name>, e.g. UPSERT:CUSTOMERS, EXPORT:BILLS, DIGEST:RANGES.
+//
+// parse_us covers decoding and JSON parsing, sql_us binding and stepping,
+// commit_us the COMMIT, tx_us writing the reply to serial. The records are
+// also summed per phase since the last SYNC_SESSION:
+//
+//   SYNC_REPORT
+//     BEGIN_SYNC_REPORT|<session>|<elapsed_ms since the session started>
+//     REPORT|<phase>|<calls>|<rows>|<bytes>|<parse_us>|<sql_us>|<commit_us>|<tx_us>|<heap_min>|<block_min>
+//     END_SYNC_REPORT
+
+#define SYNC_STATS_MAX_PHASES 16
+
+struct SyncStat {
+  uint32_t rows = 0;
+  uint32_t bytes = 0;
+  uint32_t parseUs = 0;
+  uint32_t sqlUs = 0;
+  uint32_t commitUs = 0;
+  uint32_t txUs = 0;
+};
+
+struct SyncPhaseTotals {
+  const char* kind = nullptr;   // string literals of the reporting handler
+  const char* name = nullptr;
+  uint32_t calls = 0;
+  SyncStat sum;
+  uint32_t heapMin = UINT32_MAX;
+  uint32_t blockMin = UINT32_MAX;
+};
+
+static SyncPhaseTotals syncPhaseTotals[SYNC_STATS_MAX_PHASES];
+static uint32_t syncStatsStartMs = 0;
+
+void syncStatsReset() {
+  for (auto& totals : syncPhaseTotals) totals = SyncPhaseTotals();
+  syncStatsStartMs = millis();
+}
+
+static SyncPhaseTotals* syncPhaseTotalsFor(const char* kind, const char* name) {
+  for (auto& totals : syncPhaseTotals) {
+    if (totals.kind && strcmp(totals.kind, kind) == 0 && strcmp(totals.name, name) == 0) return &totals;
+    if (!totals.kind) {
+      totals.kind = kind;
+      totals.name = name;
+      return &totals;
+    }
+  }
+  return nullptr;  // table full, the STAT line is still printed
+}
+
+// Adds a record to the phase totals only, for work that happens in the
+// middle of a reply line (e.g. compressing a payload field)
+void syncStatAdd(const char* kind, const char* name, const SyncStat& stat) {
+  uint32_t heap = ESP.getFreeHeap();
+  uint32_t block = ESP.getMaxAllocHeap();
+  SyncPhaseTotals* totals = syncPhaseTotalsFor(kind, name);
+  if (!totals) return;
+  totals->calls++;
+  totals->sum.rows += stat.rows;
+  totals->sum.bytes += stat.bytes;
+  totals->sum.parseUs += stat.parseUs;
+  totals->sum.sqlUs += stat.sqlUs;
+  totals->sum.commitUs += stat.commitUs;
+  totals->sum.txUs += stat.txUs;
+  if (heap < totals->heapMin) totals->heapMin = heap;
+  if (block < totals->blockMin) totals->blockMin = block;
+}
+
+// Prints the STAT record and adds it to the phase totals
+void syncStatRecord(const char* kind, const char* name, int index, const SyncStat& stat) {
+  Serial.printf("STAT|%s:%s|%d|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%lu\n", kind, name, index,
+                (unsigned long)stat.rows, (unsigned long)stat.bytes,
+                (unsigned long)stat.parseUs, (unsigned long)stat.sqlUs,
+                (unsigned long)stat.commitUs, (unsigned long)stat.txUs,
+                (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMaxAllocHeap());
+  syncStatAdd(kind, name, stat);
+}
+
+void printSyncReport(const String& sessionId) {
+  Serial.printf("BEGIN_SYNC_REPORT|%s|%lu\n", sessionId.c_str(), (unsigned long)(millis() - syncStatsStartMs));
+  for (const auto& totals : syncPhaseTotals) {
+    if (!totals.kind) break;
+    Serial.printf("REPORT|%s:%s|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%lu|%lu\n", totals.kind, totals.name,
+                  (unsigned long)totals.calls, (unsigned long)totals.sum.rows,
+                  (unsigned long)totals.sum.bytes, (unsigned long)totals.sum.parseUs,
+                  (unsigned long)totals.sum.sqlUs, (unsigned long)totals.sum.commitUs,
+                  (unsigned long)totals.sum.txUs, (unsigned long)totals.heapMin,
+                  (unsigned long)totals.blockMin);
+  }
+  Serial.println(F("END_SYNC_REPORT"));
+}
+
+#endif // SYNC_STATS_H
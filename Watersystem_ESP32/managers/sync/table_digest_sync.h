@@ -0,0 +1,54 @@
+#ifndef TABLE_DIGEST_SYNC_H
+#define TABLE_DIGEST_SYNC_H
+
+#include "../../configuration/config.h"
+#include "../../database/table_digests.h"
+#include "sync_codec.h"
+#include "sync_stats.h"
+#include <sqlite3.h>
+
+// ===== TABLE DIGESTS =====
+//   TABLE_DIGESTS
+//     BEGIN_TABLE_DIGESTS|<tables>
+//     TABLE_DIGEST|<table>|<rows>|<max updated_at>|<hash, 16 hex digits>
+//     END_TABLE_DIGESTS
+// Read from the trigger-maintained table_digests rows (see
+// database/table_digests.h), so the cost does not grow with the tables.
+
+// Handle TABLE_DIGESTS command
+bool handleTableDigests() {
+  uint32_t t0 = micros();
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, "SELECT table_name, row_count, max_updated_at, hash FROM table_digests ORDER BY table_name;", -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.println(F("ERR|TABLE_DIGESTS_FAILED"));
+    return true;
+  }
+
+  Serial.print(F("BEGIN_TABLE_DIGESTS|"));
+  Serial.println(sizeof(TABLE_DIGEST_SPECS) / sizeof(TABLE_DIGEST_SPECS[0]));
+  int tables = 0;
+  char hex[17];
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char* maxUpdated = (const char*)sqlite3_column_text(stmt, 2);
+    fnv64Hex((uint64_t)sqlite3_column_int64(stmt, 3), hex);
+    Serial.print(F("TABLE_DIGEST|"));
+    Serial.print((const char*)sqlite3_column_text(stmt, 0));
+    Serial.print(F("|"));
+    Serial.print((long)sqlite3_column_int64(stmt, 1));
+    Serial.print(F("|"));
+    Serial.print(maxUpdated ? maxUpdated : "");
+    Serial.print(F("|"));
+    Serial.println(hex);
+    tables++;
+  }
+  sqlite3_finalize(stmt);
+
+  SyncStat stat;
+  stat.rows = tables;
+  stat.sqlUs = micros() - t0;
+  syncStatRecord("DIGEST", "TABLES", 0, stat);
+  Serial.println(F("END_TABLE_DIGESTS"));
+  return true;
+}
+
+#endif // TABLE_DIGEST_SYNC_H
@@ -0,0 +1,358 @@
+#ifndef UPSERT_ENGINE_H
+#define UPSERT_ENGINE_H
+
+#include "../../configuration/config.h"
+#include "sync_compress.h"
+#include "chunk_window.h"
+#include "export_engine.h"
+#include <ArduinoJson.h>
+#include <sqlite3.h>
+
+// ===== CHUNK UPSERT ENGINE =====
+// Shared by every <TABLE>_JSON_CHUNK import. A table describes its columns
+// once; the engine builds the statement from the descriptor, binds each
+// JSON row by column type, and applies the chunk in one transaction with
+// the chunk window and session ledger bookkeeping.
+//
+// Statements are kept prepared for the whole sync session (or until the
+// stream completes outside a session) and released by
+// upsertReleaseStatements() before the schema or the database goes away.
+
+enum UpsertColType : uint8_t {
+  UPSERT_INT,
+  UPSERT_REAL,
+  UPSERT_TEXT
+};
+
+#define UPSERT_FLAG_NULLABLE 0x01  // missing/null (and 0 for INT) is stored as NULL
+#define UPSERT_FLAG_KEY      0x02  // conflict target (UPSERT_INSERT) or WHERE key (UPSERT_UPDATE)
+
+enum UpsertMode : uint8_t {
+  UPSERT_INSERT,    // INSERT ... ON CONFLICT(key) DO UPDATE
+  UPSERT_UPDATE,    // UPDATE ... WHERE key = ?, unknown keys are skipped
+  UPSERT_REPLACE    // INSERT OR REPLACE, rows carry their own primary key
+};
+
+struct UpsertColumn {
+  const char* name;         // column name and JSON key
+  UpsertColType type;
+  uint8_t flags;
+  const char* textDefault;  // UPSERT_TEXT when the key is missing
+  double numDefault;        // UPSERT_INT / UPSERT_REAL when the key is missing
+};
+
+struct UpsertSpec {
+  const char* stream;       // chunk window / ledger stream name
+  const char* table;
+  const UpsertColumn* columns;
+  size_t columnCount;
+  UpsertMode mode;
+  bool stampTimestamps;     // created_at/updated_at = datetime('now')
+  size_t docCapacity;       // JSON nodes per chunk (strings are parsed in place)
+  const char* finalAck;     // ACK|<finalAck>|<rows> once the stream completes, or nullptr
+  void (*onComplete)();     // called once the stream completes, or nullptr
+  const char* resetSql;     // when the stream carries the whole table: run inside
+                            // the transaction of the transfer's first chunk to be
+                            // committed, whatever its index, or nullptr
+};
+
+// ===== COLUMN BINDING =====
+template <UpsertColType T>
+struct UpsertBinder;
+
+template <>
+struct UpsertBinder<UPSERT_INT> {
+  static int bind(sqlite3_stmt* stmt, int idx, JsonVariantConst v, const UpsertColumn& col) {
+    bool nullable = col.flags & UPSERT_FLAG_NULLABLE;
+    if (v.isNull()) {
+      return nullable ? sqlite3_bind_null(stmt, idx) : sqlite3_bind_int64(stmt, idx, (int64_t)col.numDefault);
+    }
+    int64_t value = v.as<int64_t>();
+    if (nullable && value == 0) return sqlite3_bind_null(stmt, idx);
+    return sqlite3_bind_int64(stmt, idx, value);
+  }
+};
+
+template <>
+struct UpsertBinder<UPSERT_REAL> {
+  static int bind(sqlite3_stmt* stmt, int idx, JsonVariantConst v, const UpsertColumn& col) {
+    if (v.isNull()) {
+      return (col.flags & UPSERT_FLAG_NULLABLE) ? sqlite3_bind_null(stmt, idx)
+                                                : sqlite3_bind_double(stmt, idx, col.numDefault);
+    }
+    return sqlite3_bind_double(stmt, idx, v.as<double>());
+  }
+};
+
+template <>
+struct UpsertBinder<UPSERT_TEXT> {
+  // The JSON document outlives the step, so text is bound without a copy
+  static int bind(sqlite3_stmt* stmt, int idx, JsonVariantConst v, const UpsertColumn& col) {
+    const char* text = v.as<const char*>();
+    if (!text) {
+      if (col.flags & UPSERT_FLAG_NULLABLE) return sqlite3_bind_null(stmt, idx);
+      text = col.textDefault ? col.textDefault : "";
+    }
+    return sqlite3_bind_text(stmt, idx, text, -1, SQLITE_STATIC);
+  }
+};
+
+static int upsertBindColumn(sqlite3_stmt* stmt, int idx, JsonVariantConst v, const UpsertColumn& col) {
+  switch (col.type) {
+    case UPSERT_INT:  return UpsertBinder<UPSERT_INT>::bind(stmt, idx, v, col);
+    case UPSERT_REAL: return UpsertBinder<UPSERT_REAL>::bind(stmt, idx, v, col);
+    default:          return UpsertBinder<UPSERT_TEXT>::bind(stmt, idx, v, col);
+  }
+}
+
+// ===== STATEMENT BUILDING =====
+// Parameter ?N is always column N of the descriptor, whatever the mode.
+static String buildUpsertSql(const UpsertSpec& spec) {
+  String sql;
+  const char* key = nullptr;
+  for (size_t i = 0; i < spec.columnCount; i++) {
+    if (spec.columns[i].flags & UPSERT_FLAG_KEY) key = spec.columns[i].name;
+  }
+
+  if (spec.mode == UPSERT_UPDATE) {
+    sql = "UPDATE ";
+    sql += spec.table;
+    sql += " SET ";
+    bool first = true;
+    int keyParam = 0;
+    for (size_t i = 0; i < spec.columnCount; i++) {
+      if (spec.columns[i].flags & UPSERT_FLAG_KEY) {
+        keyParam = i + 1;
+        continue;
+      }
+      if (!first) sql += ", ";
+      sql += spec.columns[i].name;
+      sql += " = ?";
+      sql += (int)(i + 1);
+      first = false;
+    }
+    if (spec.stampTimestamps) sql += ", updated_at = datetime('now')";
+    sql += " WHERE ";
+    sql += key;
+    sql += " = ?";
+    sql += keyParam;
+    sql += ";";
+    return sql;
+  }
+
+  sql = spec.mode == UPSERT_REPLACE ? "INSERT OR REPLACE INTO " : "INSERT INTO ";
+  sql += spec.table;
+  sql += " (";
+  for (size_t i = 0; i < spec.columnCount; i++) {
+    if (i > 0) sql += ", ";
+    sql += spec.columns[i].name;
+  }
+  if (spec.stampTimestamps) sql += ", created_at, updated_at";
+  sql += ") VALUES (";
+  for (size_t i = 0; i < spec.columnCount; i++) {
+    if (i > 0) sql += ", ";
+    sql += "?";
+    sql += (int)(i + 1);
+  }
+  if (spec.stampTimestamps) sql += ", datetime('now'), datetime('now')";
+  sql += ")";
+
+  // A retried chunk whose ACK was lost updates the rows it already
+  // inserted instead of failing on the key and rolling the chunk back.
+  if (spec.mode == UPSERT_INSERT && key) {
+    sql += " ON CONFLICT(";
+    sql += key;
+    sql += ") DO UPDATE SET ";
+    bool first = true;
+    for (size_t i = 0; i < spec.columnCount; i++) {
+      if (spec.columns[i].flags & UPSERT_FLAG_KEY) continue;
+      if (!first) sql += ", ";
+      sql += spec.columns[i].name;
+      sql += " = excluded.";
+      sql += spec.columns[i].name;
+      first = false;
+    }
+    if (spec.stampTimestamps) sql += ", updated_at = excluded.updated_at";
+  }
+  sql += ";";
+  return sql;
+}
+
+// ===== STATEMENT CACHE =====
+#define UPSERT_MAX_STATEMENTS 8
+
+struct UpsertStatement {
+  const UpsertSpec* spec = nullptr;
+  sqlite3_stmt* stmt = nullptr;
+};
+
+static UpsertStatement upsertStatements[UPSERT_MAX_STATEMENTS];
+
+static void upsertReleaseStatement(UpsertStatement& entry) {
+  if (entry.stmt) sqlite3_finalize(entry.stmt);
+  entry.stmt = nullptr;
+  entry.spec = nullptr;
+}
+
+// Finalizes every cached statement; call before dropping tables or
+// closing the database, and when a sync session ends.
+void upsertReleaseStatements() {
+  for (auto& entry : upsertStatements) upsertReleaseStatement(entry);
+}
+
+static sqlite3_stmt* upsertStatementFor(const UpsertSpec& spec) {
+  UpsertStatement* slot = nullptr;
+  for (auto& entry : upsertStatements) {
+    if (entry.spec == &spec) return entry.stmt;
+    if (!slot && !entry.spec) slot = &entry;
+  }
+  if (!slot) {
+    slot = &upsertStatements[0];
+    upsertReleaseStatement(*slot);
+  }
+
+  String sql = buildUpsertSql(spec);
+  sqlite3_stmt* stmt;
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    Serial.print(F("SQLite prepare error: "));
+    Serial.println(sqlite3_errmsg(db));
+    return nullptr;
+  }
+  slot->spec = &spec;
+  slot->stmt = stmt;
+  return stmt;
+}
+
+static void upsertRejectChunk(int chunkIndex, const __FlashStringHelper* reason, bool rollback) {
+  if (rollback) sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+  chunkWindowReject(chunkIndex, reason);
+}
+
+// ===== CHUNK APPLY =====
+// Payload: <index>|<total>|<json array, '|' escaped as '\|'>
+bool runChunkUpsert(const UpsertSpec& spec, String payload) {
+  int p1 = payload.indexOf('|');
+  int p2 = (p1 >= 0) ? payload.indexOf('|', p1 + 1) : -1;
+  if (p1 < 0 || p2 < 0) {
+    Serial.println(F("ERR|BAD_CHUNK_FORMAT"));
+    return true;
+  }
+
+  int chunkIndex = payload.substring(0, p1).toInt();
+  int totalChunks = payload.substring(p1 + 1, p2).toInt();
+  String jsonChunk = payload.substring(p2 + 1);
+  payload = String();  // free the raw line before parsing
+  jsonChunk.replace("\\|", "|");
+  if (!chunkWindowBegin(spec.stream, chunkIndex, totalChunks, jsonChunk)) {
+    return true;  // already committed, ACK repeated
+  }
+  SyncStat stat;
+  stat.bytes = jsonChunk.length();
+  uint32_t t0 = micros();
+  const __FlashStringHelper* decodeError = nullptr;
+  if (!decodeSyncPayload(jsonChunk, decodeError)) {
+    chunkWindowReject(chunkIndex, decodeError);
+    return true;
+  }
+
+  // Parse in place: strings stay in jsonChunk and are bound from there
+  DynamicJsonDocument doc(spec.docCapacity);
+  DeserializationError error = deserializeJson(doc, jsonChunk.begin(), jsonChunk.length());
+  if (error) {
+    Serial.print(F("Error: "));
+    Serial.println(error.c_str());
+    chunkWindowReject(chunkIndex, F("JSON_PARSE_FAILED"));
+    return true;
+  }
+  JsonArray rows = doc.as<JsonArray>();
+  stat.rows = rows.size();
+  stat.parseUs = micros() - t0;
+  t0 = micros();
+
+  // Set synchronous to NORMAL for speed during sync (durability is still good)
+  sqlite3_exec(db, "PRAGMA synchronous = NORMAL;", NULL, NULL, NULL);
+
+  if (sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL) != SQLITE_OK) {
+    Serial.print(F("BEGIN failed for chunk "));
+    Serial.print(chunkIndex);
+    Serial.print(F(": "));
+    Serial.println(sqlite3_errmsg(db));
+    upsertRejectChunk(chunkIndex, F("UPSERT_FAILED"), false);
+    return true;
+  }
+
+  // Only before anything of this transfer is in: a resent chunk 0, or one
+  // that arrives after later chunks, must not wipe committed rows
+  bool reset = spec.resetSql && chunkWindowUntouched(spec.stream, totalChunks);
+  if (reset && sqlite3_exec(db, spec.resetSql, NULL, NULL, NULL) != SQLITE_OK) {
+    Serial.print(F("SQLite reset error: "));
+    Serial.println(sqlite3_errmsg(db));
+    upsertRejectChunk(chunkIndex, F("UPSERT_FAILED"), true);
+    return true;
+  }
+
+  sqlite3_stmt* stmt = upsertStatementFor(spec);
+  if (!stmt) {
+    upsertRejectChunk(chunkIndex, F("UPSERT_FAILED"), true);
+    return true;
+  }
+
+  for (JsonObject row : rows) {
+    sqlite3_reset(stmt);
+    for (size_t i = 0; i < spec.columnCount; i++) {
+      upsertBindColumn(stmt, i + 1, row[spec.columns[i].name], spec.columns[i]);
+    }
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+      Serial.print(F("SQLite step error: "));
+      Serial.println(sqlite3_errmsg(db));
+      sqlite3_reset(stmt);
+      upsertRejectChunk(chunkIndex, F("UPSERT_FAILED"), true);
+      return true;
+    }
+  }
+  sqlite3_reset(stmt);
+  stat.sqlUs = micros() - t0;
+
+  t0 = micros();
+  chunkLedgerRecord(spec.stream, chunkIndex, totalChunks);
+  if (sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+    Serial.print(F("COMMIT failed for chunk "));
+    Serial.print(chunkIndex);
+    Serial.print(F(": "));
+    Serial.println(sqlite3_errmsg(db));
+    upsertRejectChunk(chunkIndex, F("UPSERT_FAILED"), true);
+    return true;
+  }
+  stat.commitUs = micros() - t0;
+  syncStatRecord("UPSERT", spec.stream, chunkIndex, stat);
+
+#if WS_SERIAL_VERBOSE
+  Serial.printf("%s chunk %d/%d: %d rows, heap free %d\n", spec.stream, chunkIndex + 1, totalChunks, (int)rows.size(), ESP.getFreeHeap());
+#endif
+
+  if (!chunkWindowCommit(spec.stream, chunkIndex, totalChunks)) {
+    return true;
+  }
+
+  // Whole stream committed
+#if WS_SERIAL_VERBOSE
+  String countSql = String("SELECT COUNT(*) FROM ") + spec.table + ";";
+  Serial.printf("Total rows in %s after sync: %d\n", spec.table, (int)exportScalar(countSql.c_str()));
+#endif
+  if (syncSessionId.length() == 0) {
+    for (auto& entry : upsertStatements) {
+      if (entry.spec == &spec) upsertReleaseStatement(entry);
+    }
+  }
+  if (spec.onComplete) spec.onComplete();
+  if (spec.finalAck) {
+    Serial.print(F("ACK|"));
+    Serial.print(spec.finalAck);
+    Serial.print(F("|"));
+    Serial.println(rows.size());
+  }
+  Serial.flush();
+  return true;
+}
+
+#endif // UPSERT_ENGINE_H
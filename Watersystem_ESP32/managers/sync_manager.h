@@ -22,6 +22,14 @@
 #include "sync/barangay_sync.h"
 #include "sync/customer_type_sync.h"
 #include "sync/customer_sync.h"
+#include "sync/export_pull.h"
+#include "sync/customer_digest.h"
+#include "sync/table_digest_sync.h"
+#include "sync/id_lease_sync.h"
+#include "sync/batch_bill_sync.h"
+#include "sync/penalty_sync.h"
+#include "sync/link_sync.h"
+#include "sync/receipt_template_sync.h"
 
 // Function to handle all sync protocol commands
 bool handleSyncCommands(String raw) {
@@ -45,16 +53,59 @@ bool handleSyncCommands(String raw) {
     return handleSetLastSync(payload);
   }
 
-  if (raw == "EXPORT_READINGS") {
-    return handleExportReadings();
+  if (raw.startsWith("SET_BAUD|")) {
+    String payload = raw.substring(String("SET_BAUD|").length());
+    return handleSetBaud(payload);
   }
 
-  if (raw == "EXPORT_BILLS") {
-    return handleExportBills();
+  if (raw.startsWith("LINKTEST|")) {
+    String payload = raw.substring(String("LINKTEST|").length());
+    return handleLinkTest(payload);
   }
 
-  if (raw == "EXPORT_BILL_TRANSACTIONS") {
-    return handleExportBillTransactions();
+  if (raw.startsWith("LINKTEST_ECHO|")) {
+    String payload = raw.substring(String("LINKTEST_ECHO|").length());
+    return handleLinkTestEcho(payload);
+  }
+
+  if (raw.startsWith("SET_EXPORT_FORMAT|")) {
+    String payload = raw.substring(String("SET_EXPORT_FORMAT|").length());
+    return handleSetExportFormat(payload);
+  }
+
+  if (raw.startsWith("SET_COMPRESSION|")) {
+    String payload = raw.substring(String("SET_COMPRESSION|").length());
+    return handleSetCompression(payload);
+  }
+
+  if (raw == "EXPORT_READINGS" || raw.startsWith("EXPORT_READINGS|")) {
+    String args = raw.startsWith("EXPORT_READINGS|") ? raw.substring(String("EXPORT_READINGS|").length()) : String();
+    return handleExportReadings(args);
+  }
+
+  if (raw == "EXPORT_BILLS" || raw.startsWith("EXPORT_BILLS|")) {
+    String args = raw.startsWith("EXPORT_BILLS|") ? raw.substring(String("EXPORT_BILLS|").length()) : String();
+    return handleExportBills(args);
+  }
+
+  if (raw == "EXPORT_BILL_TRANSACTIONS" || raw.startsWith("EXPORT_BILL_TRANSACTIONS|")) {
+    String args = raw.startsWith("EXPORT_BILL_TRANSACTIONS|") ? raw.substring(String("EXPORT_BILL_TRANSACTIONS|").length()) : String();
+    return handleExportBillTransactions(args);
+  }
+
+  if (raw.startsWith("EXPORT_OPEN|")) {
+    String payload = raw.substring(String("EXPORT_OPEN|").length());
+    return handleExportOpen(payload);
+  }
+
+  if (raw.startsWith("EXPORT_PULL|")) {
+    String payload = raw.substring(String("EXPORT_PULL|").length());
+    return handleExportPull(payload);
+  }
+
+  if (raw.startsWith("EXPORT_CLOSE|")) {
+    String payload = raw.substring(String("EXPORT_CLOSE|").length());
+    return handleExportClose(payload);
   }
 
   if (raw == "READINGS_SYNCED") {
@@ -80,21 +131,102 @@ bool handleSyncCommands(String raw) {
     return handleUpsertUpdatedCustomerJsonChunk(payload);
   }
 
+  if (raw.startsWith("SYNC_SESSION|")) {
+    String payload = raw.substring(String("SYNC_SESSION|").length());
+    return handleSyncSession(payload);
+  }
+
+  if (raw.startsWith("RESUME|")) {
+    String payload = raw.substring(String("RESUME|").length());
+    return handleResume(payload);
+  }
+
+  if (raw == "SYNC_REPORT") {
+    return handleSyncReport();
+  }
+
+  if (raw.startsWith("SYNC_SESSION_END|")) {
+    String payload = raw.substring(String("SYNC_SESSION_END|").length());
+    return handleSyncSessionEnd(payload);
+  }
+
+  if (raw == "TABLE_DIGESTS") {
+    return handleTableDigests();
+  }
+
+  if (raw == "ID_LEASES") {
+    return handleIdLeases();
+  }
+
+  if (raw.startsWith("SET_ID_LEASE|")) {
+    String payload = raw.substring(String("SET_ID_LEASE|").length());
+    return handleSetIdLease(payload);
+  }
+
+  if (raw.startsWith("BATCH_BILL|")) {
+    String payload = raw.substring(String("BATCH_BILL|").length());
+    return handleBatchBill(payload);
+  }
+
+  if (raw == "PENALTY_RUN") {
+    return handlePenaltyRun();
+  }
+
+  if (raw.startsWith("RECEIPT_TEMPLATE|")) {
+    String payload = raw.substring(String("RECEIPT_TEMPLATE|").length());
+    return handleReceiptTemplate(payload);
+  }
+
+  if (raw == "DIGEST" || raw.startsWith("DIGEST|")) {
+    String args = raw.startsWith("DIGEST|") ? raw.substring(String("DIGEST|").length()) : String();
+    return handleDigest(args);
+  }
+
+  if (raw == "DIGEST_KEYS" || raw.startsWith("DIGEST_KEYS|")) {
+    String args = raw.startsWith("DIGEST_KEYS|") ? raw.substring(String("DIGEST_KEYS|").length()) : String();
+    return handleDigestKeys(args);
+  }
+
+  if (raw.startsWith("REMOVE_CUSTOMER|")) {
+    String payload = raw.substring(String("REMOVE_CUSTOMER|").length());
+    return handleRemoveCustomer(payload);
+  }
+
   if (raw.startsWith("UPSERT_DEDUCTION|")) {
     String payload = raw.substring(String("UPSERT_DEDUCTION|").length());
     return handleUpsertDeduction(payload);
   }
 
+  if (raw.startsWith("UPSERT_DEDUCTIONS_JSON_CHUNK|")) {
+    String payload = raw.substring(String("UPSERT_DEDUCTIONS_JSON_CHUNK|").length());
+    return handleUpsertDeductionsJsonChunk(payload);
+  }
+
   if (raw.startsWith("UPSERT_BARANGAY|")) {
     String payload = raw.substring(String("UPSERT_BARANGAY|").length());
     return handleUpsertBarangay(payload);
   }
 
+  if (raw.startsWith("UPSERT_BARANGAYS_JSON_CHUNK|")) {
+    String payload = raw.substring(String("UPSERT_BARANGAYS_JSON_CHUNK|").length());
+    return handleUpsertBarangaysJsonChunk(payload);
+  }
+
   if (raw.startsWith("UPSERT_CUSTOMER_TYPE|")) {
     String payload = raw.substring(String("UPSERT_CUSTOMER_TYPE|").length());
     return handleUpsertCustomerType(payload);
   }
 
+  if (raw.startsWith("UPSERT_CUSTOMER_TYPES_JSON_CHUNK|")) {
+    String payload = raw.substring(String("UPSERT_CUSTOMER_TYPES_JSON_CHUNK|").length());
+    return handleUpsertCustomerTypesJsonChunk(payload);
+  }
+
+  if (raw.startsWith("UPSERT_TARIFF_TIERS_JSON_CHUNK|")) {
+    String payload = raw.substring(String("UPSERT_TARIFF_TIERS_JSON_CHUNK|").length());
+    return handleUpsertTariffTiersJsonChunk(payload);
+  }
+
   if (raw.startsWith("UPSERT_BILLS_JSON_CHUNK|")) {
     String payload = raw.substring(String("UPSERT_BILLS_JSON_CHUNK|").length());
     return handleUpsertBillsJsonChunk(payload);
@@ -13,6 +13,7 @@ extern TFT_eSPI tft;
 #include "screens/enter_account_screen.h"
 #include "screens/customer_info_screen.h"
 #include "screens/enter_reading_screen.h"
+#include "screens/usage_anomaly_screen.h"
 #include "screens/reading_already_done_screen.h"
 #include "screens/bill_calculated_screen.h"
 #include "screens/view_rate_screen.h"
@@ -36,8 +37,8 @@ enum WorkflowState {
   STATE_ACCOUNT_FOUND,     // Account found, showing customer info
   STATE_READING_ALREADY_DONE, // Reading already done this month
   STATE_ENTER_READING,     // Waiting for current meter reading entry
+  STATE_CONFIRM_ANOMALY,   // Usage outside the customer's usual range, keep or re-enter
   STATE_BILL_CALCULATED,   // Bill calculated, ready to print
-  STATE_PRINTING,          // Printing bill
   STATE_VIEW_RATE          // Viewing current rate
 };
 
@@ -98,24 +99,47 @@ void processReadingEntry() {
     delay(2000);
     displayEnterReadingScreen();
   } else {
+    inputBuffer = "";
+    UsageCheck check = checkContextUsage(currentContext, currentReading);
+    currentContext.anomaly = check.anomaly;
+    if (check.anomaly != USAGE_OK) {
+      // Unusual usage - let the reader confirm before the bill is made
+      currentState = STATE_CONFIRM_ANOMALY;
+      displayUsageAnomalyScreen(check);
+      Serial.print(F("Usage anomaly: "));
+      Serial.println(usageAnomalyName(check.anomaly));
+      return;
+    }
     // Valid reading - calculate bill
     currentState = STATE_BILL_CALCULATED;
-    inputBuffer = "";
     displayBillCalculated();
     Serial.println(F("Bill calculated. Ready to print."));
   }
 }
 
-void resetWorkflow() {
+// Drops the customer being worked on
+void clearWorkflow() {
   if (currentCustomer) {
     delete currentCustomer;
     currentCustomer = nullptr;
   }
-  currentState = STATE_WELCOME;
+  currentContext = CustomerContext();
   inputBuffer = "";
   selectedCustomerIndex = -1;
   currentReading = 0;
+}
+
+void resetWorkflow() {
+  clearWorkflow();
+  currentState = STATE_WELCOME;
   showWelcomeScreen();
 }
 
+// Straight to the next account number, as after a bill is queued for printing
+void nextAccountWorkflow() {
+  clearWorkflow();
+  currentState = STATE_ENTER_ACCOUNT;
+  displayEnterAccountScreen();
+}
+
 #endif  // TFT_SCREEN_MANAGER_H
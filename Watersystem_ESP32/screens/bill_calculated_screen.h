@@ -4,26 +4,22 @@
 #include "../configuration/config.h"
 #include "../database/customers_database.h"
 #include "../database/bill_database.h"
-#include <SD.h>
+#include "../database/customer_context.h"
 
 // ===== EXTERNAL OBJECTS =====
 extern TFT_eSPI tft;
 extern Customer* currentCustomer;
+extern CustomerContext currentContext;
 extern unsigned long currentReading;
 
-// ===== FUNCTIONS FROM OTHER MODULES =====
-bool generateBillForCustomer(String accountNo, unsigned long currentReading);
-bool isSDCardReady();
-void deselectTftSelectSd();
-
 void displayBillCalculated() {
   tft.fillScreen(COLOR_BG);
   
   Customer* cust = currentCustomer;
   if (cust == nullptr) return;
   
-  // Generate bill using customer type logic
-  bool billGenerated = generateBillForCustomer(cust->account_no, currentReading);
+  // Generate bill from the context loaded with the account
+  bool billGenerated = generateBillForContext(currentContext, currentReading);
   Serial.print(F("Bill generated: "));
   Serial.println(billGenerated ? F("Success") : F("Failed"));
   if (!billGenerated) {
@@ -35,25 +31,12 @@ void displayBillCalculated() {
     return;
   }
   
-  // Save temp reading date to SD
-  if (isSDCardReady()) {
-    deselectTftSelectSd();
-    File f = SD.open("/temp_reading_date.txt", FILE_WRITE);
-    if (f) {
-      f.println(currentBill.readingDateTime);
-      f.close();
-      Serial.println(F("Temp reading date saved to SD"));
-    } else {
-      Serial.println(F("Failed to save temp reading date"));
-    }
-  }
-  
   Serial.print(F("Customer: "));
   Serial.println(currentBill.customerName);
   Serial.print(F("Usage: "));
   Serial.println(currentBill.usage);
   Serial.print(F("Total: P"));
-  Serial.println(currentBill.total, 2);
+  printlnMoney(Serial, currentBill.total);
   
   tft.setTextColor(COLOR_HEADER);
   tft.setTextSize(1);
@@ -83,19 +66,19 @@ void displayBillCalculated() {
   tft.setCursor(2, 58);
   if (currentBill.usage <= currentBill.minM3 && currentBill.minM3 > 0) {
     tft.print(F("Min Charge: P"));
-    tft.println(currentBill.minCharge, 2);
+    printlnMoney(tft, currentBill.minCharge);
   } else {
     tft.print(F("Rate: P"));
-    tft.print(currentBill.rate, 2);
+    printMoney(tft, currentBill.rate);
     tft.println(F("/m3"));
   }
   
   // Show deduction if any
-  if (currentBill.deductions > 0) {
+  if (currentBill.deductions > Money()) {
     tft.setTextColor(COLOR_LABEL);
     tft.setCursor(2, 70);
     tft.print(F("Discount: P"));
-    tft.println(currentBill.deductions, 2);
+    printlnMoney(tft, currentBill.deductions);
     tft.drawLine(0, 82, 160, 82, COLOR_LINE);
     
     tft.setTextColor(COLOR_HEADER);
@@ -106,7 +89,7 @@ void displayBillCalculated() {
     tft.setTextSize(2);
     tft.setCursor(20, 102);
     tft.print(F("P"));
-    tft.println(currentBill.total, 2);
+    printlnMoney(tft, currentBill.total);
     tft.setTextSize(1);
     
     tft.setTextColor(COLOR_LABEL);
@@ -123,7 +106,7 @@ void displayBillCalculated() {
     tft.setTextSize(2);
     tft.setCursor(20, 90);
     tft.print(F("P"));
-    tft.println(currentBill.total, 2);
+    printlnMoney(tft, currentBill.total);
     tft.setTextSize(1);
     
     tft.setTextColor(COLOR_LABEL);
@@ -12,7 +12,7 @@ void displayBillOnTFT() {
   
   // Calculate used and total
   unsigned long used = currentBill.currReading - currentBill.prevReading;
-  float total = used * currentBill.rate + currentBill.penalty;
+  Money total = currentBill.rate * used + currentBill.penalty;
   
   // Header
   tft.setTextColor(COLOR_HEADER);
@@ -77,7 +77,7 @@ void displayBillOnTFT() {
   tft.setTextSize(2);
   tft.setCursor(20, 112);
   tft.print(F("P"));
-  tft.println(total, 2);
+  printlnMoney(tft, total);
   tft.setTextSize(1);
 }
 
@@ -3,11 +3,13 @@
 
 #include "../configuration/config.h"
 #include "../database/customers_database.h"
-#include "../database/readings_database.h"
+#include "../database/customer_context.h"
+#include "../components/usage_sparkline.h"
 
 // ===== EXTERNAL OBJECTS =====
 extern TFT_eSPI tft;
 extern Customer* currentCustomer;
+extern CustomerContext currentContext;
 extern unsigned long correctPreviousReading;
 
 void displayCustomerInfo() {
@@ -43,15 +45,8 @@ void displayCustomerInfo() {
   
   tft.drawLine(0, 58, 160, 58, COLOR_LINE);
   
-  // Check if customer has existing reading and show correct previous reading
-  unsigned long displayPrevReading = cust->previous_reading;
-  if (hasReadingThisMonth(cust->customer_id)) {
-    unsigned long existingPrev = 0, existingCurr = 0, existingUsage = 0;
-    if (getExistingReadingDataThisMonth(cust->customer_id, existingPrev, existingCurr, existingUsage)) {
-      displayPrevReading = existingPrev;
-    }
-  }
-  
+  // A reading already taken this month is replaced, so its previous reading applies
+  unsigned long displayPrevReading = contextPreviousReading(currentContext);
   correctPreviousReading = displayPrevReading;
   
   tft.setTextColor(COLOR_LABEL);
@@ -59,6 +54,26 @@ void displayCustomerInfo() {
   tft.print(F("Prev: "));
   tft.setTextColor(COLOR_AMOUNT);
   tft.println(displayPrevReading);
+
+  // Usage trend from the history loaded with the account
+  uint32_t average = 0;
+  tft.setTextColor(COLOR_LABEL);
+  tft.setCursor(2, 76);
+  tft.print(F("Avg 6mo: "));
+  tft.setTextColor(COLOR_AMOUNT);
+  if (usageHistoryAverage(currentContext.history, 6, average)) {
+    tft.print(average);
+    tft.println(F(" m3"));
+  } else {
+    tft.println(F("-"));
+  }
+  uint32_t t0 = micros();
+  drawUsageSparkline(2, 86, 156, 12, currentContext.history);
+#if WS_SERIAL_VERBOSE
+  Serial.printf("Sparkline drawn in %lu us\n", (unsigned long)(micros() - t0));
+#else
+  (void)t0;
+#endif
   
   tft.setTextColor(COLOR_LABEL);
   tft.setCursor(2, 100);
@@ -0,0 +1,76 @@
+#ifndef USAGE_ANOMALY_SCREEN_H
+#define USAGE_ANOMALY_SCREEN_H
+
+#include "../configuration/config.h"
+#include "../database/customers_database.h"
+#include "../database/usage_anomaly.h"
+
+// ===== EXTERNAL OBJECTS =====
+extern TFT_eSPI tft;
+extern Customer* currentCustomer;
+extern unsigned long currentReading;
+
+// Shown instead of the bill when the entered reading fails checkUsage();
+// D keeps it (stored with the flag), B re-enters it, C cancels
+void displayUsageAnomalyScreen(const UsageCheck& check) {
+  tft.fillScreen(COLOR_BG);
+
+  tft.setTextColor(ST77XX_RED);
+  tft.setTextSize(1);
+  tft.setCursor(22, 5);
+  tft.println(F("CHECK THE READING"));
+
+  tft.drawLine(0, 16, 160, 16, COLOR_LINE);
+
+  if (currentCustomer != nullptr) {
+    tft.setTextColor(COLOR_TEXT);
+    tft.setCursor(2, 22);
+    tft.println(currentCustomer->customer_name);
+  }
+
+  tft.setTextColor(COLOR_LABEL);
+  tft.setCursor(2, 34);
+  tft.print(F("Reading: "));
+  tft.setTextColor(COLOR_TEXT);
+  tft.println(currentReading);
+
+  tft.setTextColor(COLOR_LABEL);
+  tft.setCursor(2, 46);
+  tft.print(F("Used: "));
+  tft.setTextColor(COLOR_AMOUNT);
+  tft.print(check.usage);
+  tft.println(F(" m3"));
+
+  tft.setTextColor(COLOR_LABEL);
+  tft.setCursor(2, 58);
+  if (check.anomaly == USAGE_TYPE_MAX) {
+    tft.print(F("Type limit: "));
+    tft.setTextColor(COLOR_TEXT);
+    tft.print(check.typeMax);
+    tft.println(F(" m3"));
+  } else {
+    tft.print(F("Usual: "));
+    tft.setTextColor(COLOR_TEXT);
+    tft.print(check.low);
+    tft.print(F("-"));
+    tft.print(check.high);
+    tft.print(F(" m3"));
+    tft.setTextColor(COLOR_LABEL);
+    tft.print(F(" ~"));
+    tft.println(check.expected);
+  }
+
+  tft.setTextColor(ST77XX_RED);
+  tft.setCursor(2, 72);
+  tft.println(check.anomaly == USAGE_LOW ? F("Usage unusually LOW.") : F("Usage unusually HIGH."));
+
+  tft.setTextColor(COLOR_LABEL);
+  tft.setCursor(2, 92);
+  tft.println(F("D - Keep reading"));
+  tft.setCursor(2, 104);
+  tft.println(F("B - Re-enter"));
+  tft.setCursor(2, 116);
+  tft.println(F("C - Cancel"));
+}
+
+#endif // USAGE_ANOMALY_SCREEN_H
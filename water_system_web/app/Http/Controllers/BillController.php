@@ -6,6 +6,7 @@
 use App\Models\Setting;
 use App\Models\Customer;
 use App\Models\BillTransaction;
+use App\Models\DeviceIdLease;
 use Carbon\Carbon;
 use Illuminate\Http\Request;
 
@@ -176,21 +177,23 @@ public function markPaid(Request $request, Bill $bill)
             'status' => ['nullable', 'string', 'in:paid'],
         ]);
 
-        // Apply penalty at payment time (if overdue beyond grace days).
-        $settings = Setting::query()->orderBy('id')->first();
-        $penaltyAfterDays = $settings ? (int) $settings->penalty_after_days : (int) env('PENALTY_AFTER_DAYS', 0);
-        $penaltyAmount = $settings ? (float) $settings->penalty_amount : (float) env('PENALTY_AMOUNT', 0.00);
-
-        $penalty = 0.0;
-        if ($bill->due_date) {
-            $threshold = Carbon::parse($bill->due_date)->addDays($penaltyAfterDays);
-            if (now()->greaterThan($threshold) && $penaltyAmount > 0) {
-                $penalty = $penaltyAmount;
+        // Apply penalty at payment time (if overdue beyond grace days),
+        // unless the device already penalized the bill.
+        if (! $bill->penaltyAlreadyApplied()) {
+            $settings = Setting::query()->orderBy('id')->first();
+            $penaltyAfterDays = $settings ? (int) $settings->penalty_after_days : (int) env('PENALTY_AFTER_DAYS', 0);
+            $penaltyAmount = $settings ? (float) $settings->penalty_amount : (float) env('PENALTY_AMOUNT', 0.00);
+
+            $penalty = 0.0;
+            if ($bill->due_date) {
+                $threshold = Carbon::parse($bill->due_date)->addDays($penaltyAfterDays);
+                if (now()->greaterThan($threshold) && $penaltyAmount > 0) {
+                    $penalty = $penaltyAmount;
+                }
             }
-        }
 
-        $bill->penalty = $penalty;
-        $bill->total_due = (float) $bill->charges + (float) $bill->penalty;
+            $bill->applyPenalty($penalty);
+        }
 
         $bill->status = 'paid';
         $bill->save();
@@ -275,11 +278,13 @@ public function getPayment(Request $request, Bill $bill)
 
     /**
      * Bulk upsert bills coming from the device.
-     * Expects: { bills: [ {bill_id, reference_number, customer_id, reading_id, bill_no, bill_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at} ] }
+     * Expects: { bills: [ {bill_id, reference_number, customer_id, reading_id, bill_no, bill_date, due_date, rate_per_m3, charges, penalty, total_due, status, created_at, updated_at} ] }
      */
     public function sync(Request $request)
     {
         $validated = $request->validate([
+            'device_mac' => ['nullable', 'string'],
+            'db_id' => ['nullable', 'integer', 'min:0'],
             'bills' => ['required', 'array', 'max:1000'],
             'bills.*.bill_id' => ['nullable', 'integer'],
             'bills.*.reference_number' => ['required', 'string', 'max:255'],
@@ -287,6 +292,7 @@ public function sync(Request $request)
             'bills.*.reading_id' => ['nullable', 'integer'],
             'bills.*.device_uid' => ['nullable', 'string', 'max:255'],
             'bills.*.bill_date' => ['nullable', 'string'],
+            'bills.*.due_date' => ['nullable', 'string'],
             'bills.*.rate_per_m3' => ['nullable', 'numeric'],
             'bills.*.charges' => ['nullable', 'numeric'],
             'bills.*.penalty' => ['nullable', 'numeric'],
@@ -297,18 +303,25 @@ public function sync(Request $request)
         ]);
 
         $bills = $validated['bills'];
+        $deviceMac = $validated['device_mac'] ?? null;
+        $dbId = $validated['db_id'] ?? null;
         $processed = 0;
 
         \Log::info('Syncing bills', ['count' => count($bills)]);
 
         foreach ($bills as $row) {
-            Bill::updateOrCreate(
-                ['reference_number' => $row['reference_number']],
+            $bill = Bill::firstOrNew(['reference_number' => $row['reference_number']]);
+            if (!$bill->exists && !empty($row['bill_id']) && DeviceIdLease::covers('bills', (int) $row['bill_id'], $deviceMac, $dbId)) {
+                // Keys from this device's own blocks are unique across devices
+                $bill->bill_id = (int) $row['bill_id'];
+            }
+            $bill->fill(
                 [
                     'customer_id' => $row['customer_id'],
                     'reading_id' => $row['reading_id'] ?? null,
                     'device_uid' => $row['device_uid'] ?? null,
                     'bill_date' => $row['bill_date'] ?? null,
+                    'due_date' => $row['due_date'] ?? null,
                     'rate_per_m3' => $row['rate_per_m3'] ?? 0,
                     'charges' => $row['charges'] ?? 0,
                     'penalty' => $row['penalty'] ?? 0,
@@ -317,7 +330,7 @@ public function sync(Request $request)
                     'created_at' => $row['created_at'] ?? now(),
                     'updated_at' => $row['updated_at'] ?? now(),
                 ]
-            );
+            )->save();
 
             $processed++;
         }
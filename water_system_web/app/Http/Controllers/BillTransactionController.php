@@ -3,6 +3,7 @@
 namespace App\Http\Controllers;
 
 use App\Models\BillTransaction;
+use App\Models\DeviceIdLease;
 use Illuminate\Http\Request;
 
 class BillTransactionController extends Controller
@@ -10,6 +11,8 @@ class BillTransactionController extends Controller
     public function sync(Request $request)
     {
         $validated = $request->validate([
+            'device_mac' => ['nullable', 'string'],
+            'db_id' => ['nullable', 'integer', 'min:0'],
             'bill_transactions' => ['required', 'array', 'max:1000'],
             'bill_transactions.*.bill_transaction_id' => ['nullable', 'integer'],
             'bill_transactions.*.bill_id' => ['required', 'integer'],
@@ -28,13 +31,30 @@ public function sync(Request $request)
         ]);
 
         $billTransactions = $validated['bill_transactions'];
+        $deviceMac = $validated['device_mac'] ?? null;
+        $dbId = $validated['db_id'] ?? null;
         $processed = 0;
+        $conflicts = 0;
 
         \Log::info('Syncing bill transactions', ['count' => count($billTransactions)]);
 
         foreach ($billTransactions as $row) {
-            BillTransaction::updateOrCreate(
-                ['bill_transaction_id' => $row['bill_transaction_id']],
+            $id = (int) ($row['bill_transaction_id'] ?? 0);
+            $transaction = BillTransaction::firstOrNew(['bill_transaction_id' => $id ?: null]);
+            $owned = $id > 0 && DeviceIdLease::covers('bill_transactions', $id, $deviceMac, $dbId);
+            if ($id > 0 && !$owned && ($transaction->exists
+                ? $transaction->processed_by_device_uid !== ($row['processed_by_device_uid'] ?? null)
+                : DeviceIdLease::granted('bill_transactions', $id))) {
+                // Another device's key; never overwrite its row
+                \Log::warning('Bill transaction key owned by another device, skipped', ['bill_transaction_id' => $id, 'device_mac' => $deviceMac]);
+                $conflicts++;
+                continue;
+            }
+            if (!$transaction->exists && $id > 0) {
+                // This device's block, or a key outside every block
+                $transaction->bill_transaction_id = $id;
+            }
+            $transaction->fill(
                 [
                     'bill_id' => $row['bill_id'],
                     'bill_reference_number' => $row['bill_reference_number'] ?? null,
@@ -50,7 +70,7 @@ public function sync(Request $request)
                     'created_at' => $row['created_at'] ?? now(),
                     'updated_at' => $row['updated_at'] ?? now(),
                 ]
-            );
+            )->save();
 
             $processed++;
         }
@@ -59,6 +79,7 @@ public function sync(Request $request)
 
         return response()->json([
             'processed' => $processed,
+            'conflicts' => $conflicts,
         ]);
     }
 }
\ No newline at end of file
@@ -10,7 +10,7 @@ class CustomerTypeController extends Controller
     public function index()
     {
         return response()->json([
-            'data' => CustomerType::all()
+            'data' => CustomerType::with('tiers')->get()
         ]);
     }
 }
\ No newline at end of file
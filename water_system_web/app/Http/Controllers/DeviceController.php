@@ -3,10 +3,21 @@
 namespace App\Http\Controllers;
 
 use App\Models\Device;
+use App\Models\DeviceIdLease;
 use Illuminate\Http\Request;
+use Illuminate\Support\Facades\DB;
 
 class DeviceController extends Controller
 {
+    // Device table => [server table, primary key] for leased key blocks
+    private const ID_LEASE_TABLES = [
+        'readings' => ['reading', 'reading_id'],
+        'bills' => ['bill', 'bill_id'],
+        'bill_transactions' => ['bill_transaction', 'bill_transaction_id'],
+    ];
+    private const ID_LEASE_BLOCK = 1000;
+    private const ID_LEASE_REFILL = 250;
+
     public function sync(Request $request)
     {
         \Log::info('Device sync request received', $request->all());
@@ -44,6 +55,115 @@ public function sync(Request $request)
         return response()->json([
             'message' => 'Device info synced successfully',
             'device_mac' => $device->device_mac,
+            'watermarks' => $this->watermarksFor($device),
+        ]);
+    }
+
+    /**
+     * Record the highest change_seq stored per table for a device database.
+     * Watermarks only move forward unless the device database changed.
+     */
+    public function watermarks(Request $request)
+    {
+        $validated = $request->validate([
+            'device_mac' => ['required', 'string'],
+            'db_id' => ['required', 'integer', 'min:0'],
+            'watermarks' => ['required', 'array'],
+            'watermarks.readings' => ['nullable', 'integer', 'min:0'],
+            'watermarks.bills' => ['nullable', 'integer', 'min:0'],
+            'watermarks.bill_transactions' => ['nullable', 'integer', 'min:0'],
+        ]);
+
+        $device = Device::findOrFail($validated['device_mac']);
+
+        if ((int) $device->watermark_db_id !== (int) $validated['db_id']) {
+            $device->watermark_db_id = $validated['db_id'];
+            $device->readings_watermark = 0;
+            $device->bills_watermark = 0;
+            $device->bill_transactions_watermark = 0;
+        }
+
+        foreach (['readings', 'bills', 'bill_transactions'] as $table) {
+            $mark = $validated['watermarks'][$table] ?? null;
+            if ($mark !== null) {
+                $column = $table . '_watermark';
+                $device->{$column} = max((int) $device->{$column}, (int) $mark);
+            }
+        }
+
+        $device->save();
+
+        return response()->json([
+            'message' => 'Watermarks updated',
+            'watermarks' => $this->watermarksFor($device),
+        ]);
+    }
+
+    /**
+     * Grant a new primary key block for each table where the device has
+     * fewer than ID_LEASE_REFILL leased ids left. A block starts past every
+     * block granted before and every stored key, so rows from different
+     * devices can be stored under their device keys.
+     */
+    public function idLeases(Request $request)
+    {
+        $validated = $request->validate([
+            'device_mac' => ['required', 'string'],
+            'db_id' => ['nullable', 'integer', 'min:0'],
+            'remaining' => ['required', 'array'],
+            'remaining.readings' => ['nullable', 'integer', 'min:0'],
+            'remaining.bills' => ['nullable', 'integer', 'min:0'],
+            'remaining.bill_transactions' => ['nullable', 'integer', 'min:0'],
         ]);
+
+        $device = Device::findOrFail($validated['device_mac']);
+        $leases = [];
+
+        DB::transaction(function () use ($validated, $device, &$leases) {
+            foreach (self::ID_LEASE_TABLES as $table => [$serverTable, $key]) {
+                $remaining = $validated['remaining'][$table] ?? null;
+                if ($remaining === null || (int) $remaining >= self::ID_LEASE_REFILL) {
+                    continue;
+                }
+
+                // Locks the table's newest grant so concurrent syncs get disjoint blocks
+                $lastGranted = (int) DeviceIdLease::where('table_name', $table)->lockForUpdate()->max('last_id');
+                $lastStored = (int) DB::table($serverTable)->max($key);
+                $firstId = max($lastGranted, $lastStored) + 1;
+
+                $lease = DeviceIdLease::create([
+                    'device_mac' => $device->device_mac,
+                    'table_name' => $table,
+                    'db_id' => $validated['db_id'] ?? null,
+                    'first_id' => $firstId,
+                    'last_id' => $firstId + self::ID_LEASE_BLOCK - 1,
+                ]);
+
+                $leases[$table] = ['first_id' => $lease->first_id, 'last_id' => $lease->last_id];
+            }
+        });
+
+        // Rows created on the server itself must not take keys from a granted
+        // block. ALTER TABLE commits implicitly, so it runs after the grants.
+        if (DB::getDriverName() === 'mysql') {
+            foreach ($leases as $table => $lease) {
+                DB::statement('ALTER TABLE ' . self::ID_LEASE_TABLES[$table][0] . ' AUTO_INCREMENT = ' . ($lease['last_id'] + 1));
+            }
+        }
+
+        return response()->json([
+            'message' => 'ID leases granted',
+            'leases' => (object) $leases,
+        ]);
+    }
+
+    private function watermarksFor(Device $device): array
+    {
+        return [
+            'db_id' => $device->watermark_db_id,
+            'readings' => (int) $device->readings_watermark,
+            'bills' => (int) $device->bills_watermark,
+            'bill_transactions' => (int) $device->bill_transactions_watermark,
+        ];
     }
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 use App\Models\Bill;
 use App\Models\Customer;
+use App\Models\DeviceIdLease;
 use App\Models\Reading;
 use App\Models\Setting;
 use Carbon\Carbon;
@@ -34,6 +35,7 @@ public function indexByCustomer(Request $request, Customer $customer)
                 'reading.current_reading',
                 'reading.usage_m3',
                 'reading.reading_at',
+                'reading.anomaly',
                 'reading.read_by_user_id',
                 'reading.created_at',
                 'reading.updated_at',
@@ -53,6 +55,8 @@ public function indexByCustomer(Request $request, Customer $customer)
     public function sync(Request $request)
     {
         $validated = $request->validate([
+            'device_mac' => ['nullable', 'string'],
+            'db_id' => ['nullable', 'integer', 'min:0'],
             'readings' => ['required', 'array', 'max:2000'],
             'readings.*.reading_id' => ['required', 'integer', 'min:1'],
             'readings.*.customer_id' => ['required', 'integer', 'min:1'],
@@ -61,9 +65,12 @@ public function sync(Request $request)
             'readings.*.current_reading' => ['required', 'integer', 'min:0'],
             'readings.*.usage_m3' => ['required', 'integer', 'min:0'],
             'readings.*.reading_at' => ['nullable', 'integer', 'min:0'], // epoch seconds
+            'readings.*.anomaly' => ['nullable', 'string', 'in:HIGH,LOW,TYPE_MAX'], // flagged and kept on the device
         ]);
 
         $rows = $validated['readings'];
+        $deviceMac = $validated['device_mac'] ?? null;
+        $dbId = $validated['db_id'] ?? null;
         $customerIds = collect($rows)->pluck('customer_id')->unique()->values();
 
         $customersById = Customer::query()
@@ -78,8 +85,9 @@ public function sync(Request $request)
         $inserted = 0;
         $updated = 0;
         $skipped = 0;
+        $conflicts = 0;
 
-        DB::transaction(function () use ($rows, $customersById, $ratePerM3, $dueDays, &$inserted, &$updated, &$skipped) {
+        DB::transaction(function () use ($rows, $customersById, $ratePerM3, $dueDays, $deviceMac, $dbId, &$inserted, &$updated, &$skipped, &$conflicts) {
             foreach ($rows as $row) {
                 $customer = $customersById->get($row['customer_id']);
                 if (!$customer) {
@@ -91,8 +99,20 @@ public function sync(Request $request)
                     ? Carbon::createFromTimestamp((int) $row['reading_at'])
                     : now();
 
-                // Check if reading exists
-                $existing = Reading::where('reading_id', (int) $row['reading_id'])->first();
+                // The key is this device's when it lies in one of its blocks, or
+                // names a row it exported before leases; anything else belongs
+                // to another device and is never overwritten
+                $readingId = (int) $row['reading_id'];
+                $existing = Reading::where('reading_id', $readingId)->first();
+                $owned = DeviceIdLease::covers('readings', $readingId, $deviceMac, $dbId);
+                if (!$owned && ($existing
+                    ? $existing->device_uid !== ($row['device_uid'] ?? null)
+                    : DeviceIdLease::granted('readings', $readingId))) {
+                    \Log::warning('Reading key owned by another device, skipped', ['reading_id' => $readingId, 'device_mac' => $deviceMac]);
+                    $conflicts++;
+                    continue;
+                }
+
                 if ($existing) {
                     $existing->update([
                         'customer_id' => $customer->customer_id,
@@ -101,18 +121,20 @@ public function sync(Request $request)
                         'current_reading' => (int) $row['current_reading'],
                         'usage_m3' => (int) $row['usage_m3'],
                         'reading_at' => $readingAt,
+                        'anomaly' => $row['anomaly'] ?? null,
                         'read_by_user_id' => null,
                     ]);
                     $updated++;
                 } else {
-                    DB::insert("INSERT INTO reading (reading_id, customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, read_by_user_id, created_at, updated_at) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", [
-                        (int) $row['reading_id'],
+                    DB::insert("INSERT INTO reading (reading_id, customer_id, device_uid, previous_reading, current_reading, usage_m3, reading_at, anomaly, read_by_user_id, created_at, updated_at) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", [
+                        $readingId,
                         $customer->customer_id,
                         $row['device_uid'] ?? null,
                         (int) $row['previous_reading'],
                         (int) $row['current_reading'],
                         (int) $row['usage_m3'],
                         $readingAt,
+                        $row['anomaly'] ?? null,
                         null,
                         now(),
                         now(),
@@ -127,6 +149,7 @@ public function sync(Request $request)
             'inserted' => $inserted,
             'updated' => $updated,
             'skipped' => $skipped,
+            'conflicts' => $conflicts,
         ]);
     }
 }
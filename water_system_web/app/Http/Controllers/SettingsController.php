@@ -40,6 +40,7 @@ public function update(Request $request)
             'bill_due_days' => ['required', 'integer', 'min:0', 'max:365'],
             'penalty_after_days' => ['required', 'integer', 'min:0', 'max:365'],
             'penalty_amount' => ['required', 'numeric', 'min:0', 'max:100000'],
+            'receipt_template' => ['nullable', 'string', 'max:8192'],
         ]);
 
         $row->fill($validated);
@@ -33,6 +33,32 @@ class Bill extends Model
         'total_due' => 'decimal:2',
     ];
 
+    /**
+     * Replaces the penalty. total_due already has the deduction taken off
+     * (the device computes it), so only the change in penalty is applied;
+     * charges + penalty would drop the deduction. Done in centavos.
+     */
+    public function applyPenalty(float|string $penalty): void
+    {
+        $centavos = fn ($amount) => (int) round((float) $amount * 100);
+        $penaltyCentavos = $centavos($penalty);
+        $totalCentavos = $centavos($this->total_due) - $centavos($this->penalty) + $penaltyCentavos;
+
+        $this->penalty = number_format($penaltyCentavos / 100, 2, '.', '');
+        $this->total_due = number_format($totalCentavos / 100, 2, '.', '');
+    }
+
+    /**
+     * The device penalty engine adds the customer type's penalty once and
+     * moves the bill to 'Due'; such a bill is collected at the stored total,
+     * the one its receipt shows.
+     */
+    public function penaltyAlreadyApplied(): bool
+    {
+        return strcasecmp((string) $this->status, 'due') === 0
+            || (int) round((float) $this->penalty * 100) !== 0;
+    }
+
     public function customer()
     {
         return $this->belongsTo(Customer::class);
@@ -4,6 +4,7 @@
 
 use Illuminate\Database\Eloquent\Factories\HasFactory;
 use Illuminate\Database\Eloquent\Model;
+use Illuminate\Database\Eloquent\Relations\HasMany;
 
 class CustomerType extends Model
 {
@@ -18,6 +19,7 @@ class CustomerType extends Model
         'min_m3',
         'min_charge',
         'penalty',
+        'max_m3',
     ];
 
     protected $casts = [
@@ -25,5 +27,51 @@ class CustomerType extends Model
         'min_m3' => 'integer',
         'min_charge' => 'decimal:2',
         'penalty' => 'decimal:2',
+        'max_m3' => 'integer',
     ];
-}
\ No newline at end of file
+
+    /**
+     * Tariff blocks above min_m3, each starting at its from_m3.
+     */
+    public function tiers(): HasMany
+    {
+        return $this->hasMany(CustomerTypeTier::class, 'type_id', 'type_id')->orderBy('from_m3');
+    }
+
+    /**
+     * Water charge for $usage m3, in centavos. Same rules as the device
+     * (Watersystem_ESP32/database/tariff_database.h): min_charge up to
+     * min_m3; without tiers the whole usage at rate_per_m3; with tiers
+     * min_charge plus every m3 above min_m3 at the rate of its block. The
+     * first block always starts at min_m3.
+     */
+    public function chargeCentavos(int $usage): int
+    {
+        $minM3 = (int) $this->min_m3;
+        $minCentavos = (int) round((float) $this->min_charge * 100);
+        if ($usage <= $minM3) {
+            return $minCentavos;
+        }
+
+        $blocks = [];
+        foreach ($this->tiers as $tier) {
+            $from = empty($blocks) ? $minM3 : max((int) $tier->from_m3, $minM3);
+            $blocks[$from] = (int) round((float) $tier->rate_per_m3 * 100);
+        }
+        if (empty($blocks)) {
+            return $usage * (int) round((float) $this->rate_per_m3 * 100);
+        }
+
+        $charge = $minCentavos;
+        $starts = array_keys($blocks);
+        foreach ($starts as $i => $from) {
+            if ($usage <= $from) {
+                break;
+            }
+            $to = $starts[$i + 1] ?? $usage;
+            $charge += (min($usage, $to) - $from) * $blocks[$from];
+        }
+
+        return $charge;
+    }
+}
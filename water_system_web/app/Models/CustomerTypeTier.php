@@ -0,0 +1,28 @@
+<?php
+
+namespace App\Models;
+
+use Illuminate\Database\Eloquent\Model;
+use Illuminate\Database\Eloquent\Relations\BelongsTo;
+
+class CustomerTypeTier extends Model
+{
+    protected $table = 'customer_type_tier';
+    protected $primaryKey = 'tier_id';
+
+    protected $fillable = [
+        'type_id',
+        'from_m3',
+        'rate_per_m3',
+    ];
+
+    protected $casts = [
+        'from_m3' => 'integer',
+        'rate_per_m3' => 'decimal:2',
+    ];
+
+    public function customerType(): BelongsTo
+    {
+        return $this->belongsTo(CustomerType::class, 'type_id', 'type_id');
+    }
+}
@@ -20,6 +20,10 @@ class Device extends Model
         'print_count',
         'customer_count',
         'last_sync',
+        'watermark_db_id',
+        'readings_watermark',
+        'bills_watermark',
+        'bill_transactions_watermark',
     ];
 
     protected $casts = [
@@ -27,5 +31,9 @@ class Device extends Model
         'print_count' => 'integer',
         'customer_count' => 'integer',
         'last_sync' => 'datetime',
+        'watermark_db_id' => 'integer',
+        'readings_watermark' => 'integer',
+        'bills_watermark' => 'integer',
+        'bill_transactions_watermark' => 'integer',
     ];
 }
\ No newline at end of file
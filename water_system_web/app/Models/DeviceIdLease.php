@@ -0,0 +1,57 @@
+<?php
+
+namespace App\Models;
+
+use Illuminate\Database\Eloquent\Model;
+
+class DeviceIdLease extends Model
+{
+    protected $table = 'device_id_lease';
+    protected $primaryKey = 'lease_id';
+
+    protected $fillable = [
+        'device_mac',
+        'table_name',
+        'db_id',
+        'first_id',
+        'last_id',
+    ];
+
+    protected $casts = [
+        'db_id' => 'integer',
+        'first_id' => 'integer',
+        'last_id' => 'integer',
+    ];
+
+    /**
+     * Whether $id lies in a block granted for $table to this device and
+     * database. Only such keys are known not to collide with keys from
+     * other devices.
+     */
+    public static function covers(string $table, int $id, ?string $deviceMac, ?int $dbId): bool
+    {
+        if ($deviceMac === null || $deviceMac === '') {
+            return false;
+        }
+
+        return static::where('table_name', $table)
+            ->where('device_mac', $deviceMac)
+            ->when($dbId === null, fn ($query) => $query->whereNull('db_id'), fn ($query) => $query->where('db_id', $dbId))
+            ->where('first_id', '<=', $id)
+            ->where('last_id', '>=', $id)
+            ->exists();
+    }
+
+    /**
+     * Whether $id lies in a block granted for $table to any device. A key
+     * outside every block cannot be handed out later either, because new
+     * blocks start past the largest stored key.
+     */
+    public static function granted(string $table, int $id): bool
+    {
+        return static::where('table_name', $table)
+            ->where('first_id', '<=', $id)
+            ->where('last_id', '>=', $id)
+            ->exists();
+    }
+}
@@ -17,6 +17,7 @@ class Reading extends Model
         'current_reading',
         'usage_m3',
         'reading_at',
+        'anomaly',
         'read_by_user_id',
     ];
 
@@ -27,6 +28,7 @@ class Reading extends Model
         'current_reading' => 'integer',
         'usage_m3' => 'integer',
         'reading_at' => 'datetime',
+        'anomaly' => 'string',
         'read_by_user_id' => 'integer',
     ];
 }
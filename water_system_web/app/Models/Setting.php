@@ -13,6 +13,7 @@ class Setting extends Model
         'bill_due_days',
         'penalty_after_days',
         'penalty_amount',
+        'receipt_template',
     ];
 
     protected $casts = [
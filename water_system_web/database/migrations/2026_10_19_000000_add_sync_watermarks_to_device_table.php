@@ -0,0 +1,31 @@
+<?php
+
+use Illuminate\Database\Migrations\Migration;
+use Illuminate\Database\Schema\Blueprint;
+use Illuminate\Support\Facades\Schema;
+
+return new class extends Migration
+{
+    /**
+     * Run the migrations.
+     */
+    public function up(): void
+    {
+        Schema::table('device', function (Blueprint $table) {
+            $table->unsignedBigInteger('watermark_db_id')->nullable()->after('customer_count');
+            $table->unsignedBigInteger('readings_watermark')->default(0)->after('watermark_db_id');
+            $table->unsignedBigInteger('bills_watermark')->default(0)->after('readings_watermark');
+            $table->unsignedBigInteger('bill_transactions_watermark')->default(0)->after('bills_watermark');
+        });
+    }
+
+    /**
+     * Reverse the migrations.
+     */
+    public function down(): void
+    {
+        Schema::table('device', function (Blueprint $table) {
+            $table->dropColumn(['watermark_db_id', 'readings_watermark', 'bills_watermark', 'bill_transactions_watermark']);
+        });
+    }
+};
@@ -0,0 +1,36 @@
+<?php
+
+use Illuminate\Database\Migrations\Migration;
+use Illuminate\Database\Schema\Blueprint;
+use Illuminate\Support\Facades\Schema;
+
+return new class extends Migration
+{
+    /**
+     * Run the migrations.
+     */
+    public function up(): void
+    {
+        Schema::create('device_id_lease', function (Blueprint $table) {
+            $table->id('lease_id');
+            $table->string('device_mac');
+            $table->string('table_name');
+            $table->unsignedBigInteger('db_id')->nullable();
+            $table->unsignedBigInteger('first_id');
+            $table->unsignedBigInteger('last_id');
+            $table->timestamps();
+
+            $table->index(['table_name', 'last_id']);
+            $table->index(['device_mac', 'table_name']);
+            $table->foreign('device_mac')->references('device_mac')->on('device');
+        });
+    }
+
+    /**
+     * Reverse the migrations.
+     */
+    public function down(): void
+    {
+        Schema::dropIfExists('device_id_lease');
+    }
+};
@@ -0,0 +1,33 @@
+<?php
+
+use Illuminate\Database\Migrations\Migration;
+use Illuminate\Database\Schema\Blueprint;
+use Illuminate\Support\Facades\Schema;
+
+return new class extends Migration
+{
+    /**
+     * Run the migrations.
+     */
+    public function up(): void
+    {
+        Schema::create('customer_type_tier', function (Blueprint $table) {
+            $table->id('tier_id');
+            $table->unsignedBigInteger('type_id');
+            $table->unsignedInteger('from_m3');
+            $table->decimal('rate_per_m3', 10, 2);
+            $table->timestamps();
+
+            $table->unique(['type_id', 'from_m3']);
+            $table->foreign('type_id')->references('type_id')->on('customer_type')->cascadeOnDelete();
+        });
+    }
+
+    /**
+     * Reverse the migrations.
+     */
+    public function down(): void
+    {
+        Schema::dropIfExists('customer_type_tier');
+    }
+};
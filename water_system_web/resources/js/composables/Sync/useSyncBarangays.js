@@ -1,4 +1,5 @@
 import { serialService } from '../../services/serialService'
+import { useSyncReferenceBatch } from './useSyncReferenceBatch'
 
 export function useSyncBarangays() {
   const sendLine = async (line) => {
@@ -13,12 +14,26 @@ export function useSyncBarangays() {
       .trim()
   }
 
+  const { pushReferenceRows } = useSyncReferenceBatch()
+
+  const epochOf = (value) => (value ? Math.floor(new Date(value).getTime() / 1000) : 0)
+
   const pushBarangaysToDevice = async (dbBarangays) => {
-    // Send each upsert line-by-line (adds new barangays, updates existing ones)
+    // One transaction per batch on current firmware
+    const rows = dbBarangays.map((b) => ({
+      brgy_id: Number(b.brgy_id || b.id || 1),
+      barangay: String(b.barangay || '').trim(),
+      prefix: String(b.prefix || '').trim(),
+      next_number: Number(b.next_number || 1),
+      updated_at: epochOf(b.updated_at)
+    }))
+    if (await pushReferenceRows('BARANGAYS', rows)) return
+
+    // Older firmware: one upsert line per row (adds new barangays, updates existing ones)
     for (let i = 0; i < dbBarangays.length; i++) {
       const b = dbBarangays[i]
-      const createdAt = b.created_at ? Math.floor(new Date(b.created_at).getTime() / 1000) : 0
-      const updatedAt = b.updated_at ? Math.floor(new Date(b.updated_at).getTime() / 1000) : 0
+      const createdAt = epochOf(b.created_at)
+      const updatedAt = epochOf(b.updated_at)
       const line = [
         'UPSERT_BARANGAY',
         String(Number(b.brgy_id || b.id || 1)),
@@ -1,6 +1,8 @@
 import { ref } from 'vue'
 import { serialService } from '../../services/serialService'
 import { databaseService } from '../../services/databaseService'
+import { decodeColumnarExport, inflateChunkLines, parseExportStats, parseJsonChunks, parseWatermark } from '../../services/syncCodec'
+import { useSyncExportPull } from './useSyncExportPull'
 
 export function useSyncBillTransactions() {
   const exportInProgress = ref(false)
@@ -12,17 +14,24 @@ export function useSyncBillTransactions() {
   const exportEndMarker = ref(null)
   const exportLinePrefix = ref(null)
   const lastAck = ref(null)
+  const { pullExport } = useSyncExportPull()
 
   const sendLine = async (line) => {
     const text = String(line).replace(/\r|\n/g, '')
     await serialService.sendLine(text)
   }
 
-  const exportBillTransactionsFromDevice = async () => {
+  const exportBillTransactionsFromDevice = async (since = null) => {
     if (exportInProgress.value) {
       throw new Error('Export already in progress')
     }
 
+    // Client-paced pull; firmware without EXPORT_OPEN gets the pushed export below
+    const pulled = await pullExport('BILL_TRANSACTIONS', since)
+    if (pulled) {
+      return { rows: parseBillTransactionsExportLines(pulled), watermark: parseWatermark(pulled, 'BILL_TRANSACTIONS') }
+    }
+
     exportInProgress.value = true
     exportLines.value = []
     lastAck.value = null
@@ -38,10 +47,11 @@ export function useSyncBillTransactions() {
       }, 60000)
     })
 
-    await sendLine('EXPORT_BILL_TRANSACTIONS')
+    // With a watermark only rows changed since then are exported
+    await sendLine(since === null ? 'EXPORT_BILL_TRANSACTIONS' : `EXPORT_BILL_TRANSACTIONS|since=${since}`)
 
     const lines = await promise
-    return parseBillTransactionsExportLines(lines)
+    return { rows: parseBillTransactionsExportLines(lines), watermark: parseWatermark(lines, 'BILL_TRANSACTIONS') }
   }
 
   const finishExport = (error, lines = null) => {
@@ -63,68 +73,46 @@ export function useSyncBillTransactions() {
     exportReject.value = null
   }
 
-  const parseBillTransactionsExportLines = (lines) => {
-    const billTransactions = []
-    let chunkBuffer = ''
-    for (const line of lines) {
-      if (line.startsWith('BILL_TRANSACTIONS_CHUNK|')) {
-        const parts = line.split('|', 3)
-        if (parts.length >= 3) {
-          chunkBuffer = parts[2] || ''
-        }
-        continue
-      }
-
-      if (chunkBuffer) {
-        if (line.startsWith('Heap free') || line === 'END_BILL_TRANSACTIONS_JSON' || line === 'BEGIN_BILL_TRANSACTIONS_JSON') {
-          // skip meta
-        } else {
-          chunkBuffer += String(line).trim()
-        }
-      }
-
-      if (chunkBuffer) {
-        try {
-          const chunkTransactions = JSON.parse(chunkBuffer)
-          for (const transaction of chunkTransactions) {
-            billTransactions.push({
-              bill_transaction_id: Number(transaction.bill_transaction_id || 0),
-              bill_id: Number(transaction.bill_id || 0),
-              bill_reference_number: transaction.bill_reference_number || '',
-              type: transaction.type || 'payment',
-              source: transaction.source || 'Device',
-              amount: Number(transaction.amount || 0),
-              cash_received: Number(transaction.cash_received || 0),
-              change: Number(transaction.change || 0),
-              transaction_date: transaction.transaction_date || '',
-              payment_method: transaction.payment_method || 'cash',
-              processed_by_device_uid: transaction.processed_by_device_uid || null,
-              notes: transaction.notes || null,
-              created_at: transaction.created_at || null,
-              updated_at: transaction.updated_at || null,
-            })
-          }
-          chunkBuffer = '' // Clear after successful parse
-        } catch (e) {
-          // Not complete yet, continue accumulating
-        }
-      }
-    }
-    return billTransactions
+  const toBillTransaction = (transaction) => ({
+    bill_transaction_id: Number(transaction.bill_transaction_id || 0),
+    bill_id: Number(transaction.bill_id || 0),
+    bill_reference_number: transaction.bill_reference_number || '',
+    type: transaction.type || 'payment',
+    source: transaction.source || 'Device',
+    amount: Number(transaction.amount || 0),
+    cash_received: Number(transaction.cash_received || 0),
+    change: Number(transaction.change || 0),
+    transaction_date: transaction.transaction_date || '',
+    payment_method: transaction.payment_method || 'cash',
+    processed_by_device_uid: transaction.processed_by_device_uid || null,
+    notes: transaction.notes || null,
+    created_at: transaction.created_at || null,
+    updated_at: transaction.updated_at || null,
+  })
+
+  const parseBillTransactionsExportLines = (rawLines) => {
+    const stats = parseExportStats(rawLines, 'BILL_TRANSACTIONS')
+    if (stats) console.log('Bill transactions export stats:', stats)
+
+    const columnar = decodeColumnarExport(rawLines, 'BILL_TRANSACTIONS')
+    if (columnar) return columnar.map(toBillTransaction)
+
+    const lines = inflateChunkLines(rawLines, 'BILL_TRANSACTIONS_CHUNK|')
+    return parseJsonChunks(lines, 'BILL_TRANSACTIONS_CHUNK|').map(toBillTransaction)
   }
 
-  const syncBillTransactionsFromDevice = async () => {
-    const deviceBillTransactions = await exportBillTransactionsFromDevice()
+  const syncBillTransactionsFromDevice = async (since = null, owner = {}) => {
+    const { rows: deviceBillTransactions, watermark } = await exportBillTransactionsFromDevice(since)
 
     if (deviceBillTransactions.length === 0) {
-      return
+      return { processed: 0, watermark }
     }
 
     console.log('Bill transactions exported from device:', deviceBillTransactions)
 
-    const processed = await databaseService.upsertBillTransactionsToDatabase(deviceBillTransactions)
+    const processed = await databaseService.upsertBillTransactionsToDatabase(deviceBillTransactions, owner)
     console.log('Bill transactions synced to database, processed:', processed)
-    return processed
+    return { processed, watermark }
   }
 
   const handleDeviceLine = (line) => {
@@ -1,6 +1,8 @@
 import { ref } from 'vue'
 import { serialService } from '../../services/serialService'
 import { databaseService } from '../../services/databaseService'
+import { decodeColumnarExport, inflateChunkLines, parseExportStats, parseJsonChunks, parseWatermark } from '../../services/syncCodec'
+import { useSyncExportPull } from './useSyncExportPull'
 
 export function useSyncBills() {
   const exportInProgress = ref(false)
@@ -12,17 +14,24 @@ export function useSyncBills() {
   const exportEndMarker = ref(null)
   const exportLinePrefix = ref(null)
   const lastAck = ref(null)
+  const { pullExport } = useSyncExportPull()
 
   const sendLine = async (line) => {
     const text = String(line).replace(/\r|\n/g, '')
     await serialService.sendLine(text)
   }
 
-  const exportBillsFromDevice = async () => {
+  const exportBillsFromDevice = async (since = null) => {
     if (exportInProgress.value) {
       throw new Error('Export already in progress')
     }
 
+    // Client-paced pull; firmware without EXPORT_OPEN gets the pushed export below
+    const pulled = await pullExport('BILLS', since)
+    if (pulled) {
+      return { rows: parseBillsExportLines(pulled), watermark: parseWatermark(pulled, 'BILLS') }
+    }
+
     exportInProgress.value = true
     exportLines.value = []
     lastAck.value = null
@@ -38,10 +47,11 @@ export function useSyncBills() {
       }, 60000)
     })
 
-    await sendLine('EXPORT_BILLS')
+    // With a watermark only rows changed since then are exported
+    await sendLine(since === null ? 'EXPORT_BILLS' : `EXPORT_BILLS|since=${since}`)
 
     const lines = await promise
-    return parseBillsExportLines(lines)
+    return { rows: parseBillsExportLines(lines), watermark: parseWatermark(lines, 'BILLS') }
   }
 
   const finishExport = (error, lines = null) => {
@@ -63,65 +73,44 @@ export function useSyncBills() {
     exportReject.value = null
   }
 
-  const parseBillsExportLines = (lines) => {
-    const bills = []
-    let chunkBuffer = ''
-    for (const line of lines) {
-      if (line.startsWith('BILLS_CHUNK|')) {
-        const parts = line.split('|', 3)
-        if (parts.length >= 3) {
-          chunkBuffer = parts[2] || ''
-        }
-        continue
-      }
-
-      if (chunkBuffer) {
-        if (line.startsWith('Heap free') || line === 'END_BILLS_JSON' || line === 'BEGIN_BILLS_JSON') {
-          // skip meta
-        } else {
-          chunkBuffer += String(line).trim()
-        }
-      }
-
-      if (chunkBuffer) {
-        try {
-          const chunkBills = JSON.parse(chunkBuffer)
-          for (const bill of chunkBills) {
-            bills.push({
-              bill_id: Number(bill.bill_id || 0),
-              reference_number: bill.reference_number || '',
-              customer_id: Number(bill.customer_id || 0),
-              reading_id: Number(bill.reading_id || 0),
-              device_uid: bill.device_uid || '',
-              bill_date: bill.bill_date || '',
-              rate_per_m3: Number(bill.rate_per_m3 || 0),
-              charges: Number(bill.charges || 0),
-              penalty: Number(bill.penalty || 0),
-              total_due: Number(bill.total_due || 0),
-              status: bill.status || 'pending',
-            })
-          }
-          chunkBuffer = '' // Clear after successful parse
-        } catch (e) {
-          // Not complete yet, continue accumulating
-        }
-      }
-    }
-    return bills
+  const toBill = (bill) => ({
+    bill_id: Number(bill.bill_id || 0),
+    reference_number: bill.reference_number || '',
+    customer_id: Number(bill.customer_id || 0),
+    reading_id: Number(bill.reading_id || 0),
+    device_uid: bill.device_uid || '',
+    bill_date: bill.bill_date || '',
+    due_date: bill.due_date || null,
+    rate_per_m3: Number(bill.rate_per_m3 || 0),
+    charges: Number(bill.charges || 0),
+    penalty: Number(bill.penalty || 0),
+    total_due: Number(bill.total_due || 0),
+    status: bill.status || 'pending',
+  })
+
+  const parseBillsExportLines = (rawLines) => {
+    const stats = parseExportStats(rawLines, 'BILLS')
+    if (stats) console.log('Bills export stats:', stats)
+
+    const columnar = decodeColumnarExport(rawLines, 'BILLS')
+    if (columnar) return columnar.map(toBill)
+
+    const lines = inflateChunkLines(rawLines, 'BILLS_CHUNK|')
+    return parseJsonChunks(lines, 'BILLS_CHUNK|').map(toBill)
   }
 
-  const syncBillsFromDevice = async () => {
-    const deviceBills = await exportBillsFromDevice()
+  const syncBillsFromDevice = async (since = null, owner = {}) => {
+    const { rows: deviceBills, watermark } = await exportBillsFromDevice(since)
 
     if (deviceBills.length === 0) {
-      return
+      return { processed: 0, watermark }
     }
 
     console.log('Bills exported from device:', deviceBills)
 
-    const processed = await databaseService.upsertBillsToDatabase(deviceBills)
+    const processed = await databaseService.upsertBillsToDatabase(deviceBills, owner)
     console.log('Bills synced to database, processed:', processed)
-    return processed
+    return { processed, watermark }
   }
 
   const handleDeviceLine = (line) => {
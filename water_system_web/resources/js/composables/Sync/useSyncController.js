@@ -11,6 +11,24 @@ export function useSyncController() {
   const showCommandSuccess = ref(false)
   const commandSuccessMessage = ref('')
 
+  // Resolves with the first line starting with one of `prefixes`, or null
+  // after timeoutMs. Listening starts before the command goes out.
+  const waitForDeviceLine = (prefixes, timeoutMs) => {
+    return new Promise((resolve) => {
+      let timer = null
+      const unlisten = serialService.onLine((line) => {
+        if (!prefixes.some((p) => line.startsWith(p))) return
+        clearTimeout(timer)
+        unlisten()
+        resolve(line)
+      })
+      timer = setTimeout(() => {
+        unlisten()
+        resolve(null)
+      }, timeoutMs)
+    })
+  }
+
   const sendCommand = async (command, addLog) => {
     const st = serialService.getState()
     if (!st.writer) {
@@ -47,10 +65,12 @@ export function useSyncController() {
     isFormatting.value = true
     try {
       addLog('Formatting SD card...')
+      const ackPromise = waitForDeviceLine(['Database reinitialized after format', 'ERR|FORMAT_FAILED'], 30000)
       await sendLineDevice('FORMAT_SD')
 
-      // Wait for acknowledgment
-      await new Promise(resolve => setTimeout(resolve, 2000))
+      const ack = await ackPromise
+      if (!ack) throw new Error('No response from device')
+      if (ack.startsWith('ERR|')) throw new Error('Device error: ' + ack)
 
       commandSuccessMessage.value = 'SD card has been formatted successfully. The device will reinitialize the file system.'
       showCommandSuccess.value = true
@@ -74,10 +94,9 @@ export function useSyncController() {
     isRestarting.value = true
     try {
       addLog('Restarting device...')
+      const ackPromise = waitForDeviceLine(['ACK|RESTART_DEVICE'], 1000)
       await sendLineDevice('RESTART_DEVICE')
-
-      // Wait a moment for the command to be sent
-      await new Promise(resolve => setTimeout(resolve, 500))
+      await ackPromise
 
       commandSuccessMessage.value = 'Device restart command sent. The device will restart momentarily.'
       showCommandSuccess.value = true
@@ -104,10 +123,12 @@ export function useSyncController() {
 
     try {
       addLog('Dropping database...')
+      const ackPromise = waitForDeviceLine(['Database reinitialized after drop', 'ERR|DROP_DB_FAILED'], 10000)
       await sendLineDevice('DROP_DB')
 
-      // Wait for acknowledgment
-      await new Promise(resolve => setTimeout(resolve, 2000))
+      const ack = await ackPromise
+      if (!ack) throw new Error('No response from device')
+      if (ack.startsWith('ERR|')) throw new Error('Device error: ' + ack)
 
       commandSuccessMessage.value = 'Database has been dropped and reinitialized successfully.'
       showCommandSuccess.value = true
@@ -1,4 +1,5 @@
 import { serialService } from '../../services/serialService'
+import { useSyncReferenceBatch } from './useSyncReferenceBatch'
 
 export function useSyncCustomerTypes() {
   const sendLine = async (line) => {
@@ -13,12 +14,49 @@ export function useSyncCustomerTypes() {
       .trim()
   }
 
+  const { pushReferenceRows } = useSyncReferenceBatch()
+
+  const epochOf = (value) => (value ? Math.floor(new Date(value).getTime() / 1000) : 0)
+
+  // Every tier of every type in one stream; the device replaces its whole
+  // tariff_tiers table with it. Firmware without tiers keeps the flat rate.
+  const pushTariffTiers = async (dbCustomerTypes) => {
+    const rows = dbCustomerTypes.flatMap((ct) =>
+      (ct.tiers || []).map((tier) => ({
+        tier_id: Number(tier.tier_id),
+        type_id: Number(ct.id || ct.type_id || 1),
+        from_m3: Number(tier.from_m3 || 0),
+        rate_per_m3: Number(tier.rate_per_m3 || 0),
+        created_at: epochOf(tier.created_at),
+        updated_at: epochOf(tier.updated_at)
+      }))
+    )
+    await pushReferenceRows('TARIFF_TIERS', rows, { wholeTable: true })
+  }
+
   const pushCustomerTypesToDevice = async (dbCustomerTypes) => {
-    // Send each upsert line-by-line (adds new customer types, updates existing ones)
+    // One transaction per batch on current firmware
+    const rows = dbCustomerTypes.map((ct) => ({
+      type_id: Number(ct.id || ct.type_id || 1),
+      type_name: String(ct.type_name || ct.name || '').trim(),
+      rate_per_m3: Number(ct.rate_per_m3 || 0),
+      min_m3: Number(ct.min_m3 || 0),
+      min_charge: Number(ct.min_charge || 0),
+      penalty: Number(ct.penalty || 0),
+      max_m3: Number(ct.max_m3 || 0),
+      created_at: epochOf(ct.created_at),
+      updated_at: epochOf(ct.updated_at)
+    }))
+    if (await pushReferenceRows('CUSTOMER_TYPES', rows)) {
+      await pushTariffTiers(dbCustomerTypes)
+      return
+    }
+
+    // Older firmware: one upsert line per row (adds new customer types, updates existing ones)
     for (let i = 0; i < dbCustomerTypes.length; i++) {
       const ct = dbCustomerTypes[i]
-      const createdAt = ct.created_at ? Math.floor(new Date(ct.created_at).getTime() / 1000) : 0
-      const updatedAt = ct.updated_at ? Math.floor(new Date(ct.updated_at).getTime() / 1000) : 0
+      const createdAt = epochOf(ct.created_at)
+      const updatedAt = epochOf(ct.updated_at)
       const line = [
         'UPSERT_CUSTOMER_TYPE',
         String(Number(ct.id || ct.type_id || 1)),
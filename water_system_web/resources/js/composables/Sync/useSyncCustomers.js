@@ -1,56 +1,132 @@
 import { ref } from 'vue'
 import { serialService } from '../../services/serialService'
+import { syncCodec, customerDigestHash, digestHex, fnv64 } from '../../services/syncCodec'
 
 export function useSyncCustomers() {
-  const chunkAckPromise = ref(null)
-  const chunkAckResolve = ref(null)
-  const chunkAckReject = ref(null)
-  const expectedChunkAck = ref(null)
-  const chunkAckTimeoutId = ref(null)
+  // Sliding-window import: up to WINDOW_SIZE chunks are in flight so the
+  // device always has the next chunk buffered while it commits the current one.
+  const WINDOW_SIZE = 4
+  const CHUNK_SIZE = 45
+  const CHUNK_TIMEOUT_MS = 15000
+  const MAX_ATTEMPTS = 3
+
+  // Roster digest: mismatched ranges are split into DIGEST_BUCKETS until the
+  // device holds at most DIGEST_LEAF_ROWS customers in them, then keys are listed.
+  const DIGEST_BUCKETS = 16
+  const DIGEST_LEAF_ROWS = 48
+  const DIGEST_TIMEOUT_MS = 15000
+
+  const activeTransfer = ref(null)
+
+  // Sync session: chunks the device already applied (from RESUME) are
+  // skipped when their payload hash still matches.
+  const SESSION_STORAGE_PREFIX = 'syncSession:'
+  const syncSession = { id: null, storageKey: null, applied: new Map() }
 
   const sendLine = async (line) => {
     const text = String(line).replace(/\r|\n/g, '')
     await serialService.sendLine(text)
   }
 
-  const sendCustomerChunks = async (type, customers) => {
-    // Send customers in chunks sequentially, waiting for ACK each time.
-    // Register the ACK waiter BEFORE sending to avoid ACK arriving
-    // while the promise hasn't been hooked (race condition).
-    // Implement retries in case ACKs are lost or the web serial write fails.
-    const chunkSize = 45
-    const totalChunks = Math.ceil(customers.length / chunkSize)
-    const maxRetries = 3
-    for (let i = 0; i < customers.length; i += chunkSize) {
-      const chunk = customers.slice(i, i + chunkSize)
-      const customersJson = JSON.stringify(chunk).replace(/\|/g, '\\|')
-      const chunkIndex = Math.floor(i / chunkSize)
-      const line = `UPSERT_${type}_CUSTOMER_JSON_CHUNK|${chunkIndex}|${totalChunks}|${customersJson}`
-
-      let attempt = 0
-      while (attempt < maxRetries) {
-        attempt++
-        try {
-          // Create the ACK promise first so the line handler can resolve it
-          const ackPromise = waitForChunkAck(chunkIndex, totalChunks)
-          await sendLine(line)
-          // Wait for ACK (or timeout inside waitForChunkAck)
-          await ackPromise
-          // Success
-          break
-        } catch (error) {
-          console.error(`Chunk ${chunkIndex} for ${type} attempt ${attempt} failed:`, error)
-          if (attempt >= maxRetries) {
-            throw new Error(`Failed to send chunk ${chunkIndex} for ${type} after ${maxRetries} attempts`)
+  const sendCustomerChunks = (type, customers) => {
+    // The device answers every committed chunk with ACK|CHUNK|<i>|<next_expected>
+    // (selective + cumulative) and every failed one with NAK|CHUNK|<i>|<reason>.
+    // Only chunks that were NAKed, timed out, or overtaken by a later ACK are resent.
+    const totalChunks = Math.ceil(customers.length / CHUNK_SIZE)
+    if (totalChunks === 0) return Promise.resolve()
+
+    const chunks = []
+    for (let i = 0; i < customers.length; i += CHUNK_SIZE) {
+      const json = JSON.stringify(customers.slice(i, i + CHUNK_SIZE))
+      const encoded = syncCodec.encodePayloadText(json)
+      const customersJson = encoded ?? json.replace(/\|/g, '\\|')
+      const chunkIndex = Math.floor(i / CHUNK_SIZE)
+      // The device hashes the payload after unescaping pipes
+      const hash = digestHex(fnv64(new TextEncoder().encode(encoded ?? json)))
+      chunks.push({
+        line: `UPSERT_${type}_CUSTOMER_JSON_CHUNK|${chunkIndex}|${totalChunks}|${customersJson}`,
+        acked: syncSession.applied.get(`${type}_CUSTOMER|${chunkIndex}|${totalChunks}`) === hash,
+        inFlight: false,
+        sentAt: 0,
+        seq: 0,
+        attempts: 0
+      })
+    }
+
+    return new Promise((resolve, reject) => {
+      let base = 0
+      let sendSeq = 0
+      let finished = false
+      let timer = null
+
+      const finish = (error) => {
+        if (finished) return
+        finished = true
+        clearInterval(timer)
+        activeTransfer.value = null
+        if (error) reject(error)
+        else resolve()
+      }
+
+      const transmit = (index) => {
+        const chunk = chunks[index]
+        if (chunk.attempts >= MAX_ATTEMPTS) {
+          finish(new Error(`Failed to send chunk ${index} for ${type} after ${MAX_ATTEMPTS} attempts`))
+          return
+        }
+        chunk.attempts++
+        chunk.inFlight = true
+        chunk.sentAt = Date.now()
+        chunk.seq = ++sendSeq
+        sendLine(chunk.line).catch((error) => {
+          console.error(`Chunk ${index} for ${type} attempt ${chunk.attempts} failed:`, error)
+          chunk.inFlight = false
+        })
+      }
+
+      const pump = () => {
+        if (finished) return
+        while (base < totalChunks && chunks[base].acked) base++
+        if (base >= totalChunks) {
+          finish()
+          return
+        }
+        const now = Date.now()
+        const windowEnd = Math.min(base + WINDOW_SIZE, totalChunks)
+        for (let i = base; i < windowEnd && !finished; i++) {
+          const chunk = chunks[i]
+          if (chunk.acked) continue
+          if (!chunk.inFlight || now - chunk.sentAt > CHUNK_TIMEOUT_MS) transmit(i)
+        }
+      }
+
+      activeTransfer.value = {
+        onAck(index, nextExpected) {
+          if (chunks[index]) chunks[index].acked = true
+          for (let i = 0; i < Math.min(nextExpected, totalChunks); i++) chunks[i].acked = true
+          // The device handles lines in order, so anything sent before the
+          // acknowledged chunk and still unacknowledged never arrived intact.
+          const ackedSeq = chunks[index] ? chunks[index].seq : 0
+          for (const chunk of chunks) {
+            if (!chunk.acked && chunk.inFlight && chunk.seq < ackedSeq) chunk.inFlight = false
+          }
+          pump()
+        },
+        onNak(index, reason) {
+          console.warn(`Device rejected chunk ${index} for ${type}: ${reason}`)
+          // The same line would be dropped again, so resending cannot help
+          if (reason === 'LINE_TOO_LONG') {
+            finish(new Error(`Chunk ${index} for ${type} is longer than the device line buffer`))
+            return
           }
-          // Backoff before retry
-          await new Promise(resolve => setTimeout(resolve, 500 * attempt))
+          if (chunks[index]) chunks[index].inFlight = false
+          pump()
         }
       }
 
-      // Small pause to let device finalize processing before next chunk
-      await new Promise(resolve => setTimeout(resolve, 200))
-    }
+      timer = setInterval(pump, 1000)
+      pump()
+    })
   }
 
   const pushCustomersToDevice = async (newCustomers, updatedCustomers) => {
@@ -64,59 +140,186 @@ export function useSyncCustomers() {
     }
   }
 
-  const waitForChunkAck = (chunkIndex, totalChunks) => {
+  // Sends a command and collects reply lines until isEnd(line) matches
+  const requestDeviceLines = (command, isEnd, timeoutMs = DIGEST_TIMEOUT_MS) => {
     return new Promise((resolve, reject) => {
-      chunkAckResolve.value = resolve
-      chunkAckReject.value = reject
-      expectedChunkAck.value = chunkIndex
-      // Timeout after 30 seconds
-      if (chunkAckTimeoutId.value) {
-        clearTimeout(chunkAckTimeoutId.value)
-        chunkAckTimeoutId.value = null
+      const lines = []
+      let timer = null
+      let unlisten = null
+      const done = (error, last) => {
+        clearTimeout(timer)
+        if (unlisten) unlisten()
+        if (error) reject(error)
+        else resolve({ lines, last })
       }
-      chunkAckTimeoutId.value = setTimeout(() => {
-        if (chunkAckResolve.value) {
-          chunkAckResolve.value = null
-          chunkAckReject.value = null
-          expectedChunkAck.value = null
-          chunkAckTimeoutId.value = null
-          reject(new Error('Timeout waiting for chunk ACK'))
-        }
-      }, 30000)
+      unlisten = serialService.onLine((raw) => {
+        const line = String(raw).trim()
+        if (isEnd(line)) done(null, line)
+        else if (line.startsWith('UNKNOWN_COMMAND')) done(new Error('Device does not support ' + command.split('|')[0]))
+        else lines.push(line)
+      })
+      timer = setTimeout(() => done(new Error('Timed out waiting for reply to ' + command.split('|')[0])), timeoutMs)
+      sendLine(command).catch((error) => done(error))
     })
   }
 
-  const handleChunkAck = (line) => {
-    // Handle chunk ACKs: only resolve if ACK matches expected chunk index
-    if (line.startsWith('ACK|CHUNK|') || line.startsWith('ACK|UPSERT_NEW_CUSTOMER_JSON|') || line.startsWith('ACK|UPSERT_UPDATED_CUSTOMER_JSON|') || line.startsWith('ACK|UPSERT_CUSTOMERS_JSON|')) {
-      try {
-        let ackIndex = null
-        if (line.startsWith('ACK|CHUNK|')) {
+  // Compares the server roster with the device through DIGEST range hashes
+  // and returns only what differs: customers missing on the device, customers
+  // whose fields changed, and account numbers the server no longer has.
+  const reconcileCustomersWithDevice = async (dbCustomers, brgyId) => {
+    // Sorted like the device's account_no index (code-unit order matches
+    // SQLite's byte order for the ASCII account numbers used here)
+    const roster = dbCustomers
+      .filter(c => c.account_no)
+      .map(c => ({ customer: c, key: String(c.account_no), hash: customerDigestHash(c) }))
+      .sort((a, b) => (a.key < b.key ? -1 : a.key > b.key ? 1 : 0))
+
+    const lowerBound = (key) => {
+      let lo = 0
+      let hi = roster.length
+      while (lo < hi) {
+        const mid = (lo + hi) >> 1
+        if (roster[mid].key < key) lo = mid + 1
+        else hi = mid
+      }
+      return lo
+    }
+    const rowsIn = (lo, hi) => roster.slice(lowerBound(lo), hi === '' ? roster.length : lowerBound(hi))
+    const rangeArgs = (lo, hi) => `lo=${lo},hi=${hi}` + (brgyId ? `,brgy=${brgyId}` : '')
+    const isReplyEnd = (endLine) => (line) => line === endLine || line.startsWith('ERR|')
+
+    const result = { missing: [], changed: [], extra: [], requests: 0 }
+    const queue = [{ lo: '', hi: '', deviceCount: null }]
+
+    while (queue.length > 0) {
+      const { lo, hi, deviceCount } = queue.shift()
+      const local = rowsIn(lo, hi)
+
+      if (deviceCount === 0) {
+        result.missing.push(...local.map(r => r.customer))
+        continue
+      }
+
+      if (deviceCount !== null && deviceCount <= DIGEST_LEAF_ROWS) {
+        result.requests++
+        const { lines, last } = await requestDeviceLines(`DIGEST_KEYS|${rangeArgs(lo, hi)}`, isReplyEnd('END_DIGEST_KEYS'))
+        if (last !== 'END_DIGEST_KEYS') throw new Error('Device digest failed: ' + last)
+        const deviceKeys = new Map()
+        for (const line of lines) {
+          if (!line.startsWith('DIGEST_KEY|')) continue
           const parts = line.split('|')
-          ackIndex = Number(parts[2])
-        } else if (line.startsWith('ACK|UPSERT_NEW_CUSTOMER_JSON|') || line.startsWith('ACK|UPSERT_UPDATED_CUSTOMER_JSON|') || line.startsWith('ACK|UPSERT_CUSTOMERS_JSON|')) {
-          // final ACK may include count; treat as last chunk acknowledge
-          ackIndex = expectedChunkAck.value // allow final ack to resolve current waiter
+          deviceKeys.set(parts[1], parts[2])
+        }
+        for (const row of local) {
+          const deviceHash = deviceKeys.get(row.key)
+          if (deviceHash === undefined) result.missing.push(row.customer)
+          else if (deviceHash !== digestHex(row.hash)) result.changed.push(row.customer)
+          deviceKeys.delete(row.key)
         }
+        result.extra.push(...deviceKeys.keys())
+        continue
+      }
+
+      result.requests++
+      const { lines, last } = await requestDeviceLines(`DIGEST|${rangeArgs(lo, hi)},buckets=${DIGEST_BUCKETS}`, isReplyEnd('END_DIGEST'))
+      if (last !== 'END_DIGEST') throw new Error('Device digest failed: ' + last)
+      for (const line of lines) {
+        if (!line.startsWith('DIGEST_RANGE|')) continue
+        const [, rangeLo, rangeHi, count, hash] = line.split('|')
+        const rows = rowsIn(rangeLo, rangeHi)
+        const localHash = rows.reduce((h, r) => h ^ r.hash, 0n)
+        if (Number(count) === rows.length && hash === digestHex(localHash)) continue
+        queue.push({ lo: rangeLo, hi: rangeHi, deviceCount: Number(count) })
+      }
+    }
+
+    return result
+  }
+
+  // Starts a sync session on the device, resuming the last unfinished one
+  // for this device when the device still has its ledger. Returns null when
+  // the firmware has no session support.
+  const beginSyncSession = async (deviceUid) => {
+    syncSession.id = null
+    syncSession.applied = new Map()
+    syncSession.storageKey = SESSION_STORAGE_PREFIX + (deviceUid || 'device')
 
-        if (chunkAckResolve.value && (expectedChunkAck.value === null || ackIndex === expectedChunkAck.value)) {
-          chunkAckResolve.value(line)
-          chunkAckResolve.value = null
-          chunkAckReject.value = null
-          expectedChunkAck.value = null
-          if (chunkAckTimeoutId.value) {
-            clearTimeout(chunkAckTimeoutId.value)
-            chunkAckTimeoutId.value = null
+    const isSessionReply = (prefix) => (line) => line.startsWith(prefix) || line.startsWith('ERR|')
+    try {
+      const stored = window.localStorage.getItem(syncSession.storageKey)
+      if (stored) {
+        const { lines, last } = await requestDeviceLines(`RESUME|${stored}`, isSessionReply('ACK|RESUME|'))
+        if (last.startsWith('ACK|RESUME|')) {
+          for (const line of lines) {
+            if (!line.startsWith('RESUME_CHUNK|')) continue
+            const [, stream, index, total, hash] = line.split('|')
+            syncSession.applied.set(`${stream}|${index}|${total}`, hash)
           }
+          syncSession.id = stored
+          return { id: stored, resumed: true, appliedChunks: syncSession.applied.size }
         }
-      } catch (e) {
-        console.error('Error handling ACK line:', e)
       }
+
+      const id = Date.now().toString(36) + Math.random().toString(36).slice(2, 8)
+      const { last } = await requestDeviceLines(`SYNC_SESSION|${id}`, isSessionReply('ACK|SYNC_SESSION|'))
+      if (!last.startsWith('ACK|')) return null
+      window.localStorage.setItem(syncSession.storageKey, id)
+      syncSession.id = id
+      return { id, resumed: false, appliedChunks: 0 }
+    } catch (error) {
+      console.warn('Sync sessions unavailable:', error)
+      return null
+    }
+  }
+
+  // Called after a successful sync; the device drops the ledger
+  const endSyncSession = async () => {
+    if (!syncSession.id) return
+    try {
+      await requestDeviceLines(`SYNC_SESSION_END|${syncSession.id}`, (line) => line.startsWith('ACK|SYNC_SESSION_END|') || line.startsWith('ERR|'))
+    } catch (error) {
+      console.warn('Failed to end sync session:', error)
+    }
+    window.localStorage.removeItem(syncSession.storageKey)
+    syncSession.id = null
+    syncSession.applied = new Map()
+  }
+
+  // Removes customers the server no longer has; ones with readings or bills
+  // on the device are kept. Returns the number removed.
+  const removeCustomersFromDevice = async (accountNumbers) => {
+    let removed = 0
+    for (const accountNo of accountNumbers) {
+      const { last } = await requestDeviceLines(
+        `REMOVE_CUSTOMER|${accountNo}`,
+        (line) => line.startsWith('ACK|REMOVE_CUSTOMER|') || line.startsWith('ERR|')
+      )
+      if (last.startsWith('ACK|')) removed++
+      else console.warn(`Customer ${accountNo} not removed from device: ${last}`)
+    }
+    return removed
+  }
+
+  const handleChunkAck = (line) => {
+    const transfer = activeTransfer.value
+    if (!transfer) return
+
+    if (line.startsWith('ACK|CHUNK|')) {
+      const parts = line.split('|')
+      // Older firmware omits next_expected; treat that as a selective ACK only
+      transfer.onAck(Number(parts[2]), Number(parts[3] || 0))
+    } else if (line.startsWith('NAK|CHUNK|')) {
+      const parts = line.split('|')
+      transfer.onNak(Number(parts[2]), parts[3] || '')
     }
   }
 
   return {
     pushCustomersToDevice,
+    reconcileCustomersWithDevice,
+    removeCustomersFromDevice,
+    beginSyncSession,
+    endSyncSession,
     handleChunkAck
   }
-}
\ No newline at end of file
+}
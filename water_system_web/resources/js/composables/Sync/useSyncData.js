@@ -1,15 +1,22 @@
 import { ref, computed } from 'vue'
 import { serialService } from '../../services/serialService'
 import { databaseService } from '../../services/databaseService'
+import { syncCodec } from '../../services/syncCodec'
+import { useSyncTableDigests } from './useSyncTableDigests'
+import { useSyncIdLeases } from './useSyncIdLeases'
 
 export function useSyncData() {
   const isSyncing = ref(false)
   const syncStartTime = ref(null)
   const syncLogs = ref([])
+  const lastSyncReport = ref(null)
+  const { fetchTableDigests, serverSignature, loadBaseline, saveBaseline } = useSyncTableDigests()
+  const { refreshIdLeases } = useSyncIdLeases()
 
   const isJsonLog = (message) => {
     if (!message.startsWith('Device ← ')) return false
     const dataPart = message.substring(10).trim()
+    if (dataPart.startsWith('STAT|')) return true
     return dataPart.includes('"bill_id"') || dataPart.includes('"reading_id"') || dataPart.includes('"customer_id"')
   }
 
@@ -23,6 +30,7 @@ export function useSyncData() {
   }
 
   const formatElapsedTime = (ms) => {
+    if (ms < 1000) return `${ms} ms`
     const seconds = Math.floor(ms / 1000)
     const minutes = Math.floor(seconds / 60)
     const remainingSeconds = seconds % 60
@@ -33,6 +41,130 @@ export function useSyncData() {
     }
   }
 
+  // Sends a command and waits for the line that confirms it (or the timeout)
+  const sendAndWaitFor = (command, reply, timeoutMs) => {
+    return new Promise((resolve) => {
+      let timer = null
+      const unlisten = serialService.onLine((line) => {
+        if (line !== reply && !line.startsWith('ERR|')) return
+        clearTimeout(timer)
+        unlisten()
+        resolve(line)
+      })
+      timer = setTimeout(() => {
+        unlisten()
+        resolve(null)
+      }, timeoutMs)
+      serialService.sendLine(command).catch(() => {
+        clearTimeout(timer)
+        unlisten()
+        resolve(null)
+      })
+    })
+  }
+
+  // Sends a transfer option and resolves with the device's ACK line, or null
+  // when the firmware rejects it or predates the command.
+  const negotiateDeviceOption = (command, ackPrefix, timeoutMs = 2000) => {
+    return new Promise((resolve) => {
+      let timer = null
+      let unlisten = null
+      const done = (result) => {
+        clearTimeout(timer)
+        if (unlisten) unlisten()
+        resolve(result)
+      }
+      unlisten = serialService.onLine((line) => {
+        if (line.startsWith(ackPrefix)) done(line)
+        else if (line.startsWith('ERR|UNKNOWN_') || line.startsWith('UNKNOWN_COMMAND:')) done(null)
+      })
+      timer = setTimeout(() => done(null), timeoutMs)
+      serialService.sendLine(command).catch(() => done(null))
+    })
+  }
+
+  // RECEIPT_TEMPLATE|{"source":...} -> the device's ACK or ERR line, or null
+  // from firmware without receipt templates
+  const pushReceiptTemplate = (source, timeoutMs = 5000) => {
+    return new Promise((resolve) => {
+      let timer = null
+      let unlisten = null
+      const done = (result) => {
+        clearTimeout(timer)
+        if (unlisten) unlisten()
+        resolve(result)
+      }
+      unlisten = serialService.onLine((line) => {
+        if (line.startsWith('ACK|RECEIPT_TEMPLATE|') || line.startsWith('ERR|RECEIPT_TEMPLATE|')) done(line)
+        else if (line.startsWith('ERR|UNKNOWN_') || line.startsWith('UNKNOWN_COMMAND:')) done(null)
+      })
+      timer = setTimeout(() => done(null), timeoutMs)
+      serialService.sendLine('RECEIPT_TEMPLATE|' + JSON.stringify({ source })).catch(() => done(null))
+    })
+  }
+
+  // Wall-clock time of each client phase, merged with the device's
+  // SYNC_REPORT at the end of the run
+  const clientPhases = []
+  const timePhase = async (name, fn) => {
+    const started = performance.now()
+    try {
+      return await fn()
+    } finally {
+      clientPhases.push({ phase: name, ms: Math.round(performance.now() - started) })
+    }
+  }
+
+  // SYNC_REPORT -> [{ phase, calls, rows, bytes, parseMs, sqlMs, commitMs, txMs, heapMin, blockMin }],
+  // or null when the firmware has no telemetry
+  const fetchSyncReport = (timeoutMs = 3000) => {
+    return new Promise((resolve) => {
+      const phases = []
+      let timer = null
+      let unlisten = null
+      const done = (result) => {
+        clearTimeout(timer)
+        if (unlisten) unlisten()
+        resolve(result)
+      }
+      const ms = (us) => Math.round(Number(us) / 100) / 10
+      unlisten = serialService.onLine((line) => {
+        if (line.startsWith('REPORT|')) {
+          const [, phase, calls, rows, bytes, parseUs, sqlUs, commitUs, txUs, heapMin, blockMin] = line.split('|')
+          phases.push({
+            phase,
+            calls: Number(calls),
+            rows: Number(rows),
+            bytes: Number(bytes),
+            parseMs: ms(parseUs),
+            sqlMs: ms(sqlUs),
+            commitMs: ms(commitUs),
+            txMs: ms(txUs),
+            heapMin: Number(heapMin),
+            blockMin: Number(blockMin)
+          })
+        } else if (line === 'END_SYNC_REPORT') {
+          done(phases)
+        } else if (line.startsWith('UNKNOWN_COMMAND:')) {
+          done(null)
+        }
+      })
+      timer = setTimeout(() => done(null), timeoutMs)
+      serialService.sendLine('SYNC_REPORT').catch(() => done(null))
+    })
+  }
+
+  const logSyncReport = (devicePhases) => {
+    lastSyncReport.value = { client: [...clientPhases], device: devicePhases || [] }
+    addLog('Phase timings: ' + clientPhases.map(p => `${p.phase} ${p.ms} ms`).join(', '))
+    if (!devicePhases) return
+    for (const p of devicePhases) {
+      addLog(`Device ${p.phase}: ${p.rows} rows in ${p.calls} calls, ${p.bytes} B, parse ${p.parseMs} ms, sql ${p.sqlMs} ms, commit ${p.commitMs} ms, tx ${p.txMs} ms, min heap ${p.heapMin}`)
+    }
+    console.table(clientPhases)
+    console.table(devicePhases)
+  }
+
   const separateCustomersBySyncStatus = (customers) => {
     const newCustomers = customers.filter(c => !c.Synced && c.last_sync === null)
     const updatedCustomers = customers.filter(c => !c.Synced && c.last_sync !== null)
@@ -49,6 +181,12 @@ export function useSyncData() {
     syncBillsFromDevice,
     syncBillTransactionsFromDevice,
     pushCustomersToDevice,
+    reconcileCustomersWithDevice,
+    removeCustomersFromDevice,
+    beginSyncSession,
+    endSyncSession,
+    negotiateBaudRate,
+    restoreDefaultBaudRate,
     refreshDeviceInfo,
     sendLineDevice,
     onSyncSuccess
@@ -61,19 +199,23 @@ export function useSyncData() {
 
     isSyncing.value = true
     syncStartTime.value = Date.now()
+    clientPhases.length = 0
+    lastSyncReport.value = null
+    syncCodec.setCompression(false)
 
     try {
       addLog('Starting customer sync...')
 
       // Get device info first to know which barangay this device belongs to
       addLog('Getting device information...')
-      const deviceInfo = await exportDeviceInfoFromDevice()
+      const deviceInfo = await timePhase('device info', () => exportDeviceInfoFromDevice())
       const deviceBrgyId = deviceInfo?.brgy_id || 1
       const deviceId = deviceInfo?.device_id || 1
       const lastSyncEpoch = deviceInfo?.last_sync_epoch || 0
       addLog(`Device ID: ${deviceId}, Barangay ID: ${deviceBrgyId}, Last Sync: ${lastSyncEpoch}`)
 
       // Sync device info to server immediately
+      let serverWatermarks = null
       try {
         console.log('Syncing device info to server:', deviceInfo)
         const serverDeviceInfo = {
@@ -87,13 +229,55 @@ export function useSyncData() {
           customer_count: deviceInfo.customer_count || 0,
         }
         console.log('Sending serverDeviceInfo:', serverDeviceInfo)
-        await databaseService.syncDeviceInfoToDatabase(serverDeviceInfo)
+        const deviceSyncResult = await databaseService.syncDeviceInfoToDatabase(serverDeviceInfo)
+        serverWatermarks = deviceSyncResult?.watermarks || null
         console.log('Device info synced successfully')
       } catch (error) {
         console.error('Failed to sync device info to server:', error)
         // Continue with sync even if device info sync fails
       }
 
+      // A table is skipped when the device digest and the server rows both
+      // match what the last successful sync of this database left behind
+      const deviceDbId = typeof deviceInfo?.db_id === 'number' ? deviceInfo.db_id : null
+      const tableDigests = await timePhase('table digests', () => fetchTableDigests())
+      const baseline = tableDigests ? loadBaseline(deviceInfo.device_uid, deviceDbId) : null
+      const serverState = {}
+      let changedPhases = 0
+      const deviceUnchanged = (table) => !!baseline && baseline.device[table] === tableDigests[table]
+      const phaseUnchanged = (table, rows, ignore = []) => {
+        serverState[table] = serverSignature(rows, ignore)
+        const unchanged = deviceUnchanged(table) && baseline.server[table] === serverState[table]
+        if (!unchanged) changedPhases++
+        return unchanged
+      }
+      const exportUnchanged = (table) => {
+        const unchanged = deviceUnchanged(table)
+        if (!unchanged) changedPhases++
+        return unchanged
+      }
+
+      // Raise the serial link speed when both ends can, but only once a bulk
+      // phase actually has something to move
+      let linkReady = false
+      const ensureFastLink = async () => {
+        if (linkReady || !negotiateBaudRate) return
+        linkReady = true
+        const link = await timePhase('link', () => negotiateBaudRate())
+        const rates = link.test
+          ? ` (${Math.round(link.test.downloadBytesPerSec / 1024)} KB/s down, ${Math.round(link.test.uploadBytesPerSec / 1024)} KB/s up)`
+          : ''
+        addLog(`Serial link: ${link.baudRate} baud${rates}`)
+      }
+
+      // Chunks applied before a dropped connection are skipped on resume
+      const session = beginSyncSession ? await beginSyncSession(deviceInfo.device_uid) : null
+      if (session?.resumed) {
+        addLog(`Resuming sync session ${session.id} (${session.appliedChunks} chunks already applied)`)
+      } else if (session) {
+        addLog(`Sync session ${session.id} started`)
+      }
+
       // Get customers from web database, filtered by barangay and updated after last sync
       addLog('Fetching customers from database...')
       let dbCustomers = await databaseService.fetchCustomersFromDatabase({ brgy_id: deviceBrgyId, updated_after: lastSyncEpoch })
@@ -107,43 +291,157 @@ export function useSyncData() {
       }
 
       // No need to filter further, API already filtered
-      const filteredDbCustomers = dbCustomers
+      let filteredDbCustomers = dbCustomers
 
       // Sync customer types from DB to device first (needed for customer references)
       addLog('Fetching customer types from database...')
       const dbCustomerTypes = await databaseService.fetchCustomerTypesFromDatabase()
       addLog(`Database has ${dbCustomerTypes.length} customer types`)
-      addLog(`Pushing ${dbCustomerTypes.length} customer types to ESP32...`)
-      await pushCustomerTypesToDevice(dbCustomerTypes)
-      addLog('✓ Customer types sync completed')
+      if (phaseUnchanged('customer_types', dbCustomerTypes)) {
+        addLog('Customer types unchanged, skipped')
+      } else {
+        addLog(`Pushing ${dbCustomerTypes.length} customer types to ESP32...`)
+        await timePhase('customer types', () => pushCustomerTypesToDevice(dbCustomerTypes))
+        addLog('✓ Customer types sync completed')
+      }
 
       // Sync deductions from DB to device
       addLog('Fetching deductions from database...')
       const dbDeductions = await databaseService.fetchDeductionsFromDatabase()
       addLog(`Database has ${dbDeductions.length} deductions`)
-      addLog(`Pushing ${dbDeductions.length} deductions to ESP32...`)
-      await pushDeductionsToDevice(dbDeductions)
-      addLog('✓ Deductions sync completed')
+      if (phaseUnchanged('deductions', dbDeductions)) {
+        addLog('Deductions unchanged, skipped')
+      } else {
+        addLog(`Pushing ${dbDeductions.length} deductions to ESP32...`)
+        await timePhase('deductions', () => pushDeductionsToDevice(dbDeductions))
+        addLog('✓ Deductions sync completed')
+      }
 
       // Sync barangays from DB to device
       addLog('Fetching barangays from database...')
       const dbBarangays = await databaseService.fetchBarangaysFromDatabase()
       addLog(`Database has ${dbBarangays.length} barangays`)
-      addLog(`Pushing ${dbBarangays.length} barangays to ESP32...`)
-      await pushBarangaysToDevice(dbBarangays)
-      addLog('✓ Barangays sync completed')
+      if (phaseUnchanged('barangay_sequence', dbBarangays)) {
+        addLog('Barangays unchanged, skipped')
+      } else {
+        addLog(`Pushing ${dbBarangays.length} barangays to ESP32...`)
+        await timePhase('barangays', () => pushBarangaysToDevice(dbBarangays))
+        addLog('✓ Barangays sync completed')
+      }
+
+      // Receipt layout from settings; an empty one puts the device back on its built-in receipt
+      const settings = await databaseService.fetchSettingsFromDatabase()
+      const templateReply = await timePhase('receipt_template', () => pushReceiptTemplate(settings.receipt_template || ''))
+      if (templateReply === null) {
+        addLog('Receipt template not supported by this firmware, skipped')
+      } else if (templateReply.startsWith('ERR|')) {
+        const [, , reason, line] = templateReply.split('|')
+        addLog(`⚠ Receipt template rejected: ${reason} at line ${line}`)
+      } else {
+        addLog(`✓ Receipt template set (${templateReply.split('|')[2]} bytes)`)
+      }
+
+      const exportTables = ['readings', 'bills', 'bill_transactions'].filter((table) => !exportUnchanged(table))
+      if (exportTables.length > 0) {
+        await ensureFastLink()
+        // Ask for the compact MessagePack export and LZ compression; older
+        // firmware keeps sending plain JSON, which the parsers still accept.
+        const formatAck = await negotiateDeviceOption('SET_EXPORT_FORMAT|MSGPACK', 'ACK|EXPORT_FORMAT|')
+        const compressionAck = await negotiateDeviceOption('SET_COMPRESSION|LZ', 'ACK|COMPRESSION|')
+        syncCodec.setCompression(compressionAck === 'ACK|COMPRESSION|LZ')
+        addLog(`Transfer encoding: ${formatAck ? 'MessagePack' : 'JSON'}${syncCodec.isCompressionEnabled() ? ' + LZ' : ''}`)
+      }
+
+      // Device -> DB exports only ask for rows changed since the server's
+      // watermark. A different db_id or a counter below the watermark means
+      // the device database was recreated, so start over from 0. Firmware
+      // without change tracking (no db_id) gets a full export.
+      const deviceChangeSeq = Number(deviceInfo?.change_seq ?? 0)
+      const sinceFor = (table) => {
+        if (deviceDbId === null) return null
+        if (!serverWatermarks || serverWatermarks.db_id !== deviceDbId) return 0
+        const mark = Number(serverWatermarks[table] || 0)
+        return mark > deviceChangeSeq ? 0 : mark
+      }
+      const saveWatermark = async (table, result) => {
+        if (deviceDbId === null || typeof result?.watermark !== 'number') return
+        try {
+          await databaseService.updateDeviceWatermarks(deviceInfo.device_uid, deviceDbId, { [table]: result.watermark })
+        } catch (error) {
+          // Next sync simply re-exports from the old watermark
+          console.error(`Failed to save ${table} watermark:`, error)
+        }
+      }
+
+      // Device keys are only kept on the server when they come from this
+      // device's own id lease blocks
+      const owner = { deviceMac: deviceInfo.device_uid, dbId: deviceDbId }
 
       // Sync readings (device -> DB)
-      await syncReadingsFromDevice()
+      if (exportTables.includes('readings')) {
+        await saveWatermark('readings', await timePhase('readings', () => syncReadingsFromDevice(sinceFor('readings'), owner)))
+      } else {
+        addLog('Readings unchanged on device, skipped')
+      }
 
       // Sync bills (device -> DB)
-      await syncBillsFromDevice()
+      if (exportTables.includes('bills')) {
+        await saveWatermark('bills', await timePhase('bills', () => syncBillsFromDevice(sinceFor('bills'), owner)))
+      } else {
+        addLog('Bills unchanged on device, skipped')
+      }
 
       // Sync bill transactions (device -> DB)
-      await syncBillTransactionsFromDevice()
+      if (exportTables.includes('bill_transactions')) {
+        await saveWatermark('bill_transactions', await timePhase('bill transactions', () => syncBillTransactionsFromDevice(sinceFor('bill_transactions'), owner)))
+      } else {
+        addLog('Bill transactions unchanged on device, skipped')
+      }
+
+      // Top up the key blocks new device rows are numbered from, now that
+      // the rows created with the old blocks are on the server
+      try {
+        await timePhase('id leases', () => refreshIdLeases(deviceInfo.device_uid, deviceDbId, addLog))
+      } catch (error) {
+        addLog('ID leases not refreshed: ' + (error?.message || String(error)))
+      }
 
       // Separate customers into new and updated
-      const { newCustomers, updatedCustomers } = separateCustomersBySyncStatus(filteredDbCustomers)
+      let { newCustomers, updatedCustomers } = separateCustomersBySyncStatus(filteredDbCustomers)
+
+      // Marking customers synced touches these without changing what the device gets
+      const rosterBookkeeping = ['Synced', 'last_sync', 'updated_at']
+      if (deviceInfo.customer_count === 0) {
+        phaseUnchanged('customers', dbCustomers, rosterBookkeeping)
+      }
+
+      // When the device already has a roster, compare range digests instead
+      // of trusting the last-sync filter; only differing customers are sent.
+      if (deviceInfo.customer_count > 0 && reconcileCustomersWithDevice) {
+        try {
+          const roster = await databaseService.fetchCustomersFromDatabase({ brgy_id: deviceBrgyId })
+          if (phaseUnchanged('customers', roster, rosterBookkeeping)) {
+            addLog('Customer roster unchanged, skipped')
+            newCustomers = []
+            updatedCustomers = []
+            filteredDbCustomers = []
+          } else if (roster.length > 0) {
+            addLog('Comparing customer roster with device...')
+            await ensureFastLink()
+            const digest = await timePhase('roster digest', () => reconcileCustomersWithDevice(roster, deviceBrgyId))
+            addLog(`Roster digest: ${digest.missing.length} missing, ${digest.changed.length} changed, ${digest.extra.length} removed on server (${digest.requests} requests)`)
+            newCustomers = digest.missing
+            updatedCustomers = digest.changed
+            filteredDbCustomers = roster.filter(c => !c.Synced)
+            if (digest.extra.length > 0 && removeCustomersFromDevice) {
+              const removed = await removeCustomersFromDevice(digest.extra)
+              addLog(`Removed ${removed} of ${digest.extra.length} customers from device`)
+            }
+          }
+        } catch (error) {
+          addLog('Roster digest unavailable, using last-sync filter: ' + (error?.message || String(error)))
+        }
+      }
 
       addLog(`New customers: ${newCustomers.length}, Updated customers: ${updatedCustomers.length}`)
 
@@ -154,7 +452,10 @@ export function useSyncData() {
       if (updatedCustomers.length > 0) {
         addLog(`Pushing ${updatedCustomers.length} updated customers to ESP32...`)
       }
-      await pushCustomersToDevice(newCustomers, updatedCustomers)
+      if (newCustomers.length > 0 || updatedCustomers.length > 0) {
+        await ensureFastLink()
+        await timePhase('customers', () => pushCustomersToDevice(newCustomers, updatedCustomers))
+      }
       addLog(`Sent ${newCustomers.length} new customers and ${updatedCustomers.length} updated customers to device`)
       addLog('✓ Customer sync completed')
 
@@ -171,13 +472,21 @@ export function useSyncData() {
       const epochNow = Math.floor(Date.now() / 1000)
       await sendLineDevice('SET_LAST_SYNC|' + String(epochNow))
 
-      await refreshDeviceInfo()
+      // Totals cover the session, so ask before it ends
+      logSyncReport(await fetchSyncReport())
+      if (endSyncSession) await endSyncSession()
+
+      // What this run left on the device is the baseline for the next one
+      if (tableDigests) {
+        const finalDigests = await timePhase('table digests', () => fetchTableDigests())
+        if (finalDigests) saveBaseline(deviceInfo.device_uid, deviceDbId, finalDigests, serverState)
+      }
 
       // Reload SD card to apply new settings
-      addLog('Reloading SD card on ESP32...')
-      await sendLineDevice('RELOAD_SD')
-      // Wait a moment for reload
-      await new Promise(r => setTimeout(r, 1000))
+      if (changedPhases > 0) {
+        addLog('Reloading SD card on ESP32...')
+        await sendAndWaitFor('RELOAD_SD', 'SD reloaded successfully', 5000)
+      }
       await refreshDeviceInfo()
 
       // Show success dialog
@@ -189,6 +498,9 @@ export function useSyncData() {
     } catch (error) {
       addLog('Sync failed: ' + (error?.message || String(error)))
     } finally {
+      if (restoreDefaultBaudRate) {
+        await restoreDefaultBaudRate().catch(() => {})
+      }
       isSyncing.value = false
       syncStartTime.value = null
     }
@@ -198,6 +510,7 @@ export function useSyncData() {
     isSyncing,
     syncLogs,
     filteredSyncLogs,
+    lastSyncReport,
     syncData,
     addLog,
     formatElapsedTime
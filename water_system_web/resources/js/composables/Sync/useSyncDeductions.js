@@ -1,4 +1,5 @@
 import { serialService } from '../../services/serialService'
+import { useSyncReferenceBatch } from './useSyncReferenceBatch'
 
 export function useSyncDeductions() {
   const sendLine = async (line) => {
@@ -13,12 +14,27 @@ export function useSyncDeductions() {
       .trim()
   }
 
+  const { pushReferenceRows } = useSyncReferenceBatch()
+
+  const epochOf = (value) => (value ? Math.floor(new Date(value).getTime() / 1000) : 0)
+
   const pushDeductionsToDevice = async (dbDeductions) => {
-    // Send each upsert line-by-line (adds new deductions, updates existing ones)
+    // One transaction per batch on current firmware
+    const rows = dbDeductions.map((d) => ({
+      deduction_id: Number(d.id || d.deduction_id || 1),
+      name: String(d.name || '').trim(),
+      type: String(d.type || '').trim(),
+      value: Number(d.value || 0),
+      created_at: epochOf(d.created_at),
+      updated_at: epochOf(d.updated_at)
+    }))
+    if (await pushReferenceRows('DEDUCTIONS', rows)) return
+
+    // Older firmware: one upsert line per row (adds new deductions, updates existing ones)
     for (let i = 0; i < dbDeductions.length; i++) {
       const d = dbDeductions[i]
-      const createdAt = d.created_at ? Math.floor(new Date(d.created_at).getTime() / 1000) : 0
-      const updatedAt = d.updated_at ? Math.floor(new Date(d.updated_at).getTime() / 1000) : 0
+      const createdAt = epochOf(d.created_at)
+      const updatedAt = epochOf(d.updated_at)
       const line = [
         'UPSERT_DEDUCTION',
         String(Number(d.id || d.deduction_id || 1)),
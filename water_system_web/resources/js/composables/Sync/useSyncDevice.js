@@ -86,6 +86,8 @@ export function useSyncDevice() {
       const value = parts.slice(2).join('|')
       if (
         key === 'pending_readings' ||
+        key === 'change_seq' ||
+        key === 'db_id' ||
         key === 'print_count' ||
         key === 'last_sync_epoch' ||
         key === 'device_id' ||
@@ -0,0 +1,180 @@
+import { serialService } from '../../services/serialService'
+import { digestHex, fnv64 } from '../../services/syncCodec'
+
+// Client-paced export, mirrors managers/sync/export_pull.h on the device.
+// At most WINDOW chunks are requested ahead of what has been verified, so
+// the browser never has more data in flight than it asked for; a chunk
+// whose CHUNK_SUM does not match is pulled again.
+const WINDOW = 4
+const MAX_RETRIES = 3
+
+export function useSyncExportPull() {
+  let firmwareSupportsPull = true
+
+  const waitFor = (match, timeoutMs) => {
+    return new Promise((resolve) => {
+      let timer = null
+      const unlisten = serialService.onLine((line) => {
+        if (!match(line)) return
+        clearTimeout(timer)
+        unlisten()
+        resolve(line)
+      })
+      timer = setTimeout(() => {
+        unlisten()
+        resolve(null)
+      }, timeoutMs)
+    })
+  }
+
+  // Resolves with export lines in the layout the pushed export produces
+  // (BEGIN_, chunks in order, EXPORT_STATS, WATERMARK, END_), or null when
+  // the firmware has no pull export. `filters` narrows the export on the
+  // device, e.g. { status: 'Pending', from: '2026-01-01', to: '2026-01-31' };
+  // a filtered export carries no WATERMARK.
+  const pullExport = async (label, since = null, { timeoutMs = 15000, filters = {} } = {}) => {
+    if (!firmwareSupportsPull) return null
+
+    const colsPrefix = `${label}_COLS|`
+    let colsLine = null
+    const unlistenCols = serialService.onLine((line) => {
+      if (line.startsWith(colsPrefix)) colsLine = line
+    })
+    const readyPromise = waitFor(
+      (line) => line.startsWith(`EXPORT_READY|${label}|`) || line.startsWith('UNKNOWN_COMMAND') || line.startsWith('ERR|'),
+      timeoutMs
+    )
+    const args = Object.entries(filters)
+      .filter(([, value]) => value !== null && value !== undefined && value !== '')
+      .map(([key, value]) => `${key}=${value}`)
+    if (since !== null) args.unshift(`since=${since}`)
+    await serialService.sendLine(args.length ? `EXPORT_OPEN|${label}|${args.join(',')}` : `EXPORT_OPEN|${label}`)
+    const ready = await readyPromise
+    unlistenCols()
+
+    if (!ready) return null
+    if (ready.startsWith('UNKNOWN_COMMAND')) {
+      firmwareSupportsPull = false
+      return null
+    }
+    if (ready.startsWith('ERR|')) throw new Error('Device error: ' + ready)
+
+    const [, , chunksField, , watermarkField] = ready.split('|')
+    const totalChunks = Number(chunksField || 0)
+    const chunkPrefixes = [`${label}_CHUNK|`, `${label}_MP|`]
+    const sumPrefix = `CHUNK_SUM|${label}|`
+
+    const verified = new Array(totalChunks).fill(null)
+    const received = new Map()
+    const retries = new Map()
+    const inFlight = new Set()
+    let nextToRequest = 0
+    let done = 0
+
+    const request = async (first, count) => {
+      for (let i = first; i < first + count; i++) inFlight.add(i)
+      await serialService.sendLine(`EXPORT_PULL|${label}|${first}|${count}`)
+    }
+
+    const refill = async () => {
+      const room = WINDOW - inFlight.size
+      if (room <= 0 || nextToRequest >= totalChunks) return
+      const count = Math.min(room, totalChunks - nextToRequest)
+      const first = nextToRequest
+      nextToRequest += count
+      await request(first, count)
+    }
+
+    const retry = async (index) => {
+      const attempts = (retries.get(index) || 0) + 1
+      if (attempts > MAX_RETRIES) throw new Error(`${label} chunk ${index} failed verification ${MAX_RETRIES} times`)
+      retries.set(index, attempts)
+      await request(index, 1)
+    }
+
+    const finished = new Promise((resolve, reject) => {
+      let timer = null
+      const arm = () => {
+        clearTimeout(timer)
+        timer = setTimeout(async () => {
+          // Nothing arrived for a while: ask again for whatever is outstanding
+          try {
+            for (const index of [...inFlight]) await retry(index)
+            arm()
+          } catch (e) {
+            unlisten()
+            reject(e)
+          }
+        }, timeoutMs)
+      }
+
+      const unlisten = serialService.onLine((line) => {
+        if (chunkPrefixes.some((p) => line.startsWith(p))) {
+          received.set(Number(line.split('|', 2)[1]), line)
+          return
+        }
+        if (!line.startsWith(sumPrefix)) return
+
+        const [, , indexField, , hash] = line.split('|')
+        const index = Number(indexField)
+        const chunkLine = received.get(index)
+        received.delete(index)
+        if (verified[index] !== null) return
+
+        const payload = chunkLine ? chunkLine.split('|').slice(2).join('|') : null
+        ;(async () => {
+          if (payload !== null && digestHex(fnv64(new TextEncoder().encode(payload))) === hash) {
+            verified[index] = chunkLine
+            inFlight.delete(index)
+            done++
+            if (done >= totalChunks) {
+              clearTimeout(timer)
+              unlisten()
+              resolve()
+              return
+            }
+            await refill()
+          } else {
+            await retry(index)
+          }
+          arm()
+        })().catch((e) => {
+          clearTimeout(timer)
+          unlisten()
+          reject(e)
+        })
+      })
+
+      if (totalChunks === 0) {
+        unlisten()
+        resolve()
+        return
+      }
+      arm()
+    })
+
+    await refill()
+    await finished
+
+    const endPromise = waitFor((line) => line === `END_${label}_JSON` || line.startsWith('ERR|'), timeoutMs)
+    let statsLine = null
+    const unlistenStats = serialService.onLine((line) => {
+      if (line.startsWith(`EXPORT_STATS|${label}|`)) statsLine = line
+    })
+    await serialService.sendLine(`EXPORT_CLOSE|${label}`)
+    await endPromise
+    unlistenStats()
+
+    const lines = [`BEGIN_${label}_JSON|${totalChunks}`]
+    if (colsLine) lines.push(colsLine)
+    lines.push(...verified)
+    if (statsLine) lines.push(statsLine)
+    if (watermarkField !== '-1') lines.push(`WATERMARK|${label}|${watermarkField}`)
+    lines.push(`END_${label}_JSON`)
+    return lines
+  }
+
+  return {
+    pullExport
+  }
+}
@@ -0,0 +1,79 @@
+import { serialService } from '../../services/serialService'
+import { databaseService } from '../../services/databaseService'
+
+// Keeps the device stocked with server-granted primary key blocks for the
+// rows it creates (see database/id_leases.h on the device). The server only
+// grants a block for tables running low, so most syncs send nothing.
+export function useSyncIdLeases() {
+  // Resolves with { table: remaining ids }, or null when the firmware has no ID_LEASES
+  const fetchIdLeases = (timeoutMs = 3000) => {
+    return new Promise((resolve) => {
+      const remaining = {}
+      let timer = null
+      let unlisten = null
+      const done = (result) => {
+        clearTimeout(timer)
+        if (unlisten) unlisten()
+        resolve(result)
+      }
+      unlisten = serialService.onLine((line) => {
+        if (line.startsWith('ID_LEASE|')) {
+          const [, table, , , left] = line.split('|')
+          remaining[table] = Number(left || 0)
+        } else if (line === 'END_ID_LEASES') {
+          done(remaining)
+        } else if (line.startsWith('UNKNOWN_COMMAND:')) {
+          done(null)
+        }
+      })
+      timer = setTimeout(() => done(null), timeoutMs)
+      serialService.sendLine('ID_LEASES').catch(() => done(null))
+    })
+  }
+
+  const sendLease = (table, firstId, lastId, timeoutMs = 3000) => {
+    return new Promise((resolve) => {
+      let timer = null
+      const unlisten = serialService.onLine((line) => {
+        if (!line.startsWith(`ACK|ID_LEASE|${table}|`) && !line.startsWith('ERR|ID_LEASE|')) return
+        clearTimeout(timer)
+        unlisten()
+        resolve(line)
+      })
+      timer = setTimeout(() => {
+        unlisten()
+        resolve(null)
+      }, timeoutMs)
+      serialService.sendLine(`SET_ID_LEASE|${table}|${firstId}|${lastId}`).catch(() => {
+        clearTimeout(timer)
+        unlisten()
+        resolve(null)
+      })
+    })
+  }
+
+  // Returns the tables that received a new block
+  const refreshIdLeases = async (deviceMac, dbId, log = () => {}) => {
+    const remaining = await fetchIdLeases()
+    if (!remaining) return []
+
+    const leases = await databaseService.requestDeviceIdLeases(deviceMac, dbId, remaining)
+    const granted = []
+    for (const [table, lease] of Object.entries(leases)) {
+      const reply = await sendLease(table, lease.first_id, lease.last_id)
+      if (reply?.startsWith('ACK|')) {
+        granted.push(table)
+        log(`ID lease for ${table}: ${lease.first_id}-${lease.last_id}`)
+      } else {
+        // The block stays unused; the next sync asks again
+        log(`ID lease for ${table} not applied: ${reply || 'no reply'}`)
+      }
+    }
+    return granted
+  }
+
+  return {
+    fetchIdLeases,
+    refreshIdLeases
+  }
+}
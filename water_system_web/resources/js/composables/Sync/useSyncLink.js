@@ -0,0 +1,206 @@
+import { ref } from 'vue'
+import { serialService } from '../../services/serialService'
+
+// Mirrors managers/sync/link_sync.h on the device
+const DEFAULT_BAUD = 115200
+const LINKTEST_LINE_CHARS = 96
+const BAUD_OK_PATTERN_CHARS = 128
+const BASE64_ALPHABET = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/'
+
+const patternSeed = (seed, seq) => ((seed ^ Math.imul(seq, 2654435761)) | 1) >>> 0
+
+const linkPattern = (state, chars) => {
+  let x = state >>> 0
+  let out = ''
+  for (let i = 0; i < chars; i++) {
+    x ^= x << 13
+    x ^= x >>> 17
+    x ^= x << 5
+    x >>>= 0
+    out += BASE64_ALPHABET[x & 0x3f]
+  }
+  return out
+}
+
+const randomSeed = () => (Math.floor(Math.random() * 0xfffffffe) + 1) >>> 0
+const sleep = (ms) => new Promise(r => setTimeout(r, ms))
+
+export function useSyncLink() {
+  const linkBaudRate = ref(DEFAULT_BAUD)
+  const lastLinkTest = ref(null)
+  let firmwareSupportsBaud = true
+
+  // Resolves with the first line matching one of the prefixes, or null on timeout
+  const waitForLine = (prefixes, timeoutMs) => {
+    return new Promise((resolve) => {
+      let timer = null
+      const unlisten = serialService.onLine((line) => {
+        if (prefixes.some(p => line.startsWith(p))) {
+          clearTimeout(timer)
+          unlisten()
+          resolve(line)
+        }
+      })
+      timer = setTimeout(() => {
+        unlisten()
+        resolve(null)
+      }, timeoutMs)
+    })
+  }
+
+  // Device -> client throughput plus client -> device integrity, measured
+  // at the current baud rate.
+  const runLinkTest = async ({ bytes = 32768, echoLines = 64, timeoutMs = 20000 } = {}) => {
+    const seed = randomSeed()
+    const received = new Map()
+    let expectedLines = 0
+    let endLine = null
+    let startedAt = 0
+
+    const download = new Promise((resolve) => {
+      let timer = null
+      const unlisten = serialService.onLine((line) => {
+        if (line.startsWith('BEGIN_LINKTEST|')) {
+          expectedLines = Number(line.split('|')[1] || 0)
+          startedAt = performance.now()
+        } else if (line.startsWith('LT|')) {
+          const [, seq, pattern] = line.split('|')
+          received.set(Number(seq), pattern)
+        } else if (line.startsWith('END_LINKTEST|')) {
+          endLine = line
+          clearTimeout(timer)
+          unlisten()
+          resolve()
+        }
+      })
+      timer = setTimeout(() => {
+        unlisten()
+        resolve()
+      }, timeoutMs)
+    })
+    await serialService.sendLine(`LINKTEST|${bytes}|${seed}`)
+    await download
+    const downloadMs = performance.now() - startedAt
+
+    let downloadErrors = Math.max(0, expectedLines - received.size)
+    for (const [seq, pattern] of received) {
+      if (pattern !== linkPattern(patternSeed(seed, seq), LINKTEST_LINE_CHARS)) downloadErrors++
+    }
+
+    // Upload: pipeline echo lines and time until the last verdict arrives
+    const echoSeed = randomSeed()
+    const verdicts = new Map()
+    const upload = new Promise((resolve) => {
+      let timer = null
+      const unlisten = serialService.onLine((line) => {
+        if (!line.startsWith('LT_ECHO|')) return
+        const [, seq, verdict] = line.split('|')
+        verdicts.set(Number(seq), verdict)
+        if (verdicts.size >= echoLines) {
+          clearTimeout(timer)
+          unlisten()
+          resolve()
+        }
+      })
+      timer = setTimeout(() => {
+        unlisten()
+        resolve()
+      }, timeoutMs)
+    })
+    const uploadStart = performance.now()
+    for (let seq = 0; seq < echoLines; seq++) {
+      await serialService.sendLine(`LINKTEST_ECHO|${seq}|${echoSeed}|${linkPattern(patternSeed(echoSeed, seq), LINKTEST_LINE_CHARS)}`)
+    }
+    await upload
+    const uploadMs = performance.now() - uploadStart
+    const uploadErrors = echoLines - [...verdicts.values()].filter(v => v === 'OK').length
+
+    const downloadBytes = received.size * (LINKTEST_LINE_CHARS + 8)
+    const uploadBytes = echoLines * (LINKTEST_LINE_CHARS + 26)
+    const result = {
+      baudRate: serialService.getBaudRate(),
+      completed: endLine !== null,
+      downloadBytesPerSec: downloadMs > 0 ? Math.round(downloadBytes / (downloadMs / 1000)) : 0,
+      uploadBytesPerSec: uploadMs > 0 ? Math.round(uploadBytes / (uploadMs / 1000)) : 0,
+      downloadErrors,
+      uploadErrors,
+      lineErrorRate: (downloadErrors + uploadErrors) / Math.max(1, expectedLines + echoLines),
+    }
+    lastLinkTest.value = result
+    return result
+  }
+
+  // SET_BAUD handshake: the device answers at the old rate, both sides
+  // switch, and a BAUD_OK pattern exchange must succeed at the new rate or
+  // the device reverts on its own after 2 s.
+  const switchBaudRate = async (rate) => {
+    const previous = serialService.getBaudRate()
+    if (rate === previous) return true
+
+    const ackPromise = waitForLine([`ACK|SET_BAUD|${rate}`, 'ERR|UNSUPPORTED_BAUD|', 'UNKNOWN_COMMAND'], 2000)
+    await serialService.sendLine(`SET_BAUD|${rate}`)
+    const ack = await ackPromise
+    if (ack && ack.startsWith('UNKNOWN_COMMAND')) firmwareSupportsBaud = false
+    if (!ack || !ack.startsWith('ACK|')) return false
+
+    await serialService.setBaudRate(rate)
+    await sleep(50)
+
+    const seed = randomSeed()
+    const confirmPromise = waitForLine([`ACK|BAUD_OK|${rate}|`], 1500)
+    await serialService.sendLine(`BAUD_OK|${rate}|${seed}|${linkPattern(patternSeed(seed, 0), BAUD_OK_PATTERN_CHARS)}`)
+    const confirm = await confirmPromise
+    const echoed = confirm ? confirm.split('|')[4] : null
+    if (echoed === linkPattern(patternSeed(seed, 1), BAUD_OK_PATTERN_CHARS)) {
+      linkBaudRate.value = rate
+      return true
+    }
+
+    // Device reverts by itself when the confirmation never arrived intact
+    await sleep(2200)
+    await serialService.setBaudRate(previous)
+    linkBaudRate.value = previous
+    return false
+  }
+
+  // Tries the candidates from fastest down and keeps the first rate whose
+  // link test is clean. Returns the chosen rate and its measurements.
+  const negotiateBaudRate = async ({ candidates = [921600, 460800, 230400], maxLineErrorRate = 0 } = {}) => {
+    const tried = []
+    for (const rate of candidates) {
+      if (!firmwareSupportsBaud) break
+      if (!(await switchBaudRate(rate))) {
+        tried.push({ baudRate: rate, switched: false })
+        continue
+      }
+      const test = await runLinkTest({ bytes: 16384, echoLines: 32 })
+      tried.push(test)
+      if (test.completed && test.lineErrorRate <= maxLineErrorRate) {
+        return { baudRate: rate, test, tried }
+      }
+      // A link too noisy to take the fallback command is not worth probing further
+      if (!(await restoreDefaultBaudRate())) break
+    }
+    return { baudRate: serialService.getBaudRate(), test: null, tried }
+  }
+
+  const restoreDefaultBaudRate = async () => {
+    if (serialService.getBaudRate() === DEFAULT_BAUD) return true
+    const ok = await switchBaudRate(DEFAULT_BAUD)
+    if (!ok) {
+      // The device falls back to the default after a minute of silence anyway
+      await serialService.setBaudRate(DEFAULT_BAUD)
+      linkBaudRate.value = DEFAULT_BAUD
+    }
+    return ok
+  }
+
+  return {
+    linkBaudRate,
+    lastLinkTest,
+    runLinkTest,
+    switchBaudRate,
+    negotiateBaudRate,
+    restoreDefaultBaudRate
+  }
+}
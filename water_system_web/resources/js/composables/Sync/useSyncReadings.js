@@ -1,6 +1,8 @@
 import { ref } from 'vue'
 import { serialService } from '../../services/serialService'
 import { databaseService } from '../../services/databaseService'
+import { decodeColumnarExport, inflateChunkLines, parseExportStats, parseJsonChunks, parseWatermark } from '../../services/syncCodec'
+import { useSyncExportPull } from './useSyncExportPull'
 
 export function useSyncReadings() {
   const exportInProgress = ref(false)
@@ -13,17 +15,24 @@ export function useSyncReadings() {
   const exportLinePrefix = ref(null)
   const exportCollecting = ref(false)
   const lastAck = ref(null)
+  const { pullExport } = useSyncExportPull()
 
   const sendLine = async (line) => {
     const text = String(line).replace(/\r|\n/g, '')
     await serialService.sendLine(text)
   }
 
-  const exportReadingsFromDevice = async () => {
+  const exportReadingsFromDevice = async (since = null) => {
     if (exportInProgress.value) {
       throw new Error('Export already in progress')
     }
 
+    // Client-paced pull; firmware without EXPORT_OPEN gets the pushed export below
+    const pulled = await pullExport('READINGS', since)
+    if (pulled) {
+      return { rows: parseReadingsExportLines(pulled), watermark: parseWatermark(pulled, 'READINGS') }
+    }
+
     exportInProgress.value = true
     exportLines.value = []
     lastAck.value = null
@@ -39,10 +48,11 @@ export function useSyncReadings() {
       }, 60000)
     })
 
-    await sendLine('EXPORT_READINGS')
+    // With a watermark only rows changed since then are exported
+    await sendLine(since === null ? 'EXPORT_READINGS' : `EXPORT_READINGS|since=${since}`)
 
     const lines = await promise
-    return parseReadingsExportLines(lines)
+    return { rows: parseReadingsExportLines(lines), watermark: parseWatermark(lines, 'READINGS') }
   }
 
   const finishExport = (error, lines = null) => {
@@ -64,79 +74,50 @@ export function useSyncReadings() {
     exportReject.value = null
   }
 
-  const parseReadingsExportLines = (lines) => {
-    const readings = []
-    let chunkBuffer = ''
-    for (const line of lines) {
-      const t = String(line).trim()
-
-      if (t.startsWith('READINGS_CHUNK|')) {
-        const parts = t.split('|', 3)
-        if (parts.length >= 3) {
-          chunkBuffer = parts[2] || ''
-        }
-        continue
-      }
-
-      // If there's no explicit chunk prefix, start accumulation when a line
-      // looks like the start of JSON or contains reading keys (heuristic).
-      if (!chunkBuffer) {
-        // Start accumulating on any non-meta, non-empty line. Device may
-        // emit fragments starting mid-object (e.g. 'stomer_id":273').
-        if (t && !t.startsWith('Heap free') && t !== 'END_READINGS_JSON' && t !== 'BEGIN_READINGS_JSON') {
-          chunkBuffer = t
-        } else {
-          // nothing to accumulate yet
-          continue
-        }
-      } else {
-        if (t.startsWith('Heap free') || t === 'END_READINGS_JSON' || t === 'BEGIN_READINGS_JSON') {
-          // skip meta
-        } else {
-          chunkBuffer += t
-        }
-      }
-
-      if (chunkBuffer) {
-        try {
-          const chunkReadings = JSON.parse(chunkBuffer)
-          for (const reading of chunkReadings) {
-            readings.push({
-              reading_id: Number(reading.reading_id || 0),
-              customer_id: Number(reading.customer_id || 0),
-              device_uid: reading.device_uid || '',
-              previous_reading: Number(reading.previous_reading || 0),
-              current_reading: Number(reading.current_reading || 0),
-              usage_m3: Number(reading.usage_m3 || 0),
-              reading_at: Number(reading.reading_at || 0)
-            })
-          }
-          chunkBuffer = '' // Clear after successful parse
-        } catch (e) {
-          // Not complete yet, continue accumulating
-        }
-      }
-    }
-    return readings
+  const toReading = (reading) => ({
+    reading_id: Number(reading.reading_id || 0),
+    customer_id: Number(reading.customer_id || 0),
+    device_uid: reading.device_uid || '',
+    previous_reading: Number(reading.previous_reading || 0),
+    current_reading: Number(reading.current_reading || 0),
+    usage_m3: Number(reading.usage_m3 || 0),
+    reading_at: Number(reading.reading_at || 0),
+    anomaly: reading.anomaly || null
+  })
+
+  const parseReadingsExportLines = (rawLines) => {
+    const stats = parseExportStats(rawLines, 'READINGS')
+    if (stats) console.log('Readings export stats:', stats)
+
+    const columnar = decodeColumnarExport(rawLines, 'READINGS')
+    if (columnar) return columnar.map(toReading)
+
+    const lines = inflateChunkLines(rawLines, 'READINGS_CHUNK|')
+    return parseJsonChunks(lines, 'READINGS_CHUNK|').map(toReading)
   }
 
-  const syncReadingsFromDevice = async () => {
+  const syncReadingsFromDevice = async (since = null, owner = {}) => {
     // Ensure device has a usable clock (epoch seconds)
     const epochNow = Math.floor(Date.now() / 1000)
     await sendLine('SET_TIME|' + String(epochNow))
 
-    const deviceReadings = await exportReadingsFromDevice()
+    const { rows: deviceReadings, watermark } = await exportReadingsFromDevice(since)
 
     if (deviceReadings.length === 0) {
-      return
+      return { processed: 0, watermark }
     }
 
     console.log('Readings exported from device (count):', deviceReadings.length)
     let processed = 0
     try {
-      processed = await databaseService.upsertReadingsToDatabase(deviceReadings)
+      const result = await databaseService.upsertReadingsToDatabase(deviceReadings, owner)
+      processed = result.processed
       console.log('Readings synced to database, processed:', processed)
-      if (Number(processed) !== Number(deviceReadings.length)) {
+      if (result.conflicts > 0) {
+        // Keys from another device's id lease; the server keeps its rows
+        console.warn('Readings skipped, keys owned by another device:', result.conflicts)
+      }
+      if (processed + result.conflicts !== Number(deviceReadings.length)) {
         throw new Error('Upserted readings count does not match device export count')
       }
     } catch (err) {
@@ -147,7 +128,7 @@ export function useSyncReadings() {
     // Mark device readings as synced (so next export is incremental)
     await sendLine('READINGS_SYNCED')
 
-    return processed
+    return { processed, watermark }
   }
 
   const handleDeviceLine = (line) => {
@@ -0,0 +1,56 @@
+import { serialService } from '../../services/serialService'
+import { syncCodec } from '../../services/syncCodec'
+
+// Reference tables (deductions, barangays, customer types) are pushed as
+// UPSERT_<TABLE>_JSON_CHUNK batches: each chunk is one transaction on the
+// device and its in-memory list is reloaded once, after the last chunk.
+// These tables are small, so chunks go one at a time.
+const CHUNK_ROWS = 100
+const CHUNK_TIMEOUT_MS = 10000
+const MAX_ATTEMPTS = 3
+
+export function useSyncReferenceBatch() {
+  // Resolves with 'ACK', 'NAK', 'UNKNOWN' (firmware without the command) or 'TIMEOUT'
+  const sendChunk = (line, index) => {
+    return new Promise((resolve) => {
+      let timer = null
+      const done = (result) => {
+        clearTimeout(timer)
+        unlisten()
+        resolve(result)
+      }
+      const unlisten = serialService.onLine((reply) => {
+        if (reply.startsWith(`ACK|CHUNK|${index}|`)) done('ACK')
+        else if (reply.startsWith(`NAK|CHUNK|${index}|`)) done('NAK')
+        else if (reply.startsWith('UNKNOWN_COMMAND')) done('UNKNOWN')
+      })
+      timer = setTimeout(() => done('TIMEOUT'), CHUNK_TIMEOUT_MS)
+      serialService.sendLine(line).catch(() => done('TIMEOUT'))
+    })
+  }
+
+  // Resolves true once every chunk is applied, false when the firmware has
+  // no batch command and the caller should fall back to one line per row.
+  // `wholeTable` sends an empty chunk when there are no rows, for tables the
+  // device clears on chunk 0.
+  const pushReferenceRows = async (table, rows, { wholeTable = false } = {}) => {
+    const total = Math.max(wholeTable ? 1 : 0, Math.ceil(rows.length / CHUNK_ROWS))
+    for (let index = 0; index < total; index++) {
+      const json = JSON.stringify(rows.slice(index * CHUNK_ROWS, (index + 1) * CHUNK_ROWS))
+      const payload = syncCodec.encodePayloadText(json) ?? json.replace(/\|/g, '\\|')
+      const line = `UPSERT_${table}_JSON_CHUNK|${index}|${total}|${payload}`
+
+      let result = null
+      for (let attempt = 0; attempt < MAX_ATTEMPTS && result !== 'ACK'; attempt++) {
+        result = await sendChunk(line, index)
+        if (result === 'UNKNOWN') return false
+      }
+      if (result !== 'ACK') throw new Error(`Device did not apply ${table} chunk ${index} (${result})`)
+    }
+    return true
+  }
+
+  return {
+    pushReferenceRows
+  }
+}
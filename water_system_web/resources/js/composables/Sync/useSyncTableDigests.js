@@ -0,0 +1,75 @@
+import { serialService } from '../../services/serialService'
+import { digestHex, fnv64 } from '../../services/syncCodec'
+
+// Lets a sync skip phases whose data changed on neither side since the last
+// successful sync. The device side is TABLE_DIGESTS (row count, max
+// updated_at and a content hash kept current by triggers); the server side
+// is a hash of the rows the phase would push. Both are stored per device
+// database once a sync succeeds and compared on the next one.
+const BASELINE_STORAGE_PREFIX = 'ws-sync-baseline:'
+
+export function useSyncTableDigests() {
+  // Resolves with { table: 'rows|max_updated_at|hash' }, or null when the
+  // firmware has no TABLE_DIGESTS
+  const fetchTableDigests = (timeoutMs = 3000) => {
+    return new Promise((resolve) => {
+      const digests = {}
+      let timer = null
+      let unlisten = null
+      const done = (result) => {
+        clearTimeout(timer)
+        if (unlisten) unlisten()
+        resolve(result)
+      }
+      unlisten = serialService.onLine((line) => {
+        if (line.startsWith('TABLE_DIGEST|')) {
+          const [, table, rows, maxUpdatedAt, hash] = line.split('|')
+          digests[table] = `${rows}|${maxUpdatedAt}|${hash}`
+        } else if (line === 'END_TABLE_DIGESTS') {
+          done(digests)
+        } else if (line.startsWith('UNKNOWN_COMMAND:') || line.startsWith('ERR|TABLE_DIGESTS')) {
+          done(null)
+        }
+      })
+      timer = setTimeout(() => done(null), timeoutMs)
+      serialService.sendLine('TABLE_DIGESTS').catch(() => done(null))
+    })
+  }
+
+  // Order-independent hash of server rows; `ignore` drops bookkeeping
+  // fields that change without the pushed data changing
+  const serverSignature = (rows, ignore = []) => {
+    const encoded = rows
+      .map((row) => {
+        const copy = { ...row }
+        for (const key of ignore) delete copy[key]
+        return JSON.stringify(copy)
+      })
+      .sort()
+    return `${rows.length}|${digestHex(fnv64(new TextEncoder().encode(encoded.join('\n'))))}`
+  }
+
+  const storageKey = (deviceUid) => BASELINE_STORAGE_PREFIX + (deviceUid || 'device')
+
+  // Baseline from the last successful sync of this device database, or null
+  const loadBaseline = (deviceUid, dbId) => {
+    try {
+      const stored = JSON.parse(window.localStorage.getItem(storageKey(deviceUid)) || 'null')
+      if (!stored || stored.dbId !== dbId) return null
+      return stored
+    } catch {
+      return null
+    }
+  }
+
+  const saveBaseline = (deviceUid, dbId, device, server) => {
+    window.localStorage.setItem(storageKey(deviceUid), JSON.stringify({ dbId, device, server }))
+  }
+
+  return {
+    fetchTableDigests,
+    serverSignature,
+    loadBaseline,
+    saveBaseline
+  }
+}
@@ -78,19 +78,21 @@ export const databaseService = {
     }
   },
 
-  async upsertReadingsToDatabase(readings) {
+  // owner: { deviceMac, dbId } of the exporting device; the server only
+  // keeps device keys from that device's own id lease blocks
+  async upsertReadingsToDatabase(readings, owner = {}) {
     try {
-      const res = await window.axios.post('/readings/sync', { readings })
-      return Number(res.data?.processed || 0)
+      const res = await window.axios.post('/readings/sync', { readings, device_mac: owner.deviceMac ?? null, db_id: owner.dbId ?? null })
+      return { processed: Number(res.data?.processed || 0), conflicts: Number(res.data?.conflicts || 0) }
     } catch (error) {
       if (error.response?.status === 401) throw new Error('Unauthorized (login required)')
       throw new Error('Readings sync failed: ' + (error.response?.data?.message || error.message))
     }
   },
 
-  async upsertBillsToDatabase(bills) {
+  async upsertBillsToDatabase(bills, owner = {}) {
     try {
-      const res = await window.axios.post('/bills/sync', { bills })
+      const res = await window.axios.post('/bills/sync', { bills, device_mac: owner.deviceMac ?? null, db_id: owner.dbId ?? null })
       return Number(res.data?.processed || 0)
     } catch (error) {
       if (error.response?.status === 401) throw new Error('Unauthorized (login required)')
@@ -98,9 +100,12 @@ export const databaseService = {
     }
   },
 
-  async upsertBillTransactionsToDatabase(billTransactions) {
+  async upsertBillTransactionsToDatabase(billTransactions, owner = {}) {
     try {
-      const res = await window.axios.post('/bill-transactions/sync', { bill_transactions: billTransactions })
+      const res = await window.axios.post('/bill-transactions/sync', { bill_transactions: billTransactions, device_mac: owner.deviceMac ?? null, db_id: owner.dbId ?? null })
+      if (Number(res.data?.conflicts || 0) > 0) {
+        console.warn('Bill transactions skipped, keys owned by another device:', res.data.conflicts)
+      }
       return Number(res.data?.processed || 0)
     } catch (error) {
       if (error.response?.status === 401) throw new Error('Unauthorized (login required)')
@@ -118,6 +123,26 @@ export const databaseService = {
     }
   },
 
+  async updateDeviceWatermarks(deviceMac, dbId, watermarks) {
+    try {
+      const res = await window.axios.post('/devices/watermarks', { device_mac: deviceMac, db_id: dbId, watermarks })
+      return res.data?.watermarks || null
+    } catch (error) {
+      if (error.response?.status === 401) throw new Error('Unauthorized (login required)')
+      throw new Error('Failed to update device watermarks: ' + (error.response?.data?.message || error.message))
+    }
+  },
+
+  async requestDeviceIdLeases(deviceMac, dbId, remaining) {
+    try {
+      const res = await window.axios.post('/devices/id-leases', { device_mac: deviceMac, db_id: dbId, remaining })
+      return res.data?.leases || {}
+    } catch (error) {
+      if (error.response?.status === 401) throw new Error('Unauthorized (login required)')
+      throw new Error('Failed to request ID leases: ' + (error.response?.data?.message || error.message))
+    }
+  },
+
   async markCustomersSynced(accountNumbers) {
     try {
       const res = await window.axios.post('/customers/mark-synced', { account_numbers: accountNumbers })
@@ -6,6 +6,9 @@ let textEncoder = null;
 let isConnected = false;
 let isReading = false;
 let rxBuffer = '';
+let baudRate = 115200;
+
+const MAX_LINE_CHARS = 4 * 1024 * 1024;
 
 const lineListeners = new Set();
 const statusListeners = new Set();
@@ -48,8 +51,9 @@ function handleChunk(chunk) {
     if (trimmed.length > 0) emitLine(trimmed);
   }
 
-  // flush if device prints without newlines
-  if (rxBuffer.length > 200) {
+  // Lines are only cut at newlines so export chunks arrive whole; the cap
+  // just guards against a device that never sends one.
+  if (rxBuffer.length > MAX_LINE_CHARS) {
     const flushed = rxBuffer.trimEnd();
     rxBuffer = '';
     if (flushed.length > 0) emitLine(flushed);
@@ -89,7 +93,7 @@ async function ensureStreams() {
   if (!writer) writer = port.writable.getWriter();
 }
 
-async function connect({ baudRate = 115200 } = {}) {
+async function connect({ baudRate: rate = 115200 } = {}) {
   if (!('serial' in navigator)) {
     throw new Error('Web Serial API not supported (use Chrome/Edge)');
   }
@@ -100,7 +104,8 @@ async function connect({ baudRate = 115200 } = {}) {
   }
 
   port = await navigator.serial.requestPort();
-  await port.open({ baudRate });
+  await port.open({ baudRate: rate });
+  baudRate = rate;
 
   isConnected = true;
   rxBuffer = '';
@@ -112,7 +117,7 @@ async function connect({ baudRate = 115200 } = {}) {
   void startReadLoop();
 }
 
-async function autoReconnect({ baudRate = 115200 } = {}) {
+async function autoReconnect({ baudRate: rate = 115200 } = {}) {
   if (!('serial' in navigator)) return false;
   if (isConnected && port) return true;
 
@@ -120,7 +125,8 @@ async function autoReconnect({ baudRate = 115200 } = {}) {
   if (!ports || ports.length === 0) return false;
 
   port = ports[0];
-  await port.open({ baudRate });
+  await port.open({ baudRate: rate });
+  baudRate = rate;
 
   isConnected = true;
   rxBuffer = '';
@@ -165,6 +171,38 @@ async function disconnect() {
   rxBuffer = '';
 }
 
+// Reopens the current port at another baud rate (Web Serial cannot change
+// it on an open port). Listeners stay attached.
+async function setBaudRate(rate) {
+  if (!port || !isConnected) throw new Error('No serial port connected');
+  if (rate === baudRate) return;
+
+  try {
+    if (reader) {
+      await reader.cancel();
+      reader.releaseLock();
+    }
+  } catch (_) {}
+  try {
+    if (writer) writer.releaseLock();
+  } catch (_) {}
+  reader = null;
+  writer = null;
+  while (isReading) await new Promise((r) => setTimeout(r, 5));
+
+  await port.close();
+  await port.open({ baudRate: rate });
+  baudRate = rate;
+  rxBuffer = '';
+
+  await ensureStreams();
+  void startReadLoop();
+}
+
+function getBaudRate() {
+  return baudRate;
+}
+
 async function sendLine(line) {
   if (!writer) throw new Error('Serial writer not available');
   const text = String(line).replace(/\r|\n/g, '');
@@ -210,6 +248,8 @@ export const serialService = {
   autoReconnect,
   disconnect,
   sendLine,
+  setBaudRate,
+  getBaudRate,
   onLine,
   onStatus,
   getState,
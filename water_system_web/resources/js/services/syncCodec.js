@@ -0,0 +1,434 @@
+// Decoder for the device's compact export encoding.
+//
+// After SET_EXPORT_FORMAT|MSGPACK the device sends, per export:
+//   <LABEL>_COLS|name:type[:d][:h],...   column header (once)
+//   <LABEL>_MP|<chunk>|<base64>          one MessagePack chunk
+// Each chunk is [hoisted, rows]: `hoisted` maps column names shared by every
+// row of the chunk, `rows` holds the remaining columns positionally.
+// Columns flagged `d` are sent as the difference from the previous row.
+// Type `m` columns are peso amounts sent as integer centavos.
+//
+// After SET_COMPRESSION|LZ any payload field may instead be
+// Z:<raw_len>:<base64 LZ4 block>, in either direction.
+
+// Device lines that can sit between chunk lines and are never a fragment of one
+const META_PREFIXES = ['Heap free', 'EXPORT_STATS|', 'STAT|', 'WATERMARK|', 'CHUNK_SUM|', 'BEGIN_', 'END_', 'ACK|', 'ERR|']
+
+const LZ_HASH_BITS = 12
+const LZ_MIN_MATCH = 4
+const LZ_LAST_LITERALS = 5
+const LZ_MATCH_SAFE_DISTANCE = 12
+const LZ_MAX_OFFSET = 0xffff
+const LZ_MAX_INPUT = 0xffff
+
+let compressionEnabled = false
+
+function setCompression(enabled) {
+  compressionEnabled = Boolean(enabled)
+}
+
+function isCompressionEnabled() {
+  return compressionEnabled
+}
+
+function base64ToBytes(text) {
+  const binary = atob(text)
+  const bytes = new Uint8Array(binary.length)
+  for (let i = 0; i < binary.length; i++) bytes[i] = binary.charCodeAt(i)
+  return bytes
+}
+
+function bytesToBase64(bytes) {
+  let binary = ''
+  for (let i = 0; i < bytes.length; i += 0x8000) {
+    binary += String.fromCharCode.apply(null, bytes.subarray(i, i + 0x8000))
+  }
+  return btoa(binary)
+}
+
+// ===== LZ4 block codec (matches managers/sync/sync_compress.h) =====
+
+function lzDecompress(input, rawLength) {
+  const out = new Uint8Array(rawLength)
+  let ip = 0
+  let op = 0
+  const readLength = (len) => {
+    if (len !== 15) return len
+    let b
+    do {
+      if (ip >= input.length) throw new Error('Truncated LZ length')
+      b = input[ip++]
+      len += b
+    } while (b === 255)
+    return len
+  }
+
+  while (ip < input.length) {
+    const token = input[ip++]
+    const literalLength = readLength(token >> 4)
+    if (ip + literalLength > input.length || op + literalLength > rawLength) {
+      throw new Error('Corrupt LZ literal run')
+    }
+    out.set(input.subarray(ip, ip + literalLength), op)
+    ip += literalLength
+    op += literalLength
+    if (ip >= input.length) break
+
+    const offset = input[ip] | (input[ip + 1] << 8)
+    ip += 2
+    if (offset === 0 || offset > op) throw new Error('Corrupt LZ offset')
+    const matchLength = readLength(token & 0x0f) + LZ_MIN_MATCH
+    if (op + matchLength > rawLength) throw new Error('Corrupt LZ match')
+    for (let i = 0; i < matchLength; i++, op++) out[op] = out[op - offset]
+  }
+  if (op !== rawLength) throw new Error('LZ length mismatch')
+  return out
+}
+
+function lzCompress(input) {
+  const n = input.length
+  const out = []
+  const table = new Int32Array(1 << LZ_HASH_BITS).fill(-1)
+  const read32 = (p) => (input[p] | (input[p + 1] << 8) | (input[p + 2] << 16) | (input[p + 3] << 24)) >>> 0
+  const hash = (v) => Math.imul(v, 2654435761) >>> (32 - LZ_HASH_BITS)
+  const writeLength = (len) => {
+    while (len >= 255) {
+      out.push(255)
+      len -= 255
+    }
+    out.push(len)
+  }
+  const writeLiterals = (from, to) => {
+    for (let i = from; i < to; i++) out.push(input[i])
+  }
+
+  let anchor = 0
+  let ip = 0
+  const matchStartLimit = n - LZ_MATCH_SAFE_DISTANCE
+  const matchEndLimit = n - LZ_LAST_LITERALS
+
+  while (ip < matchStartLimit) {
+    const seq = read32(ip)
+    const h = hash(seq)
+    const ref = table[h]
+    table[h] = ip
+
+    if (ref >= 0 && ip - ref <= LZ_MAX_OFFSET && read32(ref) === seq) {
+      let len = LZ_MIN_MATCH
+      while (ip + len < matchEndLimit && input[ref + len] === input[ip + len]) len++
+      const literalLength = ip - anchor
+      const matchCode = len - LZ_MIN_MATCH
+      out.push((Math.min(literalLength, 15) << 4) | Math.min(matchCode, 15))
+      if (literalLength >= 15) writeLength(literalLength - 15)
+      writeLiterals(anchor, ip)
+      out.push((ip - ref) & 0xff, (ip - ref) >> 8)
+      if (matchCode >= 15) writeLength(matchCode - 15)
+      ip += len
+      anchor = ip
+    } else {
+      ip++
+    }
+  }
+
+  const literalLength = n - anchor
+  out.push(Math.min(literalLength, 15) << 4)
+  if (literalLength >= 15) writeLength(literalLength - 15)
+  writeLiterals(anchor, n)
+  return Uint8Array.from(out)
+}
+
+// Binary payload field: plain base64 or Z:<raw_len>:<base64>
+function decodePayloadBytes(field) {
+  if (!field.startsWith('Z:')) return base64ToBytes(field)
+  const sep = field.indexOf(':', 2)
+  return lzDecompress(base64ToBytes(field.substring(sep + 1)), Number(field.substring(2, sep)))
+}
+
+// Text payload field: verbatim or Z:<raw_len>:<base64>
+function decodePayloadText(field) {
+  if (!field.startsWith('Z:')) return field
+  return new TextDecoder().decode(decodePayloadBytes(field))
+}
+
+// Compresses an outgoing text payload when compression was negotiated and it pays off.
+// Returns null when the payload should be sent as-is.
+function encodePayloadText(text) {
+  if (!compressionEnabled) return null
+  const raw = new TextEncoder().encode(text)
+  // The device refuses a larger raw length (LZ_MAX_INPUT, sync_compress.h)
+  if (raw.length > LZ_MAX_INPUT) return null
+  const packed = `Z:${raw.length}:${bytesToBase64(lzCompress(raw))}`
+  return packed.length < text.length ? packed : null
+}
+
+function decodeMsgPack(bytes) {
+  const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength)
+  const utf8 = new TextDecoder()
+  let pos = 0
+
+  const str = (len) => {
+    const s = utf8.decode(bytes.subarray(pos, pos + len))
+    pos += len
+    return s
+  }
+  const array = (len) => {
+    const out = new Array(len)
+    for (let i = 0; i < len; i++) out[i] = read()
+    return out
+  }
+  const map = (len) => {
+    const out = {}
+    for (let i = 0; i < len; i++) {
+      const key = read()
+      out[key] = read()
+    }
+    return out
+  }
+
+  const read = () => {
+    const b = bytes[pos++]
+    if (b <= 0x7f) return b
+    if (b >= 0xe0) return b - 0x100
+    if ((b & 0xf0) === 0x80) return map(b & 0x0f)
+    if ((b & 0xf0) === 0x90) return array(b & 0x0f)
+    if ((b & 0xe0) === 0xa0) return str(b & 0x1f)
+
+    let v
+    switch (b) {
+      case 0xc0: return null
+      case 0xc2: return false
+      case 0xc3: return true
+      case 0xca:
+        v = view.getFloat32(pos)
+        pos += 4
+        return Number(v.toPrecision(7))
+      case 0xcb: v = view.getFloat64(pos); pos += 8; return v
+      case 0xcc: return bytes[pos++]
+      case 0xcd: v = view.getUint16(pos); pos += 2; return v
+      case 0xce: v = view.getUint32(pos); pos += 4; return v
+      case 0xcf: v = Number(view.getBigUint64(pos)); pos += 8; return v
+      case 0xd0: v = view.getInt8(pos); pos += 1; return v
+      case 0xd1: v = view.getInt16(pos); pos += 2; return v
+      case 0xd2: v = view.getInt32(pos); pos += 4; return v
+      case 0xd3: v = Number(view.getBigInt64(pos)); pos += 8; return v
+      case 0xd9: return str(bytes[pos++])
+      case 0xda: v = view.getUint16(pos); pos += 2; return str(v)
+      case 0xdb: v = view.getUint32(pos); pos += 4; return str(v)
+      case 0xdc: v = view.getUint16(pos); pos += 2; return array(v)
+      case 0xdd: v = view.getUint32(pos); pos += 4; return array(v)
+      case 0xde: v = view.getUint16(pos); pos += 2; return map(v)
+      case 0xdf: v = view.getUint32(pos); pos += 4; return map(v)
+      default:
+        throw new Error(`Unsupported MessagePack byte 0x${b.toString(16)} at ${pos - 1}`)
+    }
+  }
+
+  return read()
+}
+
+function parseColumnHeader(spec) {
+  return spec.split(',').filter(Boolean).map((entry) => {
+    const [name, type, ...flags] = entry.split(':')
+    return { name, type, delta: flags.includes('d'), hoist: flags.includes('h') }
+  })
+}
+
+function expandChunk(columns, chunk) {
+  const [hoisted, rows] = chunk
+  const previous = {}
+  const out = []
+
+  for (const row of rows) {
+    const obj = {}
+    let i = 0
+    for (const col of columns) {
+      let value
+      if (Object.prototype.hasOwnProperty.call(hoisted, col.name)) {
+        // Sent as the rows would send it, so money is still in centavos
+        value = hoisted[col.name]
+      } else {
+        value = row[i++]
+        if (col.delta && value !== null) {
+          value += previous[col.name] || 0
+          previous[col.name] = value
+        }
+      }
+      if (col.type === 'm' && value !== null) value = Number(value) / 100
+      obj[col.name] = value
+    }
+    out.push(obj)
+  }
+  return out
+}
+
+const isMetaLine = (line) => META_PREFIXES.some((p) => line.startsWith(p))
+
+// Returns the decoded rows, or null when the export was plain JSON.
+export function decodeColumnarExport(lines, label) {
+  const colsPrefix = `${label}_COLS|`
+  const chunkPrefix = `${label}_MP|`
+  let columns = null
+  const payloads = []
+  let current = null
+
+  for (const raw of lines) {
+    const line = String(raw).trim()
+    if (line.startsWith(colsPrefix)) {
+      columns = parseColumnHeader(line.substring(colsPrefix.length))
+      current = null
+      continue
+    }
+    if (line.startsWith(chunkPrefix)) {
+      const parts = line.split('|', 3)
+      current = { index: Number(parts[1]), b64: parts[2] || '' }
+      payloads.push(current)
+      continue
+    }
+    if (isMetaLine(line)) {
+      current = null
+      continue
+    }
+    // Long lines can arrive split by the serial reader; glue the fragments back
+    if (current && line) current.b64 += line
+  }
+
+  if (!columns) return null
+
+  const rows = []
+  payloads.sort((a, b) => a.index - b.index)
+  for (const p of payloads) {
+    rows.push(...expandChunk(columns, decodeMsgPack(decodePayloadBytes(p.b64))))
+  }
+  return rows
+}
+
+// Rewrites compressed <prefix><chunk>|Z:... JSON chunk lines (and their
+// split-off fragments) into plain <prefix><chunk>|<json> lines.
+export function inflateChunkLines(lines, prefix) {
+  const out = []
+  let pending = null
+  const flush = () => {
+    if (!pending) return
+    out.push(`${prefix}${pending.index}|${decodePayloadText(pending.field)}`)
+    pending = null
+  }
+
+  for (const raw of lines) {
+    const line = String(raw).trim()
+    if (line.startsWith(prefix)) {
+      flush()
+      const parts = line.split('|')
+      const field = parts.slice(2).join('|')
+      if (field.startsWith('Z:')) {
+        pending = { index: parts[1], field }
+        continue
+      }
+      out.push(line)
+      continue
+    }
+    if (pending && line && !isMetaLine(line)) {
+      pending.field += line
+      continue
+    }
+    flush()
+    out.push(line)
+  }
+  flush()
+  return out
+}
+
+// Rows of every <prefix><index>|<json array> line; chunks arrive as whole lines
+export function parseJsonChunks(lines, prefix) {
+  const rows = []
+  for (const raw of lines) {
+    const line = String(raw).trim()
+    if (!line.startsWith(prefix)) continue
+    const payload = line.split('|').slice(2).join('|')
+    try {
+      rows.push(...JSON.parse(payload))
+    } catch (e) {
+      console.warn(`Skipping unparsable ${prefix} chunk:`, e)
+    }
+  }
+  return rows
+}
+
+// EXPORT_STATS|LABEL|FORMAT|rows|bytes|ms[|raw_bytes|compress_us]
+export function parseExportStats(lines, label) {
+  const prefix = `EXPORT_STATS|${label}|`
+  const line = lines.find((l) => String(l).startsWith(prefix))
+  if (!line) return null
+  const [, , format, rows, bytes, ms, rawBytes, compressUs] = String(line).trim().split('|')
+  const stats = { format, rows: Number(rows), bytes: Number(bytes), ms: Number(ms) }
+  if (rawBytes !== undefined) {
+    stats.rawBytes = Number(rawBytes)
+    stats.compressUs = Number(compressUs)
+    stats.ratio = stats.bytes > 0 ? stats.rawBytes / stats.bytes : 1
+    stats.compressUsPerKb = stats.rawBytes > 0 ? stats.compressUs / (stats.rawBytes / 1024) : 0
+  }
+  return stats
+}
+
+// WATERMARK|<label>|<max change_seq> follows a delta export; null when the
+// firmware predates change tracking.
+export function parseWatermark(lines, label) {
+  const prefix = `WATERMARK|${label}|`
+  const line = lines.find((l) => String(l).startsWith(prefix))
+  if (!line) return null
+  const value = Number(String(line).trim().substring(prefix.length))
+  return Number.isFinite(value) ? value : null
+}
+
+// ---- Customer roster digest (mirrors managers/sync/customer_digest.h) ----
+
+const FNV64_OFFSET = 0xcbf29ce484222325n
+const FNV64_PRIME = 0x100000001b3n
+const MASK64 = 0xffffffffffffffffn
+
+// FNV-1a 64 over the fields the device hashes, with the defaults it applies
+// when it stores a pushed customer. previous_reading is device-owned and
+// left out.
+export function fnv64(bytes) {
+  let h = FNV64_OFFSET
+  for (const b of bytes) {
+    h = ((h ^ BigInt(b)) * FNV64_PRIME) & MASK64
+  }
+  return h
+}
+
+export function customerDigestHash(customer) {
+  const fields = [
+    customer.account_no ?? '',
+    customer.customer_name ?? '',
+    customer.address ?? '',
+    customer.status ?? 'active',
+    Math.trunc(Number(customer.type_id ?? 1)),
+    Math.trunc(Number(customer.deduction_id || 0)),
+    Math.trunc(Number(customer.brgy_id ?? 1)),
+  ]
+  return fnv64(new TextEncoder().encode(fields.map(String).join('\x1f')))
+}
+
+export function digestHex(hash) {
+  return hash.toString(16).padStart(16, '0')
+}
+
+export const syncCodec = {
+  base64ToBytes,
+  bytesToBase64,
+  decodeMsgPack,
+  lzCompress,
+  lzDecompress,
+  decodePayloadText,
+  encodePayloadText,
+  setCompression,
+  isCompressionEnabled,
+  decodeColumnarExport,
+  inflateChunkLines,
+  parseJsonChunks,
+  parseExportStats,
+  parseWatermark,
+  fnv64,
+  customerDigestHash,
+  digestHex,
+}
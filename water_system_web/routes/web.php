@@ -52,6 +52,8 @@
     Route::post('/bills/sync', [BillController::class, 'sync']);
     Route::post('/bill-transactions/sync', [BillTransactionController::class, 'sync']);
     Route::post('/devices/sync', [DeviceController::class, 'sync']);
+    Route::post('/devices/watermarks', [DeviceController::class, 'watermarks']);
+    Route::post('/devices/id-leases', [DeviceController::class, 'idLeases']);
 
     Route::post('/bills/{bill}/mark-paid', [BillController::class, 'markPaid']);
     Route::post('/bills/{bill}/void', [BillController::class, 'void']);
@@ -0,0 +1,73 @@
+<?php
+
+namespace Tests\Unit;
+
+use App\Models\Bill;
+use PHPUnit\Framework\TestCase;
+
+class BillTotalsTest extends TestCase
+{
+    /**
+     * The golden table the device's bill totals are tested with
+     * (Watersystem_ESP32/database/bill_totals_test.cpp).
+     */
+    private const GOLDEN = __DIR__.'/../../../Watersystem_ESP32/database/bill_totals_golden.txt';
+
+    /**
+     * A device bill keeps its deduction and ends at the device's total once
+     * the penalty is applied, and applying another penalty replaces it.
+     */
+    public function test_penalty_keeps_the_device_total(): void
+    {
+        $lines = file(self::GOLDEN, FILE_IGNORE_NEW_LINES | FILE_SKIP_EMPTY_LINES);
+        $this->assertNotFalse($lines, 'Cannot read '.self::GOLDEN);
+
+        $cases = 0;
+        foreach ($lines as $line) {
+            if (str_starts_with($line, '#')) {
+                continue;
+            }
+            [$charges, , , $deduction, $total, $penalty, $totalWithPenalty] = preg_split('/\s+/', trim($line));
+
+            $bill = new Bill([
+                'charges' => $charges,
+                'penalty' => '0.00',
+                'total_due' => $total,
+            ]);
+
+            $bill->applyPenalty($penalty);
+            $this->assertSame($penalty, $bill->penalty, $line);
+            $this->assertSame($totalWithPenalty, $bill->total_due, $line);
+
+            $bill->applyPenalty(0);
+            $this->assertSame($total, $bill->total_due, $line);
+            $this->assertSame(
+                (int) round((float) $deduction * 100),
+                (int) round((float) $charges * 100) - (int) round((float) $bill->total_due * 100),
+                $line
+            );
+            $cases++;
+        }
+
+        $this->assertGreaterThan(0, $cases);
+    }
+
+    /**
+     * A bill the device penalized keeps its stored penalty at payment; one
+     * without a penalty still gets the settings penalty.
+     */
+    public function test_device_penalty_is_kept(): void
+    {
+        $due = new Bill(['status' => 'Due', 'penalty' => '50.00', 'total_due' => '765.00']);
+        $this->assertTrue($due->penaltyAlreadyApplied());
+
+        $penalized = new Bill(['status' => 'Pending', 'penalty' => '50.00', 'total_due' => '765.00']);
+        $this->assertTrue($penalized->penaltyAlreadyApplied());
+
+        $dueWithoutTypePenalty = new Bill(['status' => 'Due', 'penalty' => '0.00', 'total_due' => '715.00']);
+        $this->assertTrue($dueWithoutTypePenalty->penaltyAlreadyApplied());
+
+        $pending = new Bill(['status' => 'pending', 'penalty' => '0.00', 'total_due' => '715.00']);
+        $this->assertFalse($pending->penaltyAlreadyApplied());
+    }
+}
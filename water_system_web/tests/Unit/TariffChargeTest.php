@@ -0,0 +1,74 @@
+<?php
+
+namespace Tests\Unit;
+
+use App\Models\CustomerType;
+use App\Models\CustomerTypeTier;
+use PHPUnit\Framework\TestCase;
+
+class TariffChargeTest extends TestCase
+{
+    /**
+     * The golden table the device's tariffCharge() is tested with
+     * (Watersystem_ESP32/database/tariff_database_test.cpp).
+     */
+    private const GOLDEN = __DIR__.'/../../../Watersystem_ESP32/database/tariff_golden.txt';
+
+    /**
+     * Every charge in the golden table, from plans built without a database.
+     */
+    public function test_charges_match_the_device_golden_table(): void
+    {
+        $lines = file(self::GOLDEN, FILE_IGNORE_NEW_LINES | FILE_SKIP_EMPTY_LINES);
+        $this->assertNotFalse($lines, 'Cannot read '.self::GOLDEN);
+
+        $plans = [];
+        $cases = 0;
+        foreach ($lines as $line) {
+            if (str_starts_with($line, '#')) {
+                continue;
+            }
+            $words = preg_split('/\s+/', trim($line));
+            if ($words[0] === 'plan') {
+                $plans[(int) $words[1]] = $this->plan(array_slice($words, 1));
+                continue;
+            }
+
+            [$typeId, $usage, $expected] = array_map('intval', $words);
+            $this->assertSame(
+                $expected,
+                $plans[$typeId]->chargeCentavos($usage),
+                "type {$typeId}, usage {$usage} m3"
+            );
+            $cases++;
+        }
+
+        $this->assertGreaterThan(0, $cases);
+    }
+
+    /**
+     * A customer type with its tiers loaded from one "plan" line.
+     */
+    private function plan(array $words): CustomerType
+    {
+        [$typeId, $minM3, $minCharge, $rate] = $words;
+        $type = new CustomerType([
+            'min_m3' => (int) $minM3,
+            'min_charge' => $minCharge,
+            'rate_per_m3' => $rate,
+        ]);
+        $type->type_id = (int) $typeId;
+
+        $tiers = collect(array_slice($words, 4))->map(function (string $tier) use ($typeId) {
+            [$from, $tierRate] = explode(':', $tier);
+
+            return new CustomerTypeTier([
+                'type_id' => (int) $typeId,
+                'from_m3' => (int) $from,
+                'rate_per_m3' => $tierRate,
+            ]);
+        })->sortBy('from_m3')->values();
+
+        return $type->setRelation('tiers', $tiers);
+    }
+}